@@ -0,0 +1,269 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+alloc_map.cpp -- Sharded open-addressing allocation map
+\*****************************************************************************/
+#include "alloc_map.h"
+
+#include "platform.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		std::atomic<bool> g_tracking(false);
+		std::atomic<bool> g_trackStacks(false);
+	}
+}
+
+namespace {
+	using LIBNEWNAMESPACE::detail::AllocRecord;
+	using LIBNEWNAMESPACE::detail::g_tracking;
+	using LIBNEWNAMESPACE::detail::g_trackStacks;
+	using LIBNEWNAMESPACE::detail::k_stackFrames;
+	using LIBNEWNAMESPACE::detail::intern_stack;
+	using LIBNEWNAMESPACE::detail::rw_lock;
+
+	const unsigned k_shardBits = 6;
+	const size_t k_shards = size_t(1) << k_shardBits;
+	const size_t k_initialSlots = 256;
+
+	// One cache line per shard so neighbouring locks do not share a line.
+	// An empty slot has a null address.
+	struct AllocShard
+	{
+		rw_lock lock;
+		AllocRecord* table;
+		size_t mask;
+		size_t count;
+		char pad[64 - sizeof(rw_lock) - sizeof(AllocRecord*) - 2 * sizeof(size_t)];
+	};
+
+	// Locks are unlocked when zero, so static zero-initialization suffices
+	AllocShard s_shards[k_shards];
+	std::atomic<uint64_t> s_sequence(0);
+
+	const unsigned k_skipFrames = 2;        // alloc_map_insert and its caller in libnew.cpp
+
+	// Fibonacci hashing; the top bits pick the shard, the ones below the slot
+	uint64_t pointer_hash(const void* p)
+	{
+		return uint64_t(uintptr_t(p)) * 0x9E3779B97F4A7C15ull;
+	}
+
+	AllocShard& shard_for(uint64_t hash) { return s_shards[hash >> (64 - k_shardBits)]; }
+	size_t home_slot(uint64_t hash, size_t mask) { return size_t(hash >> 20) & mask; }
+
+	struct ExclusiveGuard
+	{
+		explicit ExclusiveGuard(AllocShard& s) : m_shard(s) { lock_exclusive(m_shard.lock); }
+		~ExclusiveGuard() { unlock_exclusive(m_shard.lock); }
+		ExclusiveGuard& operator=(const ExclusiveGuard&) = delete;
+		AllocShard& m_shard;
+	};
+
+	AllocRecord* new_table(size_t slots)
+	{
+		return (AllocRecord*)calloc(slots, sizeof(AllocRecord));
+	}
+
+	void place(AllocRecord* table, size_t mask, const AllocRecord& record)
+	{
+		size_t slot = home_slot(pointer_hash(record.address), mask);
+		while (table[slot].address)
+			slot = (slot + 1) & mask;
+		table[slot] = record;
+	}
+
+	// Doubles the table; keeps the old one if memory is short
+	bool grow(AllocShard& shard)
+	{
+		const size_t slots = shard.table ? (shard.mask + 1) * 2 : k_initialSlots;
+		AllocRecord* table = new_table(slots);
+		if (!table)
+			return shard.table != nullptr && shard.count + 1 < shard.mask + 1;
+		if (shard.table)
+		{
+			for (size_t i = 0; i <= shard.mask; ++i)
+				if (shard.table[i].address)
+					place(table, slots - 1, shard.table[i]);
+			free(shard.table);
+		}
+		shard.table = table;
+		shard.mask = slots - 1;
+		return true;
+	}
+}
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		void alloc_map_begin()
+		{
+			g_tracking.store(true, std::memory_order_release);
+		}
+
+		void alloc_map_end()
+		{
+			// Writers re-check g_tracking under their shard lock, so once every
+			// shard has been emptied under its lock nothing can be re-inserted
+			g_tracking.store(false, std::memory_order_release);
+			for (AllocShard& shard : s_shards)
+			{
+				AllocRecord* table;
+				{
+					ExclusiveGuard guard(shard);
+					table = shard.table;
+					shard.table = nullptr;
+					shard.mask = 0;
+					shard.count = 0;
+				}
+				free(table);
+			}
+		}
+
+		void alloc_map_insert(const AllocRecord& record)
+		{
+			AllocRecord entry = record;
+			entry.stack = nullptr;
+			if (g_trackStacks.load(std::memory_order_relaxed))
+			{
+				void* frames[k_stackFrames];
+				const unsigned depth = capture_stack(k_skipFrames, k_stackFrames, frames);
+				entry.stack = intern_stack(frames, depth);
+			}
+
+			const uint64_t hash = pointer_hash(record.address);
+			AllocShard& shard = shard_for(hash);
+			ExclusiveGuard guard(shard);
+			if (!g_tracking.load(std::memory_order_relaxed))
+				return;
+			// Load at most 3/4 keeps probe runs short
+			if ((!shard.table || (shard.count + 1) * 4 > (shard.mask + 1) * 3) && !grow(shard))
+				return;
+			size_t slot = home_slot(hash, shard.mask);
+			while (shard.table[slot].address && shard.table[slot].address != record.address)
+				slot = (slot + 1) & shard.mask;
+			if (!shard.table[slot].address)
+				++shard.count;
+			entry.sequence = s_sequence.fetch_add(1, std::memory_order_relaxed);
+			shard.table[slot] = entry;
+		}
+
+		bool alloc_map_remove(void* address, AllocRecord* removed)
+		{
+			const uint64_t hash = pointer_hash(address);
+			AllocShard& shard = shard_for(hash);
+			ExclusiveGuard guard(shard);
+			if (!shard.table)
+				return false;
+			size_t slot = home_slot(hash, shard.mask);
+			while (shard.table[slot].address != address)
+			{
+				if (!shard.table[slot].address)
+					return false;
+				slot = (slot + 1) & shard.mask;
+			}
+			*removed = shard.table[slot];
+
+			// Backward-shift deletion: pull later members of the probe run into
+			// the hole so lookups never need tombstones
+			size_t hole = slot;
+			for (size_t next = (hole + 1) & shard.mask; shard.table[next].address; next = (next + 1) & shard.mask)
+			{
+				const size_t home = home_slot(pointer_hash(shard.table[next].address), shard.mask);
+				// Move unless the entry's home lies cyclically in (hole, next]
+				if (((next - home) & shard.mask) >= ((next - hole) & shard.mask))
+				{
+					shard.table[hole] = shard.table[next];
+					hole = next;
+				}
+			}
+			shard.table[hole].address = nullptr;
+			--shard.count;
+			return true;
+		}
+
+		size_t alloc_map_size()
+		{
+			for (AllocShard& shard : s_shards)
+				lock_shared(shard.lock);
+			size_t total = 0;
+			for (AllocShard& shard : s_shards)
+				total += shard.count;
+			for (AllocShard& shard : s_shards)
+				unlock_shared(shard.lock);
+			return total;
+		}
+
+		size_t alloc_map_snapshot(DECL_NAME(AllocInfo)* buffer, size_t count)
+		{
+			// Locks are always taken in shard order, so this cannot deadlock
+			// with another snapshot, and writers hold only one at a time
+			for (AllocShard& shard : s_shards)
+				lock_shared(shard.lock);
+			size_t n = 0;
+			for (size_t s = 0; s < k_shards && n < count; ++s)
+			{
+				const AllocShard& shard = s_shards[s];
+				for (size_t i = 0; shard.table && i <= shard.mask && n < count; ++i)
+				{
+					const AllocRecord& record = shard.table[i];
+					if (!record.address)
+						continue;
+					buffer[n].address = record.address;
+					buffer[n].size = record.size;
+					buffer[n].allocator = record.allocator;
+					buffer[n].deallocator = record.deallocator;
+					++n;
+				}
+			}
+			for (AllocShard& shard : s_shards)
+				unlock_shared(shard.lock);
+			return n;
+		}
+
+		uint64_t alloc_map_sequence()
+		{
+			return s_sequence.load(std::memory_order_relaxed);
+		}
+
+		bool alloc_map_range(uint64_t first, uint64_t last, AllocRecord** records, size_t* count)
+		{
+			for (AllocShard& shard : s_shards)
+				lock_shared(shard.lock);
+			size_t n = 0;
+			for (const AllocShard& shard : s_shards)
+				for (size_t i = 0; shard.table && i <= shard.mask; ++i)
+					if (shard.table[i].address && shard.table[i].sequence >= first && shard.table[i].sequence < last)
+						++n;
+			AllocRecord* copy = n ? (AllocRecord*)malloc(n * sizeof(AllocRecord)) : nullptr;
+			if (copy)
+			{
+				size_t k = 0;
+				for (const AllocShard& shard : s_shards)
+					for (size_t i = 0; shard.table && i <= shard.mask; ++i)
+						if (shard.table[i].address && shard.table[i].sequence >= first && shard.table[i].sequence < last)
+							copy[k++] = shard.table[i];
+			}
+			for (AllocShard& shard : s_shards)
+				unlock_shared(shard.lock);
+			if (n && !copy)
+				return false;
+			*records = copy;
+			*count = n;
+			return true;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+alloc_map.h -- Live allocation map used while BeginTrackAllocs is active
+
+The map is split into shards by pointer hash, each an open-addressed table
+with its own reader/writer lock, so threads allocating at the same time
+rarely meet.  Tables come from the CRT heap, never from libAlloc, so the map
+neither tracks itself nor breaks when SetAllocator swaps allocators.
+
+Every insert takes the next number from one process-wide sequence, so a heap
+snapshot is just the sequence value at the time and the allocations made
+between two snapshots are the records numbered between them.  Call stacks,
+when captured, are interned once and kept for the life of the process.
+\*****************************************************************************/
+#ifndef CODETOOLS_CTMEMORY_ALLOC_MAP_H
+#define CODETOOLS_CTMEMORY_ALLOC_MAP_H
+#pragma once
+
+#include "libnew.h"
+#include "stack_table.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		struct AllocRecord
+		{
+			void* address;
+			size_t size;
+			LIB_ALLOC_FUNC allocator;
+			LIB_FREE_FUNC deallocator;
+			uint64_t sequence;          // set by alloc_map_insert
+			const StackTrace* stack;    // set by alloc_map_insert when capturing
+		};
+
+		extern std::atomic<bool> g_tracking;
+		extern std::atomic<bool> g_trackStacks;
+
+		// Cheap unlocked test for the allocation path
+		inline bool alloc_map_active() { return g_tracking.load(std::memory_order_acquire); }
+
+		void alloc_map_begin();
+		// Drops every record
+		void alloc_map_end();
+
+		// Both are no-ops once tracking has ended.  The insert captures the
+		// stack above its caller when g_trackStacks is set.
+		void alloc_map_insert(const AllocRecord& record);
+		bool alloc_map_remove(void* address, AllocRecord* removed);
+
+		// Number of live records
+		size_t alloc_map_size();
+		// Copies up to count records, all shards locked so the copy is one
+		// point in time; returns the number copied
+		size_t alloc_map_snapshot(DECL_NAME(AllocInfo)* buffer, size_t count);
+
+		// Sequence number the next insert will take
+		uint64_t alloc_map_sequence();
+		// Copies the live records numbered in [first, last) into an array
+		// from malloc, which the caller frees.  False if memory is short.
+		bool alloc_map_range(uint64_t first, uint64_t last, AllocRecord** records, size_t* count);
+	}
+}
+
+#endif // CODETOOLS_CTMEMORY_ALLOC_MAP_H
@@ -0,0 +1,463 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+alloc_trace.cpp -- Allocation trace recording and loading
+
+A thread's buffer is only ever touched by its owner, except when
+EndAllocTrace flushes every buffer; a flag on each buffer, uncontended
+otherwise, keeps the two apart.  Buffers are numbered by session, so events
+a thread adds after a trace has ended are dropped when the next one starts.
+The file is unbuffered, since chunks are large and stdio would otherwise
+allocate its own buffer through the allocator being traced.  A forked child
+stops tracing: it would otherwise write the parent's unflushed events a
+second time and interleave its chunks with the parent's in the same file.
+
+Loading decodes every chunk, sorts the events by time (a thread's events
+keep their recorded order) and numbers the blocks: sorting a second time by
+address pairs each free with the allocation before it.
+\*****************************************************************************/
+#include "alloc_trace.h"
+#include "platform.h"
+#include "thread_blocks.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	using namespace LIBNEWNAMESPACE::detail;
+
+	const char k_magic[8] = { 'c', 't', 'T', 'r', 'a', 'c', 'e', '1' };
+	const size_t k_bufferBytes = 64 * 1024;
+	const size_t k_maxEvent = 1 + 4 * 10;   // op byte and four varints
+
+	enum
+	{
+		op_alloc,
+		op_free,
+		op_alloc_aligned
+	};
+
+	struct TraceBuffer
+	{
+		std::atomic<bool> busy;
+		std::atomic<bool> inUse;
+		TraceBuffer* next;
+		uint32_t thread;
+		unsigned session;
+		int64_t lastTicks;
+		uint64_t lastAddress;
+		size_t used;
+		unsigned char data[k_bufferBytes];
+	};
+
+	thread_block_list<TraceBuffer> s_buffers;
+	std::atomic<uint32_t> s_threads(0);
+
+	// Held while writing a chunk, and by Begin and End
+	rw_lock s_fileLock;
+	FILE* s_file;
+	std::atomic<unsigned> s_session(0);
+	bool s_forkHandlers;    // under s_fileLock
+
+	void lock(TraceBuffer* b)
+	{
+		while (b->busy.exchange(true, std::memory_order_acquire))
+			;
+	}
+
+	void unlock(TraceBuffer* b)
+	{
+		b->busy.store(false, std::memory_order_release);
+	}
+
+	void put_u32(unsigned char* p, uint32_t v)
+	{
+		for (int i = 0; i < 4; ++i)
+			p[i] = (unsigned char)(v >> (8 * i));
+	}
+
+	uint32_t get_u32(const unsigned char* p)
+	{
+		uint32_t v = 0;
+		for (int i = 0; i < 4; ++i)
+			v |= uint32_t(p[i]) << (8 * i);
+		return v;
+	}
+
+	unsigned char* put_varint(unsigned char* p, uint64_t v)
+	{
+		while (v >= 0x80)
+		{
+			*p++ = (unsigned char)(v | 0x80);
+			v >>= 7;
+		}
+		*p++ = (unsigned char)v;
+		return p;
+	}
+
+	// False when the varint runs past end
+	bool get_varint(const unsigned char*& p, const unsigned char* end, uint64_t& v)
+	{
+		v = 0;
+		for (unsigned shift = 0; p < end && shift < 64; shift += 7)
+		{
+			const unsigned char byte = *p++;
+			v |= uint64_t(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	// Writes out the buffer as a chunk if it belongs to the open trace, and
+	// empties it either way.  The caller holds the buffer.
+	void flush(TraceBuffer* b)
+	{
+		if (b->used)
+		{
+			unsigned char header[8];
+			put_u32(header, b->thread);
+			put_u32(header + 4, uint32_t(b->used));
+			lock_exclusive(s_fileLock);
+			if (s_file && b->session == s_session.load(std::memory_order_relaxed))
+			{
+				fwrite(header, 1, sizeof(header), s_file);
+				fwrite(b->data, 1, b->used, s_file);
+			}
+			unlock_exclusive(s_fileLock);
+		}
+		b->used = 0;
+		b->lastTicks = 0;
+		b->lastAddress = 0;
+	}
+
+	TraceBuffer* new_buffer()
+	{
+		void* block = malloc(sizeof(TraceBuffer));
+		if (!block)
+			return nullptr;
+		TraceBuffer* b = new (block) TraceBuffer;
+		b->busy.store(false, std::memory_order_relaxed);
+		b->thread = s_threads.fetch_add(1, std::memory_order_relaxed);
+		b->session = 0;
+		b->used = 0;
+		return b;
+	}
+
+	// A thread's last events go out as it exits
+	void retire_buffer(TraceBuffer* b)
+	{
+		lock(b);
+		flush(b);
+		unlock(b);
+	}
+	thread_local thread_block_owner<TraceBuffer, retire_buffer> t_trace = { nullptr };
+
+	void record(unsigned op, void* address, size_t size, size_t alignment)
+	{
+		TraceBuffer* b = t_trace.block;
+		if (!b && !(b = t_trace.block = s_buffers.acquire(new_buffer)))
+			return;
+		const int64_t ticks = now_ticks();
+		lock(b);
+		const unsigned session = s_session.load(std::memory_order_relaxed);
+		if (b->session != session)
+		{
+			// Left over from an earlier trace
+			b->session = session;
+			b->used = 0;
+			b->lastTicks = 0;
+			b->lastAddress = 0;
+		}
+		else if (b->used > k_bufferBytes - k_maxEvent)
+			flush(b);
+
+		unsigned char* p = b->data + b->used;
+		*p++ = (unsigned char)op;
+		p = put_varint(p, ticks > b->lastTicks ? uint64_t(ticks - b->lastTicks) : 0);
+		const int64_t delta = int64_t(uint64_t(uintptr_t(address)) - b->lastAddress);
+		p = put_varint(p, (uint64_t(delta) << 1) ^ uint64_t(delta >> 63));
+		p = put_varint(p, size);
+		if (op == op_alloc_aligned)
+			p = put_varint(p, alignment);
+		b->used = size_t(p - b->data);
+		if (ticks > b->lastTicks)
+			b->lastTicks = ticks;
+		b->lastAddress = uint64_t(uintptr_t(address));
+		unlock(b);
+	}
+
+#ifndef _WIN32
+	void fork_prepare() { lock_exclusive(s_fileLock); }
+	void fork_parent() { unlock_exclusive(s_fileLock); }
+
+	// Only the forking thread survives.  Other threads' buffers are freed
+	// for reuse, even mid-record, and the session moves on so nothing
+	// buffered before the fork is written.  The FILE is left alone, since
+	// fclose would free through the allocator; only its descriptor closes.
+	void fork_child()
+	{
+		g_tracing.store(false, std::memory_order_relaxed);
+		s_session.fetch_add(1, std::memory_order_relaxed);
+		if (s_file)
+		{
+			close(fileno(s_file));
+			s_file = nullptr;
+		}
+		for (TraceBuffer* b = s_buffers.first(); b; b = b->next)
+		{
+			b->busy.store(false, std::memory_order_relaxed);
+			if (b != t_trace.block)
+				b->inUse.store(false, std::memory_order_relaxed);
+		}
+		unlock_exclusive(s_fileLock);
+	}
+#endif
+
+	struct RawEvent
+	{
+		int64_t ticks;
+		uint64_t address;
+		uint64_t order;     // position in the file
+		uint64_t size;
+		uint64_t alignment;
+		uint32_t thread;
+		uint32_t op;
+	};
+
+	int by_time(const void* a, const void* b)
+	{
+		const RawEvent* x = (const RawEvent*)a;
+		const RawEvent* y = (const RawEvent*)b;
+		if (x->ticks != y->ticks)
+			return x->ticks < y->ticks ? -1 : 1;
+		return x->order < y->order ? -1 : x->order > y->order ? 1 : 0;
+	}
+
+	// order holds the time position by the time this is used
+	int by_address(const void* a, const void* b)
+	{
+		const RawEvent* x = (const RawEvent*)a;
+		const RawEvent* y = (const RawEvent*)b;
+		if (x->address != y->address)
+			return x->address < y->address ? -1 : 1;
+		return x->order < y->order ? -1 : x->order > y->order ? 1 : 0;
+	}
+
+	// Appends a chunk's events to events, growing it as needed
+	bool decode(const unsigned char* p, const unsigned char* end, uint32_t thread,
+		RawEvent*& events, size_t& count, size_t& capacity)
+	{
+		int64_t ticks = 0;
+		uint64_t address = 0;
+		while (p < end)
+		{
+			if (count == capacity)
+			{
+				const size_t grown = capacity ? capacity * 2 : 4096;
+				RawEvent* more = (RawEvent*)realloc(events, grown * sizeof(RawEvent));
+				if (!more)
+					return false;
+				events = more;
+				capacity = grown;
+			}
+			RawEvent& e = events[count];
+			uint64_t tickDelta, zigzag;
+			e.op = *p++;
+			if (e.op > op_alloc_aligned || !get_varint(p, end, tickDelta) || !get_varint(p, end, zigzag) || !get_varint(p, end, e.size))
+				return false;
+			e.alignment = 0;
+			if (e.op == op_alloc_aligned && !get_varint(p, end, e.alignment))
+				return false;
+			ticks += int64_t(tickDelta);
+			address += (zigzag >> 1) ^ (0 - (zigzag & 1));
+			e.ticks = ticks;
+			e.address = address;
+			e.order = count;
+			e.thread = thread;
+			++count;
+		}
+		return true;
+	}
+
+	bool read_events(FILE* in, int64_t& frequency, RawEvent*& events, size_t& count)
+	{
+		unsigned char header[16];
+		if (fread(header, 1, sizeof(header), in) != sizeof(header) || memcmp(header, k_magic, sizeof(k_magic)))
+			return false;
+		frequency = int64_t(uint64_t(get_u32(header + 8)) | uint64_t(get_u32(header + 12)) << 32);
+
+		unsigned char* chunk = (unsigned char*)malloc(k_bufferBytes);
+		if (!chunk)
+			return false;
+		size_t capacity = 0;
+		bool ok = true;
+		unsigned char chunkHeader[8];
+		while (ok && fread(chunkHeader, 1, sizeof(chunkHeader), in) == sizeof(chunkHeader))
+		{
+			const size_t bytes = get_u32(chunkHeader + 4);
+			ok = bytes <= k_bufferBytes && fread(chunk, 1, bytes, in) == bytes &&
+				decode(chunk, chunk + bytes, get_u32(chunkHeader), events, count, capacity);
+		}
+		free(chunk);
+		return ok;
+	}
+}
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		std::atomic<bool> g_tracing(false);
+
+		void trace_alloc(void* address, size_t size, size_t alignment)
+		{
+			record(alignment ? op_alloc_aligned : op_alloc, address, size, alignment);
+		}
+
+		void trace_free(void* address, size_t size)
+		{
+			record(op_free, address, size, 0);
+		}
+	}
+}
+
+DECL_EXPORT_C(int, BeginAllocTrace)(const char* path)
+{
+	if (!path)
+		return 0;
+	FILE* out;
+#ifdef _MSC_VER
+	if (fopen_s(&out, path, "wb"))
+		out = nullptr;
+#else
+	out = fopen(path, "wb");
+#endif
+	if (!out)
+		return 0;
+	setvbuf(out, nullptr, _IONBF, 0);
+	unsigned char header[16];
+	memcpy(header, k_magic, sizeof(k_magic));
+	const uint64_t frequency = uint64_t(tick_frequency());
+	put_u32(header + 8, uint32_t(frequency));
+	put_u32(header + 12, uint32_t(frequency >> 32));
+	if (fwrite(header, 1, sizeof(header), out) != sizeof(header))
+	{
+		fclose(out);
+		return 0;
+	}
+
+	DECL_NAME(EndAllocTrace)();
+	lock_exclusive(s_fileLock);
+#ifndef _WIN32
+	if (!s_forkHandlers)
+		s_forkHandlers = pthread_atfork(fork_prepare, fork_parent, fork_child) == 0;
+#endif
+	s_file = out;
+	s_session.fetch_add(1, std::memory_order_relaxed);
+	unlock_exclusive(s_fileLock);
+	g_tracing.store(true, std::memory_order_release);
+	return 1;
+}
+
+DECL_EXPORT_C(void, EndAllocTrace)()
+{
+	g_tracing.store(false, std::memory_order_release);
+	for (TraceBuffer* b = s_buffers.first(); b; b = b->next)
+	{
+		lock(b);
+		flush(b);
+		unlock(b);
+	}
+	lock_exclusive(s_fileLock);
+	FILE* out = s_file;
+	s_file = nullptr;
+	unlock_exclusive(s_fileLock);
+	if (out)
+		fclose(out);
+}
+
+DECL_EXPORT_C(DECL_NAME(AllocTrace)*, LoadAllocTrace)(const char* path)
+{
+	if (!path)
+		return nullptr;
+	FILE* in;
+#ifdef _MSC_VER
+	if (fopen_s(&in, path, "rb"))
+		in = nullptr;
+#else
+	in = fopen(path, "rb");
+#endif
+	if (!in)
+		return nullptr;
+	int64_t frequency = 0;
+	RawEvent* events = nullptr;
+	size_t count = 0;
+	const bool ok = read_events(in, frequency, events, count);
+	fclose(in);
+	DECL_NAME(AllocTrace)* trace = ok ? (DECL_NAME(AllocTrace)*)malloc(sizeof(DECL_NAME(AllocTrace)) + count * sizeof(DECL_NAME(TraceEvent))) : nullptr;
+	if (!trace)
+	{
+		free(events);
+		return nullptr;
+	}
+
+	sort_items(events, count, sizeof(RawEvent), by_time);
+	trace->tickFrequency = frequency;
+	trace->count = count;
+	trace->blocks = 0;
+	trace->threads = 0;
+	trace->events = (DECL_NAME(TraceEvent)*)(trace + 1);
+	const int64_t start = count ? events[0].ticks : 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		DECL_NAME(TraceEvent)& e = trace->events[i];
+		e.ticks = events[i].ticks - start;
+		e.block = LIBNEW_TRACE_UNKNOWN;
+		e.size = size_t(events[i].size);
+		e.alignment = size_t(events[i].alignment);
+		e.thread = events[i].thread;
+		e.op = events[i].op == op_free ? LIBNEW_TRACE_FREE : LIBNEW_TRACE_ALLOC;
+		if (e.thread >= trace->threads)
+			trace->threads = e.thread + 1;
+		if (e.op == LIBNEW_TRACE_ALLOC)
+			e.block = trace->blocks++;
+		events[i].order = i;
+	}
+
+	// A free belongs to the latest earlier allocation at its address, if
+	// that one is not already freed
+	sort_items(events, count, sizeof(RawEvent), by_address);
+	for (size_t i = 1; i < count; ++i)
+		if (events[i].op == op_free && events[i - 1].op != op_free && events[i].address == events[i - 1].address)
+			trace->events[events[i].order].block = trace->events[events[i - 1].order].block;
+	free(events);
+	return trace;
+}
+
+DECL_EXPORT_C(void, ReleaseAllocTrace)(DECL_NAME(AllocTrace)* trace)
+{
+	free(trace);
+}
+
+namespace LIBNEWNAMESPACE
+{
+	DECL_EXPORT_CPP(int, BeginAllocTrace)(const char* path) { return DECL_NAME(BeginAllocTrace)(path); }
+	DECL_EXPORT_CPP(void, EndAllocTrace)() { DECL_NAME(EndAllocTrace)(); }
+	DECL_EXPORT_CPP(DECL_NAME(AllocTrace)*, LoadAllocTrace)(const char* path) { return DECL_NAME(LoadAllocTrace)(path); }
+	DECL_EXPORT_CPP(void, ReleaseAllocTrace)(DECL_NAME(AllocTrace)* trace) { DECL_NAME(ReleaseAllocTrace)(trace); }
+}
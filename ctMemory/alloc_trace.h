@@ -0,0 +1,51 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+alloc_trace.h -- Allocation trace recording used while BeginAllocTrace is active
+
+Each thread encodes its calls into a private buffer and appends the buffer to
+the trace file as one chunk when it fills, when the thread exits and when
+the trace ends.  The file is a header followed by chunks:
+
+  header   "ctTrace1", then the tick frequency as a little-endian int64
+  chunk    thread id and payload length (uint32 each), then the events
+
+An event is an op byte followed by varints: the tick delta from the
+thread's previous event, the zigzagged address delta from its previous
+event, the size, and for aligned allocations the alignment.  Deltas restart
+at zero in every chunk, so chunks decode independently.  A typical event
+takes six to eight bytes.
+\*****************************************************************************/
+#ifndef CODETOOLS_CTMEMORY_ALLOC_TRACE_H
+#define CODETOOLS_CTMEMORY_ALLOC_TRACE_H
+#pragma once
+
+#include "libnew.h"
+
+#include <atomic>
+#include <cstddef>
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		extern std::atomic<bool> g_tracing;
+
+		inline bool trace_active() { return g_tracing.load(std::memory_order_relaxed); }
+
+		// alignment 0 for a plain allocation
+		void trace_alloc(void* address, size_t size, size_t alignment);
+		// Must run before the memory is freed, so the event is ordered ahead
+		// of another thread's allocation of the same address
+		void trace_free(void* address, size_t size);
+	}
+}
+
+#endif // CODETOOLS_CTMEMORY_ALLOC_TRACE_H
@@ -0,0 +1,200 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+arena.cpp -- Monotonic allocation regions
+
+An arena is a chain of equal-sized blocks walked front to back.  Reset moves
+back to the first block and keeps the chain, so a request that needed three
+blocks last time needs no allocation next time.  Requests too big to share a
+block get one of their own on a separate list, which reset frees.
+
+A huge page arena takes its blocks from HugePageAlloc and counts them in the
+statistics itself, sizing each so header and data fill whole huge pages.
+\*****************************************************************************/
+#include "libnew.h"
+
+namespace {
+	const size_t k_defaultBlock = 64 * 1024;
+	const size_t k_minBlock = 256;
+
+	struct ArenaBlock
+	{
+		ArenaBlock* next;
+		size_t size;          // usable bytes after the header
+
+		char* data() { return (char*)(this + 1); }
+	};
+
+	struct ArenaImpl
+	{
+		DECL_NAME(Arena) pub; // first, so the public pointer is this one
+		ArenaBlock* first;
+		ArenaBlock* current;
+		ArenaBlock* large;
+		size_t blockSize;
+		bool huge;
+	};
+
+	ArenaImpl* impl_of(DECL_NAME(Arena)* arena) { return (ArenaImpl*)arena; }
+
+	ArenaBlock* new_block(size_t size, bool huge)
+	{
+		if (size > ~size_t(0) - sizeof(ArenaBlock))
+			return nullptr;
+		const size_t bytes = sizeof(ArenaBlock) + size;
+		ArenaBlock* block;
+		if (huge)
+		{
+			if ((block = (ArenaBlock*)DECL_NAME(HugePageAlloc)(bytes)) != nullptr)
+				DECL_NAME(CountAlloc)(bytes);
+		}
+		else
+			block = (ArenaBlock*)DECL_NAME(Alloc)(bytes);
+		if (block)
+		{
+			block->next = nullptr;
+			block->size = size;
+		}
+		return block;
+	}
+
+	void free_chain(ArenaBlock* block, bool huge)
+	{
+		while (block)
+		{
+			ArenaBlock* next = block->next;
+			if (huge)
+			{
+				DECL_NAME(CountDealloc)(sizeof(ArenaBlock) + block->size);
+				DECL_NAME(HugePageFree)(block);
+			}
+			else
+				DECL_NAME(Dealloc)(block);
+			block = next;
+		}
+	}
+
+	void enter(ArenaImpl* a, ArenaBlock* block)
+	{
+		a->current = block;
+		a->pub.cursor = block->data();
+		a->pub.limit = block->data() + block->size;
+	}
+
+	void* bump(DECL_NAME(Arena)& arena, size_t size, size_t alignment)
+	{
+		const uintptr_t p = (uintptr_t(arena.cursor) + alignment - 1) & ~uintptr_t(alignment - 1);
+		const uintptr_t limit = uintptr_t(arena.limit);
+		if (p > limit || size > limit - p)
+			return nullptr;
+		arena.cursor = (char*)(p + size);
+		return (void*)p;
+	}
+
+	DECL_NAME(Arena)* create(size_t blockSize, bool huge)
+	{
+		ArenaImpl* a = (ArenaImpl*)DECL_NAME(Alloc)(sizeof(ArenaImpl));
+		if (!a)
+			return nullptr;
+		ArenaBlock* first = new_block(blockSize, huge);
+		if (!first)
+		{
+			DECL_NAME(Dealloc)(a);
+			return nullptr;
+		}
+		a->first = first;
+		a->large = nullptr;
+		a->blockSize = blockSize;
+		a->huge = huge;
+		enter(a, first);
+		return &a->pub;
+	}
+}
+
+DECL_EXPORT_C(DECL_NAME(Arena)*, ArenaCreate)(size_t blockSize)
+{
+	if (!blockSize)
+		blockSize = k_defaultBlock;
+	else if (blockSize < k_minBlock)
+		blockSize = k_minBlock;
+	return create(blockSize, false);
+}
+
+DECL_EXPORT_C(DECL_NAME(Arena)*, ArenaCreateHuge)(size_t blockSize)
+{
+	const size_t huge = DECL_NAME(HugePageSize)();
+	if (blockSize > ~size_t(0) - huge)
+		return nullptr;
+	const size_t pages = (blockSize + sizeof(ArenaBlock) + huge - 1) / huge;
+	return create((pages ? pages : 1) * huge - sizeof(ArenaBlock), true);
+}
+
+DECL_EXPORT_C(void*, ArenaAlloc)(DECL_NAME(Arena)* arena, size_t size, size_t alignment)
+{
+	if (!alignment)
+		alignment = alignof(std::max_align_t);
+	if (!arena || (alignment & (alignment - 1)))
+		return nullptr;
+	if (void* p = bump(*arena, size, alignment))
+		return p;
+
+	ArenaImpl* a = impl_of(arena);
+	if (size > a->blockSize / 4 || alignment > a->blockSize / 4)
+	{
+		// Its own block; the current one keeps its free space
+		if (size > ~size_t(0) - alignment)
+			return nullptr;
+		ArenaBlock* block = new_block(size + alignment - 1, a->huge);
+		if (!block)
+			return nullptr;
+		block->next = a->large;
+		a->large = block;
+		return (void*)((uintptr_t(block->data()) + alignment - 1) & ~uintptr_t(alignment - 1));
+	}
+
+	ArenaBlock* next = a->current->next;
+	if (!next)
+	{
+		if (!(next = new_block(a->blockSize, a->huge)))
+			return nullptr;
+		a->current->next = next;
+	}
+	enter(a, next);
+	return bump(*arena, size, alignment);
+}
+
+DECL_EXPORT_C(void, ArenaReset)(DECL_NAME(Arena)* arena)
+{
+	if (!arena)
+		return;
+	ArenaImpl* a = impl_of(arena);
+	free_chain(a->large, a->huge);
+	a->large = nullptr;
+	enter(a, a->first);
+}
+
+DECL_EXPORT_C(void, ArenaDestroy)(DECL_NAME(Arena)* arena)
+{
+	if (!arena)
+		return;
+	ArenaImpl* a = impl_of(arena);
+	free_chain(a->large, a->huge);
+	free_chain(a->first, a->huge);
+	DECL_NAME(Dealloc)(a);
+}
+
+namespace LIBNEWNAMESPACE
+{
+	DECL_EXPORT_CPP(DECL_NAME(Arena)*, ArenaCreate)(size_t blockSize) { return DECL_NAME(ArenaCreate)(blockSize); }
+	DECL_EXPORT_CPP(DECL_NAME(Arena)*, ArenaCreateHuge)(size_t blockSize) { return DECL_NAME(ArenaCreateHuge)(blockSize); }
+	DECL_EXPORT_CPP(void*, ArenaAlloc)(DECL_NAME(Arena)* arena, size_t size, size_t alignment) { return DECL_NAME(ArenaAlloc)(arena, size, alignment); }
+	DECL_EXPORT_CPP(void, ArenaReset)(DECL_NAME(Arena)* arena) { DECL_NAME(ArenaReset)(arena); }
+	DECL_EXPORT_CPP(void, ArenaDestroy)(DECL_NAME(Arena)* arena) { DECL_NAME(ArenaDestroy)(arena); }
+}
@@ -0,0 +1,331 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+guard_alloc.cpp -- Guard page debug allocator
+
+A guarded block gets a slot of its own: whole pages for the data and one
+page that is never committed.  In overflow mode the guard page follows the
+data and the block ends as close to it as the alignment allows; in underflow
+mode the guard comes first and the block starts on the page after it.  A
+stray access past the block faults at the faulting instruction.  The bytes
+between the block and the slot's edges are filled with a pattern that is
+checked on free, which catches the small overruns alignment leaves room for.
+
+Freed slots are decommitted, so any later access faults too, and queued in
+a quarantine until enough bytes are queued behind them; then their address
+space is reused for a block needing the same number of pages.
+
+All slots come from one reserved range, so a free can tell guarded blocks
+from malloc's with a range check.  Allocations not sampled, and any once the
+range or the system's mapping limit runs out, go to malloc.
+\*****************************************************************************/
+#include "libnew.h"
+#include "os_memory.h"
+
+#include "platform.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+	using namespace LIBNEWNAMESPACE::detail;
+
+	const size_t k_regionBytes = size_t(1) << (sizeof(void*) == 8 ? 36 : 28);   // 64 GB, or 256 MB
+	const size_t k_defaultQuarantine = 64 * 1024 * 1024;
+	const unsigned char k_slackByte = 0xFD;
+	const size_t k_liveBuckets = 4096;
+	const size_t k_freeBuckets = 256;
+
+	struct Slot
+	{
+		char* base;
+		size_t pages;      // including the guard page
+		char* block;
+		size_t size;
+		int mode;
+		Slot* next;        // live table chain, quarantine queue or free list
+	};
+
+	// Everything below is under s_lock
+	rw_lock s_lock;
+	std::atomic<char*> s_region(nullptr);
+	size_t s_used;                  // bytes of the region handed out
+	Slot* s_live[k_liveBuckets];
+	Slot* s_free[k_freeBuckets];
+	Slot* s_quarantineHead;
+	Slot* s_quarantineTail;
+	size_t s_quarantined;           // bytes of slots in quarantine
+	size_t s_liveBlocks;
+	size_t s_guarded;
+
+	std::atomic<int> s_mode(LIBNEW_GUARD_OVERFLOW);
+	std::atomic<size_t> s_alignment(alignof(std::max_align_t));
+	std::atomic<unsigned> s_sampleRate(1);
+	std::atomic<size_t> s_quarantineLimit(k_defaultQuarantine);
+	std::atomic<LIB_GUARD_ERROR_FUNC> s_onError(nullptr);
+
+	// Allocations left before the next guarded one, per thread
+	thread_local unsigned t_countdown;
+	thread_local uint32_t t_rng;
+
+	size_t page_size()
+	{
+		static const size_t size = os_page_size();
+		return size;
+	}
+
+	bool in_region(const void* p)
+	{
+		const char* region = s_region.load(std::memory_order_acquire);
+		return region && (const char*)p >= region && (const char*)p < region + k_regionBytes;
+	}
+
+	size_t live_bucket(const void* p)
+	{
+		return size_t((uint64_t(uintptr_t(p)) * 0x9E3779B97F4A7C15ull) >> 52) % k_liveBuckets;
+	}
+
+	// Uniform over [1, 2 * rate - 1], so one allocation in rate on average
+	bool sample()
+	{
+		const unsigned rate = s_sampleRate.load(std::memory_order_relaxed);
+		if (rate <= 1)
+			return true;
+		if (t_countdown > 1)
+		{
+			--t_countdown;
+			return false;
+		}
+		uint32_t x = t_rng ? t_rng : uint32_t(uintptr_t(&t_rng)) | 1;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		t_rng = x;
+		const bool first = t_countdown == 0;
+		t_countdown = 1 + x % (2 * rate - 1);
+		// A thread's first allocation only draws the countdown, so threads
+		// do not all guard their first block
+		return !first;
+	}
+
+	void report(int error, void* block, size_t size)
+	{
+		LIB_GUARD_ERROR_FUNC onError = s_onError.load(std::memory_order_acquire);
+		if (onError)
+		{
+			onError(error, block, size);
+			return;
+		}
+		if (error == LIBNEW_GUARD_SLACK_DAMAGED)
+			fprintf(stderr, "ctMemory: write outside the guarded block at %p (%zu bytes)\n", block, size);
+		else
+			fprintf(stderr, "ctMemory: free of %p, which is not a live guarded block\n", block);
+		fflush(stderr);
+		abort();
+	}
+
+	// A slot of pages pages, reused or carved from the region; the caller
+	// holds s_lock
+	Slot* take_slot(size_t pages)
+	{
+		for (Slot** link = &s_free[pages % k_freeBuckets]; *link; link = &(*link)->next)
+		{
+			if ((*link)->pages == pages)
+			{
+				Slot* slot = *link;
+				*link = slot->next;
+				return slot;
+			}
+		}
+		char* region = s_region.load(std::memory_order_relaxed);
+		if (!region)
+		{
+			if (!(region = (char*)os_reserve(k_regionBytes, size_t(64) * 1024)))
+				return nullptr;
+			s_region.store(region, std::memory_order_release);
+		}
+		const size_t bytes = pages * page_size();
+		if (bytes > k_regionBytes - s_used)
+			return nullptr;
+		Slot* slot = (Slot*)malloc(sizeof(Slot));
+		if (!slot)
+			return nullptr;
+		slot->base = region + s_used;
+		slot->pages = pages;
+		s_used += bytes;
+		return slot;
+	}
+
+	void give_back(Slot* slot)
+	{
+		Slot*& head = s_free[slot->pages % k_freeBuckets];
+		slot->next = head;
+		head = slot;
+	}
+
+	char* data_of(const Slot* slot)
+	{
+		return slot->mode == LIBNEW_GUARD_UNDERFLOW ? slot->base + page_size() : slot->base;
+	}
+
+	void* guarded_alloc(size_t size)
+	{
+		const size_t page = page_size();
+		const int mode = s_mode.load(std::memory_order_relaxed);
+		size_t alignment = s_alignment.load(std::memory_order_relaxed);
+		if (mode == LIBNEW_GUARD_UNDERFLOW)
+			alignment = 1;
+		if (size > k_regionBytes)
+			return nullptr;
+		const size_t dataPages = (size + alignment - 1 + page - 1) / page;
+		const size_t pages = (dataPages ? dataPages : 1) + 1;
+		const size_t dataBytes = (pages - 1) * page;
+
+		lock_exclusive(s_lock);
+		Slot* slot = take_slot(pages);
+		if (!slot)
+		{
+			unlock_exclusive(s_lock);
+			return nullptr;
+		}
+		slot->mode = mode;
+		char* data = data_of(slot);
+		if (!os_commit(data, dataBytes))
+		{
+			give_back(slot);
+			unlock_exclusive(s_lock);
+			return nullptr;
+		}
+		char* block = mode == LIBNEW_GUARD_UNDERFLOW ? data :
+			(char*)((uintptr_t(data + dataBytes - size)) & ~uintptr_t(alignment - 1));
+		slot->block = block;
+		slot->size = size;
+		Slot*& head = s_live[live_bucket(block)];
+		slot->next = head;
+		head = slot;
+		++s_liveBlocks;
+		++s_guarded;
+		unlock_exclusive(s_lock);
+
+		memset(data, k_slackByte, size_t(block - data));
+		memset(block + size, k_slackByte, size_t(data + dataBytes - (block + size)));
+		return block;
+	}
+
+	bool slack_intact(const Slot* slot)
+	{
+		const char* data = data_of(slot);
+		const char* end = data + (slot->pages - 1) * page_size();
+		for (const char* p = data; p < slot->block; ++p)
+			if ((unsigned char)*p != k_slackByte)
+				return false;
+		for (const char* p = slot->block + slot->size; p < end; ++p)
+			if ((unsigned char)*p != k_slackByte)
+				return false;
+		return true;
+	}
+}
+
+DECL_EXPORT_C(void, SetGuardOptions)(const DECL_NAME(GuardOptions)* pOptions)
+{
+	const DECL_NAME(GuardOptions) defaults = { LIBNEW_GUARD_OVERFLOW, 0, 0, 0, nullptr };
+	if (!pOptions)
+		pOptions = &defaults;
+	size_t alignment = pOptions->alignment ? pOptions->alignment : alignof(std::max_align_t);
+	if ((alignment & (alignment - 1)) || alignment > page_size())
+		alignment = alignof(std::max_align_t);
+	s_mode.store(pOptions->mode == LIBNEW_GUARD_UNDERFLOW ? LIBNEW_GUARD_UNDERFLOW : LIBNEW_GUARD_OVERFLOW, std::memory_order_relaxed);
+	s_alignment.store(alignment, std::memory_order_relaxed);
+	s_sampleRate.store(pOptions->sampleRate, std::memory_order_relaxed);
+	s_quarantineLimit.store(pOptions->quarantineBytes ? pOptions->quarantineBytes : k_defaultQuarantine, std::memory_order_relaxed);
+	s_onError.store(pOptions->onError, std::memory_order_release);
+}
+
+DECL_EXPORT_C(void*, GuardAlloc)(size_t size)
+{
+	if (sample())
+		if (void* p = guarded_alloc(size))
+			return p;
+	return malloc(size);
+}
+
+DECL_EXPORT_C(void, GuardFree)(void* vp)
+{
+	if (!in_region(vp))
+	{
+		free(vp);
+		return;
+	}
+
+	lock_exclusive(s_lock);
+	Slot* slot = nullptr;
+	for (Slot** link = &s_live[live_bucket(vp)]; *link; link = &(*link)->next)
+	{
+		if ((*link)->block == vp)
+		{
+			slot = *link;
+			*link = slot->next;
+			break;
+		}
+	}
+	if (!slot)
+	{
+		unlock_exclusive(s_lock);
+		report(LIBNEW_GUARD_BAD_FREE, vp, 0);
+		return;
+	}
+	--s_liveBlocks;
+	const size_t size = slot->size;
+	const bool intact = slack_intact(slot);
+	os_decommit(data_of(slot), (slot->pages - 1) * page_size());
+
+	slot->next = nullptr;
+	if (s_quarantineTail)
+		s_quarantineTail->next = slot;
+	else
+		s_quarantineHead = slot;
+	s_quarantineTail = slot;
+	s_quarantined += slot->pages * page_size();
+	const size_t limit = s_quarantineLimit.load(std::memory_order_relaxed);
+	while (s_quarantined > limit && s_quarantineHead != slot)
+	{
+		Slot* oldest = s_quarantineHead;
+		s_quarantineHead = oldest->next;
+		s_quarantined -= oldest->pages * page_size();
+		give_back(oldest);
+	}
+	unlock_exclusive(s_lock);
+
+	if (!intact)
+		report(LIBNEW_GUARD_SLACK_DAMAGED, vp, size);
+}
+
+DECL_EXPORT_C(void, GetGuardStatistics)(DECL_NAME(GuardStats)* pStats)
+{
+	if (!pStats)
+		return;
+	lock_shared(s_lock);
+	pStats->guarded = s_guarded;
+	pStats->live = s_liveBlocks;
+	pStats->quarantined = s_quarantined;
+	pStats->reserved = s_used;
+	unlock_shared(s_lock);
+}
+
+namespace LIBNEWNAMESPACE
+{
+	DECL_EXPORT_CPP(void, SetGuardOptions)(const DECL_NAME(GuardOptions)* pOptions) { DECL_NAME(SetGuardOptions)(pOptions); }
+	DECL_EXPORT_CPP(void*, GuardAlloc)(size_t size) { return DECL_NAME(GuardAlloc)(size); }
+	DECL_EXPORT_CPP(void, GuardFree)(void* vp) { DECL_NAME(GuardFree)(vp); }
+	DECL_EXPORT_CPP(void, GetGuardStatistics)(DECL_NAME(GuardStats)* pStats) { DECL_NAME(GetGuardStatistics)(pStats); }
+}
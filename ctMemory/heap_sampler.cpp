@@ -0,0 +1,316 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+heap_sampler.cpp -- Sampling heap profiler
+
+Samples are aggregated per call stack, keyed by the stack's interned copy in
+stack_table, which allocation tracking shares.  Live sampled addresses are kept in
+a chained table; the 8 KB bitmap of non-empty chains stays in cache, and a
+free only takes the lock when its address hashes to a non-empty chain.
+Every structure here comes from the CRT heap, never from libAlloc.
+
+WriteHeapProfile emits the legacy text heap profile that pprof reads
+("heap profile: ... @ heap_v2/<period>"), followed by the loaded modules in
+/proc/self/maps form so pprof can map addresses to binaries (on Linux, the
+file itself).
+\*****************************************************************************/
+#include "heap_sampler.h"
+
+#include "platform.h"
+#include "stack_table.h"
+
+#ifdef _WIN32
+#include <Psapi.h>
+#endif
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		std::atomic<bool> g_sampling(false);
+		std::atomic<uint64_t> g_sampleSlots[(size_t(1) << k_sampleSlotBits) / 64];
+	}
+}
+
+namespace {
+	using LIBNEWNAMESPACE::detail::g_sampling;
+	using LIBNEWNAMESPACE::detail::StackTrace;
+	using LIBNEWNAMESPACE::detail::g_sampleSlots;
+	using LIBNEWNAMESPACE::detail::intern_stack;
+	using LIBNEWNAMESPACE::detail::k_stackFrames;
+	using LIBNEWNAMESPACE::detail::rw_lock;
+	using LIBNEWNAMESPACE::detail::sampler_slot;
+
+	const size_t k_defaultPeriod = 512 * 1024;
+	const unsigned k_skipFrames = 2;        // sampler_record and its caller in libnew.cpp
+	const size_t k_liveSlots = size_t(1) << LIBNEWNAMESPACE::detail::k_sampleSlotBits;
+	const size_t k_stackSlots = 4096;
+
+	struct StackBucket
+	{
+		const StackTrace* stack;
+		size_t allocs;
+		size_t allocBytes;
+		size_t frees;
+		size_t freeBytes;
+		StackBucket* next;
+	};
+
+	struct SampleRecord
+	{
+		void* address;
+		size_t size;
+		StackBucket* bucket;
+		SampleRecord* next;
+	};
+
+	rw_lock s_lock;
+	std::atomic<unsigned> s_generation(0);
+	std::atomic<size_t> s_period(k_defaultPeriod);
+	SampleRecord* s_live[k_liveSlots];
+	StackBucket* s_stacks[k_stackSlots];
+
+	struct ExclusiveGuard
+	{
+		ExclusiveGuard() { lock_exclusive(s_lock); }
+		~ExclusiveGuard() { unlock_exclusive(s_lock); }
+	};
+
+	// Called with the lock held.  Interned stacks are unique, so the pointer
+	// is the key.
+	StackBucket* find_stack(const StackTrace* stack)
+	{
+		StackBucket*& head = s_stacks[size_t((uint64_t(uintptr_t(stack)) * 0x9E3779B97F4A7C15ull) >> 52) % k_stackSlots];
+		for (StackBucket* b = head; b; b = b->next)
+			if (b->stack == stack)
+				return b;
+		StackBucket* b = (StackBucket*)calloc(1, sizeof(StackBucket));
+		if (!b)
+			return nullptr;
+		b->stack = stack;
+		b->next = head;
+		head = b;
+		return b;
+	}
+
+	// Called with the lock held
+	void clear()
+	{
+		for (std::atomic<uint64_t>& bits : g_sampleSlots)
+			bits.store(0, std::memory_order_relaxed);
+		for (SampleRecord*& head : s_live)
+		{
+			while (head)
+			{
+				SampleRecord* next = head->next;
+				free(head);
+				head = next;
+			}
+		}
+		for (StackBucket*& head : s_stacks)
+		{
+			while (head)
+			{
+				StackBucket* next = head->next;
+				free(head);
+				head = next;
+			}
+		}
+	}
+
+#ifdef _WIN32
+	void write_modules(FILE* out)
+	{
+		HMODULE modules[1024];
+		DWORD needed = 0;
+		HANDLE process = GetCurrentProcess();
+		if (!K32EnumProcessModules(process, modules, sizeof(modules), &needed))
+			return;
+		const DWORD count = needed / sizeof(HMODULE) < 1024 ? needed / sizeof(HMODULE) : 1024;
+		for (DWORD i = 0; i < count; ++i)
+		{
+			MODULEINFO info;
+			char path[MAX_PATH];
+			if (!K32GetModuleInformation(process, modules[i], &info, sizeof(info)) ||
+				!K32GetModuleFileNameExA(process, modules[i], path, MAX_PATH))
+				continue;
+			const uintptr_t base = uintptr_t(info.lpBaseOfDll);
+			fprintf(out, "%llx-%llx r-xp 00000000 00:00 0 %s\n",
+				(unsigned long long)base, (unsigned long long)(base + info.SizeOfImage), path);
+		}
+	}
+#else
+	// Already in the form pprof expects, where the system provides it
+	void write_modules(FILE* out)
+	{
+		FILE* maps = fopen("/proc/self/maps", "r");
+		if (!maps)
+			return;
+		char buffer[4096];
+		size_t n;
+		while ((n = fread(buffer, 1, sizeof(buffer), maps)) != 0)
+			fwrite(buffer, 1, n, out);
+		fclose(maps);
+	}
+#endif
+}
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		unsigned sampler_generation()
+		{
+			return s_generation.load(std::memory_order_relaxed);
+		}
+
+		ptrdiff_t sampler_interval(uint64_t& rng)
+		{
+			// xorshift64*; the top 53 bits make a uniform double in (0, 1]
+			rng ^= rng >> 12;
+			rng ^= rng << 25;
+			rng ^= rng >> 27;
+			const double u = double(((rng * 0x2545F4914F6CDD1Dull) >> 11) + 1) / 9007199254740992.0;
+			const double bytes = -std::log(u) * double(s_period.load(std::memory_order_relaxed));
+			return bytes < 1.0 ? 1 : bytes > 1e15 ? ptrdiff_t(1e15) : ptrdiff_t(bytes);
+		}
+
+		void sampler_begin(size_t period)
+		{
+			ExclusiveGuard guard;
+			clear();
+			s_period.store(period ? period : k_defaultPeriod, std::memory_order_relaxed);
+			s_generation.fetch_add(1, std::memory_order_relaxed);
+			g_sampling.store(true, std::memory_order_release);
+		}
+
+		void sampler_end()
+		{
+			// Paths that saw the flag still set re-check it under the lock
+			g_sampling.store(false, std::memory_order_release);
+			ExclusiveGuard guard;
+			clear();
+		}
+
+		void sampler_record(void* address, size_t size)
+		{
+			void* frames[k_stackFrames];
+			const unsigned depth = capture_stack(k_skipFrames, k_stackFrames, frames);
+			const StackTrace* stack = intern_stack(frames, depth);
+			SampleRecord* record = stack ? (SampleRecord*)malloc(sizeof(SampleRecord)) : nullptr;
+			if (!record)
+				return;
+
+			ExclusiveGuard guard;
+			StackBucket* bucket = g_sampling.load(std::memory_order_relaxed) ? find_stack(stack) : nullptr;
+			if (!bucket)
+			{
+				free(record);
+				return;
+			}
+			++bucket->allocs;
+			bucket->allocBytes += size;
+			const size_t slot = sampler_slot(address);
+			record->address = address;
+			record->size = size;
+			record->bucket = bucket;
+			record->next = s_live[slot];
+			s_live[slot] = record;
+			g_sampleSlots[slot / 64].fetch_or(uint64_t(1) << (slot % 64), std::memory_order_relaxed);
+		}
+
+		void sampler_release(void* address)
+		{
+			const size_t slot = sampler_slot(address);
+			SampleRecord* found = nullptr;
+			{
+				ExclusiveGuard guard;
+				SampleRecord* prev = nullptr;
+				for (SampleRecord* r = s_live[slot]; r; prev = r, r = r->next)
+				{
+					if (r->address != address)
+						continue;
+					if (prev)
+						prev->next = r->next;
+					else if (!(s_live[slot] = r->next))
+						g_sampleSlots[slot / 64].fetch_and(~(uint64_t(1) << (slot % 64)), std::memory_order_relaxed);
+					++r->bucket->frees;
+					r->bucket->freeBytes += r->size;
+					found = r;
+					break;
+				}
+			}
+			free(found);
+		}
+	}
+}
+
+DECL_EXPORT_C(void, BeginHeapSampling)(size_t sampleBytes)
+{
+	LIBNEWNAMESPACE::detail::sampler_begin(sampleBytes);
+}
+
+DECL_EXPORT_C(void, EndHeapSampling)()
+{
+	LIBNEWNAMESPACE::detail::sampler_end();
+}
+
+DECL_EXPORT_C(int, WriteHeapProfile)(const char* path)
+{
+	if (!path)
+		return 0;
+	FILE* out = nullptr;
+#ifdef _MSC_VER
+	if (fopen_s(&out, path, "w"))
+		out = nullptr;
+#else
+	out = fopen(path, "w");
+#endif
+	if (!out)
+		return 0;
+
+	{
+		ExclusiveGuard guard;
+		size_t inuse = 0, inuseBytes = 0, allocs = 0, allocBytes = 0;
+		for (StackBucket* head : s_stacks)
+			for (StackBucket* b = head; b; b = b->next)
+			{
+				inuse += b->allocs - b->frees;
+				inuseBytes += b->allocBytes - b->freeBytes;
+				allocs += b->allocs;
+				allocBytes += b->allocBytes;
+			}
+		fprintf(out, "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n", inuse, inuseBytes, allocs, allocBytes,
+			s_period.load(std::memory_order_relaxed));
+		for (StackBucket* head : s_stacks)
+			for (StackBucket* b = head; b; b = b->next)
+			{
+				fprintf(out, "%zu: %zu [%zu: %zu] @", b->allocs - b->frees, b->allocBytes - b->freeBytes, b->allocs, b->allocBytes);
+				for (unsigned i = 0; i < b->stack->depth; ++i)
+					fprintf(out, " 0x%llx", (unsigned long long)uintptr_t(b->stack->frames[i]));
+				fprintf(out, "\n");
+			}
+	}
+	fprintf(out, "\nMAPPED_LIBRARIES:\n");
+	write_modules(out);
+	const bool ok = !ferror(out);
+	return fclose(out) == 0 && ok ? 1 : 0;
+}
+
+namespace LIBNEWNAMESPACE
+{
+	DECL_EXPORT_CPP(void, BeginHeapSampling)(size_t sampleBytes) { DECL_NAME(BeginHeapSampling)(sampleBytes); }
+	DECL_EXPORT_CPP(void, EndHeapSampling)() { DECL_NAME(EndHeapSampling)(); }
+	DECL_EXPORT_CPP(int, WriteHeapProfile)(const char* path) { return DECL_NAME(WriteHeapProfile)(path); }
+}
@@ -0,0 +1,73 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+heap_sampler.h -- Sampling heap profiler used while BeginHeapSampling is active
+
+Each thread counts down the bytes it allocates and samples the allocation
+that crosses zero, then draws the next distance from an exponential
+distribution whose mean is the sampling period.  An allocation of n bytes is
+therefore sampled with probability 1 - exp(-n / period), which is what pprof
+assumes when it scales a heap_v2 profile back up.  The countdown lives with
+the thread's statistics counters in libnew.cpp, so an unsampled allocation
+costs one subtraction.
+\*****************************************************************************/
+#ifndef CODETOOLS_CTMEMORY_HEAP_SAMPLER_H
+#define CODETOOLS_CTMEMORY_HEAP_SAMPLER_H
+#pragma once
+
+#include "libnew.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		extern std::atomic<bool> g_sampling;
+
+		// Live samples are chained by address hash; one bit per chain says
+		// whether it is non-empty, so most frees are cleared without a call
+		const unsigned k_sampleSlotBits = 16;
+		extern std::atomic<uint64_t> g_sampleSlots[(size_t(1) << k_sampleSlotBits) / 64];
+
+		inline bool sampler_active() { return g_sampling.load(std::memory_order_relaxed); }
+
+		inline size_t sampler_slot(const void* p)
+		{
+			return size_t((uint64_t(uintptr_t(p)) * 0x9E3779B97F4A7C15ull) >> (64 - k_sampleSlotBits));
+		}
+
+		inline bool sampler_may_own(const void* p)
+		{
+			const size_t slot = sampler_slot(p);
+			return ((g_sampleSlots[slot / 64].load(std::memory_order_relaxed) >> (slot % 64)) & 1) != 0;
+		}
+
+		// Bumped by every sampler_begin, so countdowns left over from an
+		// earlier session (or another period) are redrawn first
+		unsigned sampler_generation();
+		// Bytes to the next sample
+		ptrdiff_t sampler_interval(uint64_t& rng);
+
+		void sampler_begin(size_t period);
+		// Drops every sample
+		void sampler_end();
+
+		// Records a sampled allocation with the caller's stack
+		void sampler_record(void* address, size_t size);
+		// For addresses sampler_may_own accepts.  Must run before the memory
+		// is freed, so the address cannot be handed out and sampled again in
+		// between.
+		void sampler_release(void* address);
+	}
+}
+
+#endif // CODETOOLS_CTMEMORY_HEAP_SAMPLER_H
@@ -0,0 +1,144 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+heap_snapshot.cpp -- Heap snapshots and diffs over the tracked allocations
+
+A snapshot is the allocation map's sequence number, so taking one copies
+nothing.  A diff copies out the live records numbered between two snapshots,
+sorts them once by size and once by stack to fold them into groups, and
+returns the groups in a single block from the CRT heap.
+\*****************************************************************************/
+#include "alloc_map.h"
+#include "platform.h"
+
+#include <cstdlib>
+
+namespace {
+	using LIBNEWNAMESPACE::detail::AllocRecord;
+	using LIBNEWNAMESPACE::detail::sort_items;
+
+	int by_size(const void* a, const void* b)
+	{
+		const size_t x = ((const AllocRecord*)a)->size, y = ((const AllocRecord*)b)->size;
+		return x < y ? -1 : x > y ? 1 : 0;
+	}
+
+	int by_stack(const void* a, const void* b)
+	{
+		const uintptr_t x = uintptr_t(((const AllocRecord*)a)->stack), y = uintptr_t(((const AllocRecord*)b)->stack);
+		return x < y ? -1 : x > y ? 1 : 0;
+	}
+
+	template <class Group>
+	int by_bytes_descending(const void* a, const void* b)
+	{
+		const size_t x = ((const Group*)a)->bytes, y = ((const Group*)b)->bytes;
+		return x > y ? -1 : x < y ? 1 : 0;
+	}
+}
+
+DECL_EXPORT_C(void, TrackAllocStacks)(int enable)
+{
+	LIBNEWNAMESPACE::detail::g_trackStacks.store(enable != 0, std::memory_order_relaxed);
+}
+
+DECL_EXPORT_C(DECL_NAME(HeapSnapshot), TakeHeapSnapshot)()
+{
+	const DECL_NAME(HeapSnapshot) snapshot = { LIBNEWNAMESPACE::detail::alloc_map_sequence() };
+	return snapshot;
+}
+
+DECL_EXPORT_C(DECL_NAME(HeapDiff)*, DiffHeapSnapshots)(const DECL_NAME(HeapSnapshot)* before, const DECL_NAME(HeapSnapshot)* after)
+{
+	const uint64_t first = before ? before->sequence : 0;
+	const uint64_t last = after ? after->sequence : ~uint64_t(0);
+	AllocRecord* records = nullptr;
+	size_t count = 0;
+	if (!LIBNEWNAMESPACE::detail::alloc_map_range(first, last, &records, &count))
+		return nullptr;
+
+	size_t sizeGroups = 0, stackGroups = 0;
+	sort_items(records, count, sizeof(AllocRecord), by_stack);
+	for (size_t i = 0; i < count; ++i)
+		if (records[i].stack && (!i || records[i].stack != records[i - 1].stack))
+			++stackGroups;
+	sort_items(records, count, sizeof(AllocRecord), by_size);
+	for (size_t i = 0; i < count; ++i)
+		if (!i || records[i].size != records[i - 1].size)
+			++sizeGroups;
+
+	DECL_NAME(HeapDiff)* diff = (DECL_NAME(HeapDiff)*)malloc(sizeof(DECL_NAME(HeapDiff)) +
+		sizeGroups * sizeof(DECL_NAME(HeapSizeGroup)) + stackGroups * sizeof(DECL_NAME(HeapStackGroup)));
+	if (!diff)
+	{
+		free(records);
+		return nullptr;
+	}
+	diff->count = count;
+	diff->bytes = 0;
+	diff->sizeGroups = sizeGroups;
+	diff->bySize = (DECL_NAME(HeapSizeGroup)*)(diff + 1);
+	diff->stackGroups = stackGroups;
+	diff->byStack = (DECL_NAME(HeapStackGroup)*)(diff->bySize + sizeGroups);
+
+	DECL_NAME(HeapSizeGroup)* size = diff->bySize - 1;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!i || records[i].size != records[i - 1].size)
+		{
+			++size;
+			size->size = records[i].size;
+			size->count = 0;
+			size->bytes = 0;
+		}
+		++size->count;
+		size->bytes += records[i].size;
+		diff->bytes += records[i].size;
+	}
+
+	sort_items(records, count, sizeof(AllocRecord), by_stack);
+	DECL_NAME(HeapStackGroup)* stack = diff->byStack - 1;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!records[i].stack)
+			continue;
+		if (!i || records[i].stack != records[i - 1].stack)
+		{
+			++stack;
+			stack->frames = records[i].stack->frames;
+			stack->depth = records[i].stack->depth;
+			stack->count = 0;
+			stack->bytes = 0;
+		}
+		++stack->count;
+		stack->bytes += records[i].size;
+	}
+	free(records);
+
+	sort_items(diff->bySize, sizeGroups, sizeof(DECL_NAME(HeapSizeGroup)), by_bytes_descending<DECL_NAME(HeapSizeGroup)>);
+	sort_items(diff->byStack, stackGroups, sizeof(DECL_NAME(HeapStackGroup)), by_bytes_descending<DECL_NAME(HeapStackGroup)>);
+	return diff;
+}
+
+DECL_EXPORT_C(void, ReleaseHeapDiff)(DECL_NAME(HeapDiff)* diff)
+{
+	free(diff);
+}
+
+namespace LIBNEWNAMESPACE
+{
+	DECL_EXPORT_CPP(void, TrackAllocStacks)(int enable) { DECL_NAME(TrackAllocStacks)(enable); }
+	DECL_EXPORT_CPP(DECL_NAME(HeapSnapshot), TakeHeapSnapshot)() { return DECL_NAME(TakeHeapSnapshot)(); }
+	DECL_EXPORT_CPP(DECL_NAME(HeapDiff)*, DiffHeapSnapshots)(const DECL_NAME(HeapSnapshot)* before, const DECL_NAME(HeapSnapshot)* after)
+	{
+		return DECL_NAME(DiffHeapSnapshots)(before, after);
+	}
+	DECL_EXPORT_CPP(void, ReleaseHeapDiff)(DECL_NAME(HeapDiff)* diff) { DECL_NAME(ReleaseHeapDiff)(diff); }
+}
@@ -0,0 +1,149 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+huge_pages.cpp -- Large allocations on huge pages
+
+Requests of half a huge page or more get a mapping of their own, rounded up
+to whole huge pages and aligned to one, so a pointer-chasing walk over it
+needs one TLB entry per 2 MB instead of one per 4 KB.  Smaller requests would
+waste most of a huge page and go to malloc.
+
+Every mapping starts on a huge page boundary, which malloc's blocks almost
+never do; a free tests the alignment first and only looks up aligned
+pointers in the table of mappings.  Mappings are few and large, so the table
+is a small hash under one lock.
+\*****************************************************************************/
+#include "libnew.h"
+#include "huge_pages.h"
+#include "os_memory.h"
+
+#include "platform.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+namespace {
+	using namespace LIBNEWNAMESPACE::detail;
+
+	struct HugeMapping
+	{
+		void* base;
+		size_t bytes;
+		huge_kind kind;
+		HugeMapping* next;
+	};
+
+	const size_t k_buckets = 256;
+	HugeMapping* s_mappings[k_buckets];
+	rw_lock s_lock;
+
+	// Indexed by huge_kind
+	std::atomic<size_t> s_bytes[3];
+
+	size_t huge_size()
+	{
+		static const size_t size = os_huge_page_size();
+		return size;
+	}
+
+	size_t bucket_of(const void* p)
+	{
+		return size_t((uint64_t(uintptr_t(p)) * 0x9E3779B97F4A7C15ull) >> 56) % k_buckets;
+	}
+}
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		void huge_page_usage(size_t* explicitBytes, size_t* transparentBytes, size_t* fallbackBytes)
+		{
+			*explicitBytes = s_bytes[huge_explicit].load(std::memory_order_relaxed);
+			*transparentBytes = s_bytes[huge_transparent].load(std::memory_order_relaxed);
+			*fallbackBytes = s_bytes[huge_none].load(std::memory_order_relaxed);
+		}
+	}
+}
+
+DECL_EXPORT_C(void*, HugePageAlloc)(size_t size)
+{
+	const size_t huge = huge_size();
+	if (size < huge / 2)
+		return malloc(size);
+	if (size > ~size_t(0) - huge)
+		return nullptr;
+	const size_t bytes = (size + huge - 1) & ~(huge - 1);
+
+	HugeMapping* mapping = (HugeMapping*)malloc(sizeof(HugeMapping));
+	if (!mapping)
+		return nullptr;
+	huge_kind kind = huge_none;
+	void* p = os_map_huge(bytes, &kind);
+	if (!p)
+	{
+		free(mapping);
+		return nullptr;
+	}
+	mapping->base = p;
+	mapping->bytes = bytes;
+	mapping->kind = kind;
+	s_bytes[kind].fetch_add(bytes, std::memory_order_relaxed);
+
+	HugeMapping*& head = s_mappings[bucket_of(p)];
+	lock_exclusive(s_lock);
+	mapping->next = head;
+	head = mapping;
+	unlock_exclusive(s_lock);
+	return p;
+}
+
+DECL_EXPORT_C(void, HugePageFree)(void* vp)
+{
+	if (!vp || (uintptr_t(vp) & (huge_size() - 1)))
+	{
+		free(vp);
+		return;
+	}
+
+	HugeMapping* mapping = nullptr;
+	lock_exclusive(s_lock);
+	for (HugeMapping** link = &s_mappings[bucket_of(vp)]; *link; link = &(*link)->next)
+	{
+		if ((*link)->base == vp)
+		{
+			mapping = *link;
+			*link = mapping->next;
+			break;
+		}
+	}
+	unlock_exclusive(s_lock);
+
+	if (!mapping)
+	{
+		free(vp);
+		return;
+	}
+	s_bytes[mapping->kind].fetch_sub(mapping->bytes, std::memory_order_relaxed);
+	os_release(mapping->base, mapping->bytes);
+	free(mapping);
+}
+
+DECL_EXPORT_C(size_t, HugePageSize)()
+{
+	return huge_size();
+}
+
+namespace LIBNEWNAMESPACE
+{
+	DECL_EXPORT_CPP(void*, HugePageAlloc)(size_t size) { return DECL_NAME(HugePageAlloc)(size); }
+	DECL_EXPORT_CPP(void, HugePageFree)(void* vp) { DECL_NAME(HugePageFree)(vp); }
+	DECL_EXPORT_CPP(size_t, HugePageSize)() { return DECL_NAME(HugePageSize)(); }
+}
@@ -0,0 +1,30 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+huge_pages.h -- Huge page usage, for the statistics in libnew.cpp
+\*****************************************************************************/
+#ifndef CODETOOLS_CTMEMORY_HUGE_PAGES_H
+#define CODETOOLS_CTMEMORY_HUGE_PAGES_H
+#pragma once
+
+#include "libnew.h"
+
+#include <cstddef>
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		// Bytes currently mapped by HugePageAlloc, by what the system gave
+		void huge_page_usage(size_t* explicitBytes, size_t* transparentBytes, size_t* fallbackBytes);
+	}
+}
+
+#endif // CODETOOLS_CTMEMORY_HUGE_PAGES_H
@@ -15,49 +15,40 @@ facilities to all dependencies, allowing an application to redefine how memory
 is allocated and released by dependent libraries.
 \*****************************************************************************/
 #include "libnew.h"
+#include "alloc_map.h"
+#include "alloc_trace.h"
+#include "heap_sampler.h"
+#include "huge_pages.h"
+#include "platform.h"
+#include "thread_blocks.h"
 
-#include <Windows.h>
-#undef max
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 
-#include <map>
+#ifndef _WIN32
+#include <mutex>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 LIB_ALLOC_FUNC libAlloc = malloc;
 LIB_FREE_FUNC  libFree = free;
+LIB_ALIGNED_ALLOC_FUNC libAlignedAlloc = CTMEMORY_ALIGNED_MALLOC;
+LIB_FREE_FUNC  libAlignedFree = CTMEMORY_ALIGNED_FREE;
 
-template <class T>
-struct no_track_allocator {
-	typedef T value_type;
-	no_track_allocator() {}
-	template <class U> no_track_allocator(const no_track_allocator<U>&) {}
-	T* allocate(std::size_t n) {
-		return (T*)libAlloc(sizeof(T) * n);
-	}
-	void deallocate(T* p, std::size_t) { libFree(p); }
-};
-template <class T, class U>
-bool operator==(const no_track_allocator<T>&, const no_track_allocator<U>&) { return true; }
-template <class T, class U>
-bool operator!=(const no_track_allocator<T>&, const no_track_allocator<U>&) { return false; }
-
-struct AllocInfoInt
-{
-	size_t size;
-	LIB_ALLOC_FUNC allocator;
-	LIB_FREE_FUNC deallocator;
-
-	AllocInfoInt(size_t s = 0) :size(s), allocator(libAlloc), deallocator(libFree) {};
-};
-
-typedef void* AllocMapKey;
-typedef no_track_allocator<std::pair<AllocMapKey, AllocInfoInt>> AllocMapAllocator;
-typedef std::map<AllocMapKey, AllocInfoInt, std::less<void*>, AllocMapAllocator> AllocMap;
+using LIBNEWNAMESPACE::detail::AllocRecord;
+using LIBNEWNAMESPACE::detail::now_ticks;
+using LIBNEWNAMESPACE::detail::thread_block_list;
+using LIBNEWNAMESPACE::detail::thread_block_owner;
 
 namespace {
-	AllocMap* pAllocMap = 0;
-	DECL_NAME(MemoryStats) s_statistics;
-
 	struct lnMutex
 	{
+#ifdef _WIN32
 		lnMutex() { m_mutex = CreateMutex(NULL, FALSE, NULL); }
 
 		void acquire() { WaitForSingleObject(m_mutex, INFINITE); }
@@ -65,6 +56,15 @@ namespace {
 
 	private:
 		HANDLE m_mutex;
+#else
+		// std::mutex is constant-initialized, so the lock works even for
+		// allocations made before this file's static initializers run
+		void acquire() { m_mutex.lock(); }
+		void release() { m_mutex.unlock(); }
+
+	private:
+		std::mutex m_mutex;
+#endif
 	} libnewMutex;
 
 	struct libnewMutexGuard {
@@ -72,61 +72,213 @@ namespace {
 		~libnewMutexGuard() { libnewMutex.release(); }
 	};
 
-	template <class T> T max(T a, T b) { return (a > b) ? a : b; }
+	// Tag 0 is the default; the others are registered by MemoryTag and never
+	// removed, so a reader that sees the count sees the names below it
+	const unsigned k_maxTags = 64;
+	std::atomic<const char*> s_tagNames[k_maxTags];
+	std::atomic<unsigned> s_tagCount(1);
+
+	// Statistics are kept per thread so the allocation path takes no lock and
+	// writes no shared cache line.  Only the owning thread writes its
+	// counters (a plain load and store, no interlocked operation) and
+	// GetMemoryStatistics sums every block.  Blocks are reused by later
+	// threads (see thread_blocks.h), and the counts are cumulative so they
+	// stay correct.
+	struct ThreadCounters
+	{
+		std::atomic<size_t> allocated;      // bytes allocated by this thread
+		std::atomic<size_t> deallocated;    // bytes freed by this thread
+		std::atomic<size_t> allocations;    // calls
+		std::atomic<size_t> deallocations;
+		std::atomic<size_t> binCount[LIBNEW_SIZE_BINS];
+		std::atomic<size_t> binBytes[LIBNEW_SIZE_BINS];
+		std::atomic<size_t> tagCount[k_maxTags];
+		std::atomic<size_t> tagBytes[k_maxTags];
+		unsigned tag;                       // current tag of the owning thread
+		ptrdiff_t unpublished;              // net bytes not yet in s_allocated
+		std::atomic<bool> inUse;
+		ThreadCounters* next;
+		// Heap sampling, kept here to share the thread-local lookup
+		ptrdiff_t sampleCountdown;          // bytes until the next sample
+		unsigned sampleGeneration;
+		uint64_t sampleRng;
+	};
+
+	thread_block_list<ThreadCounters> s_counters;
+
+	// The high water mark needs a process-wide running total.  Threads add
+	// their net change to it in steps of k_publishBytes, so the mark can
+	// trail the true peak by at most that much per thread.
+	const ptrdiff_t k_publishBytes = 256 * 1024;
+	std::atomic<ptrdiff_t> s_allocated(0);
+	std::atomic<size_t> s_highWater(0);
+
+	void raise_high_water(size_t allocated)
+	{
+		size_t mark = s_highWater.load(std::memory_order_relaxed);
+		while (allocated > mark && !s_highWater.compare_exchange_weak(mark, allocated, std::memory_order_relaxed))
+			;
+	}
+
+	void publish(ThreadCounters* c)
+	{
+		const ptrdiff_t total = s_allocated.fetch_add(c->unpublished, std::memory_order_relaxed) + c->unpublished;
+		c->unpublished = 0;
+		if (total > 0)
+			raise_high_water(size_t(total));
+	}
+
+	ThreadCounters* new_counters()
+	{
+		// Not from libAlloc: the block outlives any allocator swap
+		void* block = malloc(sizeof(ThreadCounters));
+		return block ? new (block) ThreadCounters() : nullptr;
+	}
+
+	void retire_counters(ThreadCounters* c)
+	{
+		publish(c);
+		c->tag = 0;
+	}
+	thread_local thread_block_owner<ThreadCounters, retire_counters> t_counters = { nullptr };
+
+	ThreadCounters* thread_counters()
+	{
+		ThreadCounters* c = t_counters.block;
+		if (!c)
+			c = t_counters.block = s_counters.acquire(new_counters);
+		return c;
+	}
+
+	// Owner-only update, see ThreadCounters
+	inline void bump(std::atomic<size_t>& counter, size_t n)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	unsigned size_bin(size_t size)
+	{
+		if (size <= 16)
+			return 0;
+#ifdef _MSC_VER
+		unsigned long bit;
+#ifdef _WIN64
+		_BitScanReverse64(&bit, size - 1);
+#else
+		_BitScanReverse(&bit, (unsigned long)(size - 1));
+#endif
+		const unsigned top = unsigned(bit);
+#else
+		const unsigned top = 63 - unsigned(__builtin_clzll((unsigned long long)(size - 1)));
+#endif
+		return top - 3 < LIBNEW_SIZE_BINS - 1 ? top - 3 : LIBNEW_SIZE_BINS - 1;
+	}
+
+	ThreadCounters* count_alloc(size_t size)
+	{
+		ThreadCounters* c = thread_counters();
+		if (!c)
+			return nullptr;
+		const unsigned bin = size_bin(size);
+		bump(c->allocated, size);
+		bump(c->allocations, 1);
+		bump(c->binCount[bin], 1);
+		bump(c->binBytes[bin], size);
+		bump(c->tagCount[c->tag], 1);
+		bump(c->tagBytes[c->tag], size);
+		if ((c->unpublished += ptrdiff_t(size)) > k_publishBytes)
+			publish(c);
+		return c;
+	}
+
+	// Kept out of line so the allocation path stays small
+	void sample_slow(ThreadCounters* c, void* address, size_t size)
+	{
+		const unsigned generation = LIBNEWNAMESPACE::detail::sampler_generation();
+		if (c->sampleGeneration != generation)
+		{
+			// First allocation since sampling (re)started: draw a countdown
+			c->sampleGeneration = generation;
+			if (!c->sampleRng)
+				c->sampleRng = uint64_t(uintptr_t(c)) * 0x9E3779B97F4A7C15ull | 1;
+		}
+		else
+			LIBNEWNAMESPACE::detail::sampler_record(address, size);
+		c->sampleCountdown = LIBNEWNAMESPACE::detail::sampler_interval(c->sampleRng);
+	}
+
+	void count_and_sample(void* address, size_t size)
+	{
+		ThreadCounters* c = count_alloc(size);
+		if (c && LIBNEWNAMESPACE::detail::sampler_active() && (c->sampleCountdown -= ptrdiff_t(size)) < 0)
+			sample_slow(c, address, size);
+	}
+
+	void count_dealloc(size_t size)
+	{
+		ThreadCounters* c = thread_counters();
+		if (!c)
+			return;
+		bump(c->deallocated, size);
+		bump(c->deallocations, 1);
+		if ((c->unpublished -= ptrdiff_t(size)) < -k_publishBytes)
+			publish(c);
+	}
+
+	const int64_t s_loadTicks = now_ticks();
 }
 
 #define THREAD_GUARD libnewMutexGuard _guard
 
 DECL_EXPORT_C(void, BeginTrackAllocs)()
 {
-	THREAD_GUARD;
-	if (!pAllocMap)
-	{
-		pAllocMap = new AllocMap;
-	}
+	LIBNEWNAMESPACE::detail::alloc_map_begin();
 }
 
 DECL_EXPORT_C(void, EndTrackAllocs)()
 {
-	AllocMap* p;
-	{
-		THREAD_GUARD;
-		p = pAllocMap;
-		pAllocMap = 0;
-	}
-	delete p;
+	LIBNEWNAMESPACE::detail::alloc_map_end();
 }
 
 DECL_EXPORT_C(size_t, GetAllocationInfo)(DECL_NAME(AllocInfo)* pBuffer, size_t count)
 {
-	unsigned n = 0;
-	THREAD_GUARD;
-	if (pAllocMap)
-	{
-		if (!pBuffer)
-			return pAllocMap->size();
-		AllocMap::iterator iter = pAllocMap->begin(), e = pAllocMap->end();
-		for (n = 0; n < count && iter != e; ++n, ++iter)
-		{
-			AllocInfoInt& aii = iter->second;;
-			pBuffer[n].address = iter->first;
-			pBuffer[n].size = aii.size;
-			pBuffer[n].allocator = aii.allocator;
-			pBuffer[n].deallocator = aii.deallocator;
-		}
-	}
-	return n;
+	if (!LIBNEWNAMESPACE::detail::alloc_map_active())
+		return 0;
+	if (!pBuffer)
+		return LIBNEWNAMESPACE::detail::alloc_map_size();
+	return LIBNEWNAMESPACE::detail::alloc_map_snapshot(pBuffer, count);
 }
 
 DECL_EXPORT_C(void, GetMemoryStatistics) (DECL_NAME(MemoryStats)* pStats)
 {
 	if (pStats)
 	{
-		THREAD_GUARD;
-		pStats->allocated = s_statistics.allocated;
-		pStats->total_allocations = s_statistics.total_allocations;
-		pStats->total_deallocations = s_statistics.total_deallocations;
-		pStats->high_water_mark = s_statistics.high_water_mark;
+		// Deallocations are read first, so a block allocated and freed during
+		// the read usually has its allocation counted too.  The counters are
+		// relaxed, so nothing guarantees that; 'allocated' is clamped at zero
+		// below instead.
+		size_t deallocated = 0, allocated = 0, deallocations = 0, allocations = 0;
+		ThreadCounters* head = s_counters.first();
+		for (ThreadCounters* c = head; c; c = c->next)
+		{
+			deallocated += c->deallocated.load(std::memory_order_relaxed);
+			deallocations += c->deallocations.load(std::memory_order_relaxed);
+		}
+		for (ThreadCounters* c = head; c; c = c->next)
+		{
+			allocated += c->allocated.load(std::memory_order_relaxed);
+			allocations += c->allocations.load(std::memory_order_relaxed);
+		}
+
+		const size_t current = allocated > deallocated ? allocated - deallocated : 0;
+		raise_high_water(current);
+		pStats->allocated = current;
+		pStats->total_allocations = allocations;
+		pStats->total_deallocations = deallocations;
+		pStats->high_water_mark = s_highWater.load(std::memory_order_relaxed);
+		pStats->bytes_allocated = allocated;
+		pStats->bytes_deallocated = deallocated;
+		LIBNEWNAMESPACE::detail::huge_page_usage(&pStats->huge_page_bytes, &pStats->transparent_huge_bytes, &pStats->huge_fallback_bytes);
 	}
 }
 
@@ -144,41 +296,258 @@ DECL_EXPORT_C(void*, Alloc)(size_t size)
 	void* result = libAlloc(size);
 	if (result)
 	{
-		THREAD_GUARD;
-		if (pAllocMap)
-			(*pAllocMap)[result] = AllocInfoInt(size);
-		s_statistics.allocated += size;
-		s_statistics.total_allocations += size;
-		s_statistics.high_water_mark = max(s_statistics.allocated, s_statistics.high_water_mark);
+		if (LIBNEWNAMESPACE::detail::alloc_map_active())
+		{
+			const AllocRecord record = { result, size, libAlloc, libFree, 0, nullptr };
+			LIBNEWNAMESPACE::detail::alloc_map_insert(record);
+		}
+		count_and_sample(result, size);
+		if (LIBNEWNAMESPACE::detail::trace_active())
+			LIBNEWNAMESPACE::detail::trace_alloc(result, size, 0);
 	}
 	return result;
 }
 
 DECL_EXPORT_C(void, Dealloc)(void* vp)
 {
+	if (!vp)
+		return;
 	LIB_FREE_FUNC freeFunc = libFree;
+	AllocRecord record;
+	size_t size = 0;  // unknown without tracking; the call is still counted
+	if (LIBNEWNAMESPACE::detail::alloc_map_active() && LIBNEWNAMESPACE::detail::alloc_map_remove(vp, &record))
+	{
+		freeFunc = record.deallocator;
+		size = record.size;
+	}
+	count_dealloc(size);
+	if (LIBNEWNAMESPACE::detail::sampler_active() && LIBNEWNAMESPACE::detail::sampler_may_own(vp))
+		LIBNEWNAMESPACE::detail::sampler_release(vp);
+	if (LIBNEWNAMESPACE::detail::trace_active())
+		LIBNEWNAMESPACE::detail::trace_free(vp, size);
+	freeFunc(vp);
+}
+
+DECL_EXPORT_C(void, SetAlignedAllocator)(LIB_ALIGNED_ALLOC_FUNC palloc, LIB_FREE_FUNC pfree)
+{
+	if (!palloc) palloc = CTMEMORY_ALIGNED_MALLOC;
+	if (!pfree) pfree = CTMEMORY_ALIGNED_FREE;
+	THREAD_GUARD;
+	libAlignedAlloc = palloc;
+	libAlignedFree = pfree;
+}
+
+DECL_EXPORT_C(void*, AllocAligned)(size_t size, size_t alignment)
+{
+	if (alignment <= alignof(std::max_align_t))
+		return DECL_NAME(Alloc)(size);
+	void* result = libAlignedAlloc(size, alignment);
+	if (result)
 	{
-		THREAD_GUARD;
-		if (pAllocMap)
+		if (LIBNEWNAMESPACE::detail::alloc_map_active())
 		{
-			AllocMap::iterator iter = pAllocMap->find(vp);
-			if (iter != pAllocMap->end())
-			{
-				size_t size = iter->second.size;
-				freeFunc = iter->second.deallocator;
-				s_statistics.allocated -= size;
-				s_statistics.total_deallocations += size;
-				pAllocMap->erase(iter);
-			}
+			const AllocRecord record = { result, size, nullptr, libAlignedFree, 0, nullptr };
+			LIBNEWNAMESPACE::detail::alloc_map_insert(record);
 		}
+		count_and_sample(result, size);
+		if (LIBNEWNAMESPACE::detail::trace_active())
+			LIBNEWNAMESPACE::detail::trace_alloc(result, size, alignment);
+	}
+	return result;
+}
+
+DECL_EXPORT_C(void, DeallocSized)(void* vp, size_t size)
+{
+	if (!vp)
+		return;
+	if (!size)
+	{
+		DECL_NAME(Dealloc)(vp);
+		return;
+	}
+	LIB_FREE_FUNC freeFunc = libFree;
+	AllocRecord record;
+	// The map is still kept current while tracking, but the statistics no
+	// longer depend on it
+	if (LIBNEWNAMESPACE::detail::alloc_map_active() && LIBNEWNAMESPACE::detail::alloc_map_remove(vp, &record))
+		freeFunc = record.deallocator;
+	count_dealloc(size);
+	if (LIBNEWNAMESPACE::detail::sampler_active() && LIBNEWNAMESPACE::detail::sampler_may_own(vp))
+		LIBNEWNAMESPACE::detail::sampler_release(vp);
+	if (LIBNEWNAMESPACE::detail::trace_active())
+		LIBNEWNAMESPACE::detail::trace_free(vp, size);
+	freeFunc(vp);
+}
+
+DECL_EXPORT_C(void, DeallocAligned)(void* vp, size_t size, size_t alignment)
+{
+	if (alignment <= alignof(std::max_align_t))
+	{
+		DECL_NAME(DeallocSized)(vp, size);
+		return;
 	}
+	if (!vp)
+		return;
+	LIB_FREE_FUNC freeFunc = libAlignedFree;
+	AllocRecord record;
+	if (LIBNEWNAMESPACE::detail::alloc_map_active() && LIBNEWNAMESPACE::detail::alloc_map_remove(vp, &record))
+	{
+		freeFunc = record.deallocator;
+		if (!size)
+			size = record.size;
+	}
+	count_dealloc(size);
+	if (LIBNEWNAMESPACE::detail::sampler_active() && LIBNEWNAMESPACE::detail::sampler_may_own(vp))
+		LIBNEWNAMESPACE::detail::sampler_release(vp);
+	if (LIBNEWNAMESPACE::detail::trace_active())
+		LIBNEWNAMESPACE::detail::trace_free(vp, size);
 	freeFunc(vp);
 }
 
+DECL_EXPORT_C(void, CountAlloc)(size_t size)
+{
+	count_alloc(size);
+}
+
+DECL_EXPORT_C(void, CountDealloc)(size_t size)
+{
+	count_dealloc(size);
+}
+
+DECL_EXPORT_C(void, RecordAlloc)(void* vp, size_t size)
+{
+	if (!vp)
+		return;
+	if (LIBNEWNAMESPACE::detail::alloc_map_active())
+	{
+		const AllocRecord record = { vp, size, nullptr, nullptr, 0, nullptr };
+		LIBNEWNAMESPACE::detail::alloc_map_insert(record);
+	}
+	count_and_sample(vp, size);
+	if (LIBNEWNAMESPACE::detail::trace_active())
+		LIBNEWNAMESPACE::detail::trace_alloc(vp, size, 0);
+}
+
+DECL_EXPORT_C(void, RecordDealloc)(void* vp, size_t size)
+{
+	if (!vp)
+		return;
+	AllocRecord record;
+	if (LIBNEWNAMESPACE::detail::alloc_map_active())
+		LIBNEWNAMESPACE::detail::alloc_map_remove(vp, &record);
+	count_dealloc(size);
+	if (LIBNEWNAMESPACE::detail::sampler_active() && LIBNEWNAMESPACE::detail::sampler_may_own(vp))
+		LIBNEWNAMESPACE::detail::sampler_release(vp);
+	if (LIBNEWNAMESPACE::detail::trace_active())
+		LIBNEWNAMESPACE::detail::trace_free(vp, size);
+}
+
+DECL_EXPORT_C(void, GetSizeHistogram)(DECL_NAME(SizeHistogram)* pHistogram)
+{
+	if (!pHistogram)
+		return;
+	for (unsigned i = 0; i < LIBNEW_SIZE_BINS; ++i)
+	{
+		pHistogram->limit[i] = i < LIBNEW_SIZE_BINS - 1 ? size_t(16) << i : SIZE_MAX;
+		pHistogram->count[i] = 0;
+		pHistogram->bytes[i] = 0;
+	}
+	for (ThreadCounters* c = s_counters.first(); c; c = c->next)
+		for (unsigned i = 0; i < LIBNEW_SIZE_BINS; ++i)
+		{
+			pHistogram->count[i] += c->binCount[i].load(std::memory_order_relaxed);
+			pHistogram->bytes[i] += c->binBytes[i].load(std::memory_order_relaxed);
+		}
+}
+
+DECL_EXPORT_C(void, SampleAllocationRate)(DECL_NAME(RateCounter)* pCounter, DECL_NAME(AllocationRate)* pRate)
+{
+	if (!pCounter)
+		return;
+	DECL_NAME(MemoryStats) stats;
+	DECL_NAME(GetMemoryStatistics)(&stats);
+	const int64_t now = now_ticks();
+	const int64_t since = pCounter->ticks ? pCounter->ticks : s_loadTicks;
+	if (pRate)
+	{
+		const double seconds = double(now - since) / double(LIBNEWNAMESPACE::detail::tick_frequency());
+		const double scale = seconds > 0 ? 1.0 / seconds : 0.0;
+		pRate->seconds = seconds;
+		pRate->allocations_per_second = double(stats.total_allocations - pCounter->allocations) * scale;
+		pRate->deallocations_per_second = double(stats.total_deallocations - pCounter->deallocations) * scale;
+		pRate->bytes_per_second = double(stats.bytes_allocated - pCounter->bytes) * scale;
+	}
+	pCounter->ticks = now;
+	pCounter->allocations = stats.total_allocations;
+	pCounter->deallocations = stats.total_deallocations;
+	pCounter->bytes = stats.bytes_allocated;
+}
+
+DECL_EXPORT_C(unsigned, MemoryTag)(const char* name)
+{
+	if (!name)
+		return 0;
+	unsigned count = s_tagCount.load(std::memory_order_acquire);
+	for (unsigned i = 1; i < count; ++i)
+	{
+		const char* tag = s_tagNames[i].load(std::memory_order_relaxed);
+		if (tag == name || !strcmp(tag, name))
+			return i;
+	}
+
+	THREAD_GUARD;
+	count = s_tagCount.load(std::memory_order_relaxed);
+	for (unsigned i = 1; i < count; ++i)
+		if (!strcmp(s_tagNames[i].load(std::memory_order_relaxed), name))
+			return i;
+	if (count == k_maxTags)
+		return 0;
+	// The caller's string may not outlive the tag; the copy is never freed
+	const size_t length = strlen(name) + 1;
+	char* copy = (char*)malloc(length);
+	if (!copy)
+		return 0;
+	memcpy(copy, name, length);
+	s_tagNames[count].store(copy, std::memory_order_relaxed);
+	s_tagCount.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+DECL_EXPORT_C(unsigned, SetMemoryTag)(unsigned tag)
+{
+	ThreadCounters* c = thread_counters();
+	if (!c)
+		return 0;
+	const unsigned previous = c->tag;
+	c->tag = tag < s_tagCount.load(std::memory_order_relaxed) ? tag : 0;
+	return previous;
+}
+
+DECL_EXPORT_C(size_t, GetTagStatistics)(DECL_NAME(TagStats)* pBuffer, size_t count)
+{
+	const unsigned tags = s_tagCount.load(std::memory_order_acquire);
+	if (!pBuffer)
+		return tags;
+	const size_t written = count < tags ? count : tags;
+	for (size_t i = 0; i < written; ++i)
+	{
+		pBuffer[i].name = i ? s_tagNames[i].load(std::memory_order_relaxed) : "untagged";
+		pBuffer[i].allocations = 0;
+		pBuffer[i].bytes = 0;
+	}
+	for (ThreadCounters* c = s_counters.first(); c; c = c->next)
+		for (size_t i = 0; i < written; ++i)
+		{
+			pBuffer[i].allocations += c->tagCount[i].load(std::memory_order_relaxed);
+			pBuffer[i].bytes += c->tagBytes[i].load(std::memory_order_relaxed);
+		}
+	return written;
+}
+
 namespace LIBNEWNAMESPACE
 {
 	DECL_EXPORT_CPP(void, BeginTrackAllocs)() { DECL_NAME(BeginTrackAllocs)(); }
-	DECL_EXPORT_CPP(void, EndTrackAllocs)() { DECL_NAME(BeginTrackAllocs)(); }
+	DECL_EXPORT_CPP(void, EndTrackAllocs)() { DECL_NAME(EndTrackAllocs)(); }
 	DECL_EXPORT_CPP(size_t, GetAllocationInfo)(DECL_NAME(AllocInfo)* pBuffer, size_t count)
 	{
 		return DECL_NAME(GetAllocationInfo)(pBuffer, count);
@@ -193,9 +562,33 @@ namespace LIBNEWNAMESPACE
 	}
 	DECL_EXPORT_CPP(void*, Alloc)(size_t size) { return DECL_NAME(Alloc)(size); }
 	DECL_EXPORT_CPP(void, Dealloc)(void* vp) { DECL_NAME(Dealloc)(vp); }
+	DECL_EXPORT_CPP(void, SetAlignedAllocator)(LIB_ALIGNED_ALLOC_FUNC alloc, LIB_FREE_FUNC free)
+	{
+		DECL_NAME(SetAlignedAllocator)(alloc, free);
+	}
+	DECL_EXPORT_CPP(void*, AllocAligned)(size_t size, size_t alignment) { return DECL_NAME(AllocAligned)(size, alignment); }
+	DECL_EXPORT_CPP(void, DeallocSized)(void* vp, size_t size) { DECL_NAME(DeallocSized)(vp, size); }
+	DECL_EXPORT_CPP(void, DeallocAligned)(void* vp, size_t size, size_t alignment) { DECL_NAME(DeallocAligned)(vp, size, alignment); }
+	DECL_EXPORT_CPP(void, CountAlloc)(size_t size) { DECL_NAME(CountAlloc)(size); }
+	DECL_EXPORT_CPP(void, CountDealloc)(size_t size) { DECL_NAME(CountDealloc)(size); }
+	DECL_EXPORT_CPP(void, RecordAlloc)(void* vp, size_t size) { DECL_NAME(RecordAlloc)(vp, size); }
+	DECL_EXPORT_CPP(void, RecordDealloc)(void* vp, size_t size) { DECL_NAME(RecordDealloc)(vp, size); }
+	DECL_EXPORT_CPP(void, GetSizeHistogram)(DECL_NAME(SizeHistogram)* pHistogram) { DECL_NAME(GetSizeHistogram)(pHistogram); }
+	DECL_EXPORT_CPP(void, SampleAllocationRate)(DECL_NAME(RateCounter)* pCounter, DECL_NAME(AllocationRate)* pRate)
+	{
+		DECL_NAME(SampleAllocationRate)(pCounter, pRate);
+	}
+	DECL_EXPORT_CPP(unsigned, MemoryTag)(const char* name) { return DECL_NAME(MemoryTag)(name); }
+	DECL_EXPORT_CPP(unsigned, SetMemoryTag)(unsigned tag) { return DECL_NAME(SetMemoryTag)(tag); }
+	DECL_EXPORT_CPP(size_t, GetTagStatistics)(DECL_NAME(TagStats)* pBuffer, size_t count)
+	{
+		return DECL_NAME(GetTagStatistics)(pBuffer, count);
+	}
 }
 
-void* operator new(size_t size) { return LIBNEWNAMESPACE::Alloc(size); }
-void* operator new[](size_t size) { return LIBNEWNAMESPACE::Alloc(size); }
-void operator delete(void* vp) { LIBNEWNAMESPACE::Dealloc(vp); }
-void operator delete[](void* vp) { LIBNEWNAMESPACE::Dealloc(vp); }
+// The library's own operators, as dependent projects get them from ctnew.cpp.
+// The preload build leaves them out: there new reaches the shim's malloc,
+// which already counts it.
+#ifndef CTMEMORY_PRELOAD
+#include "ctnew.h"
+#endif
@@ -0,0 +1,212 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+os_memory.cpp -- Page-level memory from the operating system
+\*****************************************************************************/
+#include "os_memory.h"
+#include "platform.h"
+
+#include <cstdint>
+
+#ifndef _WIN32
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		size_t os_page_size()
+		{
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwPageSize;
+		}
+
+		void* os_reserve(size_t bytes, size_t alignment)
+		{
+			// Reservations are 64 KB aligned already; for more, find a free
+			// range big enough to align and reserve inside it.  Another thread
+			// can take the range in between, hence the retries.
+			for (int attempt = 0; attempt < 8; ++attempt)
+			{
+				void* p = VirtualAlloc(NULL, bytes, MEM_RESERVE, PAGE_NOACCESS);
+				if (!p || (uintptr_t(p) & (alignment - 1)) == 0)
+					return p;
+				VirtualFree(p, 0, MEM_RELEASE);
+				p = VirtualAlloc(NULL, bytes + alignment, MEM_RESERVE, PAGE_NOACCESS);
+				if (!p)
+					return nullptr;
+				const uintptr_t aligned = (uintptr_t(p) + alignment - 1) & ~uintptr_t(alignment - 1);
+				VirtualFree(p, 0, MEM_RELEASE);
+				p = VirtualAlloc((void*)aligned, bytes, MEM_RESERVE, PAGE_NOACCESS);
+				if (p)
+					return p;
+			}
+			return nullptr;
+		}
+
+		void os_release(void* p, size_t)
+		{
+			VirtualFree(p, 0, MEM_RELEASE);
+		}
+
+		bool os_commit(void* p, size_t bytes)
+		{
+			return VirtualAlloc(p, bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+		}
+
+		void os_decommit(void* p, size_t bytes)
+		{
+			VirtualFree(p, bytes, MEM_DECOMMIT);
+		}
+
+		size_t os_huge_page_size()
+		{
+			const size_t size = GetLargePageMinimum();
+			return size ? size : 2 * 1024 * 1024;
+		}
+
+		void* os_map_huge(size_t bytes, huge_kind* kind)
+		{
+			// Large pages need SeLockMemoryPrivilege enabled on the process
+			// token; without it this fails and ordinary pages are used
+			void* p = VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			*kind = huge_explicit;
+			if (p)
+				return p;
+			*kind = huge_none;
+			p = os_reserve(bytes, os_huge_page_size());
+			if (p && !os_commit(p, bytes))
+			{
+				os_release(p, bytes);
+				return nullptr;
+			}
+			return p;
+		}
+	}
+}
+
+#else // _WIN32
+
+#if defined(MADV_HUGEPAGE)
+namespace {
+	// madvise succeeds even when transparent huge pages are switched off,
+	// so ask the kernel whether they are
+	bool read_transparent_setting()
+	{
+		FILE* f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+		if (!f)
+			return false;
+		char line[128] = {};
+		const bool read = fgets(line, sizeof(line), f) != nullptr;
+		fclose(f);
+		return read && !strstr(line, "[never]");
+	}
+
+	bool transparent_huge_pages()
+	{
+		static const bool enabled = read_transparent_setting();
+		return enabled;
+	}
+}
+#endif
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		size_t os_page_size()
+		{
+			return size_t(sysconf(_SC_PAGESIZE));
+		}
+
+		void* os_reserve(size_t bytes, size_t alignment)
+		{
+			// Over-reserve and trim both ends to the aligned range.  Reserved
+			// pages are inaccessible and not charged against overcommit.
+			if (bytes > ~size_t(0) - alignment)
+				return nullptr;
+			void* p = mmap(nullptr, bytes + alignment, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+			if (p == MAP_FAILED)
+				return nullptr;
+			const uintptr_t base = uintptr_t(p);
+			const uintptr_t aligned = (base + alignment - 1) & ~uintptr_t(alignment - 1);
+			if (aligned > base)
+				munmap(p, aligned - base);
+			const size_t tail = base + bytes + alignment - (aligned + bytes);
+			if (tail)
+				munmap((void*)(aligned + bytes), tail);
+			return (void*)aligned;
+		}
+
+		void os_release(void* p, size_t bytes)
+		{
+			munmap(p, bytes);
+		}
+
+		bool os_commit(void* p, size_t bytes)
+		{
+			return mprotect(p, bytes, PROT_READ | PROT_WRITE) == 0;
+		}
+
+		void os_decommit(void* p, size_t bytes)
+		{
+			// Private anonymous pages read back as zeros once dropped
+			madvise(p, bytes, MADV_DONTNEED);
+			mprotect(p, bytes, PROT_NONE);
+		}
+
+		size_t os_huge_page_size()
+		{
+			// The PMD size on x86-64 and 4 KB-granule ARM64; MAP_HUGETLB asks
+			// for it by name, so a 1 GB default pool is never used
+			return 2 * 1024 * 1024;
+		}
+
+		void* os_map_huge(size_t bytes, huge_kind* kind)
+		{
+#if defined(MAP_HUGETLB)
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+			// Fails at once unless the hugetlbfs pool has the pages reserved
+			void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT), -1, 0);
+			if (p != MAP_FAILED)
+			{
+				*kind = huge_explicit;
+				return p;
+			}
+#endif
+			*kind = huge_none;
+			void* q = os_reserve(bytes, os_huge_page_size());
+			if (!q)
+				return nullptr;
+			if (!os_commit(q, bytes))
+			{
+				os_release(q, bytes);
+				return nullptr;
+			}
+#if defined(MADV_HUGEPAGE)
+			if (transparent_huge_pages() && madvise(q, bytes, MADV_HUGEPAGE) == 0)
+				*kind = huge_transparent;
+#endif
+			return q;
+		}
+	}
+}
+
+#endif // _WIN32
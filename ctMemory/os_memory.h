@@ -0,0 +1,61 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+os_memory.h -- Page-level memory from the operating system
+
+Address space is reserved once and committed in pieces, so an allocator can
+own one contiguous range (and test pointers against it) while only paying
+for the pages in use.  None of this goes through libAlloc.
+
+Huge page mappings are the exception: they are committed whole, since
+explicit huge pages cannot be committed piecemeal on either platform.
+\*****************************************************************************/
+#ifndef CODETOOLS_CTMEMORY_OS_MEMORY_H
+#define CODETOOLS_CTMEMORY_OS_MEMORY_H
+#pragma once
+
+#include "libnew.h"
+
+#include <cstddef>
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		size_t os_page_size();
+
+		// Reserves address space aligned to alignment (a power of two no
+		// smaller than the allocation granularity); nullptr on failure
+		void* os_reserve(size_t bytes, size_t alignment);
+		void os_release(void* p, size_t bytes);
+
+		// Makes reserved pages usable, zero filled on first commit
+		bool os_commit(void* p, size_t bytes);
+		// Hands the pages' memory back; the range stays reserved
+		void os_decommit(void* p, size_t bytes);
+
+		enum huge_kind
+		{
+			huge_none,          // fell back to ordinary pages
+			huge_transparent,   // advised; the kernel promotes them as it can
+			huge_explicit       // hugetlbfs, or large pages on Windows
+		};
+
+		// 2 MB, or the large page minimum on Windows
+		size_t os_huge_page_size();
+		// Maps bytes (a multiple of the huge page size) aligned to the huge
+		// page size and committed, preferring explicit huge pages, then
+		// transparent ones, then ordinary pages.  kind says which it got;
+		// nullptr only when there is no memory at all.  Freed by os_release.
+		void* os_map_huge(size_t bytes, huge_kind* kind);
+	}
+}
+
+#endif // CODETOOLS_CTMEMORY_OS_MEMORY_H
@@ -0,0 +1,172 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+platform.cpp -- Out-of-line parts of the operating system layer
+\*****************************************************************************/
+#include "platform.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sched.h>
+#include <time.h>
+#if defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define CTMEMORY_HAS_BACKTRACE 1
+#endif
+#endif
+
+#ifdef _WIN32
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		unsigned capture_stack(unsigned skip, unsigned count, void** frames)
+		{
+			return CaptureStackBackTrace(skip + 1, count, frames, nullptr);
+		}
+	}
+}
+
+#else // _WIN32
+
+namespace {
+	using LIBNEWNAMESPACE::detail::rw_lock;
+	using LIBNEWNAMESPACE::detail::k_rwWaiters;
+	using LIBNEWNAMESPACE::detail::k_rwWriter;
+
+	const int k_spins = 100;
+
+	inline void cpu_relax()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+
+	// Sleeps while the lock still holds state
+	void wait(rw_lock& lock, uint32_t state)
+	{
+#if defined(__linux__)
+		syscall(SYS_futex, (uint32_t*)&lock.state, FUTEX_WAIT_PRIVATE, state, nullptr, nullptr, 0);
+#else
+		(void)lock;
+		(void)state;
+		sched_yield();
+#endif
+	}
+
+	// True once the waiters bit is set in state, false if the lock moved on
+	bool mark_waiting(rw_lock& lock, uint32_t& state)
+	{
+		if (state & k_rwWaiters)
+			return true;
+		if (!lock.state.compare_exchange_weak(state, state | k_rwWaiters, std::memory_order_relaxed))
+			return false;
+		state |= k_rwWaiters;
+		return true;
+	}
+}
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		void rw_lock_exclusive_slow(rw_lock& lock)
+		{
+			for (int spin = 0;; ++spin)
+			{
+				uint32_t state = lock.state.load(std::memory_order_relaxed);
+				if (!(state & ~k_rwWaiters))
+				{
+					// Keeps the waiters bit, so the unlock still wakes them
+					if (lock.state.compare_exchange_weak(state, state | k_rwWriter, std::memory_order_acquire, std::memory_order_relaxed))
+						return;
+					continue;
+				}
+				if (spin < k_spins)
+					cpu_relax();
+				else if (mark_waiting(lock, state))
+					wait(lock, state);
+			}
+		}
+
+		void rw_lock_shared_slow(rw_lock& lock)
+		{
+			for (int spin = 0;; ++spin)
+			{
+				uint32_t state = lock.state.load(std::memory_order_relaxed);
+				if (!(state & k_rwWriter))
+				{
+					if (lock.state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+						return;
+					continue;
+				}
+				if (spin < k_spins)
+					cpu_relax();
+				else if (mark_waiting(lock, state))
+					wait(lock, state);
+			}
+		}
+
+		void rw_wake(rw_lock& lock)
+		{
+#if defined(__linux__)
+			syscall(SYS_futex, (uint32_t*)&lock.state, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+			(void)lock;
+#endif
+		}
+
+		int64_t now_ticks()
+		{
+			timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			return int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+		}
+
+		void* LIBNEWCALL aligned_malloc(size_t size, size_t alignment)
+		{
+			if (alignment < sizeof(void*))
+				alignment = sizeof(void*);
+			void* p = nullptr;
+			return posix_memalign(&p, alignment, size ? size : 1) == 0 ? p : nullptr;
+		}
+
+		__attribute__((noinline)) unsigned capture_stack(unsigned skip, unsigned count, void** frames)
+		{
+#ifdef CTMEMORY_HAS_BACKTRACE
+			void* all[128];
+			const unsigned wanted = skip + 1 + count < 128 ? skip + 1 + count : 128;
+			const int depth = backtrace(all, int(wanted));
+			if (depth <= int(skip + 1))
+				return 0;
+			const unsigned stored = unsigned(depth) - (skip + 1);
+			memcpy(frames, all + skip + 1, stored * sizeof(void*));
+			return stored;
+#else
+			(void)skip;
+			(void)count;
+			(void)frames;
+			return 0;
+#endif
+		}
+	}
+}
+
+#endif // _WIN32
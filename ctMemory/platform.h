@@ -0,0 +1,138 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+platform.h -- Operating system primitives used throughout ctMemory
+
+On Windows these are thin wrappers over SRW locks, CaptureStackBackTrace and
+the performance counter.  Elsewhere the lock is a small futex-backed
+reader/writer lock (spinning then yielding where there is no futex), stacks
+come from backtrace() and time from the monotonic clock.  Every lock is
+unlocked when zero, so static locks need no constructor on either platform.
+\*****************************************************************************/
+#ifndef CODETOOLS_CTMEMORY_PLATFORM_H
+#define CODETOOLS_CTMEMORY_PLATFORM_H
+#pragma once
+
+#include "libnew.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <malloc.h>
+#undef max
+#undef min
+#endif
+
+#ifdef _WIN32
+#define CTMEMORY_ALIGNED_MALLOC _aligned_malloc
+#define CTMEMORY_ALIGNED_FREE   _aligned_free
+#else
+#define CTMEMORY_ALIGNED_MALLOC LIBNEWNAMESPACE::detail::aligned_malloc
+#define CTMEMORY_ALIGNED_FREE   free
+#endif
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+#ifdef _WIN32
+		struct rw_lock
+		{
+			SRWLOCK srw;
+		};
+
+		inline void lock_exclusive(rw_lock& lock) { AcquireSRWLockExclusive(&lock.srw); }
+		inline void unlock_exclusive(rw_lock& lock) { ReleaseSRWLockExclusive(&lock.srw); }
+		inline void lock_shared(rw_lock& lock) { AcquireSRWLockShared(&lock.srw); }
+		inline void unlock_shared(rw_lock& lock) { ReleaseSRWLockShared(&lock.srw); }
+
+		inline int64_t now_ticks()
+		{
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			return now.QuadPart;
+		}
+
+		inline int64_t tick_frequency()
+		{
+			LARGE_INTEGER frequency;
+			QueryPerformanceFrequency(&frequency);
+			return frequency.QuadPart;
+		}
+#else
+		// The low 30 bits count readers.  A waiter sets k_rwWaiters before it
+		// sleeps, and whoever leaves the lock free with the bit set clears it
+		// and wakes everyone.
+		const uint32_t k_rwWriter = 0x80000000u;
+		const uint32_t k_rwWaiters = 0x40000000u;
+
+		struct rw_lock
+		{
+			std::atomic<uint32_t> state;
+		};
+
+		void rw_lock_exclusive_slow(rw_lock& lock);
+		void rw_lock_shared_slow(rw_lock& lock);
+		void rw_wake(rw_lock& lock);
+
+		inline void lock_exclusive(rw_lock& lock)
+		{
+			uint32_t expected = 0;
+			if (!lock.state.compare_exchange_strong(expected, k_rwWriter, std::memory_order_acquire, std::memory_order_relaxed))
+				rw_lock_exclusive_slow(lock);
+		}
+
+		inline void unlock_exclusive(rw_lock& lock)
+		{
+			if (lock.state.exchange(0, std::memory_order_release) & k_rwWaiters)
+				rw_wake(lock);
+		}
+
+		inline void lock_shared(rw_lock& lock)
+		{
+			uint32_t state = lock.state.load(std::memory_order_relaxed);
+			if ((state & (k_rwWriter | k_rwWaiters)) ||
+				!lock.state.compare_exchange_strong(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+				rw_lock_shared_slow(lock);
+		}
+
+		inline void unlock_shared(rw_lock& lock)
+		{
+			uint32_t expected = k_rwWaiters;
+			if (lock.state.fetch_sub(1, std::memory_order_release) - 1 == k_rwWaiters &&
+				lock.state.compare_exchange_strong(expected, 0, std::memory_order_relaxed))
+				rw_wake(lock);
+		}
+
+		int64_t now_ticks();
+		inline int64_t tick_frequency() { return 1000000000; }
+
+		// The default aligned allocator; blocks are released with free
+		void* LIBNEWCALL aligned_malloc(size_t size, size_t alignment);
+#endif
+
+		// Fills frames with return addresses, innermost first, as a call to
+		// CaptureStackBackTrace in place of this one would: skip 0 starts
+		// with the caller's own frame.  Returns the number stored.
+		unsigned capture_stack(unsigned skip, unsigned count, void** frames);
+
+		// qsort, which may not be handed a null array, even an empty one
+		inline void sort_items(void* items, size_t count, size_t size, int (*compare)(const void*, const void*))
+		{
+			if (count > 1)
+				qsort(items, count, size, compare);
+		}
+	}
+}
+
+#endif // CODETOOLS_CTMEMORY_PLATFORM_H
@@ -0,0 +1,242 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+preload.cpp -- LD_PRELOAD shim for profiling unmodified programs (glibc)
+
+Built only into libctMemory_preload.so.  The shim replaces the C allocation
+functions, lets glibc allocate, and reports each block to ctMemory with
+cdtRecordAlloc / cdtRecordDealloc, so statistics, tracking and heap sampling
+all see the program's allocations.  Blocks are counted at their usable size,
+which is what glibc can report again when they are freed.
+
+ctMemory's own bookkeeping allocates too; a per-thread flag sends those
+calls straight to glibc, uncounted.
+
+Child processes inherit LD_PRELOAD and the variables below.  A %p in a file
+name becomes the process id, so each process writes its own file.  A name
+without one is removed from the environment once read, so only the first
+process writes it and its children cannot overwrite it; use %p when a
+launcher such as timeout or a shell starts the program of interest.
+
+Environment:
+  CTMEMORY_STATS=1          print cdtMemoryStats, with the process id, to
+                            stderr at exit
+  CTMEMORY_HEAP_PROFILE=f   sample the heap and write a pprof profile to f
+                            at exit
+  CTMEMORY_SAMPLE_BYTES=n   mean bytes between samples (default 512 KB)
+  CTMEMORY_TRACE=f          record an allocation trace to f, for memReplay;
+                            a process that forks without exec traces only
+                            itself
+\*****************************************************************************/
+#include "libnew.h"
+
+#include <malloc.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+extern "C"
+{
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t count, size_t size);
+	void* __libc_realloc(void* p, size_t size);
+	void* __libc_memalign(size_t alignment, size_t size);
+	void __libc_free(void* p);
+}
+
+namespace {
+	// Initial-exec TLS is set up at load time, so reading it never allocates
+	__thread bool t_busy __attribute__((tls_model("initial-exec")));
+
+	char s_profilePath[4096];
+	// A copy of stderr taken at load, since programs may close theirs on exit
+	int s_statsFd = -1;
+
+	struct BusyScope
+	{
+		BusyScope() { t_busy = true; }
+		~BusyScope() { t_busy = false; }
+	};
+
+	void* record(void* p)
+	{
+		if (p && !t_busy)
+		{
+			BusyScope busy;
+			DECL_NAME(RecordAlloc)(p, malloc_usable_size(p));
+		}
+		return p;
+	}
+
+	void unrecord(void* p)
+	{
+		if (p && !t_busy)
+		{
+			BusyScope busy;
+			DECL_NAME(RecordDealloc)(p, malloc_usable_size(p));
+		}
+	}
+
+	bool power_of_two(size_t n) { return n && !(n & (n - 1)); }
+
+	// Copies the file name in variable to path, each %p replaced by the
+	// process id; a name without %p is taken out of the environment.  False
+	// if the variable is unset or the name does not fit.
+	bool process_path(const char* variable, char* path, size_t size)
+	{
+		const char* pattern = getenv(variable);
+		if (!pattern || !*pattern)
+			return false;
+		char pid[24];
+		const int pidLength = snprintf(pid, sizeof(pid), "%d", int(getpid()));
+		bool perProcess = false;
+		size_t length = 0;
+		for (const char* p = pattern; *p; ++p)
+		{
+			const char* piece = p;
+			size_t pieceLength = 1;
+			if (p[0] == '%' && p[1] == 'p')
+			{
+				piece = pid;
+				pieceLength = size_t(pidLength);
+				perProcess = true;
+				++p;
+			}
+			if (length + pieceLength >= size)
+				return false;
+			memcpy(path + length, piece, pieceLength);
+			length += pieceLength;
+		}
+		path[length] = 0;
+		if (!perProcess)
+			unsetenv(variable);
+		return true;
+	}
+
+	__attribute__((constructor)) void preload_begin()
+	{
+		BusyScope busy;
+		if (process_path("CTMEMORY_HEAP_PROFILE", s_profilePath, sizeof(s_profilePath)))
+		{
+			const char* period = getenv("CTMEMORY_SAMPLE_BYTES");
+			DECL_NAME(BeginHeapSampling)(period ? size_t(strtoull(period, nullptr, 10)) : 0);
+		}
+		char trace[4096];
+		if (process_path("CTMEMORY_TRACE", trace, sizeof(trace)))
+			DECL_NAME(BeginAllocTrace)(trace);
+		const char* stats = getenv("CTMEMORY_STATS");
+		if (stats && *stats && strcmp(stats, "0"))
+			s_statsFd = dup(2);
+	}
+
+	__attribute__((destructor)) void preload_end()
+	{
+		BusyScope busy;
+		DECL_NAME(EndAllocTrace)();
+		char line[512];
+		int length = 0;
+		const int pid = int(getpid());
+		if (*s_profilePath && !DECL_NAME(WriteHeapProfile)(s_profilePath))
+			length = snprintf(line, sizeof(line), "ctMemory (pid %d): could not write %s\n", pid, s_profilePath);
+		if (s_statsFd >= 0)
+		{
+			DECL_NAME(MemoryStats) s;
+			DECL_NAME(GetMemoryStatistics)(&s);
+			if (length < 0 || size_t(length) >= sizeof(line))
+				length = 0;
+			length += snprintf(line + length, sizeof(line) - length,
+				"ctMemory (pid %d): %zu bytes in use, high water %zu; %zu allocations (%zu bytes), %zu frees (%zu bytes)\n",
+				pid, s.allocated, s.high_water_mark, s.total_allocations, s.bytes_allocated, s.total_deallocations, s.bytes_deallocated);
+		}
+		if (length > 0)
+		{
+			const int fd = s_statsFd >= 0 ? s_statsFd : 2;
+			if (write(fd, line, size_t(length) < sizeof(line) ? size_t(length) : sizeof(line) - 1) < 0)
+				return;
+		}
+	}
+}
+
+#pragma GCC visibility push(default)
+extern "C"
+{
+	void* malloc(size_t size) noexcept
+	{
+		return record(__libc_malloc(size));
+	}
+
+	void free(void* p) noexcept
+	{
+		unrecord(p);
+		__libc_free(p);
+	}
+
+	void* calloc(size_t count, size_t size) noexcept
+	{
+		return record(__libc_calloc(count, size));
+	}
+
+	void* realloc(void* p, size_t size) noexcept
+	{
+		// The old block leaves the books first: once realloc frees it, another
+		// thread may be handed the same address
+		const size_t old = p ? malloc_usable_size(p) : 0;
+		unrecord(p);
+		void* q = __libc_realloc(p, size);
+		if (q)
+			return record(q);
+		if (p && size && !t_busy)
+		{
+			// Failed, so the old block is still live
+			BusyScope busy;
+			DECL_NAME(RecordAlloc)(p, old);
+		}
+		return nullptr;
+	}
+
+	void* memalign(size_t alignment, size_t size) noexcept
+	{
+		return record(__libc_memalign(alignment, size));
+	}
+
+	void* aligned_alloc(size_t alignment, size_t size) noexcept
+	{
+		return record(__libc_memalign(alignment, size));
+	}
+
+	int posix_memalign(void** out, size_t alignment, size_t size) noexcept
+	{
+		if (!power_of_two(alignment) || alignment % sizeof(void*))
+			return EINVAL;
+		void* p = __libc_memalign(alignment, size);
+		if (!p)
+			return ENOMEM;
+		*out = record(p);
+		return 0;
+	}
+
+	void* valloc(size_t size) noexcept
+	{
+		return record(__libc_memalign(size_t(sysconf(_SC_PAGESIZE)), size));
+	}
+
+	void* pvalloc(size_t size) noexcept
+	{
+		const size_t page = size_t(sysconf(_SC_PAGESIZE));
+		if (size > ~size_t(0) - page)
+			return nullptr;
+		return record(__libc_memalign(page, (size + page - 1) & ~(page - 1)));
+	}
+}
+#pragma GCC visibility pop
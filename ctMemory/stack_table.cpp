@@ -0,0 +1,90 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+stack_table.cpp -- Interned call stacks
+
+Stacks are chained by hash under one reader/writer lock; a stack seen before
+is found under the shared lock.  Nodes come from the CRT heap and are never
+freed, since a process has only so many distinct allocation sites.
+\*****************************************************************************/
+#include "stack_table.h"
+
+#include "platform.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+	using LIBNEWNAMESPACE::detail::StackTrace;
+	using LIBNEWNAMESPACE::detail::rw_lock;
+
+	const size_t k_stackSlots = 4096;
+
+	struct StackNode
+	{
+		StackTrace trace;
+		uint64_t hash;
+		StackNode* next;
+	};
+
+	rw_lock s_stackLock;
+	StackNode* s_stacks[k_stackSlots];
+
+	// FNV-1a over the return addresses
+	uint64_t stack_hash(void* const* frames, unsigned depth)
+	{
+		uint64_t h = 0xCBF29CE484222325ull;
+		for (unsigned i = 0; i < depth; ++i)
+			h = (h ^ uint64_t(uintptr_t(frames[i]))) * 0x100000001B3ull;
+		return h;
+	}
+
+	// Called with s_stackLock held either way
+	StackNode* find_stack(StackNode* head, uint64_t hash, void* const* frames, unsigned depth)
+	{
+		for (StackNode* n = head; n; n = n->next)
+			if (n->hash == hash && n->trace.depth == depth && !memcmp(n->trace.frames, frames, depth * sizeof(void*)))
+				return n;
+		return nullptr;
+	}
+}
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		const StackTrace* intern_stack(void* const* frames, unsigned depth)
+		{
+			if (depth > k_stackFrames)
+				depth = k_stackFrames;
+			const uint64_t hash = stack_hash(frames, depth);
+			StackNode*& head = s_stacks[hash % k_stackSlots];
+			lock_shared(s_stackLock);
+			StackNode* found = find_stack(head, hash, frames, depth);
+			unlock_shared(s_stackLock);
+			if (found)
+				return &found->trace;
+
+			lock_exclusive(s_stackLock);
+			found = find_stack(head, hash, frames, depth);
+			if (!found && (found = (StackNode*)malloc(sizeof(StackNode))) != nullptr)
+			{
+				found->trace.depth = depth;
+				memcpy(found->trace.frames, frames, depth * sizeof(void*));
+				found->hash = hash;
+				found->next = head;
+				head = found;
+			}
+			unlock_exclusive(s_stackLock);
+			return found ? &found->trace : nullptr;
+		}
+	}
+}
@@ -0,0 +1,42 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+stack_table.h -- Interned call stacks
+
+Allocation tracking and the heap sampler both record call stacks.  Each
+distinct stack is stored once, here, and kept for the life of the process,
+so a pointer to it can stand for the stack: compared, hashed or handed out
+in a heap diff.
+\*****************************************************************************/
+#ifndef CODETOOLS_CTMEMORY_STACK_TABLE_H
+#define CODETOOLS_CTMEMORY_STACK_TABLE_H
+#pragma once
+
+#include "libnew.h"
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		const unsigned k_stackFrames = 32;
+
+		struct StackTrace
+		{
+			unsigned depth;
+			void* frames[k_stackFrames];
+		};
+
+		// The one copy of frames[0, depth), depth <= k_stackFrames; null if
+		// memory is short
+		const StackTrace* intern_stack(void* const* frames, unsigned depth);
+	}
+}
+
+#endif // CODETOOLS_CTMEMORY_STACK_TABLE_H
@@ -0,0 +1,83 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+thread_blocks.h -- Per-thread blocks that outlive their threads
+
+Statistics counters and trace buffers are one block per thread, kept on a
+lock-free list that is never shortened, so a reader can walk every block
+without a lock.  A thread claims a block on first use and releases it as it
+exits; the next new thread takes it over, so the list only grows to the
+peak number of threads.  A block needs 'std::atomic<bool> inUse' and
+'Block* next' members.
+\*****************************************************************************/
+#ifndef CODETOOLS_CTMEMORY_THREAD_BLOCKS_H
+#define CODETOOLS_CTMEMORY_THREAD_BLOCKS_H
+#pragma once
+
+#include "libnew.h"
+
+#include <atomic>
+
+namespace LIBNEWNAMESPACE
+{
+	namespace detail
+	{
+		// Zero-initialized statics are empty lists
+		template <class Block>
+		struct thread_block_list
+		{
+			std::atomic<Block*> head;
+
+			Block* first() const { return head.load(std::memory_order_acquire); }
+
+			// Claims a released block, or pushes a new one from create(),
+			// which returns null if memory is short
+			template <class Create>
+			Block* acquire(Create create)
+			{
+				Block* b;
+				for (b = first(); b; b = b->next)
+				{
+					bool expected = false;
+					if (!b->inUse.load(std::memory_order_relaxed) && b->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+						return b;
+				}
+				if (!(b = create()))
+					return nullptr;
+				b->inUse.store(true, std::memory_order_relaxed);
+				Block* top = head.load(std::memory_order_relaxed);
+				do
+					b->next = top;
+				while (!head.compare_exchange_weak(top, b, std::memory_order_release, std::memory_order_relaxed));
+				return b;
+			}
+		};
+
+		// The thread's claim on a block.  As the thread exits, retire(block)
+		// runs and the block is released for the next thread.
+		template <class Block, void (*Retire)(Block*)>
+		struct thread_block_owner
+		{
+			Block* block;
+
+			~thread_block_owner()
+			{
+				if (block)
+				{
+					Retire(block);
+					block->inUse.store(false, std::memory_order_release);
+					block = nullptr;
+				}
+			}
+		};
+	}
+}
+
+#endif // CODETOOLS_CTMEMORY_THREAD_BLOCKS_H
@@ -0,0 +1,381 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+thread_cache.cpp -- Size-class allocator with per-thread caches
+
+Requests up to 4 KB are rounded to one of 32 size classes (16 byte steps to
+256, then four steps per power of two).  Each class is carved from 64 KB
+spans, all inside one reserved address range so a free can tell its own
+pointers from malloc's with a range check and find the span header by
+masking.  Three levels:
+
+  thread cache   a free list per class, no locks; refilled from and
+                 drained to the central list in batches
+  central list   per class, under its own lock; spans with free objects
+  span pool      spans whose objects all came back; their pages (except the
+                 header page) are returned to the OS until reused
+
+Anything larger, or anything once the range is exhausted, goes to malloc.
+\*****************************************************************************/
+#include "libnew.h"
+#include "os_memory.h"
+
+#include "platform.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+namespace {
+	using namespace LIBNEWNAMESPACE::detail;
+
+	const size_t k_spanShift = 16;
+	const size_t k_spanSize = size_t(1) << k_spanShift;
+	const size_t k_spanHeader = 64;
+	const size_t k_maxSmall = 4096;
+	const size_t k_classes = 32;
+	const size_t k_cacheBytes = 32 * 1024;  // per class and thread
+
+	size_t class_of(size_t size)
+	{
+		if (size <= 256)
+			return size ? (size - 1) >> 4 : 0;
+		size_t p = 8;
+		while ((size_t(2) << p) < size)
+			++p;
+		// 2^p < size <= 2^(p+1), in four steps of 2^(p-2)
+		return 16 + (p - 8) * 4 + ((size - 1 - (size_t(1) << p)) >> (p - 2));
+	}
+
+	size_t class_size(size_t c)
+	{
+		if (c < 16)
+			return (c + 1) * 16;
+		const size_t p = 8 + (c - 16) / 4;
+		return (size_t(1) << p) + (((c - 16) % 4) + 1) * (size_t(1) << (p - 2));
+	}
+
+	// Objects a thread keeps per class before handing half back
+	uint32_t cache_limit(size_t c)
+	{
+		const size_t limit = k_cacheBytes / class_size(c);
+		return uint32_t(limit < 8 ? 8 : limit > 256 ? 256 : limit);
+	}
+
+	struct Span
+	{
+		uint32_t sizeClass;
+		uint32_t objectSize;
+		uint32_t inUse;       // objects out in thread caches or with callers
+		uint32_t listed;      // on the central list
+		void* freeList;       // objects returned to this span
+		char* unused;         // never-allocated tail, null when exhausted
+		Span* prev;
+		Span* next;           // central list, or span pool
+	};
+	static_assert(sizeof(Span) <= k_spanHeader, "span header must fit before the first object");
+
+	struct Region
+	{
+		std::atomic<char*> base;
+		char* end;
+		char* next;           // first never-used span
+		Span* pool;           // released spans, bodies decommitted
+		size_t pageSize;
+		rw_lock lock;
+	};
+	Region s_region;
+
+	struct CentralList
+	{
+		rw_lock lock;
+		Span* spans;          // spans with at least one free object
+		char pad[64 - sizeof(rw_lock) - sizeof(Span*)];
+	};
+	CentralList s_central[k_classes];
+
+	Span* span_of(void* p) { return (Span*)(uintptr_t(p) & ~uintptr_t(k_spanSize - 1)); }
+
+	bool in_region(void* p)
+	{
+		char* base = s_region.base.load(std::memory_order_acquire);
+		return base && (char*)p >= base && (char*)p < s_region.end;
+	}
+
+	// Reserves the range on first use.  Called with the region lock held.
+	bool init_region()
+	{
+		if (s_region.base.load(std::memory_order_relaxed))
+			return true;
+		if (s_region.end)  // tried and failed
+			return false;
+		size_t bytes = sizeof(void*) == 8 ? size_t(64) << 30 : size_t(256) << 20;
+		char* base;
+		while (!(base = (char*)os_reserve(bytes, k_spanSize)) && bytes > (size_t(16) << 20))
+			bytes /= 2;
+		if (!base)
+		{
+			s_region.end = (char*)1;
+			return false;
+		}
+		s_region.end = base + bytes;
+		s_region.next = base;
+		s_region.pageSize = os_page_size();
+		s_region.base.store(base, std::memory_order_release);
+		return true;
+	}
+
+	Span* new_span(size_t c)
+	{
+		Span* span = nullptr;
+		lock_exclusive(s_region.lock);
+		if (s_region.pool)
+		{
+			span = s_region.pool;
+			if (os_commit((char*)span + s_region.pageSize, k_spanSize - s_region.pageSize))
+				s_region.pool = span->next;
+			else
+				span = nullptr;
+		}
+		else if (init_region() && s_region.next < s_region.end)
+		{
+			if (os_commit(s_region.next, k_spanSize))
+			{
+				span = (Span*)s_region.next;
+				s_region.next += k_spanSize;
+			}
+		}
+		unlock_exclusive(s_region.lock);
+		if (!span)
+			return nullptr;
+
+		span->sizeClass = uint32_t(c);
+		span->objectSize = uint32_t(class_size(c));
+		span->inUse = 0;
+		span->listed = 0;
+		span->freeList = nullptr;
+		span->unused = (char*)span + k_spanHeader;
+		span->prev = span->next = nullptr;
+		return span;
+	}
+
+	void release_spans(Span* spans)
+	{
+		if (!spans)
+			return;
+		// Decommit outside the lock; the header page stays for the pool link
+		for (Span* s = spans; s; s = s->next)
+			os_decommit((char*)s + s_region.pageSize, k_spanSize - s_region.pageSize);
+		Span* last = spans;
+		while (last->next)
+			last = last->next;
+		lock_exclusive(s_region.lock);
+		last->next = s_region.pool;
+		s_region.pool = spans;
+		unlock_exclusive(s_region.lock);
+	}
+
+	void link(CentralList& central, Span* span)
+	{
+		span->prev = nullptr;
+		span->next = central.spans;
+		if (central.spans)
+			central.spans->prev = span;
+		central.spans = span;
+		span->listed = 1;
+	}
+
+	void unlink(CentralList& central, Span* span)
+	{
+		if (span->prev)
+			span->prev->next = span->next;
+		else
+			central.spans = span->next;
+		if (span->next)
+			span->next->prev = span->prev;
+		span->prev = span->next = nullptr;
+		span->listed = 0;
+	}
+
+	// Takes up to n objects of class c as a chain through their first word
+	size_t central_fetch(size_t c, size_t n, void*& head)
+	{
+		CentralList& central = s_central[c];
+		size_t got = 0;
+		head = nullptr;
+		lock_exclusive(central.lock);
+		while (got < n)
+		{
+			Span* span = central.spans;
+			if (!span)
+			{
+				if (!(span = new_span(c)))
+					break;
+				link(central, span);
+			}
+			while (got < n && (span->freeList || span->unused))
+			{
+				void* p;
+				if (span->freeList)
+				{
+					p = span->freeList;
+					span->freeList = *(void**)p;
+				}
+				else
+				{
+					p = span->unused;
+					span->unused += span->objectSize;
+					if (span->unused + span->objectSize > (char*)span + k_spanSize)
+						span->unused = nullptr;
+				}
+				*(void**)p = head;
+				head = p;
+				++span->inUse;
+				++got;
+			}
+			if (!span->freeList && !span->unused)
+				unlink(central, span);
+		}
+		unlock_exclusive(central.lock);
+		return got;
+	}
+
+	// Returns a chain of objects of class c to their spans.  A span whose
+	// objects are all back goes to the pool, unless it is the class's last.
+	void central_release(size_t c, void* head)
+	{
+		CentralList& central = s_central[c];
+		Span* empty = nullptr;
+		lock_exclusive(central.lock);
+		while (head)
+		{
+			void* p = head;
+			head = *(void**)p;
+			Span* span = span_of(p);
+			*(void**)p = span->freeList;
+			span->freeList = p;
+			if (!span->listed)
+				link(central, span);
+			if (--span->inUse == 0 && (span->prev || span->next))
+			{
+				unlink(central, span);
+				span->next = empty;
+				empty = span;
+			}
+		}
+		unlock_exclusive(central.lock);
+		release_spans(empty);
+	}
+
+	struct FreeList
+	{
+		void* head;
+		uint32_t count;
+		uint32_t limit;       // 0 until first refill or drain
+	};
+
+	struct ThreadCache
+	{
+		FreeList lists[k_classes];
+		bool dead;            // destroyed; the thread is exiting
+
+		// Later thread_local destructors may still allocate.  With every list
+		// empty they miss the fast path, and refill sees dead and goes to the
+		// central list.
+		~ThreadCache()
+		{
+			dead = true;
+			for (size_t c = 0; c < k_classes; ++c)
+			{
+				if (lists[c].head)
+					central_release(c, lists[c].head);
+				lists[c].head = nullptr;
+				lists[c].count = 0;
+			}
+		}
+	};
+	thread_local ThreadCache t_cache;
+
+	// Hands the oldest half of an overfull list back to the central list
+	void drain(FreeList& list, size_t c)
+	{
+		if (!list.limit)
+			list.limit = cache_limit(c);
+		if (list.count <= list.limit)
+			return;
+		const uint32_t keep = list.limit / 2;
+		void* p = list.head;
+		for (uint32_t i = 1; i < keep; ++i)
+			p = *(void**)p;
+		void* rest = *(void**)p;
+		*(void**)p = nullptr;
+		list.count = keep;
+		central_release(c, rest);
+	}
+
+	void* refill(ThreadCache& cache, size_t c)
+	{
+		void* head;
+		if (cache.dead)
+			return central_fetch(c, 1, head) ? head : malloc(class_size(c));
+		FreeList& list = cache.lists[c];
+		if (!list.limit)
+			list.limit = cache_limit(c);
+		const size_t got = central_fetch(c, list.limit / 2, head);
+		if (!got)
+			return malloc(class_size(c));
+		list.head = *(void**)head;
+		list.count = uint32_t(got - 1);
+		return head;
+	}
+}
+
+DECL_EXPORT_C(void*, ThreadCacheAlloc)(size_t size)
+{
+	if (size > k_maxSmall)
+		return malloc(size);
+	const size_t c = class_of(size);
+	ThreadCache& cache = t_cache;
+	FreeList& list = cache.lists[c];
+	void* p = list.head;
+	if (!p)
+		return refill(cache, c);
+	list.head = *(void**)p;
+	--list.count;
+	return p;
+}
+
+DECL_EXPORT_C(void, ThreadCacheFree)(void* vp)
+{
+	if (!in_region(vp))
+	{
+		free(vp);
+		return;
+	}
+	const size_t c = span_of(vp)->sizeClass;
+	ThreadCache& cache = t_cache;
+	if (cache.dead)
+	{
+		*(void**)vp = nullptr;
+		central_release(c, vp);
+		return;
+	}
+	FreeList& list = cache.lists[c];
+	*(void**)vp = list.head;
+	list.head = vp;
+	if (++list.count > list.limit)
+		drain(list, c);
+}
+
+namespace LIBNEWNAMESPACE
+{
+	DECL_EXPORT_CPP(void*, ThreadCacheAlloc)(size_t size) { return DECL_NAME(ThreadCacheAlloc)(size); }
+	DECL_EXPORT_CPP(void, ThreadCacheFree)(void* vp) { DECL_NAME(ThreadCacheFree)(vp); }
+}
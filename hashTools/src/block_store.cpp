@@ -0,0 +1,349 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+block_store.cpp -- Content-addressed block store over append-only segments
+\*****************************************************************************/
+
+#include "hashTools.h"
+#include "block_store.h"
+#include "word_load.h"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+BEGIN_HASHTOOLS_NS
+
+namespace
+{
+	const uint32_t k_magic = 0x4b425443;    // "CTBK"
+	const uint32_t k_headerSize = 32;
+	const uint32_t k_empty = 0xFFFFFFFF;
+	const uint64_t k_initialSlots = 1024;
+
+	// Record header, little-endian:
+	//   0 magic  4 length  8 crc32c(data)  12 digest type, 3 zero bytes  16 digest
+	void write_header(uint8_t* header, uint32_t length, uint32_t crc, cdc_digest digest, const uint8_t* key)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			header[i] = uint8_t(k_magic >> (8 * i));
+			header[4 + i] = uint8_t(length >> (8 * i));
+			header[8 + i] = uint8_t(crc >> (8 * i));
+			header[12 + i] = 0;
+		}
+		header[12] = uint8_t(digest);
+		memcpy(header + 16, key, 16);
+	}
+
+	int seek(FILE* file, uint64_t offset)
+	{
+#ifdef _MSC_VER
+		return _fseeki64(file, (__int64)offset, SEEK_SET);
+#else
+		return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+	}
+
+	uint64_t file_size(FILE* file)
+	{
+#ifdef _MSC_VER
+		if (_fseeki64(file, 0, SEEK_END))
+			return 0;
+		const __int64 size = _ftelli64(file);
+#else
+		if (fseeko(file, 0, SEEK_END))
+			return 0;
+		const off_t size = ftello(file);
+#endif
+		return size < 0 ? 0 : uint64_t(size);
+	}
+}
+
+block_store::block_store(const char* directory, const block_store_options& options) :
+	m_options(options),
+	m_error(0),
+	m_directory(nullptr),
+	m_table(nullptr),
+	m_mask(k_initialSlots - 1),
+	m_count(0),
+	m_storedBytes(0),
+	m_duplicateBytes(0),
+	m_write(nullptr),
+	m_segment(0),
+	m_writeOffset(0),
+	m_writeDirty(false),
+	m_read(nullptr),
+	m_readSegment(k_empty)
+{
+	const size_t length = strlen(directory);
+	m_directory = new char[length + 1];
+	memcpy(m_directory, directory, length + 1);
+	m_table = new entry[k_initialSlots];
+	for (uint64_t i = 0; i < k_initialSlots; ++i)
+		m_table[i].segment = k_empty;
+
+#ifdef _WIN32
+	const int made = _mkdir(directory);
+#else
+	const int made = mkdir(directory, 0755);
+#endif
+	if (made != 0 && errno != EEXIST)
+	{
+		m_error = errno;
+		return;
+	}
+
+	// Segments are numbered without gaps.  A segment whose tail is torn (a
+	// crash mid-append) keeps its intact records but is not appended to.
+	bool found = false, clean = false;
+	uint64_t end = 0;
+	for (uint32_t segment = 0; !m_error; ++segment)
+	{
+		FILE* file = open_segment(segment, "rb");
+		if (!file)
+			break;
+		clean = scan_segment(file, segment, end);
+		fclose(file);
+		found = true;
+		m_segment = segment;
+	}
+	if (found && (!clean || end >= m_options.segment_size))
+		++m_segment;
+	else if (found)
+		m_writeOffset = end;
+}
+
+block_store::~block_store()
+{
+	if (m_write)
+		fclose(m_write);
+	if (m_read)
+		fclose(m_read);
+	delete[] m_table;
+	delete[] m_directory;
+}
+
+void block_store::digest(const void* data, size_t length, uint8_t* key) const noexcept
+{
+	if (m_options.digest == cdc_digest::md5)
+	{
+		md5_ref(data, length, key);
+		return;
+	}
+	uint64_t high = 0;
+	const uint64_t low = spooky_128(data, length, 0, &high);
+	memcpy(key, &low, sizeof(low));
+	memcpy(key + sizeof(low), &high, sizeof(high));
+}
+
+block_put block_store::put(const void* data, uint32_t length, uint8_t* key)
+{
+	uint8_t digested[16];
+	digest(data, length, digested);
+	if (key)
+		memcpy(key, digested, sizeof(digested));
+	return put(digested, data, length);
+}
+
+block_put block_store::put(const uint8_t* key, const void* data, uint32_t length)
+{
+	if (m_error)
+		return block_put::failed;
+	if (find(key))
+	{
+		m_duplicateBytes += length;
+		return block_put::present;
+	}
+
+	if (m_writeOffset && m_writeOffset + k_headerSize + length > m_options.segment_size)
+	{
+		if (m_write)
+			fclose(m_write);
+		m_write = nullptr;
+		m_writeDirty = false;
+		++m_segment;
+		m_writeOffset = 0;
+	}
+	if (!m_write && !(m_write = open_segment(m_segment, "ab")))
+	{
+		m_error = errno ? errno : EIO;
+		return block_put::failed;
+	}
+
+	uint8_t header[k_headerSize];
+	write_header(header, length, crc32c(data, length), m_options.digest, key);
+	if (fwrite(header, 1, k_headerSize, m_write) != k_headerSize ||
+	    fwrite(data, 1, length, m_write) != length)
+	{
+		// A torn record would be misread as the next block's header
+		m_error = errno ? errno : EIO;
+		return block_put::failed;
+	}
+	m_writeDirty = true;
+
+	entry e;
+	memcpy(e.key, key, sizeof(e.key));
+	e.offset = m_writeOffset + k_headerSize;
+	e.segment = m_segment;
+	e.length = length;
+	insert(e);
+	m_writeOffset += k_headerSize + length;
+	m_storedBytes += length;
+	return block_put::stored;
+}
+
+int64_t block_store::length(const uint8_t* key) const noexcept
+{
+	const entry* e = find(key);
+	return e ? int64_t(e->length) : -1;
+}
+
+int64_t block_store::get(const uint8_t* key, void* buffer, size_t capacity)
+{
+	const entry* e = find(key);
+	if (!e || e->length > capacity)
+		return -1;
+
+	if (e->segment == m_segment && m_writeDirty)
+	{
+		fflush(m_write);
+		m_writeDirty = false;
+	}
+	if (m_readSegment != e->segment)
+	{
+		if (m_read)
+			fclose(m_read);
+		m_readSegment = e->segment;
+		if (!(m_read = open_segment(e->segment, "rb")))
+		{
+			m_readSegment = k_empty;
+			return -1;
+		}
+	}
+
+	uint8_t header[k_headerSize];
+	if (seek(m_read, e->offset - k_headerSize) ||
+	    fread(header, 1, k_headerSize, m_read) != k_headerSize ||
+	    fread(buffer, 1, e->length, m_read) != e->length)
+		return -1;
+	if (m_options.verify_reads &&
+	    (memcmp(header + 16, e->key, 16) != 0 || detail::load_le32(header + 8) != crc32c(buffer, e->length)))
+		return -1;
+	return e->length;
+}
+
+bool block_store::flush() noexcept
+{
+	m_writeDirty = false;
+	return !m_write || fflush(m_write) == 0;
+}
+
+const block_store::entry* block_store::find(const uint8_t* key) const noexcept
+{
+	uint64_t k[2];
+	memcpy(k, key, sizeof(k));
+	for (uint64_t slot = k[0] & m_mask;; slot = (slot + 1) & m_mask)
+	{
+		const entry& e = m_table[slot];
+		if (e.segment == k_empty)
+			return nullptr;
+		if (e.key[0] == k[0] && e.key[1] == k[1])
+			return &e;
+	}
+}
+
+void block_store::insert(const entry& e)
+{
+	// Keep the load at or below 3/4 so misses end after a short run
+	if ((m_count + 1) * 4 > (m_mask + 1) * 3)
+		grow();
+	uint64_t slot = e.key[0] & m_mask;
+	while (m_table[slot].segment != k_empty)
+		slot = (slot + 1) & m_mask;
+	m_table[slot] = e;
+	++m_count;
+}
+
+void block_store::grow()
+{
+	const uint64_t oldSlots = m_mask + 1;
+	entry* old = m_table;
+	m_mask = oldSlots * 2 - 1;
+	m_table = new entry[oldSlots * 2];
+	for (uint64_t i = 0; i <= m_mask; ++i)
+		m_table[i].segment = k_empty;
+	for (uint64_t i = 0; i < oldSlots; ++i)
+		if (old[i].segment != k_empty)
+		{
+			uint64_t slot = old[i].key[0] & m_mask;
+			while (m_table[slot].segment != k_empty)
+				slot = (slot + 1) & m_mask;
+			m_table[slot] = old[i];
+		}
+	delete[] old;
+}
+
+FILE* block_store::open_segment(uint32_t segment, const char* mode) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/segment-%08u.blk", segment);
+	const std::string path = std::string(m_directory) + name;
+	FILE* file = nullptr;
+#ifdef _MSC_VER
+	if (fopen_s(&file, path.c_str(), mode))
+		file = nullptr;
+#else
+	file = fopen(path.c_str(), mode);
+#endif
+	return file;
+}
+
+// Indexes the records of one segment.  end receives the offset after the
+// last intact record; returns false if anything follows it.
+bool block_store::scan_segment(FILE* file, uint32_t segment, uint64_t& end)
+{
+	const uint64_t size = file_size(file);
+	end = 0;
+	uint8_t header[k_headerSize];
+	while (end + k_headerSize <= size)
+	{
+		if (seek(file, end) || fread(header, 1, k_headerSize, file) != k_headerSize)
+			return false;
+		const uint32_t length = detail::load_le32(header + 4);
+		if (detail::load_le32(header) != k_magic || end + k_headerSize + length > size)
+			return false;
+		if (header[12] != uint8_t(m_options.digest))
+		{
+			m_error = EINVAL;
+			return false;
+		}
+		if (!find(header + 16))
+		{
+			entry e;
+			memcpy(e.key, header + 16, sizeof(e.key));
+			e.offset = end + k_headerSize;
+			e.segment = segment;
+			e.length = length;
+			insert(e);
+			m_storedBytes += length;
+		}
+		end += k_headerSize + length;
+	}
+	return end == size;
+}
+
+END_HASHTOOLS_NS
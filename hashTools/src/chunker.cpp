@@ -0,0 +1,270 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+chunker.cpp -- Content-defined chunking (FastCDC over a gear hash)
+\*****************************************************************************/
+
+#include "hashTools.h"
+#include "chunker.h"
+
+#include <cstdio>
+#include <cstring>
+
+BEGIN_HASHTOOLS_NS
+
+namespace
+{
+	// A mask of 'bits' one bits spread over bits 16..62 of the gear hash.  The
+	// low bits of a gear hash only depend on the last few bytes, so the mask
+	// is kept high to make every cut depend on the whole 64 byte window.  Bit
+	// 63 is left clear so the two-bytes-per-step scan can test (mask << 1).
+	uint64_t spread_mask(uint32_t bits)
+	{
+		const uint32_t k_low = 16, k_high = 62;
+		if (bits < 1)
+			bits = 1;
+		if (bits > k_high - k_low + 1)
+			bits = k_high - k_low + 1;
+		uint64_t mask = 0;
+		for (uint32_t k = 0; k < bits; ++k)
+			mask |= 1ull << (k_high - (k * (k_high - k_low + 1)) / bits);
+		return mask;
+	}
+
+	uint32_t log2_round(uint32_t x)
+	{
+		uint32_t bits = 0;
+		while ((2ull << bits) <= x)
+			++bits;
+		// round to nearest: 12288 -> 2^14, 11000 -> 2^13
+		if (bits < 31 && x - (1u << bits) >= (1u << bits) / 2)
+			++bits;
+		return bits;
+	}
+}
+
+cdc_chunker::cdc_chunker(const cdc_params& params) noexcept :
+	m_params(params)
+{
+	if (m_params.min_size < 64)
+		m_params.min_size = 64;
+	if (m_params.avg_size < m_params.min_size)
+		m_params.avg_size = m_params.min_size;
+	if (m_params.max_size < m_params.avg_size)
+		m_params.max_size = m_params.avg_size;
+
+	const uint32_t bits = log2_round(m_params.avg_size);
+	m_maskSmall = spread_mask(bits + 2);
+	m_maskLarge = spread_mask(bits > 3 ? bits - 2 : 1);
+
+	uint64_t seed = m_params.seed;
+	for (unsigned i = 0; i < 256; ++i)
+	{
+		m_gear[i] = splitmix64(seed);
+		m_gearShifted[i] = m_gear[i] << 1;
+	}
+}
+
+// Rolls the gear hash over data[i, end), two bytes per step.  Returns the
+// length of the chunk if a cut point was found, otherwise 0.
+size_t cdc_chunker::scan(const uint8_t* data, size_t i, size_t end, uint64_t& h, uint64_t mask) const noexcept
+{
+	const uint64_t maskShifted = mask << 1;
+	uint64_t hash = h;
+	for (; i + 2 <= end; i += 2)
+	{
+		// (hash << 2) + (G[a] << 1) is the single step value shifted left by
+		// one, so testing it against mask << 1 is the single step test.
+		hash = (hash << 2) + m_gearShifted[data[i]];
+		if (!(hash & maskShifted))
+			return i + 1;
+		hash += m_gear[data[i + 1]];
+		if (!(hash & mask))
+			return i + 2;
+	}
+	if (i < end)
+	{
+		hash = (hash << 1) + m_gear[data[i]];
+		if (!(hash & mask))
+			return i + 1;
+	}
+	h = hash;
+	return 0;
+}
+
+size_t cdc_chunker::next_boundary(const uint8_t* data, size_t len, bool final) const noexcept
+{
+	const size_t n = len < m_params.max_size ? len : m_params.max_size;
+	const bool complete = final || len >= m_params.max_size;
+	if (n <= m_params.min_size)
+		return complete ? n : 0;
+
+	// Skip ahead: no cut is allowed before min_size, so those bytes are
+	// never hashed.  The cut points only depend on the chunk start, which
+	// keeps the result independent of how much data is available.
+	uint64_t h = 0;
+	const size_t normal = m_params.avg_size < n ? m_params.avg_size : n;
+	size_t cut = scan(data, m_params.min_size, normal, h, m_maskSmall);
+	if (!cut && normal < n)
+		cut = scan(data, normal, n, h, m_maskLarge);
+	if (cut)
+		return cut;
+	return complete ? n : 0;
+}
+
+size_t cdc_chunker::chunk(const void* data, size_t len, cdc_sink sink, void* context, uint64_t baseOffset) const
+{
+	const uint8_t* p = (const uint8_t*)data;
+	size_t count = 0;
+	cdc_chunk chunk;
+	chunk.offset = baseOffset;
+	while (len)
+	{
+		const size_t cut = next_boundary(p, len, true);
+		chunk.length = (uint32_t)cut;
+		digest(p, cut, chunk.digest);
+		sink(chunk, p, context);
+		chunk.offset += cut;
+		p += cut;
+		len -= cut;
+		++count;
+	}
+	return count;
+}
+
+void cdc_chunker::digest(const uint8_t* data, size_t len, uint8_t* out) const noexcept
+{
+	if (m_params.digest == cdc_digest::md5)
+	{
+		md5_ref(data, len, out);
+		return;
+	}
+	uint64_t high = 0;
+	const uint64_t low = spooky_128(data, len, 0, &high);
+	memcpy(out, &low, sizeof(low));
+	memcpy(out + sizeof(low), &high, sizeof(high));
+}
+
+cdc_stream::cdc_stream(const cdc_chunker& chunker, cdc_sink sink, void* context) :
+	m_chunker(&chunker),
+	m_sink(sink),
+	m_context(context),
+	m_carry(new uint8_t[chunker.params().max_size]),
+	m_carryLength(0),
+	m_offset(0)
+{}
+
+cdc_stream::~cdc_stream()
+{
+	delete[] m_carry;
+}
+
+void cdc_stream::emit(const uint8_t* data, size_t len)
+{
+	cdc_chunk chunk;
+	chunk.offset = m_offset;
+	chunk.length = (uint32_t)len;
+	m_chunker->digest(data, len, chunk.digest);
+	m_sink(chunk, data, m_context);
+	m_offset += len;
+}
+
+void cdc_stream::update(const void* data, size_t len)
+{
+	const size_t maxSize = m_chunker->params().max_size;
+	const uint8_t* p = (const uint8_t*)data;
+	while (len)
+	{
+		if (m_carryLength)
+		{
+			// Top up the pending partial chunk and look for its end
+			size_t take = maxSize - m_carryLength;
+			if (take > len)
+				take = len;
+			memcpy(m_carry + m_carryLength, p, take);
+			m_carryLength += take;
+			p += take;
+			len -= take;
+
+			const size_t cut = m_chunker->next_boundary(m_carry, m_carryLength, false);
+			if (cut)
+			{
+				emit(m_carry, cut);
+				m_carryLength -= cut;
+				memmove(m_carry, m_carry + cut, m_carryLength);
+			}
+		}
+		else
+		{
+			// Fast path: chunk straight out of the caller's buffer
+			const size_t cut = m_chunker->next_boundary(p, len, false);
+			if (!cut)
+			{
+				memcpy(m_carry, p, len);
+				m_carryLength = len;
+				return;
+			}
+			emit(p, cut);
+			p += cut;
+			len -= cut;
+		}
+	}
+}
+
+void cdc_stream::finish()
+{
+	while (m_carryLength)
+	{
+		const size_t cut = m_chunker->next_boundary(m_carry, m_carryLength, true);
+		emit(m_carry, cut);
+		m_carryLength -= cut;
+		memmove(m_carry, m_carry + cut, m_carryLength);
+	}
+}
+
+EXPORT size_t cdc_chunk_file(const char* filename, const cdc_chunker& chunker, cdc_sink sink, void* context)
+{
+	struct counter
+	{
+		cdc_sink sink;
+		void* context;
+		size_t chunks;
+		static void count(const cdc_chunk& chunk, const uint8_t* data, void* self)
+		{
+			counter* c = (counter*)self;
+			++c->chunks;
+			c->sink(chunk, data, c->context);
+		}
+	} state{ sink, context, 0 };
+
+	FILE* file = nullptr;
+#ifdef _MSC_VER
+	if (fopen_s(&file, filename, "rb"))
+		file = nullptr;
+#else
+	file = fopen(filename, "rb");
+#endif
+	if (!file)
+		return size_t(-1);
+
+	const size_t k_readSize = 1 << 20;
+	uint8_t* buffer = new uint8_t[k_readSize];
+	cdc_stream stream(chunker, &counter::count, &state);
+	size_t got;
+	while ((got = fread(buffer, 1, k_readSize, file)) != 0)
+		stream.update(buffer, got);
+	const bool failed = ferror(file) != 0;
+	stream.finish();
+	fclose(file);
+	delete[] buffer;
+	return failed ? size_t(-1) : state.chunks;
+}
+
+END_HASHTOOLS_NS
@@ -0,0 +1,81 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+consistent_hash.cpp -- Jump consistent hash
+
+From "A Fast, Minimal Memory, Consistent Hash Algorithm", Lamping & Veach,
+2014.  The key drives a 64-bit LCG; each step jumps to the next bucket count
+at which the key would move, until the jump passes the number of buckets.
+\*****************************************************************************/
+
+#include "hashTools.h"
+#include "consistent_hash.h"
+
+BEGIN_HASHTOOLS_NS
+
+namespace
+{
+	const uint64_t k_jump_lcg = 2862933555777941757ull;
+
+	inline int64_t jump_step(int64_t b, uint64_t key)
+	{
+		return int64_t((b + 1) * (double(1ll << 31) / double((key >> 33) + 1)));
+	}
+}
+
+EXPORT int32_t jump_consistent_hash(uint64_t key, int32_t buckets) noexcept
+{
+	int64_t b = -1, j = 0;
+	while (j < buckets)
+	{
+		b = j;
+		key = key * k_jump_lcg + 1;
+		j = jump_step(b, key);
+	}
+	return int32_t(b);
+}
+
+EXPORT void jump_consistent_hash_batch(const uint64_t* keys, size_t n, int32_t buckets, int32_t* out) noexcept
+{
+	// Each key needs about ln(buckets) dependent steps, each ending in a
+	// divide and an unpredictable loop exit.  Running four keys in lock
+	// step with selects instead of branches overlaps their divides and
+	// leaves one predictable loop-exit branch per group.
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		uint64_t k[4] = { keys[i], keys[i + 1], keys[i + 2], keys[i + 3] };
+		int64_t b[4] = { -1, -1, -1, -1 };
+		int64_t j[4] = { 0, 0, 0, 0 };
+		for (;;)
+		{
+			bool active = false;
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				const bool live = j[lane] < buckets;
+				active |= live;
+				const uint64_t nk = k[lane] * k_jump_lcg + 1;
+				const int64_t nb = live ? j[lane] : b[lane];
+				b[lane] = nb;
+				k[lane] = live ? nk : k[lane];
+				const int64_t nj = jump_step(nb, nk);
+				j[lane] = live ? nj : j[lane];
+			}
+			if (!active)
+				break;
+		}
+		for (int lane = 0; lane < 4; ++lane)
+			out[i + lane] = int32_t(b[lane]);
+	}
+	for (; i < n; ++i)
+		out[i] = jump_consistent_hash(keys[i], buckets);
+}
+
+END_HASHTOOLS_NS
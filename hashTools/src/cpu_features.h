@@ -0,0 +1,114 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+cpu_features.h -- Runtime instruction set detection for the hashTools kernels
+
+Private to the hashTools library.  Kernels that use an instruction set
+beyond the build baseline are compiled with HASHTOOLS_TARGET(...) so GCC and
+Clang accept the intrinsics without raising the baseline for the whole file,
+and are only called after checking cpu().
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_CPU_FEATURES_H
+#define CODETOOLS_HASHTOOLS_CPU_FEATURES_H
+#pragma once
+
+#include "hashTools.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HASHTOOLS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(HASHTOOLS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define HASHTOOLS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define HASHTOOLS_TARGET(isa)
+#endif
+
+BEGIN_HASHTOOLS_NS
+namespace detail
+{
+	struct cpu_features
+	{
+		bool sse2;
+		bool sse41;
+		bool sse42;
+		bool pclmul;
+		bool avx2;
+	};
+
+#ifdef HASHTOOLS_X86
+	inline void cpuid(int leaf, int subleaf, int regs[4]) noexcept
+	{
+#ifdef _MSC_VER
+		__cpuidex(regs, leaf, subleaf);
+#else
+		unsigned a = 0, b = 0, c = 0, d = 0;
+		__cpuid_count(leaf, subleaf, a, b, c, d);
+		regs[0] = (int)a; regs[1] = (int)b; regs[2] = (int)c; regs[3] = (int)d;
+#endif
+	}
+
+	inline uint64_t xgetbv0() noexcept
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned lo, hi;
+		__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		return ((uint64_t)hi << 32) | lo;
+#endif
+	}
+
+	inline cpu_features detect_cpu_features() noexcept
+	{
+		cpu_features f = { false, false, false, false, false };
+		int regs[4];
+		cpuid(0, 0, regs);
+		const int maxLeaf = regs[0];
+		if (maxLeaf < 1)
+			return f;
+		cpuid(1, 0, regs);
+		f.sse2 = (regs[3] & (1 << 26)) != 0;
+		f.sse41 = (regs[2] & (1 << 19)) != 0;
+		f.sse42 = (regs[2] & (1 << 20)) != 0;
+		f.pclmul = (regs[2] & (1 << 1)) != 0;
+		// AVX state must also be enabled by the OS
+		const bool osxsave = (regs[2] & (1 << 27)) != 0;
+		const bool avx = (regs[2] & (1 << 28)) != 0;
+		if (maxLeaf >= 7 && osxsave && avx && (xgetbv0() & 6) == 6)
+		{
+			cpuid(7, 0, regs);
+			f.avx2 = (regs[1] & (1 << 5)) != 0;
+		}
+		return f;
+	}
+#else
+	inline cpu_features detect_cpu_features() noexcept
+	{
+		cpu_features f = { false, false, false, false, false };
+		return f;
+	}
+#endif
+
+	inline const cpu_features& cpu() noexcept
+	{
+		static const cpu_features features = detect_cpu_features();
+		return features;
+	}
+}
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_CPU_FEATURES_H
@@ -0,0 +1,317 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+crc.cpp -- CRC-32C and CRC-64/XZ with hardware paths and combine
+
+Both CRCs are reflected, start from all ones and are inverted at the end.
+Internally the kernels work on the raw shift register; the public functions
+add the inversions.  The raw register is linear, so
+
+  raw(r, A || B) = shift(raw(r, A), |B|) ^ raw(0, B)
+
+where shift(c, n) = c * x^(8n) mod P.  That identity merges the CRC-32C
+streams of the three-way kernel and is all that *_combine() needs.
+
+Polynomial arithmetic is on reflected values: bit 31 (or 63) of a register
+holds the x^0 coefficient.  xn_mod_p() gives x^n mod P in that form, which
+is also the operand layout PCLMULQDQ needs for the folding constants, so the
+constants are derived from the polynomial at start-up rather than tabulated.
+
+  Software    slicing-by-8 tables
+  CRC-32C     SSE4.2 crc32 over three interleaved streams, merged with
+              PCLMULQDQ; one stream when PCLMULQDQ is missing
+  CRC-64      PCLMULQDQ folding of four 128-bit lanes; no crc64 instruction
+              exists
+\*****************************************************************************/
+
+#include "hashTools.h"
+#include "cpu_features.h"
+#include "word_load.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define HASHTOOLS_X64 1
+#endif
+
+BEGIN_HASHTOOLS_NS
+
+namespace
+{
+	const uint32_t k_crc32c_poly = 0x82F63B78;           // Castagnoli, reflected
+	const uint64_t k_crc64_poly = 0xC96C5795D7870F42ull; // ECMA-182, reflected
+
+	template <class Word>
+	struct crc_tables
+	{
+		Word slice[8][256];
+		Word x2n[64];                // x^(2^k) mod P
+
+		explicit crc_tables(Word poly) noexcept
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				Word c = i;
+				for (int b = 0; b < 8; ++b)
+					c = (c & 1) ? (c >> 1) ^ poly : c >> 1;
+				slice[0][i] = c;
+			}
+			for (int k = 1; k < 8; ++k)
+				for (uint32_t i = 0; i < 256; ++i)
+					slice[k][i] = (slice[k - 1][i] >> 8) ^ slice[0][slice[k - 1][i] & 0xFF];
+
+			x2n[0] = Word(1) << (sizeof(Word) * 8 - 2);  // x^1
+			for (int k = 1; k < 64; ++k)
+				x2n[k] = mul(x2n[k - 1], x2n[k - 1], poly);
+		}
+
+		// a * b mod P
+		static Word mul(Word a, Word b, Word poly) noexcept
+		{
+			Word m = Word(1) << (sizeof(Word) * 8 - 1), p = 0;
+			for (;;)
+			{
+				if (a & m)
+				{
+					p ^= b;
+					if ((a & (m - 1)) == 0)
+						break;
+				}
+				m >>= 1;
+				b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+			}
+			return p;
+		}
+
+		// x^n mod P
+		Word xn_mod_p(uint64_t n, Word poly) const noexcept
+		{
+			Word p = Word(1) << (sizeof(Word) * 8 - 1);     // x^0
+			for (int k = 0; n; n >>= 1, ++k)
+				if (n & 1)
+					p = mul(x2n[k & 63], p, poly);
+			return p;
+		}
+
+		Word update(Word crc, const uint8_t* p, size_t length) const noexcept
+		{
+			for (; length >= 8; length -= 8, p += 8)
+			{
+				const uint64_t v = detail::load_le64(p) ^ crc;
+				crc = Word(slice[7][v & 0xFF] ^ slice[6][(v >> 8) & 0xFF] ^
+				           slice[5][(v >> 16) & 0xFF] ^ slice[4][(v >> 24) & 0xFF] ^
+				           slice[3][(v >> 32) & 0xFF] ^ slice[2][(v >> 40) & 0xFF] ^
+				           slice[1][(v >> 48) & 0xFF] ^ slice[0][v >> 56]);
+			}
+			for (; length; --length, ++p)
+				crc = (crc >> 8) ^ slice[0][(crc ^ *p) & 0xFF];
+			return crc;
+		}
+	};
+
+	// The three-way CRC-32C kernel runs each stream over k_long (or k_short)
+	// bytes; the folding constants depend on the lane strides.
+	const size_t k_long = 4096;
+	const size_t k_short = 256;
+
+	struct crc32c_state : crc_tables<uint32_t>
+	{
+		uint64_t shiftLong[2];       // merge constants for k_long and 2 * k_long
+		uint64_t shiftShort[2];      // and for k_short and 2 * k_short
+
+		crc32c_state() noexcept : crc_tables<uint32_t>(k_crc32c_poly)
+		{
+			// crc32(0, clmul(c, k)) = c * k * x^33 mod P, so shifting by n
+			// bytes uses k = x^(8n - 33)
+			shiftLong[0] = xn_mod_p(8 * k_long - 33, k_crc32c_poly);
+			shiftLong[1] = xn_mod_p(16 * k_long - 33, k_crc32c_poly);
+			shiftShort[0] = xn_mod_p(8 * k_short - 33, k_crc32c_poly);
+			shiftShort[1] = xn_mod_p(16 * k_short - 33, k_crc32c_poly);
+		}
+	};
+
+	struct crc64_state : crc_tables<uint64_t>
+	{
+		// clmul(lo, k) of a reflected 128-bit lane is lo * k * x, so folding
+		// a lane forward by d bits uses x^(d + 63) for the low half and
+		// x^(d - 1) for the high half
+		uint64_t fold512[2];
+		uint64_t fold128[2];
+
+		crc64_state() noexcept : crc_tables<uint64_t>(k_crc64_poly)
+		{
+			fold512[0] = xn_mod_p(512 + 63, k_crc64_poly);
+			fold512[1] = xn_mod_p(512 - 1, k_crc64_poly);
+			fold128[0] = xn_mod_p(128 + 63, k_crc64_poly);
+			fold128[1] = xn_mod_p(128 - 1, k_crc64_poly);
+		}
+	};
+
+	const crc32c_state& crc32c_tables() noexcept
+	{
+		static const crc32c_state state;
+		return state;
+	}
+
+	const crc64_state& crc64_tables() noexcept
+	{
+		static const crc64_state state;
+		return state;
+	}
+
+#ifdef HASHTOOLS_X86
+	HASHTOOLS_TARGET("sse4.2")
+	uint32_t crc32c_bytes_sse42(uint32_t crc, const uint8_t* p, size_t length) noexcept
+	{
+#ifdef HASHTOOLS_X64
+		uint64_t c = crc;
+		for (; length >= 8; length -= 8, p += 8)
+			c = _mm_crc32_u64(c, detail::load_le64(p));
+		crc = uint32_t(c);
+#else
+		for (; length >= 4; length -= 4, p += 4)
+			crc = _mm_crc32_u32(crc, detail::load_le32(p));
+#endif
+		for (; length; --length, ++p)
+			crc = _mm_crc32_u8(crc, *p);
+		return crc;
+	}
+
+	HASHTOOLS_TARGET("sse4.2,pclmul")
+	uint32_t crc32c_shift_clmul(uint32_t crc, uint64_t k) noexcept
+	{
+		const __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(int(crc)), _mm_set_epi64x(0, int64_t(k)), 0x00);
+#ifdef HASHTOOLS_X64
+		return uint32_t(_mm_crc32_u64(0, uint64_t(_mm_cvtsi128_si64(product))));
+#else
+		const uint32_t lo = uint32_t(_mm_cvtsi128_si32(product));
+		const uint32_t hi = uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(product, 4)));
+		return _mm_crc32_u32(_mm_crc32_u32(0, lo), hi);
+#endif
+	}
+
+	// Three independent crc32 chains keep the instruction's pipeline full
+	// (latency 3, throughput 1); the chains are merged with two shifts.
+	HASHTOOLS_TARGET("sse4.2,pclmul")
+	uint32_t crc32c_sse42_clmul(uint32_t crc, const uint8_t* p, size_t length) noexcept
+	{
+		const crc32c_state& s = crc32c_tables();
+		const size_t strides[2] = { k_long, k_short };
+		const uint64_t* shifts[2] = { s.shiftLong, s.shiftShort };
+		for (int level = 0; level < 2; ++level)
+		{
+			const size_t stride = strides[level];
+			while (length >= 3 * stride)
+			{
+#ifdef HASHTOOLS_X64
+				uint64_t c0 = crc, c1 = 0, c2 = 0;
+				for (size_t i = 0; i < stride; i += 8)
+				{
+					c0 = _mm_crc32_u64(c0, detail::load_le64(p + i));
+					c1 = _mm_crc32_u64(c1, detail::load_le64(p + stride + i));
+					c2 = _mm_crc32_u64(c2, detail::load_le64(p + 2 * stride + i));
+				}
+#else
+				uint32_t c0 = crc, c1 = 0, c2 = 0;
+				for (size_t i = 0; i < stride; i += 4)
+				{
+					c0 = _mm_crc32_u32(c0, detail::load_le32(p + i));
+					c1 = _mm_crc32_u32(c1, detail::load_le32(p + stride + i));
+					c2 = _mm_crc32_u32(c2, detail::load_le32(p + 2 * stride + i));
+				}
+#endif
+				crc = crc32c_shift_clmul(uint32_t(c0), shifts[level][1]) ^
+				      crc32c_shift_clmul(uint32_t(c1), shifts[level][0]) ^ uint32_t(c2);
+				p += 3 * stride;
+				length -= 3 * stride;
+			}
+		}
+		return crc32c_bytes_sse42(crc, p, length);
+	}
+
+	HASHTOOLS_TARGET("sse2,pclmul")
+	inline __m128i fold(__m128i lane, __m128i k, __m128i next) noexcept
+	{
+		return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(lane, k, 0x00), _mm_clmulepi64_si128(lane, k, 0x11)), next);
+	}
+
+	// Folds 16-byte lanes forward with carry-less multiplies until one lane
+	// is left; its 16 bytes then go through the table with a zero register.
+	// length must be at least 64.
+	HASHTOOLS_TARGET("sse2,pclmul")
+	uint64_t crc64_clmul(uint64_t crc, const uint8_t* p, size_t length) noexcept
+	{
+		const crc64_state& s = crc64_tables();
+		const __m128i k512 = _mm_set_epi64x(int64_t(s.fold512[1]), int64_t(s.fold512[0]));
+		const __m128i k128 = _mm_set_epi64x(int64_t(s.fold128[1]), int64_t(s.fold128[0]));
+
+		__m128i x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)p), _mm_set_epi64x(0, int64_t(crc)));
+		__m128i x1 = _mm_loadu_si128((const __m128i*)(p + 16));
+		__m128i x2 = _mm_loadu_si128((const __m128i*)(p + 32));
+		__m128i x3 = _mm_loadu_si128((const __m128i*)(p + 48));
+		p += 64;
+		length -= 64;
+
+		for (; length >= 64; length -= 64, p += 64)
+		{
+			x0 = fold(x0, k512, _mm_loadu_si128((const __m128i*)p));
+			x1 = fold(x1, k512, _mm_loadu_si128((const __m128i*)(p + 16)));
+			x2 = fold(x2, k512, _mm_loadu_si128((const __m128i*)(p + 32)));
+			x3 = fold(x3, k512, _mm_loadu_si128((const __m128i*)(p + 48)));
+		}
+
+		x0 = fold(x0, k128, x1);
+		x0 = fold(x0, k128, x2);
+		x0 = fold(x0, k128, x3);
+		for (; length >= 16; length -= 16, p += 16)
+			x0 = fold(x0, k128, _mm_loadu_si128((const __m128i*)p));
+
+		uint8_t lane[16];
+		_mm_storeu_si128((__m128i*)lane, x0);
+		return s.update(s.update(0, lane, 16), p, length);
+	}
+#endif
+}
+
+EXPORT uint32_t crc32c(const void* data, size_t length, uint32_t crc) noexcept
+{
+	const uint8_t* p = (const uint8_t*)data;
+	crc = ~crc;
+#ifdef HASHTOOLS_X86
+	if (detail::cpu().sse42 && detail::cpu().pclmul)
+		return ~crc32c_sse42_clmul(crc, p, length);
+	if (detail::cpu().sse42)
+		return ~crc32c_bytes_sse42(crc, p, length);
+#endif
+	return ~crc32c_tables().update(crc, p, length);
+}
+
+EXPORT uint32_t crc32c_combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB) noexcept
+{
+	const crc32c_state& s = crc32c_tables();
+	return crc_tables<uint32_t>::mul(s.xn_mod_p(8 * lengthB, k_crc32c_poly), crcA, k_crc32c_poly) ^ crcB;
+}
+
+EXPORT uint64_t crc64(const void* data, size_t length, uint64_t crc) noexcept
+{
+	const uint8_t* p = (const uint8_t*)data;
+	crc = ~crc;
+#ifdef HASHTOOLS_X86
+	if (length >= 64 && detail::cpu().pclmul)
+		return ~crc64_clmul(crc, p, length);
+#endif
+	return ~crc64_tables().update(crc, p, length);
+}
+
+EXPORT uint64_t crc64_combine(uint64_t crcA, uint64_t crcB, uint64_t lengthB) noexcept
+{
+	const crc64_state& s = crc64_tables();
+	return crc_tables<uint64_t>::mul(s.xn_mod_p(8 * lengthB, k_crc64_poly), crcA, k_crc64_poly) ^ crcB;
+}
+
+END_HASHTOOLS_NS
@@ -0,0 +1,494 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+fingerprint.cpp -- Tree walker, bounded work queue and block readers
+
+On Windows the reader keeps one overlapped ReadFile in flight while the
+previous block is hashed.  Elsewhere each worker reads synchronously with
+pread and a sequential-access hint; the kernel's readahead overlaps those
+reads with hashing and the other workers supply the queue depth.
+\*****************************************************************************/
+
+#include "hashTools.h"
+#include "fingerprint.h"
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+BEGIN_HASHTOOLS_NS
+
+namespace
+{
+	class block_hasher
+	{
+	public:
+		explicit block_hasher(fingerprint_hash hash) noexcept : m_hash(hash), m_crc(0)
+		{
+			if (m_hash == fingerprint_hash::spooky_128)
+				spooky_init(m_spooky);
+			else if (m_hash == fingerprint_hash::md5)
+				md5_init(m_md5);
+		}
+
+		void update(const void* data, size_t length) noexcept
+		{
+			if (m_hash == fingerprint_hash::spooky_128)
+				spooky_update(m_spooky, data, length);
+			else if (m_hash == fingerprint_hash::md5)
+				md5_update(m_md5, data, length);
+			else
+				m_crc = crc32c(data, length, m_crc);
+		}
+
+		unsigned final(unsigned char* digest) noexcept
+		{
+			if (m_hash == fingerprint_hash::spooky_128)
+			{
+				uint64_t high;
+				const uint64_t low = spooky_final(m_spooky, &high);
+				for (int i = 0; i < 8; ++i)
+				{
+					digest[i] = (unsigned char)(low >> (8 * i));
+					digest[8 + i] = (unsigned char)(high >> (8 * i));
+				}
+				return 16;
+			}
+			if (m_hash == fingerprint_hash::md5)
+			{
+				md5_final(m_md5, digest);
+				return 16;
+			}
+			memset(digest, 0, 16);
+			for (int i = 0; i < 4; ++i)
+				digest[i] = (unsigned char)(m_crc >> (8 * (3 - i)));
+			return 4;
+		}
+
+	private:
+		fingerprint_hash m_hash;
+		spooky_state m_spooky;
+		md5_state m_md5;
+		uint32_t m_crc;
+	};
+
+	// Fixed-capacity queue; push blocks while full, pop blocks while empty
+	// and returns false once the queue is closed and drained
+	template <class T>
+	class bounded_queue
+	{
+	public:
+		explicit bounded_queue(size_t capacity) : m_capacity(capacity ? capacity : 1), m_closed(false) {}
+
+		void push(T&& item)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_notFull.wait(lock, [this]() { return m_items.size() < m_capacity; });
+			m_items.push_back(std::move(item));
+			m_notEmpty.notify_one();
+		}
+
+		bool pop(T& item)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_notEmpty.wait(lock, [this]() { return !m_items.empty() || m_closed; });
+			if (m_items.empty())
+				return false;
+			item = std::move(m_items.front());
+			m_items.pop_front();
+			m_notFull.notify_one();
+			return true;
+		}
+
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_closed = true;
+			m_notEmpty.notify_all();
+		}
+
+	private:
+		size_t m_capacity;
+		bool m_closed;
+		std::deque<T> m_items;
+		std::mutex m_mutex;
+		std::condition_variable m_notEmpty;
+		std::condition_variable m_notFull;
+	};
+
+#ifdef _WIN32
+	std::wstring widen(const std::string& utf8)
+	{
+		std::wstring wide;
+		const int n = MultiByteToWideChar(CP_UTF8, 0, utf8.data(), (int)utf8.size(), NULL, 0);
+		if (n > 0)
+		{
+			wide.resize(n);
+			MultiByteToWideChar(CP_UTF8, 0, utf8.data(), (int)utf8.size(), &wide[0], n);
+		}
+		return wide;
+	}
+
+	std::string narrow(const wchar_t* wide)
+	{
+		std::string utf8;
+		const int n = WideCharToMultiByte(CP_UTF8, 0, wide, -1, NULL, 0, NULL, NULL);
+		if (n > 1)
+		{
+			utf8.resize(n - 1);
+			WideCharToMultiByte(CP_UTF8, 0, wide, -1, &utf8[0], n, NULL, NULL);
+		}
+		return utf8;
+	}
+
+	// Two buffers, two OVERLAPPED: the read of block n + 1 is issued before
+	// block n is hashed
+	const size_t k_read_buffers = 2;
+
+	int hash_file(const std::string& path, block_hasher& hasher, std::vector<char>* buffers, uint64_t& size)
+	{
+		const HANDLE file = CreateFileW(widen(path).c_str(), GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+			FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return (int)GetLastError();
+
+		OVERLAPPED ov[2];
+		ZeroMemory(ov, sizeof(ov));
+		ov[0].hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+		ov[1].hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+		const DWORD blockSize = (DWORD)buffers[0].size();
+
+		auto issue = [&](int slot, uint64_t offset) -> DWORD {
+			ov[slot].Offset = (DWORD)(offset & 0xFFFFFFFF);
+			ov[slot].OffsetHigh = (DWORD)(offset >> 32);
+			ResetEvent(ov[slot].hEvent);
+			if (ReadFile(file, buffers[slot].data(), blockSize, NULL, &ov[slot]))
+				return ERROR_SUCCESS;
+			const DWORD err = GetLastError();
+			return err == ERROR_IO_PENDING ? ERROR_SUCCESS : err;
+		};
+
+		int error = 0;
+		uint64_t offset = 0;
+		int slot = 0;
+		DWORD err = issue(slot, offset);
+		bool pending = err == ERROR_SUCCESS;
+		if (err != ERROR_SUCCESS && err != ERROR_HANDLE_EOF)
+			error = (int)err;
+		while (pending)
+		{
+			DWORD got = 0;
+			if (!GetOverlappedResult(file, &ov[slot], &got, TRUE))
+			{
+				err = GetLastError();
+				if (err != ERROR_HANDLE_EOF)
+					error = (int)err;
+				break;
+			}
+			offset += got;
+			pending = false;
+			if (got == blockSize)
+			{
+				err = issue(slot ^ 1, offset);
+				pending = err == ERROR_SUCCESS;
+				if (err != ERROR_SUCCESS && err != ERROR_HANDLE_EOF)
+					error = (int)err;
+			}
+			hasher.update(buffers[slot].data(), got);
+			slot ^= 1;
+			if (error)
+				break;
+		}
+		if (pending)
+		{
+			// Leaving early with a read in flight: it must finish before
+			// its buffer and OVERLAPPED go away
+			CancelIoEx(file, &ov[slot]);
+			DWORD ignored;
+			GetOverlappedResult(file, &ov[slot], &ignored, TRUE);
+		}
+		CloseHandle(ov[0].hEvent);
+		CloseHandle(ov[1].hEvent);
+		CloseHandle(file);
+		size = offset;
+		return error;
+	}
+
+	// Depth-first, one directory listing in memory at a time.  visit(relative)
+	// is called for each regular file.
+	template <class Visit>
+	void walk_tree(const std::string& root, Visit visit)
+	{
+		std::vector<std::string> pending(1, std::string());
+		while (!pending.empty())
+		{
+			const std::string dir = pending.back();
+			pending.pop_back();
+			const std::wstring pattern = widen(dir.empty() ? root : root + "/" + dir) + L"\\*";
+			WIN32_FIND_DATAW data;
+			const HANDLE find = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data,
+				FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+			if (find == INVALID_HANDLE_VALUE)
+				continue;
+			do
+			{
+				if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+					continue;
+				if (wcscmp(data.cFileName, L".") == 0 || wcscmp(data.cFileName, L"..") == 0)
+					continue;
+				const std::string relative = dir.empty() ? narrow(data.cFileName) : dir + "/" + narrow(data.cFileName);
+				if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+					pending.push_back(relative);
+				else
+					visit(relative);
+			} while (FindNextFileW(find, &data));
+			FindClose(find);
+		}
+	}
+#else
+	// One buffer; readahead does the overlapping
+	const size_t k_read_buffers = 1;
+
+	int hash_file(const std::string& path, block_hasher& hasher, std::vector<char>* buffers, uint64_t& size)
+	{
+		const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return errno;
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+		int error = 0;
+		uint64_t offset = 0;
+		for (;;)
+		{
+			const ssize_t got = pread(fd, buffers[0].data(), buffers[0].size(), (off_t)offset);
+			if (got < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				error = errno;
+				break;
+			}
+			if (got == 0)
+				break;
+			hasher.update(buffers[0].data(), (size_t)got);
+			offset += (uint64_t)got;
+		}
+		close(fd);
+		size = offset;
+		return error;
+	}
+
+	template <class Visit>
+	void walk_tree(const std::string& root, Visit visit)
+	{
+		std::vector<std::string> pending(1, std::string());
+		while (!pending.empty())
+		{
+			const std::string dir = pending.back();
+			pending.pop_back();
+			const std::string full = dir.empty() ? root : root + "/" + dir;
+			DIR* d = opendir(full.c_str());
+			if (!d)
+				continue;
+			while (const dirent* e = readdir(d))
+			{
+				if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+					continue;
+				const std::string relative = dir.empty() ? std::string(e->d_name) : dir + "/" + e->d_name;
+				bool isDir = false, isFile = false;
+#ifdef DT_DIR
+				isDir = e->d_type == DT_DIR;
+				isFile = e->d_type == DT_REG;
+				if (e->d_type == DT_UNKNOWN)
+#endif
+				{
+					struct stat st;
+					if (lstat((root + "/" + relative).c_str(), &st) == 0)
+					{
+						isDir = S_ISDIR(st.st_mode);
+						isFile = S_ISREG(st.st_mode);
+					}
+				}
+				if (isDir)
+					pending.push_back(relative);
+				else if (isFile)
+					visit(relative);
+			}
+			closedir(d);
+		}
+	}
+#endif
+
+	// Closes the queue and joins the workers however fingerprint_tree leaves
+	struct worker_joiner
+	{
+		bounded_queue<std::string>& queue;
+		std::vector<std::thread>& workers;
+
+		~worker_joiner()
+		{
+			queue.close();
+			for (std::thread& worker : workers)
+				worker.join();
+		}
+	};
+
+	struct sink_writer
+	{
+		FILE* out;
+	};
+
+	void manifest_sink(void* context, const fingerprint_entry& entry)
+	{
+		write_fingerprint_entry(((sink_writer*)context)->out, entry);
+	}
+}
+
+EXPORT int fingerprint_file(const char* path, fingerprint_hash hash, unsigned char* digest, uint64_t* size, uint32_t blockSize) noexcept
+{
+	try
+	{
+		std::vector<char> buffers[k_read_buffers];
+		for (std::vector<char>& buffer : buffers)
+			buffer.resize(blockSize ? blockSize : 1 << 20);
+		block_hasher hasher(hash);
+		uint64_t length = 0;
+		const int error = hash_file(path, hasher, buffers, length);
+		hasher.final(digest);
+		if (size)
+			*size = length;
+		return error;
+	}
+	catch (const std::bad_alloc&)
+	{
+		return ENOMEM;
+	}
+}
+
+EXPORT uint64_t fingerprint_tree(const char* root, const fingerprint_options& options, fingerprint_sink sink, void* context)
+{
+	unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+	if (!threads)
+		threads = 1;
+	const size_t blockSize = options.blockSize ? options.blockSize : 1 << 20;
+	const std::string base(root);
+
+	bounded_queue<std::string> queue(options.queueDepth ? options.queueDepth : 4 * threads);
+	std::mutex sinkMutex;
+	uint64_t files = 0;
+	// The first exception out of the sink; later files are skipped and it is
+	// rethrown once the workers are done
+	std::exception_ptr sinkError;
+	std::atomic<bool> stopped(false);
+
+	std::vector<std::thread> workers;
+	worker_joiner joiner = { queue, workers };
+	for (unsigned t = 0; t < threads; ++t)
+		workers.emplace_back([&]() {
+			// A worker that cannot get its buffers, or the memory to name a
+			// file, still drains the queue and reports ENOMEM for each file
+			std::vector<char> buffers[k_read_buffers];
+			bool buffered = true;
+			try
+			{
+				for (std::vector<char>& buffer : buffers)
+					buffer.resize(blockSize);
+			}
+			catch (const std::bad_alloc&)
+			{
+				buffered = false;
+			}
+			std::string relative;
+			while (queue.pop(relative))
+			{
+				if (stopped.load(std::memory_order_relaxed))
+					continue;
+				block_hasher hasher(options.hash);
+				fingerprint_entry entry;
+				entry.path = relative.c_str();
+				entry.size = 0;
+				try
+				{
+					entry.error = buffered ? hash_file(base + "/" + relative, hasher, buffers, entry.size) : ENOMEM;
+				}
+				catch (const std::bad_alloc&)
+				{
+					entry.error = ENOMEM;
+				}
+				entry.digestSize = hasher.final(entry.digest);
+
+				std::lock_guard<std::mutex> lock(sinkMutex);
+				if (sinkError)
+					continue;
+				try
+				{
+					sink(context, entry);
+					++files;
+				}
+				catch (...)
+				{
+					sinkError = std::current_exception();
+					stopped.store(true, std::memory_order_relaxed);
+				}
+			}
+		});
+
+	walk_tree(base, [&](const std::string& relative) { queue.push(std::string(relative)); });
+	queue.close();
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+	if (sinkError)
+		std::rethrow_exception(sinkError);
+	return files;
+}
+
+EXPORT void write_fingerprint_entry(FILE* out, const fingerprint_entry& entry) noexcept
+{
+	if (entry.error)
+	{
+		fprintf(out, "error:%d  0  %s\n", entry.error, entry.path);
+		return;
+	}
+	char hex[33];
+	for (unsigned i = 0; i < entry.digestSize; ++i)
+	{
+		hex[2 * i] = "0123456789abcdef"[entry.digest[i] >> 4];
+		hex[2 * i + 1] = "0123456789abcdef"[entry.digest[i] & 0xF];
+	}
+	hex[2 * entry.digestSize] = 0;
+	fprintf(out, "%s  %llu  %s\n", hex, (unsigned long long)entry.size, entry.path);
+}
+
+EXPORT uint64_t write_fingerprint_manifest(const char* root, FILE* out, const fingerprint_options& options)
+{
+	sink_writer writer = { out };
+	return fingerprint_tree(root, options, manifest_sink, &writer);
+}
+
+END_HASHTOOLS_NS
@@ -13,18 +13,7 @@ Some slight modifications because C++11.
 \*****************************************************************************/
 
 #include "hashTools.h"
-
-//#include "pstdint.h" /* Replace with <stdint.h> if appropriate */
-#undef get16bits
-#if (defined(__GNUC__) && defined(__i386__)) || defined(__WATCOMC__) \
-  || defined(_MSC_VER) || defined (__BORLANDC__) || defined (__TURBOC__)
-#define get16bits(d) (*((const uint16_t *) (d)))
-#endif
-
-#if !defined (get16bits)
-#define get16bits(d) ((((uint32_t)(((const uint8_t *)(d))[1])) << 8)\
-                       +(uint32_t)(((const uint8_t *)(d))[0]) )
-#endif
+#include "word_load.h"
 
 BEGIN_HASHTOOLS_NS
 
@@ -41,10 +30,22 @@ EXPORT uint32_t hseih_32(const void* message, size_t size, uint32_t initialVal)
 	rem = size & 3;
 	size >>= 2;
 
-	/* Main loop */
-	for (; size; --size) {
-		hash += get16bits(data);
-		tmp = (get16bits(data + 2) << 11) ^ hash;
+	/* Main loop, two rounds per 8-byte load */
+	for (; size >= 2; size -= 2) {
+		const uint64_t w = detail::load_le64(data);
+		hash += uint32_t(w) & 0xFFFF;
+		tmp = ((uint32_t(w >> 16) & 0xFFFF) << 11) ^ hash;
+		hash = (hash << 16) ^ tmp;
+		hash += hash >> 11;
+		hash += uint32_t(w >> 32) & 0xFFFF;
+		tmp = (uint32_t(w >> 48) << 11) ^ hash;
+		hash = (hash << 16) ^ tmp;
+		hash += hash >> 11;
+		data += 4 * sizeof(uint16_t);
+	}
+	if (size) {
+		hash += detail::load_le16(data);
+		tmp = (uint32_t(detail::load_le16(data + 2)) << 11) ^ hash;
 		hash = (hash << 16) ^ tmp;
 		data += 2 * sizeof(uint16_t);
 		hash += hash >> 11;
@@ -52,12 +53,12 @@ EXPORT uint32_t hseih_32(const void* message, size_t size, uint32_t initialVal)
 
 	/* Handle end cases */
 	switch (rem) {
-	case 3: hash += get16bits(data);
+	case 3: hash += detail::load_le16(data);
 		hash ^= hash << 16;
 		hash ^= ((signed char)data[sizeof(uint16_t)]) << 18;
 		hash += hash >> 11;
 		break;
-	case 2: hash += get16bits(data);
+	case 2: hash += detail::load_le16(data);
 		hash ^= hash << 11;
 		hash += hash >> 17;
 		break;
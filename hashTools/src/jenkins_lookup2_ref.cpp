@@ -12,6 +12,7 @@ Some slight modifications because C++11.
 \*****************************************************************************/
 
 #include "hashTools.h"
+#include "word_load.h"
 
 BEGIN_HASHTOOLS_NS
 
@@ -101,30 +102,25 @@ EXPORT uint32_t jenkins_lookup2_32(
 						   /*---------------------------------------- handle most of the key */
 	while (len >= 12)
 	{
-		a += (k[0] + ((uint32_t)k[1] << 8) + ((uint32_t)k[2] << 16) + ((uint32_t)k[3] << 24));
-		b += (k[4] + ((uint32_t)k[5] << 8) + ((uint32_t)k[6] << 16) + ((uint32_t)k[7] << 24));
-		c += (k[8] + ((uint32_t)k[9] << 8) + ((uint32_t)k[10] << 16) + ((uint32_t)k[11] << 24));
+		a += detail::load_le32(k);
+		b += detail::load_le32(k + 4);
+		c += detail::load_le32(k + 8);
 		mix(a, b, c);
 		k += 12; len -= 12;
 	}
 
 	/*------------------------------------- handle the last 11 bytes */
 	c += length;
-	switch (len)              /* all the case statements fall through */
+	if (len)
 	{
-	case 11: c += ((uint32_t)k[10] << 24);
-	case 10: c += ((uint32_t)k[9] << 16);
-	case 9: c += ((uint32_t)k[8] << 8);
-		/* the first byte of c is reserved for the length */
-	case 8: b += ((uint32_t)k[7] << 24);
-	case 7: b += ((uint32_t)k[6] << 16);
-	case 6: b += ((uint32_t)k[5] << 8);
-	case 5: b += k[4];
-	case 4: a += ((uint32_t)k[3] << 24);
-	case 3: a += ((uint32_t)k[2] << 16);
-	case 2: a += ((uint32_t)k[1] << 8);
-	case 1: a += k[0];
-		/* case 0: nothing left to add */
+		/* zero padding adds nothing, so whole words give the same sums as
+		   the byte-by-byte switch; the first byte of c is reserved for the
+		   length */
+		uint8_t tail[12] = { 0 };
+		memcpy(tail, k, len);
+		a += detail::load_le32(tail);
+		b += detail::load_le32(tail + 4);
+		c += detail::load_le32(tail + 8) << 8;
 	}
 	mix(a, b, c);
 	/*-------------------------------------------- report the result */
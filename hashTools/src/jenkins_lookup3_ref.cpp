@@ -12,6 +12,7 @@ Some slight modifications because C++11.
 \*****************************************************************************/
 
 #include "hashTools.h"
+#include "word_load.h"
 
 /*
 These are functions for producing 32-bit hashes for hash table lookup.
@@ -46,8 +47,13 @@ on 1 byte), but shoehorning those bytes into integers efficiently is messy.
 -------------------------------------------------------------------------------
 */
 
+#if HASHTOOLS_LITTLE_ENDIAN
 # define HASH_LITTLE_ENDIAN 1
 # define HASH_BIG_ENDIAN 0
+#else
+# define HASH_LITTLE_ENDIAN 0
+# define HASH_BIG_ENDIAN 1
+#endif
 
 #define hashsize(n) ((uint32_t)1<<(n))
 #define hashmask(n) (hashsize(n)-1)
@@ -681,18 +687,93 @@ uint32_t hashbig(const void *key, size_t length, uint32_t initval)
 	return c;
 }
 
+/*
+-------------------------------------------------------------------------------
+hash_words() -- hashlittle2()/hashbig() for a fixed byte order
+
+Words reads the key's 32-bit words as little- or big-endian with a single
+(unaligned) load and at most a byte swap, so the result does not depend on
+the host.  The partial last block is zero-padded into a local buffer, which
+gives the same value as the masking and byte cases above.  With le_words
+this is hashlittle2(); with be_words it is hashbig() (in *pc) and the
+hashbig2() that lookup3.c does not provide (in *pb).
+-------------------------------------------------------------------------------
+*/
+template <class Words>
+void hash_words(const void *key, size_t length, uint32_t *pc, uint32_t *pb)
+{
+	uint32_t a, b, c;
+	const uint8_t *k = (const uint8_t *)key;
+
+	a = b = c = 0xdeadbeef + ((uint32_t)length) + *pc;
+	c += *pb;
+
+	while (length > 12)
+	{
+		a += Words::load32(k);
+		b += Words::load32(k + 4);
+		c += Words::load32(k + 8);
+		mix(a, b, c);
+		length -= 12;
+		k += 12;
+	}
+
+	if (length == 0)                   /* zero length strings require no mixing */
+	{
+		*pc = c; *pb = b;
+		return;
+	}
+
+	uint8_t tail[12] = { 0 };
+	memcpy(tail, k, length);
+	a += Words::load32(tail);
+	b += Words::load32(tail + 4);
+	c += Words::load32(tail + 8);
+
+	final(a, b, c);
+	*pc = c; *pb = b;
+}
+
 BEGIN_HASHTOOLS_NS
+namespace
+{
+	inline byte_order resolve(byte_order order) noexcept
+	{
+		if (order == byte_order::native)
+			return HASHTOOLS_LITTLE_ENDIAN ? byte_order::little : byte_order::big;
+		return order;
+	}
+}
+
 EXPORT uint32_t jenkins_lookup3_32(const void* key, size_t length, uint32_t initialValue) noexcept
 {
-	return hashlittle(key, length, initialValue);
+	return jenkins_lookup3_32(key, length, initialValue, byte_order::little);
 }
 
 EXPORT uint64_t jenkins_lookup3_64(const void* key, size_t length, uint64_t initialValue) noexcept
 {
-	// TODO: Add control for big-ending and selecing hashbig instead
+	return jenkins_lookup3_64(key, length, initialValue, byte_order::little);
+}
+
+EXPORT uint32_t jenkins_lookup3_32(const void* key, size_t length, uint32_t initialValue, byte_order order) noexcept
+{
+	return uint32_t(jenkins_lookup3_64(key, length, initialValue, order));
+}
+
+EXPORT uint64_t jenkins_lookup3_64(const void* key, size_t length, uint64_t initialValue, byte_order order) noexcept
+{
 	uint32_t a = initialValue & 0xFFFFFFFF;
 	uint32_t b = initialValue >> 32;
-	hashlittle2(key, length, &a, &b);
+	order = resolve(order);
+	// hashlittle2()'s word loop is a little quicker for short aligned keys;
+	// its unaligned paths read a byte or half-word at a time, so those go
+	// through hash_words().
+	if (HASH_LITTLE_ENDIAN && order == byte_order::little && ((uintptr_t)key & 0x3) == 0)
+		hashlittle2(key, length, &a, &b);
+	else if (order == byte_order::little)
+		hash_words<detail::le_words>(key, length, &a, &b);
+	else
+		hash_words<detail::be_words>(key, length, &a, &b);
 	return a | (uint64_t(b) << 32);
 }
 
@@ -12,6 +12,7 @@ Some slight modifications because C++11.
 \*****************************************************************************/
 
 #include "hashTools.h"
+#include "word_load.h"
 #include <memory.h>
 
 #pragma warning(disable : 4127)
@@ -43,7 +44,11 @@ BEGIN_HASHTOOLS_NS
 // the CRCs of wholes.  There are also cryptographic hashes, but those are even 
 // slower than MD5.
 //
+// Words is detail::le_words or detail::be_words and sets the byte order in
+// which the message's 64- and 32-bit words are read.
+//
 
+template <class Words>
 class SpookyHash
 {
 public:
@@ -131,23 +136,23 @@ public:
 	// I tried 3 pairs of each; they all differed by at least 212 bits.
 	//
 	static inline void Mix(
-		const uint64_t *data,
+		const uint8_t *data,
 		uint64_t &s0, uint64_t &s1, uint64_t &s2, uint64_t &s3,
 		uint64_t &s4, uint64_t &s5, uint64_t &s6, uint64_t &s7,
 		uint64_t &s8, uint64_t &s9, uint64_t &s10, uint64_t &s11)
 	{
-		s0 += data[0];    s2 ^= s10;    s11 ^= s0;    s0 = Rot64(s0, 11);    s11 += s1;
-		s1 += data[1];    s3 ^= s11;    s0 ^= s1;    s1 = Rot64(s1, 32);    s0 += s2;
-		s2 += data[2];    s4 ^= s0;    s1 ^= s2;    s2 = Rot64(s2, 43);    s1 += s3;
-		s3 += data[3];    s5 ^= s1;    s2 ^= s3;    s3 = Rot64(s3, 31);    s2 += s4;
-		s4 += data[4];    s6 ^= s2;    s3 ^= s4;    s4 = Rot64(s4, 17);    s3 += s5;
-		s5 += data[5];    s7 ^= s3;    s4 ^= s5;    s5 = Rot64(s5, 28);    s4 += s6;
-		s6 += data[6];    s8 ^= s4;    s5 ^= s6;    s6 = Rot64(s6, 39);    s5 += s7;
-		s7 += data[7];    s9 ^= s5;    s6 ^= s7;    s7 = Rot64(s7, 57);    s6 += s8;
-		s8 += data[8];    s10 ^= s6;    s7 ^= s8;    s8 = Rot64(s8, 55);    s7 += s9;
-		s9 += data[9];    s11 ^= s7;    s8 ^= s9;    s9 = Rot64(s9, 54);    s8 += s10;
-		s10 += data[10];    s0 ^= s8;    s9 ^= s10;    s10 = Rot64(s10, 22);    s9 += s11;
-		s11 += data[11];    s1 ^= s9;    s10 ^= s11;    s11 = Rot64(s11, 46);    s10 += s0;
+		s0 += Words::load64(data + 0);    s2 ^= s10;    s11 ^= s0;    s0 = Rot64(s0, 11);    s11 += s1;
+		s1 += Words::load64(data + 8);    s3 ^= s11;    s0 ^= s1;    s1 = Rot64(s1, 32);    s0 += s2;
+		s2 += Words::load64(data + 16);    s4 ^= s0;    s1 ^= s2;    s2 = Rot64(s2, 43);    s1 += s3;
+		s3 += Words::load64(data + 24);    s5 ^= s1;    s2 ^= s3;    s3 = Rot64(s3, 31);    s2 += s4;
+		s4 += Words::load64(data + 32);    s6 ^= s2;    s3 ^= s4;    s4 = Rot64(s4, 17);    s3 += s5;
+		s5 += Words::load64(data + 40);    s7 ^= s3;    s4 ^= s5;    s5 = Rot64(s5, 28);    s4 += s6;
+		s6 += Words::load64(data + 48);    s8 ^= s4;    s5 ^= s6;    s6 = Rot64(s6, 39);    s5 += s7;
+		s7 += Words::load64(data + 56);    s9 ^= s5;    s6 ^= s7;    s7 = Rot64(s7, 57);    s6 += s8;
+		s8 += Words::load64(data + 64);    s10 ^= s6;    s7 ^= s8;    s8 = Rot64(s8, 55);    s7 += s9;
+		s9 += Words::load64(data + 72);    s11 ^= s7;    s8 ^= s9;    s9 = Rot64(s9, 54);    s8 += s10;
+		s10 += Words::load64(data + 80);    s0 ^= s8;    s9 ^= s10;    s10 = Rot64(s10, 22);    s9 += s11;
+		s11 += Words::load64(data + 88);    s1 ^= s9;    s10 ^= s11;    s11 = Rot64(s11, 46);    s10 += s0;
 	}
 
 	//
@@ -186,14 +191,14 @@ public:
 	}
 
 	static inline void End(
-		const uint64_t *data,
+		const uint8_t *data,
 		uint64_t &h0, uint64_t &h1, uint64_t &h2, uint64_t &h3,
 		uint64_t &h4, uint64_t &h5, uint64_t &h6, uint64_t &h7,
 		uint64_t &h8, uint64_t &h9, uint64_t &h10, uint64_t &h11)
 	{
-		h0 += data[0];   h1 += data[1];   h2 += data[2];   h3 += data[3];
-		h4 += data[4];   h5 += data[5];   h6 += data[6];   h7 += data[7];
-		h8 += data[8];   h9 += data[9];   h10 += data[10]; h11 += data[11];
+		h0 += Words::load64(data + 0);   h1 += Words::load64(data + 8);   h2 += Words::load64(data + 16);   h3 += Words::load64(data + 24);
+		h4 += Words::load64(data + 32);   h5 += Words::load64(data + 40);   h6 += Words::load64(data + 48);   h7 += Words::load64(data + 56);
+		h8 += Words::load64(data + 64);   h9 += Words::load64(data + 72);   h10 += Words::load64(data + 80); h11 += Words::load64(data + 88);
 		EndPartial(h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
 		EndPartial(h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
 		EndPartial(h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
@@ -306,34 +311,21 @@ private:
 //   July 30 2012: I reintroduced the buffer overflow
 //   August 5 2012: SpookyV2: d = should be d += in short hash, and remove extra mix from long hash
 
-#define ALLOW_UNALIGNED_READS 1
+// The word loads go through memcpy (see word_load.h), so unaligned messages
+// need no copying.
 
 //
 // short hash ... it could be used on any message, 
 // but it's used by Spooky just for short messages.
 //
-void SpookyHash::Short(
+template <class Words>
+void SpookyHash<Words>::Short(
 	const void *message,
 	size_t length,
 	uint64_t *hash1,
 	uint64_t *hash2)
 {
-	uint64_t buf[2 * sc_numVars];
-	union
-	{
-		const uint8_t *p8;
-		uint32_t *p32;
-		uint64_t *p64;
-		size_t i;
-	} u;
-
-	u.p8 = (const uint8_t *)message;
-
-	if (!ALLOW_UNALIGNED_READS && (u.i & 0x7))
-	{
-		memcpy(buf, message, length);
-		u.p64 = buf;
-	}
+	const uint8_t *p = (const uint8_t *)message;
 
 	size_t remainder = length % 32;
 	uint64_t a = *hash1;
@@ -343,25 +335,25 @@ void SpookyHash::Short(
 
 	if (length > 15)
 	{
-		const uint64_t *end = u.p64 + (length / 32) * 4;
+		const uint8_t *end = p + (length / 32) * 32;
 
 		// handle all complete sets of 32 bytes
-		for (; u.p64 < end; u.p64 += 4)
+		for (; p < end; p += 32)
 		{
-			c += u.p64[0];
-			d += u.p64[1];
+			c += Words::load64(p);
+			d += Words::load64(p + 8);
 			ShortMix(a, b, c, d);
-			a += u.p64[2];
-			b += u.p64[3];
+			a += Words::load64(p + 16);
+			b += Words::load64(p + 24);
 		}
 
 		//Handle the case of 16+ remaining bytes.
 		if (remainder >= 16)
 		{
-			c += u.p64[0];
-			d += u.p64[1];
+			c += Words::load64(p);
+			d += Words::load64(p + 8);
 			ShortMix(a, b, c, d);
-			u.p64 += 2;
+			p += 16;
 			remainder -= 16;
 		}
 	}
@@ -371,39 +363,39 @@ void SpookyHash::Short(
 	switch (remainder)
 	{
 	case 15:
-		d += ((uint64_t)u.p8[14]) << 48;
+		d += ((uint64_t)p[14]) << 48;
 	case 14:
-		d += ((uint64_t)u.p8[13]) << 40;
+		d += ((uint64_t)p[13]) << 40;
 	case 13:
-		d += ((uint64_t)u.p8[12]) << 32;
+		d += ((uint64_t)p[12]) << 32;
 	case 12:
-		d += u.p32[2];
-		c += u.p64[0];
+		d += Words::load32(p + 8);
+		c += Words::load64(p);
 		break;
 	case 11:
-		d += ((uint64_t)u.p8[10]) << 16;
+		d += ((uint64_t)p[10]) << 16;
 	case 10:
-		d += ((uint64_t)u.p8[9]) << 8;
+		d += ((uint64_t)p[9]) << 8;
 	case 9:
-		d += (uint64_t)u.p8[8];
+		d += (uint64_t)p[8];
 	case 8:
-		c += u.p64[0];
+		c += Words::load64(p);
 		break;
 	case 7:
-		c += ((uint64_t)u.p8[6]) << 48;
+		c += ((uint64_t)p[6]) << 48;
 	case 6:
-		c += ((uint64_t)u.p8[5]) << 40;
+		c += ((uint64_t)p[5]) << 40;
 	case 5:
-		c += ((uint64_t)u.p8[4]) << 32;
+		c += ((uint64_t)p[4]) << 32;
 	case 4:
-		c += u.p32[0];
+		c += Words::load32(p);
 		break;
 	case 3:
-		c += ((uint64_t)u.p8[2]) << 16;
+		c += ((uint64_t)p[2]) << 16;
 	case 2:
-		c += ((uint64_t)u.p8[1]) << 8;
+		c += ((uint64_t)p[1]) << 8;
 	case 1:
-		c += (uint64_t)u.p8[0];
+		c += (uint64_t)p[0];
 		break;
 	case 0:
 		c += sc_const;
@@ -418,7 +410,8 @@ void SpookyHash::Short(
 
 
 // do the whole hash in one call
-void SpookyHash::Hash128(
+template <class Words>
+void SpookyHash<Words>::Hash128(
 	const void *message,
 	size_t length,
 	uint64_t *hash1,
@@ -432,49 +425,26 @@ void SpookyHash::Hash128(
 
 	uint64_t h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11;
 	uint64_t buf[sc_numVars];
-	uint64_t *end;
-	union
-	{
-		const uint8_t *p8;
-		uint64_t *p64;
-		size_t i;
-	} u;
+	const uint8_t *p = (const uint8_t *)message;
+	const uint8_t *end = p + (length / sc_blockSize)*sc_blockSize;
 	size_t remainder;
 
 	h0 = h3 = h6 = h9 = *hash1;
 	h1 = h4 = h7 = h10 = *hash2;
 	h2 = h5 = h8 = h11 = sc_const;
 
-	u.p8 = (const uint8_t *)message;
-	end = u.p64 + (length / sc_blockSize)*sc_numVars;
-
 	// handle all whole sc_blockSize blocks of bytes
-	if (ALLOW_UNALIGNED_READS || ((u.i & 0x7) == 0))
-	{
-		while (u.p64 < end)
-		{
-			Mix(u.p64, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
-			u.p64 += sc_numVars;
-		}
-	}
-	else
-	{
-		while (u.p64 < end)
-		{
-			memcpy(buf, u.p64, sc_blockSize);
-			Mix(buf, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
-			u.p64 += sc_numVars;
-		}
-	}
+	for (; p < end; p += sc_blockSize)
+		Mix(p, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
 
 	// handle the last partial block of sc_blockSize bytes
-	remainder = (length - ((const uint8_t *)end - (const uint8_t *)message));
+	remainder = (length - (end - (const uint8_t *)message));
 	memcpy(buf, end, remainder);
 	memset(((uint8_t *)buf) + remainder, 0, sc_blockSize - remainder);
 	((uint8_t *)buf)[sc_blockSize - 1] = (uint8_t)remainder;
 
 	// do some final mixing 
-	End(buf, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
+	End((const uint8_t *)buf, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
 	*hash1 = h0;
 	*hash2 = h1;
 }
@@ -482,7 +452,8 @@ void SpookyHash::Hash128(
 
 
 // init spooky state
-void SpookyHash::Init(uint64_t seed1, uint64_t seed2)
+template <class Words>
+void SpookyHash<Words>::Init(uint64_t seed1, uint64_t seed2)
 {
 	m_length = 0;
 	m_remainder = 0;
@@ -492,18 +463,14 @@ void SpookyHash::Init(uint64_t seed1, uint64_t seed2)
 
 
 // add a message fragment to the state
-void SpookyHash::Update(const void *message, size_t length)
+template <class Words>
+void SpookyHash<Words>::Update(const void *message, size_t length)
 {
 	uint64_t h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11;
 	size_t newLength = length + m_remainder;
 	uint8_t  remainder;
-	union
-	{
-		const uint8_t *p8;
-		uint64_t *p64;
-		size_t i;
-	} u;
-	const uint64_t *end;
+	const uint8_t *p;
+	const uint8_t *end;
 
 	// Is this message fragment too short?  If it is, stuff it away.
 	if (newLength < sc_bufSize)
@@ -543,37 +510,21 @@ void SpookyHash::Update(const void *message, size_t length)
 	{
 		uint8_t prefix = sc_bufSize - m_remainder;
 		memcpy(&(((uint8_t *)m_data)[m_remainder]), message, prefix);
-		u.p64 = m_data;
-		Mix(u.p64, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
-		Mix(&u.p64[sc_numVars], h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
-		u.p8 = ((const uint8_t *)message) + prefix;
+		Mix((const uint8_t *)m_data, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
+		Mix((const uint8_t *)&m_data[sc_numVars], h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
+		p = ((const uint8_t *)message) + prefix;
 		length -= prefix;
 	}
 	else
 	{
-		u.p8 = (const uint8_t *)message;
+		p = (const uint8_t *)message;
 	}
 
 	// handle all whole blocks of sc_blockSize bytes
-	end = u.p64 + (length / sc_blockSize)*sc_numVars;
-	remainder = (uint8_t)(length - ((const uint8_t *)end - u.p8));
-	if (ALLOW_UNALIGNED_READS || (u.i & 0x7) == 0)
-	{
-		while (u.p64 < end)
-		{
-			Mix(u.p64, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
-			u.p64 += sc_numVars;
-		}
-	}
-	else
-	{
-		while (u.p64 < end)
-		{
-			memcpy(m_data, u.p8, sc_blockSize);
-			Mix(m_data, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
-			u.p64 += sc_numVars;
-		}
-	}
+	end = p + (length / sc_blockSize)*sc_blockSize;
+	remainder = (uint8_t)(length - (end - p));
+	for (; p < end; p += sc_blockSize)
+		Mix(p, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
 
 	// stuff away the last few bytes
 	m_remainder = remainder;
@@ -596,7 +547,8 @@ void SpookyHash::Update(const void *message, size_t length)
 
 
 // report the hash for the concatenation of all message fragments so far
-void SpookyHash::Final(uint64_t *hash1, uint64_t *hash2)
+template <class Words>
+void SpookyHash<Words>::Final(uint64_t *hash1, uint64_t *hash2)
 {
 	// init the variables
 	if (m_length < sc_bufSize)
@@ -607,7 +559,7 @@ void SpookyHash::Final(uint64_t *hash1, uint64_t *hash2)
 		return;
 	}
 
-	const uint64_t *data = (const uint64_t *)m_data;
+	uint8_t *data = (uint8_t *)m_data;
 	uint8_t remainder = m_remainder;
 
 	uint64_t h0 = m_state[0];
@@ -627,14 +579,14 @@ void SpookyHash::Final(uint64_t *hash1, uint64_t *hash2)
 	{
 		// m_data can contain two blocks; handle any whole first block
 		Mix(data, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
-		data += sc_numVars;
+		data += sc_blockSize;
 		remainder -= sc_blockSize;
 	}
 
 	// mix in the last partial block, and the length mod sc_blockSize
-	memset(&((uint8_t *)data)[remainder], 0, (sc_blockSize - remainder));
+	memset(&data[remainder], 0, (sc_blockSize - remainder));
 
-	((uint8_t *)data)[sc_blockSize - 1] = remainder;
+	data[sc_blockSize - 1] = remainder;
 
 	// do some final mixing
 	End(data, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9, h10, h11);
@@ -645,21 +597,63 @@ void SpookyHash::Final(uint64_t *hash1, uint64_t *hash2)
 
 EXPORT uint32_t spooky_32(const void* message, size_t length, uint32_t seed) noexcept
 {
-	return SpookyHash::Hash32(message, length, seed);
+	return SpookyHash<detail::le_words>::Hash32(message, length, seed);
 }
 
 EXPORT uint64_t spooky_64(const void* message, size_t length, uint64_t seed) noexcept
 {
-	return SpookyHash::Hash64(message, length, seed);
+	return SpookyHash<detail::le_words>::Hash64(message, length, seed);
 }
 
 EXPORT uint64_t spooky_128(const void* message, size_t length, uint64_t seed, uint64_t* pHigh) noexcept
+{
+	return spooky_128(message, length, seed, pHigh, byte_order::little);
+}
+
+EXPORT uint32_t spooky_32(const void* message, size_t length, uint32_t seed, byte_order order) noexcept
+{
+	uint64_t high = seed;
+	return uint32_t(spooky_128(message, length, seed, &high, order));
+}
+
+EXPORT uint64_t spooky_64(const void* message, size_t length, uint64_t seed, byte_order order) noexcept
+{
+	uint64_t high = seed;
+	return spooky_128(message, length, seed, &high, order);
+}
+
+EXPORT uint64_t spooky_128(const void* message, size_t length, uint64_t seed, uint64_t* pHigh, byte_order order) noexcept
 {
 	uint64_t dummy = seed;
 	if (!pHigh)
 		pHigh = &dummy;
-	SpookyHash::Hash128(message, length, &seed, pHigh);
+	if (order == byte_order::big || (order == byte_order::native && !HASHTOOLS_LITTLE_ENDIAN))
+		SpookyHash<detail::be_words>::Hash128(message, length, &seed, pHigh);
+	else
+		SpookyHash<detail::le_words>::Hash128(message, length, &seed, pHigh);
 	return seed;
 }
 
+typedef SpookyHash<detail::le_words> spooky_stream;
+static_assert(sizeof(spooky_stream) <= sizeof(spooky_state), "spooky_state is too small for SpookyHash");
+
+EXPORT void spooky_init(spooky_state& state, uint64_t seed1, uint64_t seed2) noexcept
+{
+	reinterpret_cast<spooky_stream&>(state).Init(seed1, seed2);
+}
+
+EXPORT void spooky_update(spooky_state& state, const void* message, size_t length) noexcept
+{
+	reinterpret_cast<spooky_stream&>(state).Update(message, length);
+}
+
+EXPORT uint64_t spooky_final(spooky_state& state, uint64_t* pHigh) noexcept
+{
+	uint64_t hash1, hash2;
+	reinterpret_cast<spooky_stream&>(state).Final(&hash1, &hash2);
+	if (pHigh)
+		*pHigh = hash2;
+	return hash1;
+}
+
 END_HASHTOOLS_NS
\ No newline at end of file
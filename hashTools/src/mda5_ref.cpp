@@ -356,10 +356,32 @@ EXPORT void md5_ref(const void* message, size_t length, unsigned char* digest) n
 	if (!digest || !message)
 		return;
 
-	MD5_CTX context;
-	MD5Init(&context);
-	MD5Update(&context, (unsigned char*)message, length);
-	MD5Final(digest, &context);
+	md5_state state;
+	md5_init(state);
+	md5_update(state, message, length);
+	md5_final(state, digest);
+}
+
+static_assert(sizeof(md5_state) == sizeof(MD5_CTX), "md5_state must mirror MD5_CTX");
+
+EXPORT void md5_init(md5_state& state) noexcept
+{
+	MD5Init((MD5_CTX*)&state);
+}
+
+EXPORT void md5_update(md5_state& state, const void* message, size_t length) noexcept
+{
+	// MD5Update takes an unsigned int length
+	unsigned char* p = (unsigned char*)message;
+	const size_t k_chunk = size_t(1) << 30;
+	for (; length > k_chunk; length -= k_chunk, p += k_chunk)
+		MD5Update((MD5_CTX*)&state, p, (unsigned int)k_chunk);
+	MD5Update((MD5_CTX*)&state, p, (unsigned int)length);
+}
+
+EXPORT void md5_final(md5_state& state, unsigned char* digest) noexcept
+{
+	MD5Final(digest, (MD5_CTX*)&state);
 }
 
 END_HASHTOOLS_NS
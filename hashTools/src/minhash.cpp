@@ -0,0 +1,200 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+minhash.cpp -- MinHash signatures and SimHash fingerprints
+\*****************************************************************************/
+
+#include "hashTools.h"
+#include "minhash.h"
+#include "cpu_features.h"
+
+BEGIN_HASHTOOLS_NS
+
+namespace
+{
+	// jenkins_lookup3_32 of a single 4-byte word: hashlittle() seeds a, b and
+	// c with 0xdeadbeef + length + seed, adds the word to a and runs final().
+	// The SIMD kernels below are lane-wise copies of this.
+	const uint32_t k_lookup3_init = 0xdeadbeef + 4;
+
+	inline uint32_t rot(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+
+	inline uint32_t lookup3_word(uint32_t word, uint32_t seed)
+	{
+		uint32_t a, b, c;
+		a = b = c = k_lookup3_init + seed;
+		a += word;
+		c ^= b; c -= rot(b, 14);
+		a ^= c; a -= rot(c, 11);
+		b ^= a; b -= rot(a, 25);
+		c ^= b; c -= rot(b, 16);
+		a ^= c; a -= rot(c, 4);
+		b ^= a; b -= rot(a, 14);
+		c ^= b; c -= rot(b, 24);
+		return c;
+	}
+
+	void minhash_scalar(const uint32_t* shingles, size_t n, const uint32_t* seeds, uint32_t first, uint32_t k, uint32_t* signature)
+	{
+		for (uint32_t i = first; i < k; ++i)
+		{
+			uint32_t m = 0xFFFFFFFF;
+			for (size_t j = 0; j < n; ++j)
+			{
+				const uint32_t h = lookup3_word(shingles[j], seeds[i]);
+				m = h < m ? h : m;
+			}
+			signature[i] = m;
+		}
+	}
+
+#ifdef HASHTOOLS_X86
+	// The whole shingle set is streamed once per group of slots, so the
+	// running minimums stay in registers: 8 slots per pass with SSE4.1 (two
+	// vectors for latency), 16 with AVX2.
+#define HASHTOOLS_LOOKUP3_FINAL(V, XOR, SUB) \
+	{ \
+		c = XOR(c, b); c = SUB(c, V(b, 14)); \
+		a = XOR(a, c); a = SUB(a, V(c, 11)); \
+		b = XOR(b, a); b = SUB(b, V(a, 25)); \
+		c = XOR(c, b); c = SUB(c, V(b, 16)); \
+		a = XOR(a, c); a = SUB(a, V(c, 4)); \
+		b = XOR(b, a); b = SUB(b, V(a, 14)); \
+		c = XOR(c, b); c = SUB(c, V(b, 24)); \
+	}
+
+	HASHTOOLS_TARGET("sse4.1")
+	inline __m128i rot128(__m128i x, int k)
+	{
+		return _mm_or_si128(_mm_slli_epi32(x, k), _mm_srli_epi32(x, 32 - k));
+	}
+
+	HASHTOOLS_TARGET("sse4.1")
+	inline __m128i lookup3_word_sse(__m128i init, __m128i word)
+	{
+		__m128i a = _mm_add_epi32(init, word), b = init, c = init;
+		HASHTOOLS_LOOKUP3_FINAL(rot128, _mm_xor_si128, _mm_sub_epi32)
+		return c;
+	}
+
+	HASHTOOLS_TARGET("sse4.1")
+	uint32_t minhash_sse41(const uint32_t* shingles, size_t n, const uint32_t* seeds, uint32_t k, uint32_t* signature)
+	{
+		const __m128i base = _mm_set1_epi32((int)k_lookup3_init);
+		uint32_t i = 0;
+		for (; i + 8 <= k; i += 8)
+		{
+			const __m128i init0 = _mm_add_epi32(base, _mm_loadu_si128((const __m128i*)(seeds + i)));
+			const __m128i init1 = _mm_add_epi32(base, _mm_loadu_si128((const __m128i*)(seeds + i + 4)));
+			__m128i min0 = _mm_set1_epi32(-1), min1 = min0;
+			for (size_t j = 0; j < n; ++j)
+			{
+				const __m128i word = _mm_set1_epi32((int)shingles[j]);
+				min0 = _mm_min_epu32(min0, lookup3_word_sse(init0, word));
+				min1 = _mm_min_epu32(min1, lookup3_word_sse(init1, word));
+			}
+			_mm_storeu_si128((__m128i*)(signature + i), min0);
+			_mm_storeu_si128((__m128i*)(signature + i + 4), min1);
+		}
+		return i;
+	}
+
+	HASHTOOLS_TARGET("avx2")
+	inline __m256i rot256(__m256i x, int k)
+	{
+		return _mm256_or_si256(_mm256_slli_epi32(x, k), _mm256_srli_epi32(x, 32 - k));
+	}
+
+	HASHTOOLS_TARGET("avx2")
+	inline __m256i lookup3_word_avx2(__m256i init, __m256i word)
+	{
+		__m256i a = _mm256_add_epi32(init, word), b = init, c = init;
+		HASHTOOLS_LOOKUP3_FINAL(rot256, _mm256_xor_si256, _mm256_sub_epi32)
+		return c;
+	}
+
+	HASHTOOLS_TARGET("avx2")
+	uint32_t minhash_avx2(const uint32_t* shingles, size_t n, const uint32_t* seeds, uint32_t k, uint32_t* signature)
+	{
+		const __m256i base = _mm256_set1_epi32((int)k_lookup3_init);
+		uint32_t i = 0;
+		for (; i + 16 <= k; i += 16)
+		{
+			const __m256i init0 = _mm256_add_epi32(base, _mm256_loadu_si256((const __m256i*)(seeds + i)));
+			const __m256i init1 = _mm256_add_epi32(base, _mm256_loadu_si256((const __m256i*)(seeds + i + 8)));
+			__m256i min0 = _mm256_set1_epi32(-1), min1 = min0;
+			for (size_t j = 0; j < n; ++j)
+			{
+				const __m256i word = _mm256_set1_epi32((int)shingles[j]);
+				min0 = _mm256_min_epu32(min0, lookup3_word_avx2(init0, word));
+				min1 = _mm256_min_epu32(min1, lookup3_word_avx2(init1, word));
+			}
+			_mm256_storeu_si256((__m256i*)(signature + i), min0);
+			_mm256_storeu_si256((__m256i*)(signature + i + 8), min1);
+		}
+		return i;
+	}
+#undef HASHTOOLS_LOOKUP3_FINAL
+#endif
+}
+
+EXPORT size_t shingle_hashes_32(const void* data, size_t len, uint32_t width, uint32_t* out, uint32_t seed) noexcept
+{
+	const uint8_t* p = (const uint8_t*)data;
+	if (!len)
+		return 0;
+	if (!width || len <= width)
+	{
+		out[0] = jenkins_lookup3_32(p, len, seed);
+		return 1;
+	}
+	const size_t count = len - width + 1;
+	for (size_t i = 0; i < count; ++i)
+		out[i] = jenkins_lookup3_32(p + i, width, seed);
+	return count;
+}
+
+EXPORT void minhash_seeds(uint64_t familySeed, uint32_t k, uint32_t* seeds) noexcept
+{
+	for (uint32_t i = 0; i < k; ++i)
+		seeds[i] = uint32_t(splitmix64(familySeed));
+}
+
+EXPORT void minhash_32(const uint32_t* shingles, size_t n, const uint32_t* seeds, uint32_t k, uint32_t* signature) noexcept
+{
+	uint32_t done = 0;
+#ifdef HASHTOOLS_X86
+	if (detail::cpu().avx2)
+		done = minhash_avx2(shingles, n, seeds, k, signature);
+	if (detail::cpu().sse41)
+		done += minhash_sse41(shingles, n, seeds + done, k - done, signature + done);
+#endif
+	minhash_scalar(shingles, n, seeds, done, k, signature);
+}
+
+EXPORT uint64_t simhash_64(const uint64_t* features, const uint32_t* weights, size_t n) noexcept
+{
+	// Signed votes per bit.  The inner loop is branch-free so the compiler
+	// can vectorize it.
+	int64_t votes[64] = {};
+	for (size_t i = 0; i < n; ++i)
+	{
+		const uint64_t f = features[i];
+		const int64_t w = weights ? int64_t(weights[i]) : 1;
+		for (unsigned bit = 0; bit < 64; ++bit)
+			votes[bit] += (int64_t((f >> bit) & 1) * 2 - 1) * w;
+	}
+	uint64_t result = 0;
+	for (unsigned bit = 0; bit < 64; ++bit)
+		result |= uint64_t(votes[bit] > 0) << bit;
+	return result;
+}
+
+END_HASHTOOLS_NS
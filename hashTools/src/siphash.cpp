@@ -0,0 +1,223 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+siphash.cpp -- SipHash and HalfSipHash
+
+From "SipHash: a fast short-input PRF", Aumasson & Bernstein, 2012, and the
+reference HalfSipHash.  SipHash-c-d runs c rounds per 8-byte block and d
+finalization rounds; HalfSipHash is the same construction on 32-bit words.
+
+The last partial block is assembled from at most two overlapping word loads
+(or three byte loads below four bytes) instead of a byte switch, which keeps
+short keys, the common case for hash tables, down to a couple of branches.
+\*****************************************************************************/
+
+#include "hashTools.h"
+#include "word_load.h"
+
+#include <chrono>
+#include <random>
+
+BEGIN_HASHTOOLS_NS
+
+namespace
+{
+	inline uint64_t rotl64(uint64_t x, int k) noexcept { return (x << k) | (x >> (64 - k)); }
+	inline uint32_t rotl32(uint32_t x, int k) noexcept { return (x << k) | (x >> (32 - k)); }
+
+	struct sip_state
+	{
+		uint64_t v0, v1, v2, v3;
+
+		explicit sip_state(const sip_key& key) noexcept :
+			v0(key.k0 ^ 0x736f6d6570736575ull),
+			v1(key.k1 ^ 0x646f72616e646f6dull),
+			v2(key.k0 ^ 0x6c7967656e657261ull),
+			v3(key.k1 ^ 0x7465646279746573ull)
+		{}
+
+		void round() noexcept
+		{
+			v0 += v1; v1 = rotl64(v1, 13); v1 ^= v0; v0 = rotl64(v0, 32);
+			v2 += v3; v3 = rotl64(v3, 16); v3 ^= v2;
+			v0 += v3; v3 = rotl64(v3, 21); v3 ^= v0;
+			v2 += v1; v1 = rotl64(v1, 17); v1 ^= v2; v2 = rotl64(v2, 32);
+		}
+
+		template <int C>
+		void compress(uint64_t m) noexcept
+		{
+			v3 ^= m;
+			for (int i = 0; i < C; ++i)
+				round();
+			v0 ^= m;
+		}
+
+		template <int D>
+		uint64_t finish() noexcept
+		{
+			v2 ^= 0xFF;
+			for (int i = 0; i < D; ++i)
+				round();
+			return v0 ^ v1 ^ v2 ^ v3;
+		}
+	};
+
+	struct half_sip_state
+	{
+		uint32_t v0, v1, v2, v3;
+
+		explicit half_sip_state(const sip_key& key) noexcept :
+			v0(uint32_t(key.k0)),
+			v1(uint32_t(key.k0 >> 32)),
+			v2(uint32_t(key.k0) ^ 0x6c796765),
+			v3(uint32_t(key.k0 >> 32) ^ 0x74656462)
+		{}
+
+		void round() noexcept
+		{
+			v0 += v1; v1 = rotl32(v1, 5); v1 ^= v0; v0 = rotl32(v0, 16);
+			v2 += v3; v3 = rotl32(v3, 8); v3 ^= v2;
+			v0 += v3; v3 = rotl32(v3, 7); v3 ^= v0;
+			v2 += v1; v1 = rotl32(v1, 13); v1 ^= v2; v2 = rotl32(v2, 16);
+		}
+
+		template <int C>
+		void compress(uint32_t m) noexcept
+		{
+			v3 ^= m;
+			for (int i = 0; i < C; ++i)
+				round();
+			v0 ^= m;
+		}
+
+		template <int D>
+		uint32_t finish() noexcept
+		{
+			v2 ^= 0xFF;
+			for (int i = 0; i < D; ++i)
+				round();
+			return v1 ^ v3;
+		}
+	};
+
+	// The remaining 0..7 bytes, little-endian, without a per-byte switch
+	inline uint64_t tail64(const uint8_t* p, size_t n) noexcept
+	{
+		if (n >= 4)
+			return detail::load_le32(p) | (uint64_t(detail::load_le32(p + n - 4)) << (8 * (n - 4)));
+		if (n)
+			return p[0] | (uint64_t(p[n / 2]) << (8 * (n / 2))) | (uint64_t(p[n - 1]) << (8 * (n - 1)));
+		return 0;
+	}
+
+	// The remaining 0..3 bytes
+	inline uint32_t tail32(const uint8_t* p, size_t n) noexcept
+	{
+		if (n)
+			return p[0] | (uint32_t(p[n / 2]) << (8 * (n / 2))) | (uint32_t(p[n - 1]) << (8 * (n - 1)));
+		return 0;
+	}
+
+	template <int C, int D>
+	uint64_t siphash(const void* message, size_t length, const sip_key& key) noexcept
+	{
+		const uint8_t* p = (const uint8_t*)message;
+		sip_state s(key);
+		const uint8_t* end = p + (length & ~size_t(7));
+		for (; p != end; p += 8)
+			s.compress<C>(detail::load_le64(p));
+		s.compress<C>((uint64_t(length) << 56) | tail64(p, length & 7));
+		return s.finish<D>();
+	}
+
+	template <int C, int D>
+	uint64_t siphash_u64(uint64_t value, const sip_key& key) noexcept
+	{
+		sip_state s(key);
+		s.compress<C>(value);
+		s.compress<C>(uint64_t(8) << 56);
+		return s.finish<D>();
+	}
+
+	template <int C, int D>
+	uint32_t halfsiphash(const void* message, size_t length, const sip_key& key) noexcept
+	{
+		const uint8_t* p = (const uint8_t*)message;
+		half_sip_state s(key);
+		const uint8_t* end = p + (length & ~size_t(3));
+		for (; p != end; p += 4)
+			s.compress<C>(detail::load_le32(p));
+		s.compress<C>((uint32_t(length) << 24) | tail32(p, length & 3));
+		return s.finish<D>();
+	}
+
+	sip_key make_random_key() noexcept
+	{
+		sip_key key;
+		try
+		{
+			std::random_device rd;
+			key.k0 = (uint64_t(rd()) << 32) ^ rd();
+			key.k1 = (uint64_t(rd()) << 32) ^ rd();
+		}
+		catch (...)
+		{
+			// No entropy source; the clock and ASLR are better than a fixed key
+			uint64_t state = uint64_t(std::chrono::high_resolution_clock::now().time_since_epoch().count()) ^ uint64_t(uintptr_t(&key));
+			key.k0 = splitmix64(state);
+			key.k1 = splitmix64(state);
+		}
+		return key;
+	}
+}
+
+EXPORT uint64_t siphash_2_4(const void* message, size_t length, const sip_key& key) noexcept
+{
+	return siphash<2, 4>(message, length, key);
+}
+
+EXPORT uint64_t siphash_1_3(const void* message, size_t length, const sip_key& key) noexcept
+{
+	return siphash<1, 3>(message, length, key);
+}
+
+EXPORT uint64_t siphash_2_4_u64(uint64_t value, const sip_key& key) noexcept
+{
+	return siphash_u64<2, 4>(value, key);
+}
+
+EXPORT uint64_t siphash_1_3_u64(uint64_t value, const sip_key& key) noexcept
+{
+	return siphash_u64<1, 3>(value, key);
+}
+
+EXPORT uint32_t halfsiphash_2_4(const void* message, size_t length, const sip_key& key) noexcept
+{
+	return halfsiphash<2, 4>(message, length, key);
+}
+
+EXPORT uint32_t halfsiphash_1_3(const void* message, size_t length, const sip_key& key) noexcept
+{
+	return halfsiphash<1, 3>(message, length, key);
+}
+
+EXPORT sip_key random_sip_key() noexcept
+{
+	return make_random_key();
+}
+
+EXPORT const sip_key& process_sip_key() noexcept
+{
+	static const sip_key key = make_random_key();
+	return key;
+}
+
+END_HASHTOOLS_NS
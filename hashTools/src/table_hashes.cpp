@@ -0,0 +1,162 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+table_hashes.cpp -- Table generators and branch-free universal/Zobrist kernels
+
+The results are identical to universal_ref.cpp and zobrist_ref.cpp.
+\*****************************************************************************/
+
+#include "hashTools.h"
+#include "cpu_features.h"
+
+BEGIN_HASHTOOLS_NS
+
+namespace
+{
+	uint32_t universal_scalar(const uint8_t* key, uint32_t len, const uint32_t* tab, uint32_t hash)
+	{
+		for (uint32_t i = 0; i < len; ++i, tab += 8)
+		{
+			const uint32_t k = key[i];
+			for (uint32_t b = 0; b < 8; ++b)
+				hash ^= tab[b] & (0u - ((k >> b) & 1));
+		}
+		return hash;
+	}
+
+	uint32_t zobrist_scalar(const uint8_t* key, uint32_t len, const uint32_t* tab, uint32_t hash)
+	{
+		// Four independent chains so the loads are not serialized on hash
+		uint32_t h1 = 0, h2 = 0, h3 = 0;
+		uint32_t i = 0;
+		for (; i + 4 <= len; i += 4, tab += 4 * 256)
+		{
+			hash ^= tab[key[i]];
+			h1 ^= tab[256 + key[i + 1]];
+			h2 ^= tab[512 + key[i + 2]];
+			h3 ^= tab[768 + key[i + 3]];
+		}
+		for (; i < len; ++i, tab += 256)
+			hash ^= tab[key[i]];
+		return hash ^ h1 ^ h2 ^ h3;
+	}
+
+#ifdef HASHTOOLS_X86
+	// Each key byte is broadcast, ANDed with the lane's bit and compared, which
+	// gives an all-ones mask in the lanes whose table entry is XORed in.
+	HASHTOOLS_TARGET("sse2")
+	uint32_t universal_sse2(const uint8_t* key, uint32_t len, const uint32_t* tab, uint32_t hash)
+	{
+		const __m128i bitsLo = _mm_setr_epi32(0x01, 0x02, 0x04, 0x08);
+		const __m128i bitsHi = _mm_setr_epi32(0x10, 0x20, 0x40, 0x80);
+		__m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+		for (uint32_t i = 0; i < len; ++i, tab += 8)
+		{
+			const __m128i k = _mm_set1_epi32(key[i]);
+			const __m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(k, bitsLo), bitsLo);
+			const __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(k, bitsHi), bitsHi);
+			acc0 = _mm_xor_si128(acc0, _mm_and_si128(m0, _mm_loadu_si128((const __m128i*)tab)));
+			acc1 = _mm_xor_si128(acc1, _mm_and_si128(m1, _mm_loadu_si128((const __m128i*)(tab + 4))));
+		}
+		__m128i acc = _mm_xor_si128(acc0, acc1);
+		acc = _mm_xor_si128(acc, _mm_shuffle_epi32(acc, 0x4E));
+		acc = _mm_xor_si128(acc, _mm_shuffle_epi32(acc, 0xB1));
+		return hash ^ (uint32_t)_mm_cvtsi128_si32(acc);
+	}
+
+	HASHTOOLS_TARGET("avx2")
+	uint32_t universal_avx2(const uint8_t* key, uint32_t len, const uint32_t* tab, uint32_t hash)
+	{
+		const __m256i bits = _mm256_setr_epi32(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+		__m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+		uint32_t i = 0;
+		for (; i + 2 <= len; i += 2, tab += 16)
+		{
+			const __m256i k0 = _mm256_set1_epi32(key[i]);
+			const __m256i k1 = _mm256_set1_epi32(key[i + 1]);
+			const __m256i m0 = _mm256_cmpeq_epi32(_mm256_and_si256(k0, bits), bits);
+			const __m256i m1 = _mm256_cmpeq_epi32(_mm256_and_si256(k1, bits), bits);
+			acc0 = _mm256_xor_si256(acc0, _mm256_and_si256(m0, _mm256_loadu_si256((const __m256i*)tab)));
+			acc1 = _mm256_xor_si256(acc1, _mm256_and_si256(m1, _mm256_loadu_si256((const __m256i*)(tab + 8))));
+		}
+		if (i < len)
+		{
+			const __m256i k0 = _mm256_set1_epi32(key[i]);
+			const __m256i m0 = _mm256_cmpeq_epi32(_mm256_and_si256(k0, bits), bits);
+			acc0 = _mm256_xor_si256(acc0, _mm256_and_si256(m0, _mm256_loadu_si256((const __m256i*)tab)));
+		}
+		const __m256i acc256 = _mm256_xor_si256(acc0, acc1);
+		__m128i acc = _mm_xor_si128(_mm256_castsi256_si128(acc256), _mm256_extracti128_si256(acc256, 1));
+		acc = _mm_xor_si128(acc, _mm_shuffle_epi32(acc, 0x4E));
+		acc = _mm_xor_si128(acc, _mm_shuffle_epi32(acc, 0xB1));
+		return hash ^ (uint32_t)_mm_cvtsi128_si32(acc);
+	}
+
+	// Eight key bytes are widened to lane indices into eight consecutive
+	// 256-entry rows and fetched with one gather.
+	HASHTOOLS_TARGET("avx2")
+	uint32_t zobrist_avx2(const uint8_t* key, uint32_t len, const uint32_t* tab, uint32_t hash)
+	{
+		const __m256i rows = _mm256_setr_epi32(0, 256, 512, 768, 1024, 1280, 1536, 1792);
+		__m256i acc = _mm256_setzero_si256();
+		uint32_t i = 0;
+		for (; i + 8 <= len; i += 8, tab += 8 * 256)
+		{
+			const __m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(key + i)));
+			const __m256i index = _mm256_add_epi32(bytes, rows);
+			acc = _mm256_xor_si256(acc, _mm256_i32gather_epi32((const int*)tab, index, 4));
+		}
+		__m128i acc128 = _mm_xor_si128(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+		acc128 = _mm_xor_si128(acc128, _mm_shuffle_epi32(acc128, 0x4E));
+		acc128 = _mm_xor_si128(acc128, _mm_shuffle_epi32(acc128, 0xB1));
+		return zobrist_scalar(key + i, len - i, tab, hash ^ (uint32_t)_mm_cvtsi128_si32(acc128));
+	}
+#endif
+}
+
+EXPORT void universal_table_32(uint32_t* table, uint32_t maxlen, uint64_t seed) noexcept
+{
+	for (size_t i = 0; i < size_t(maxlen) * 8; ++i)
+		table[i] = uint32_t(splitmix64(seed));
+}
+
+EXPORT void zobrist_table_32(uint32_t* table, uint32_t maxlen, uint64_t seed) noexcept
+{
+	for (size_t i = 0; i < size_t(maxlen) * 256; ++i)
+		table[i] = uint32_t(splitmix64(seed));
+}
+
+EXPORT uint32_t universal_hash_32_fast(const void* key, uint32_t len, uint32_t maxlen, const uint32_t* table) noexcept
+{
+	if (len > maxlen)
+		len = maxlen;
+	const uint8_t* p = (const uint8_t*)key;
+#ifdef HASHTOOLS_X86
+	if (detail::cpu().avx2)
+		return universal_avx2(p, len, table, len);
+	if (detail::cpu().sse2)
+		return universal_sse2(p, len, table, len);
+#endif
+	return universal_scalar(p, len, table, len);
+}
+
+EXPORT uint32_t zobrist_hash_32_fast(const void* key, uint32_t len, uint32_t maxlen, const uint32_t* table) noexcept
+{
+	if (len > maxlen)
+		len = maxlen;
+	const uint8_t* p = (const uint8_t*)key;
+#ifdef HASHTOOLS_X86
+	if (detail::cpu().avx2)
+		return zobrist_avx2(p, len, table, len);
+#endif
+	return zobrist_scalar(p, len, table, len);
+}
+
+END_HASHTOOLS_NS
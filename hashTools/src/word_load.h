@@ -0,0 +1,127 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+word_load.h -- Unaligned fixed-byte-order word loads
+
+Private to the hashTools library.  The loads go through memcpy, which the
+compilers turn into a single (unaligned) move, so they are safe for any
+alignment and free of strict-aliasing problems.  When the requested order is
+not the host's the word is byte-swapped after the load (a single bswap),
+never assembled a byte at a time.  le_words and be_words bundle the loads for
+hashes templated on the order they read the key in.
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_WORD_LOAD_H
+#define CODETOOLS_HASHTOOLS_WORD_LOAD_H
+#pragma once
+
+#include "hashTools.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define HASHTOOLS_LITTLE_ENDIAN 1
+#else
+#define HASHTOOLS_LITTLE_ENDIAN 0
+#endif
+
+BEGIN_HASHTOOLS_NS
+namespace detail
+{
+	// gcc and clang recognize the shift-and-mask idiom as bswap
+	inline uint32_t bswap32(uint32_t v) noexcept
+	{
+#ifdef _MSC_VER
+		return _byteswap_ulong(v);
+#else
+		return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+#endif
+	}
+
+	inline uint64_t bswap64(uint64_t v) noexcept
+	{
+#ifdef _MSC_VER
+		return _byteswap_uint64(v);
+#else
+		return (uint64_t(bswap32(uint32_t(v))) << 32) | bswap32(uint32_t(v >> 32));
+#endif
+	}
+
+	inline uint16_t load_le16(const void* p) noexcept
+	{
+		uint16_t v;
+		memcpy(&v, p, sizeof(v));
+#if !HASHTOOLS_LITTLE_ENDIAN
+		v = uint16_t((v >> 8) | (v << 8));
+#endif
+		return v;
+	}
+
+	inline uint32_t load_le32(const void* p) noexcept
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+#if !HASHTOOLS_LITTLE_ENDIAN
+		v = bswap32(v);
+#endif
+		return v;
+	}
+
+	inline uint64_t load_le64(const void* p) noexcept
+	{
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+#if !HASHTOOLS_LITTLE_ENDIAN
+		v = bswap64(v);
+#endif
+		return v;
+	}
+
+	inline uint32_t load_be32(const void* p) noexcept
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+#if HASHTOOLS_LITTLE_ENDIAN
+		v = bswap32(v);
+#endif
+		return v;
+	}
+
+	inline uint64_t load_be64(const void* p) noexcept
+	{
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+#if HASHTOOLS_LITTLE_ENDIAN
+		v = bswap64(v);
+#endif
+		return v;
+	}
+
+	struct le_words
+	{
+		static uint32_t load32(const void* p) noexcept { return load_le32(p); }
+		static uint64_t load64(const void* p) noexcept { return load_le64(p); }
+	};
+
+	struct be_words
+	{
+		static uint32_t load32(const void* p) noexcept { return load_be32(p); }
+		static uint64_t load64(const void* p) noexcept { return load_be64(p); }
+	};
+
+#if HASHTOOLS_LITTLE_ENDIAN
+	typedef le_words native_words;
+#else
+	typedef be_words native_words;
+#endif
+}
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_WORD_LOAD_H
@@ -21,7 +21,7 @@ EXPORT uint32_t zobrist_hash_32(char *key, uint32_t len, uint32_t maxlen, uint32
 		len = maxlen;
 	uint32_t hash, i;
 	for (hash = len, i = 0; i<len; ++i)
-		hash ^= tab[i * 256 + key[i]];
+		hash ^= tab[i * 256 + (uint8_t)key[i]];
 	return hash;
 }
 
@@ -9,6 +9,11 @@ of the license can be found at https://opensource.org/licenses/MIT . See also
 'LICENSE' or 'LICENSE.txt' for more information.
 
 ctnew.h -- ctnew operators declaration and libnew entry points
+
+Every replaceable operator new and delete: plain, array, nothrow, sized
+(C++14) and, where the compiler supports them, over-aligned (C++17).  The
+throwing forms call the new handler and throw std::bad_alloc as the standard
+requires.  Include this in exactly one translation unit.
 \*****************************************************************************/
 #ifndef CODETOOLS_NEW_H
 #define CODETOOLS_NEW_H
@@ -16,9 +21,86 @@ ctnew.h -- ctnew operators declaration and libnew entry points
 
 #include "libnew.h"
 
-void* operator new(size_t size) { return LIBNEWNAMESPACE::Alloc(size); }
-void* operator new[](size_t size) { return LIBNEWNAMESPACE::Alloc(size); }
-void operator delete(void* vp) { LIBNEWNAMESPACE::Dealloc(vp); }
-void operator delete[](void* vp) { LIBNEWNAMESPACE::Dealloc(vp); }
+#include <new>
+
+namespace {
+	void* ctnew_allocate(size_t size, size_t alignment)
+	{
+		if (!size)
+			size = 1;
+		for (;;)
+		{
+			void* p = LIBNEWNAMESPACE::AllocAligned(size, alignment);
+			if (p)
+				return p;
+			std::new_handler handler = std::get_new_handler();
+			if (!handler)
+				throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	void* ctnew_allocate_nothrow(size_t size, size_t alignment) noexcept
+	{
+		try
+		{
+			return ctnew_allocate(size, alignment);
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
+}
+
+void* operator new(size_t size) { return ctnew_allocate(size, 0); }
+void* operator new[](size_t size) { return ctnew_allocate(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return ctnew_allocate_nothrow(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return ctnew_allocate_nothrow(size, 0); }
+
+void operator delete(void* vp) noexcept { LIBNEWNAMESPACE::Dealloc(vp); }
+void operator delete[](void* vp) noexcept { LIBNEWNAMESPACE::Dealloc(vp); }
+void operator delete(void* vp, const std::nothrow_t&) noexcept { LIBNEWNAMESPACE::Dealloc(vp); }
+void operator delete[](void* vp, const std::nothrow_t&) noexcept { LIBNEWNAMESPACE::Dealloc(vp); }
+void operator delete(void* vp, size_t size) noexcept { LIBNEWNAMESPACE::DeallocSized(vp, size); }
+void operator delete[](void* vp, size_t size) noexcept { LIBNEWNAMESPACE::DeallocSized(vp, size); }
+
+#ifdef __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t alignment) { return ctnew_allocate(size, size_t(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return ctnew_allocate(size, size_t(alignment)); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return ctnew_allocate_nothrow(size, size_t(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return ctnew_allocate_nothrow(size, size_t(alignment));
+}
+
+void operator delete(void* vp, std::align_val_t alignment) noexcept
+{
+	LIBNEWNAMESPACE::DeallocAligned(vp, 0, size_t(alignment));
+}
+void operator delete[](void* vp, std::align_val_t alignment) noexcept
+{
+	LIBNEWNAMESPACE::DeallocAligned(vp, 0, size_t(alignment));
+}
+void operator delete(void* vp, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	LIBNEWNAMESPACE::DeallocAligned(vp, 0, size_t(alignment));
+}
+void operator delete[](void* vp, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	LIBNEWNAMESPACE::DeallocAligned(vp, 0, size_t(alignment));
+}
+void operator delete(void* vp, size_t size, std::align_val_t alignment) noexcept
+{
+	LIBNEWNAMESPACE::DeallocAligned(vp, size, size_t(alignment));
+}
+void operator delete[](void* vp, size_t size, std::align_val_t alignment) noexcept
+{
+	LIBNEWNAMESPACE::DeallocAligned(vp, size, size_t(alignment));
+}
+#endif // __cpp_aligned_new
 
 #endif // CODETOOLS_NEW_H
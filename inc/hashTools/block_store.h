@@ -0,0 +1,130 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+block_store.h -- Content-addressed, deduplicating block store
+
+Blocks are named by their 128-bit digest (spooky_128 or MD5, as for the
+chunker) and appended to segment files "segment-NNNNNNNN.blk" in the store
+directory.  Each record is a 32-byte header (magic, length, CRC-32C of the
+data, digest type, digest) followed by the data.  Nothing else is on disk:
+opening a store reads the record headers back into the index.
+
+The index is a flat open-addressed table of 32-byte entries (digest,
+segment, offset, length) probed linearly from the first digest word, two
+entries to a cache line.  Putting a block that is already present costs one
+digest and one probe and touches no file.
+
+A store is used from one thread at a time.  Blocks are never removed; start
+a new store to reclaim space.  Pairs with cdc_chunker to dedup files:
+
+  block_store store("cache");
+  cdc_chunker chunker;
+  cdc_chunk_file(path, chunker, [](const cdc_chunk& c, const uint8_t* data, void* s) {
+      ((block_store*)s)->put(c.digest, data, c.length); }, &store);
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_BLOCK_STORE_H
+#define CODETOOLS_HASHTOOLS_BLOCK_STORE_H
+#pragma once
+
+#include "hashTools.h"
+#include "chunker.h"
+
+#include <cstdio>
+
+BEGIN_HASHTOOLS_NS
+
+	struct block_store_options
+	{
+		block_store_options(cdc_digest digestType = cdc_digest::spooky_128, uint64_t maxSegmentSize = 1ull << 30,
+		                    bool verify = true) noexcept :
+			digest(digestType), segment_size(maxSegmentSize), verify_reads(verify)
+		{}
+
+		cdc_digest digest;      // must match the one the store was written with
+		uint64_t segment_size;  // a segment is closed once it would grow past this
+		bool verify_reads;      // check the CRC-32C of every block read
+	};
+
+	enum class block_put { stored, present, failed };
+
+	class EXPORT block_store
+	{
+	public:
+		// Opens the store in directory, creating it if needed, and rebuilds the
+		// index from the segments.  Check error() before use.
+		explicit block_store(const char* directory, const block_store_options& options = block_store_options());
+		~block_store();
+
+		block_store(const block_store&) = delete;
+		block_store& operator=(const block_store&) = delete;
+
+		// 0, or the errno of the failure that left the store unusable
+		int error() const noexcept { return m_error; }
+		const block_store_options& options() const noexcept { return m_options; }
+
+		// The key a block is stored under
+		void digest(const void* data, size_t length, uint8_t* key) const noexcept;
+
+		// Stores a block unless one with the same digest is present; key, if
+		// given, receives the digest
+		block_put put(const void* data, uint32_t length, uint8_t* key = 0);
+		// As put(), with a digest already computed with options().digest
+		block_put put(const uint8_t* key, const void* data, uint32_t length);
+
+		bool contains(const uint8_t* key) const noexcept { return find(key) != nullptr; }
+		// Length of a stored block, or -1 if absent
+		int64_t length(const uint8_t* key) const noexcept;
+
+		// Copies a block into buffer and returns its length; -1 if it is absent,
+		// larger than capacity, unreadable or fails verification
+		int64_t get(const uint8_t* key, void* buffer, size_t capacity);
+
+		// Pushes buffered writes to the operating system
+		bool flush() noexcept;
+
+		uint64_t blocks() const noexcept { return m_count; }
+		uint64_t stored_bytes() const noexcept { return m_storedBytes; }
+		uint64_t duplicate_bytes() const noexcept { return m_duplicateBytes; } // put() calls satisfied from the index
+		uint32_t segments() const noexcept { return m_segment + (m_writeOffset ? 1 : 0); }
+
+	private:
+		struct entry
+		{
+			uint64_t key[2];
+			uint64_t offset;    // of the data, after the record header
+			uint32_t segment;   // k_empty for a free slot
+			uint32_t length;
+		};
+
+		block_store_options m_options;
+		int m_error;
+		char* m_directory;
+		entry* m_table;
+		uint64_t m_mask;         // table size - 1
+		uint64_t m_count;
+		uint64_t m_storedBytes;
+		uint64_t m_duplicateBytes;
+		FILE* m_write;           // the segment being appended to
+		uint32_t m_segment;
+		uint64_t m_writeOffset;
+		bool m_writeDirty;       // m_write holds unflushed data
+		FILE* m_read;            // most recently read segment
+		uint32_t m_readSegment;
+
+		const entry* find(const uint8_t* key) const noexcept;
+		void insert(const entry& e);
+		void grow();
+		FILE* open_segment(uint32_t segment, const char* mode) const;
+		bool scan_segment(FILE* file, uint32_t segment, uint64_t& end);
+	};
+
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_BLOCK_STORE_H
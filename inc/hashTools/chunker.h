@@ -0,0 +1,122 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+chunker.h -- Content-defined chunking
+
+Splits a byte stream into variable sized chunks whose boundaries depend only
+on the local content, so an insertion or deletion only changes the chunks
+around it.  Used for deduplicating backup data: identical chunks produce
+identical digests wherever they occur.
+
+The cut point search is FastCDC (Xia et al.) over the gear_64 rolling hash:
+  * the first min_size bytes of a chunk are skipped without hashing,
+  * normalized chunking: a harder mask before avg_size and an easier one
+    after it keeps chunk sizes close to avg_size,
+  * the hash is rolled two bytes per iteration using a pre-shifted table.
+Every chunk is reported with its offset, length and a 128-bit digest.
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_CHUNKER_H
+#define CODETOOLS_HASHTOOLS_CHUNKER_H
+#pragma once
+
+#include "hashTools.h"
+
+BEGIN_HASHTOOLS_NS
+
+	enum class cdc_digest { spooky_128, md5 };
+
+	struct cdc_params
+	{
+		cdc_params(uint32_t minSize = 2048, uint32_t avgSize = 8192, uint32_t maxSize = 65536,
+		           uint64_t gearSeed = 0, cdc_digest digestType = cdc_digest::spooky_128) noexcept :
+			min_size(minSize), avg_size(avgSize), max_size(maxSize), seed(gearSeed), digest(digestType)
+		{}
+
+		uint32_t min_size;
+		uint32_t avg_size;   // rounded to a power of two
+		uint32_t max_size;
+		uint64_t seed;       // seeds the gear table; chunkers must agree on it to dedup
+		cdc_digest digest;
+	};
+
+	struct cdc_chunk
+	{
+		uint64_t offset;     // offset of the chunk in the stream
+		uint32_t length;
+		uint8_t digest[16];
+	};
+
+	// Receives each chunk along with a pointer to its bytes
+	typedef void (*cdc_sink)(const cdc_chunk& chunk, const uint8_t* data, void* context);
+
+	class EXPORT cdc_chunker
+	{
+	public:
+		explicit cdc_chunker(const cdc_params& params = cdc_params()) noexcept;
+
+		const cdc_params& params() const noexcept { return m_params; }
+
+		// Length of the chunk that starts at data.  When no cut point is found
+		// in the first len bytes and len < max_size, returns 0 to ask for more
+		// data, unless this is the final piece of the stream in which case the
+		// rest of it is one chunk.
+		size_t next_boundary(const uint8_t* data, size_t len, bool final) const noexcept;
+
+		// Chunks a complete buffer, returns the number of chunks emitted
+		size_t chunk(const void* data, size_t len, cdc_sink sink, void* context, uint64_t baseOffset = 0) const;
+
+		// The strong digest reported for a chunk
+		void digest(const uint8_t* data, size_t len, uint8_t* out) const noexcept;
+
+	private:
+		cdc_params m_params;
+		uint64_t m_maskSmall;   // harder mask, used before avg_size
+		uint64_t m_maskLarge;   // easier mask, used after avg_size
+		uint64_t m_gear[256];
+		uint64_t m_gearShifted[256];
+
+		size_t scan(const uint8_t* data, size_t i, size_t end, uint64_t& h, uint64_t mask) const noexcept;
+	};
+
+	// Incremental chunking of a stream delivered in arbitrary pieces; the
+	// chunks are the same as chunking the concatenated stream in one call.
+	class EXPORT cdc_stream
+	{
+	public:
+		cdc_stream(const cdc_chunker& chunker, cdc_sink sink, void* context);
+		~cdc_stream();
+
+		cdc_stream(const cdc_stream&) = delete;
+		cdc_stream& operator=(const cdc_stream&) = delete;
+
+		void update(const void* data, size_t len);
+		// Emits whatever is left as the final chunk(s)
+		void finish();
+
+		uint64_t offset() const noexcept { return m_offset + m_carryLength; }
+
+	private:
+		const cdc_chunker* m_chunker;
+		cdc_sink m_sink;
+		void* m_context;
+		uint8_t* m_carry;        // partial chunk waiting for a cut point
+		size_t m_carryLength;
+		uint64_t m_offset;       // stream offset of m_carry[0]
+
+		void emit(const uint8_t* data, size_t len);
+	};
+
+	// Streams a file through a chunker.  Returns the number of chunks, or
+	// size_t(-1) if the file could not be read.
+	EXPORT size_t cdc_chunk_file(const char* filename, const cdc_chunker& chunker, cdc_sink sink, void* context);
+
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_CHUNKER_H
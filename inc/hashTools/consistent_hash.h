@@ -0,0 +1,267 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+consistent_hash.h -- Routing keys to shards with minimal movement
+
+Three schemes, all routing a 64-bit key hash (see shard_key()):
+
+  jump_consistent_hash  Lamping & Veach.  No state and perfectly even, but
+                        shards are numbered 0..n-1 and can only be added or
+                        removed at the end.
+  hash_ring             Karger et al. ring with virtual nodes.  Arbitrary
+                        node ids; O(log points) lookup, narrowed by a prefix
+                        table to a few probes.  Skew falls with more vnodes.
+  rendezvous_hash       Highest random weight (Thaler & Ravishakar) with
+                        optional weights.  Arbitrary node ids, best balance
+                        and no extra memory, but O(nodes) per lookup.
+
+When a node joins, each scheme only moves keys onto the new node; when one
+leaves, only that node's keys move.  The *_batch calls route arrays of
+hashes and are the fast path for bulk routing.
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_CONSISTENT_HASH_H
+#define CODETOOLS_HASHTOOLS_CONSISTENT_HASH_H
+#pragma once
+
+#include "hashTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+BEGIN_HASHTOOLS_NS
+
+	enum class shard_hash { spooky_64, fnv1a_64 };
+
+	// Final avalanche of MurmurHash3; spreads FNV's weak high bits
+	inline uint64_t shard_mix(uint64_t h) noexcept
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	// 64-bit routing hash of a key.  FNV-1a is cheaper for short keys.
+	inline uint64_t shard_key(const void* key, size_t length, shard_hash hash = shard_hash::spooky_64, uint64_t seed = 0) noexcept
+	{
+		if (hash == shard_hash::fnv1a_64)
+			return shard_mix(fnv1a_64(key, length, 0xcbf29ce484222325ull ^ seed));
+		return spooky_64(key, length, seed);
+	}
+
+	// Bucket in [0, buckets) for a key hash; buckets must be positive
+	EXPORT int32_t jump_consistent_hash(uint64_t key, int32_t buckets) noexcept;
+	EXPORT void jump_consistent_hash_batch(const uint64_t* keys, size_t n, int32_t buckets, int32_t* out) noexcept;
+
+	class hash_ring
+	{
+	public:
+		explicit hash_ring(uint32_t vnodes = 160) noexcept : m_vnodes(vnodes ? vnodes : 1), m_shift(64) {}
+
+		size_t nodes() const noexcept { return m_nodes.size(); }
+		bool empty() const noexcept { return m_nodes.empty(); }
+
+		// A node with weight w gets w * vnodes points on the ring.  Adding an
+		// existing node updates its weight.
+		void add(uint64_t node, uint32_t weight = 1) { add(&node, 1, weight); }
+
+		// Adds several nodes with one re-sort of the ring
+		void add(const uint64_t* nodes, size_t count, uint32_t weight = 1)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				std::vector<std::pair<uint64_t, uint32_t>>::iterator iter = find_node(nodes[i]);
+				if (iter != m_nodes.end())
+				{
+					iter->second = weight;
+					remove_points(nodes[i]);
+				}
+				else
+					m_nodes.push_back(std::make_pair(nodes[i], weight));
+				const uint64_t id = shard_mix(nodes[i]);
+				for (uint32_t v = 0; v < weight * m_vnodes; ++v)
+					m_points.push_back(point{ spooky_64(&id, sizeof(id), v), nodes[i] });
+			}
+			rebuild();
+		}
+
+		void remove(uint64_t node)
+		{
+			std::vector<std::pair<uint64_t, uint32_t>>::iterator iter = find_node(node);
+			if (iter == m_nodes.end())
+				return;
+			m_nodes.erase(iter);
+			remove_points(node);
+			rebuild();
+		}
+
+		// The first point clockwise from the key.  The ring must not be empty.
+		uint64_t route(uint64_t keyHash) const noexcept
+		{
+			const uint64_t slot = m_shift < 64 ? keyHash >> m_shift : 0;
+			const point* first = m_points.data() + m_prefix[slot];
+			const point* last = m_points.data() + m_prefix[slot + 1];
+			while (first < last && first->hash < keyHash)
+				++first;
+			return first == m_points.data() + m_points.size() ? m_points[0].node : first->node;
+		}
+
+		void route_batch(const uint64_t* keyHashes, size_t n, uint64_t* out) const noexcept
+		{
+			for (size_t i = 0; i < n; ++i)
+				out[i] = route(keyHashes[i]);
+		}
+
+	private:
+		struct point
+		{
+			uint64_t hash;
+			uint64_t node;
+		};
+
+		uint32_t m_vnodes;
+		uint32_t m_shift;                                   // 64 - prefix bits
+		std::vector<std::pair<uint64_t, uint32_t>> m_nodes; // node, weight
+		std::vector<point> m_points;                        // sorted by hash
+		std::vector<uint32_t> m_prefix;                     // first point at or above each prefix
+
+		std::vector<std::pair<uint64_t, uint32_t>>::iterator find_node(uint64_t node)
+		{
+			return std::find_if(m_nodes.begin(), m_nodes.end(),
+				[=](const std::pair<uint64_t, uint32_t>& n) { return n.first == node; });
+		}
+
+		void remove_points(uint64_t node)
+		{
+			m_points.erase(std::remove_if(m_points.begin(), m_points.end(),
+				[=](const point& p) { return p.node == node; }), m_points.end());
+		}
+
+		void rebuild()
+		{
+			std::sort(m_points.begin(), m_points.end(),
+				[](const point& lhs, const point& rhs) { return lhs.hash < rhs.hash || (lhs.hash == rhs.hash && lhs.node < rhs.node); });
+
+			// About one point per prefix slot, so a lookup scans one or two
+			// points after a single table read instead of a binary search.
+			uint32_t bits = 0;
+			while (bits < 24 && (size_t(1) << bits) < m_points.size())
+				++bits;
+			m_shift = 64 - bits;
+			const size_t slots = size_t(1) << bits;
+			m_prefix.assign(slots + 1, uint32_t(m_points.size()));
+			size_t p = 0;
+			for (size_t slot = 0; slot < slots; ++slot)
+			{
+				while (p < m_points.size() && (bits ? m_points[p].hash >> m_shift : 0) < slot)
+					++p;
+				m_prefix[slot] = uint32_t(p);
+			}
+		}
+	};
+
+	class rendezvous_hash
+	{
+	public:
+		size_t nodes() const noexcept { return m_nodes.size(); }
+		bool empty() const noexcept { return m_nodes.empty(); }
+
+		// Weights are relative shares of the key space.  Adding an existing
+		// node updates its weight.
+		void add(uint64_t node, double weight = 1.0)
+		{
+			for (entry& e : m_nodes)
+				if (e.node == node)
+				{
+					e.weight = weight;
+					update_weighting();
+					return;
+				}
+			m_nodes.push_back(entry{ node, shard_mix(node), weight });
+			update_weighting();
+		}
+
+		void remove(uint64_t node)
+		{
+			m_nodes.erase(std::remove_if(m_nodes.begin(), m_nodes.end(),
+				[=](const entry& e) { return e.node == node; }), m_nodes.end());
+			update_weighting();
+		}
+
+		// The node with the highest score for the key.  Must not be empty.
+		uint64_t route(uint64_t keyHash) const noexcept
+		{
+			size_t best = 0;
+			if (!m_weighted)
+			{
+				// Equal weights: comparing the raw scores is enough
+				uint64_t bestScore = 0;
+				for (size_t i = 0; i < m_nodes.size(); ++i)
+				{
+					const uint64_t s = score(keyHash, m_nodes[i].seed);
+					if (s > bestScore || i == 0)
+					{
+						bestScore = s;
+						best = i;
+					}
+				}
+			}
+			else
+			{
+				// Weighted: -w / ln(u) for u uniform in (0, 1)
+				double bestScore = 0;
+				for (size_t i = 0; i < m_nodes.size(); ++i)
+				{
+					const double u = (double(score(keyHash, m_nodes[i].seed) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+					const double s = -m_nodes[i].weight / std::log(u);
+					if (s > bestScore || i == 0)
+					{
+						bestScore = s;
+						best = i;
+					}
+				}
+			}
+			return m_nodes[best].node;
+		}
+
+		void route_batch(const uint64_t* keyHashes, size_t n, uint64_t* out) const noexcept
+		{
+			for (size_t i = 0; i < n; ++i)
+				out[i] = route(keyHashes[i]);
+		}
+
+	private:
+		struct entry
+		{
+			uint64_t node;
+			uint64_t seed;
+			double weight;
+		};
+
+		std::vector<entry> m_nodes;
+		bool m_weighted = false;
+
+		static uint64_t score(uint64_t keyHash, uint64_t nodeSeed) noexcept { return shard_mix(keyHash ^ nodeSeed); }
+
+		void update_weighting() noexcept
+		{
+			m_weighted = false;
+			for (const entry& e : m_nodes)
+				m_weighted = m_weighted || e.weight != m_nodes[0].weight;
+		}
+	};
+
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_CONSISTENT_HASH_H
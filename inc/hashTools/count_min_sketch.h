@@ -0,0 +1,222 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+count_min_sketch.h -- Count-min frequency sketch
+
+A count-min sketch (Cormode & Muthukrishnan) over byte-string keys, with
+optional conservative update.  Each key is hashed exactly once with seeded
+lookup3 (hashlittle2); the per-row indices are derived from the two 32-bit
+halves by double hashing, h_i = h1 + i * h2, so an update costs one hash
+plus 'depth' counter touches no matter how deep the sketch is.
+
+Sketches with the same width, depth and seed can be merged.  For high update
+rates give each thread its own sketch and periodically merge() them into a
+shared one; the merged sketch is still a valid over-estimate.
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_COUNT_MIN_SKETCH_H
+#define CODETOOLS_HASHTOOLS_COUNT_MIN_SKETCH_H
+#pragma once
+
+#include "hashTools.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Prefetch for the batched update; a no-op where there is no hint to give
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#define HASHTOOLS_PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#elif defined(__GNUC__) || defined(__clang__)
+#define HASHTOOLS_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define HASHTOOLS_PREFETCH(p) ((void)(p))
+#endif
+
+BEGIN_HASHTOOLS_NS
+
+	template <class Counter = uint32_t>
+	class count_min_sketch
+	{
+	public:
+		typedef Counter counter_type;
+
+		// Deepest sketch supported; 16 rows is already an error probability of e^-16
+		static const uint32_t k_max_depth = 16;
+
+		// width_bits: log2 of the number of counters per row
+		// depth: number of rows, 1..k_max_depth
+		count_min_sketch(uint32_t width_bits, uint32_t depth, uint64_t seed = 0, bool conservative = true) :
+			m_widthBits(width_bits < 1 ? 1 : (width_bits > 31 ? 31 : width_bits)),
+			m_depth(depth < 1 ? 1 : (depth > k_max_depth ? k_max_depth : depth)),
+			m_mask(jenkins_hashmask(m_widthBits)),
+			m_seed(seed),
+			m_conservative(conservative),
+			m_total(0),
+			m_counters(size_t(m_depth) << m_widthBits, Counter(0))
+		{}
+
+		uint32_t width() const noexcept { return m_mask + 1; }
+		uint32_t depth() const noexcept { return m_depth; }
+		uint64_t seed() const noexcept { return m_seed; }
+		bool conservative() const noexcept { return m_conservative; }
+		// Sum of all counts added, including merged sketches
+		uint64_t total() const noexcept { return m_total; }
+
+		// The hash used for a key; callers that already hash their keys with
+		// jenkins_lookup3_64 and the same seed can use the *_hash entry points.
+		uint64_t hash(const void* key, size_t len) const noexcept { return jenkins_lookup3_64(key, len, m_seed); }
+
+		void add(const void* key, size_t len, Counter count = 1) noexcept { add_hash(hash(key, len), count); }
+		Counter estimate(const void* key, size_t len) const noexcept { return estimate_hash(hash(key, len)); }
+
+		void add_hash(uint64_t h, Counter count = 1) noexcept
+		{
+			size_t index[k_max_depth];
+			row_indices(h, index);
+			update(index, count);
+		}
+
+		// Batched update.  Row indices for a group of keys are computed and
+		// their counters prefetched before any of them are touched, so the
+		// cache misses of one group overlap instead of serializing.
+		void add_hashes(const uint64_t* hashes, size_t n, Counter count = 1) noexcept
+		{
+			const size_t k_group = 8;
+			size_t index[k_group][k_max_depth];
+			while (n)
+			{
+				const size_t g = n < k_group ? n : k_group;
+				for (size_t k = 0; k < g; ++k)
+				{
+					row_indices(hashes[k], index[k]);
+					for (uint32_t r = 0; r < m_depth; ++r)
+						HASHTOOLS_PREFETCH(&m_counters[index[k][r]]);
+				}
+				for (size_t k = 0; k < g; ++k)
+					update(index[k], count);
+				hashes += g;
+				n -= g;
+			}
+		}
+
+		// Batched update of byte-string keys, keys[i] has length lengths[i]
+		void add_batch(const void* const* keys, const size_t* lengths, size_t n, Counter count = 1) noexcept
+		{
+			const size_t k_group = 64;
+			uint64_t hashes[k_group];
+			while (n)
+			{
+				const size_t g = n < k_group ? n : k_group;
+				for (size_t k = 0; k < g; ++k)
+					hashes[k] = hash(keys[k], lengths[k]);
+				add_hashes(hashes, g, count);
+				keys += g;
+				lengths += g;
+				n -= g;
+			}
+		}
+
+		Counter estimate_hash(uint64_t h) const noexcept
+		{
+			size_t index[k_max_depth];
+			row_indices(h, index);
+			return minimum(index);
+		}
+
+		// Adds the counts of 'other' into this sketch.  Returns false, leaving
+		// this sketch untouched, if the two were not built with the same shape
+		// and seed.
+		bool merge(const count_min_sketch& other) noexcept
+		{
+			if (other.m_widthBits != m_widthBits || other.m_depth != m_depth || other.m_seed != m_seed)
+				return false;
+			const Counter* src = other.m_counters.data();
+			Counter* dst = m_counters.data();
+			for (size_t i = 0, e = m_counters.size(); i < e; ++i)
+				dst[i] = saturating_add(dst[i], src[i]);
+			m_total += other.m_total;
+			return true;
+		}
+
+		// Divides every counter by 2^shift; used to age out old traffic when
+		// tracking hot keys over a sliding period.
+		void age(unsigned shift = 1) noexcept
+		{
+			for (Counter& c : m_counters)
+				c = Counter(c >> shift);
+			m_total >>= shift;
+		}
+
+		void clear() noexcept
+		{
+			std::fill(m_counters.begin(), m_counters.end(), Counter(0));
+			m_total = 0;
+		}
+
+	private:
+		uint32_t m_widthBits;
+		uint32_t m_depth;
+		uint32_t m_mask;
+		uint64_t m_seed;
+		bool m_conservative;
+		uint64_t m_total;
+		std::vector<Counter> m_counters; // m_depth rows of (m_mask + 1) counters
+
+		// Absolute counter offsets for each row; size_t, since depth << width_bits
+		// can pass 32 bits.  Row 0 always exists and is written outside the
+		// loop, so the compiler can see minimum() never reads an unset entry.
+		void row_indices(uint64_t h, size_t* index) const noexcept
+		{
+			const uint32_t h1 = uint32_t(h);
+			const uint32_t h2 = uint32_t(h >> 32) | 1;
+			index[0] = h1 & m_mask;
+			for (uint32_t r = 1; r < m_depth; ++r)
+				index[r] = (size_t(r) << m_widthBits) + ((h1 + r * h2) & m_mask);
+		}
+
+		Counter minimum(const size_t* index) const noexcept
+		{
+			Counter m = m_counters[index[0]];
+			for (uint32_t r = 1; r < m_depth; ++r)
+				if (m_counters[index[r]] < m)
+					m = m_counters[index[r]];
+			return m;
+		}
+
+		void update(const size_t* index, Counter count) noexcept
+		{
+			m_total += count;
+			if (m_conservative)
+			{
+				// Only raise the counters that are below the new estimate
+				const Counter target = saturating_add(minimum(index), count);
+				for (uint32_t r = 0; r < m_depth; ++r)
+					if (m_counters[index[r]] < target)
+						m_counters[index[r]] = target;
+			}
+			else
+			{
+				for (uint32_t r = 0; r < m_depth; ++r)
+					m_counters[index[r]] = saturating_add(m_counters[index[r]], count);
+			}
+		}
+
+		static Counter saturating_add(Counter a, Counter b) noexcept
+		{
+			const Counter room = (std::numeric_limits<Counter>::max)() - a;
+			return (b > room) ? (std::numeric_limits<Counter>::max)() : Counter(a + b);
+		}
+	};
+
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_COUNT_MIN_SKETCH_H
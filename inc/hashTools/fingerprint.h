@@ -0,0 +1,77 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+fingerprint.h -- Parallel fingerprinting of files and directory trees
+
+fingerprint_tree() walks a tree on the calling thread and hands each regular
+file to a pool of workers through a bounded queue, so memory stays flat
+however many files the tree holds: at most queueDepth paths are waiting and
+each worker owns one blockSize read buffer (two on Windows).  Workers read a
+file in blocks, hashing one block while the next read is in flight
+(overlapped I/O on Windows, kernel readahead elsewhere), and many workers
+keep many reads outstanding, which is what an NVMe drive needs to reach its
+bandwidth.
+
+Results reach the sink one at a time, in completion order; sort the manifest
+if a stable order matters.  Symbolic links and reparse points are not
+followed.  Paths are UTF-8, relative to the root and '/' separated.
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_FINGERPRINT_H
+#define CODETOOLS_HASHTOOLS_FINGERPRINT_H
+#pragma once
+
+#include "hashTools.h"
+
+#include <cstdio>
+
+BEGIN_HASHTOOLS_NS
+
+	enum class fingerprint_hash { spooky_128, md5, crc32c };
+
+	struct fingerprint_options
+	{
+		fingerprint_hash hash;
+		unsigned threads;    // hashing workers; 0 for one per hardware thread
+		uint32_t blockSize;  // bytes per read
+		unsigned queueDepth; // files waiting for a worker; 0 for 4 per worker
+
+		fingerprint_options() noexcept : hash(fingerprint_hash::spooky_128), threads(0), blockSize(1 << 20), queueDepth(0) {}
+	};
+
+	struct fingerprint_entry
+	{
+		const char* path;          // relative to the root
+		uint64_t size;             // bytes hashed
+		unsigned char digest[16];  // spooky_128: low then high word, little-endian;
+		                           // crc32c: big-endian, as CRCs are usually printed
+		unsigned digestSize;       // 16, or 4 for crc32c
+		int error;                 // 0, or the errno / GetLastError() of the failed open or read
+	};
+
+	// Called from one thread at a time; context is passed through
+	typedef void (*fingerprint_sink)(void* context, const fingerprint_entry& entry);
+
+	// Hashes one file; returns 0 or the error code.  digest holds 16 bytes.
+	EXPORT int fingerprint_file(const char* path, fingerprint_hash hash, unsigned char* digest, uint64_t* size = 0, uint32_t blockSize = 1 << 20) noexcept;
+
+	// Fingerprints every regular file under root and returns how many were
+	// passed to the sink.  A file the workers lack the memory for is reported
+	// with ENOMEM.  If the sink throws, the remaining files are skipped and the
+	// exception is rethrown once the workers have stopped.
+	EXPORT uint64_t fingerprint_tree(const char* root, const fingerprint_options& options, fingerprint_sink sink, void* context);
+
+	// Manifest lines are "<hex digest>  <size>  <path>", or
+	// "error:<code>  0  <path>" for a file that could not be read
+	EXPORT void write_fingerprint_entry(FILE* out, const fingerprint_entry& entry) noexcept;
+	EXPORT uint64_t write_fingerprint_manifest(const char* root, FILE* out, const fingerprint_options& options);
+
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_FINGERPRINT_H
@@ -2,6 +2,7 @@
 #define CODETOOLS_HASHTOOLS_H
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 #ifdef EXPORT
@@ -19,6 +20,19 @@
 
 BEGIN_HASHTOOLS_NS
 
+	//////////////////////////////////////////////////////////////////////////////
+	// Table generation
+	//////////////////////////////////////////////////////////////////////////////
+	// One SplitMix64 step (Steele, Lea & Flood); expands a seed into the random
+	// tables used by the table-driven hashes.  Same seed, same tables.
+	inline uint64_t splitmix64(uint64_t& state) noexcept
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
 	//////////////////////////////////////////////////////////////////////////////
 	// Miscellaneous hashes
 	//////////////////////////////////////////////////////////////////////////////
@@ -29,6 +43,16 @@ BEGIN_HASHTOOLS_NS
 	// table is a naked pointer to uint32_t[maxlen][256]
 	EXPORT uint32_t zobrist_hash_32(char *key, uint32_t len, uint32_t maxlen, uint32_t* table) noexcept;
 
+	// Fill the tables above from a seed with splitmix64()
+	EXPORT void universal_table_32(uint32_t* table, uint32_t maxlen, uint64_t seed) noexcept;
+	EXPORT void zobrist_table_32(uint32_t* table, uint32_t maxlen, uint64_t seed) noexcept;
+
+	// Branch-free versions with the same results: universal hashing selects
+	// table entries with bit masks instead of tests, Zobrist gathers eight
+	// entries at a time.  Use AVX2 or SSE2 when available.
+	EXPORT uint32_t universal_hash_32_fast(const void* key, uint32_t len, uint32_t maxlen, const uint32_t* table) noexcept;
+	EXPORT uint32_t zobrist_hash_32_fast(const void* key, uint32_t len, uint32_t maxlen, const uint32_t* table) noexcept;
+
 	//////////////////////////////////////////////////////////////////////////////
 	// Hseih hash
 	//////////////////////////////////////////////////////////////////////////////
@@ -55,9 +79,17 @@ BEGIN_HASHTOOLS_NS
 		return jenkins_lookup2_32((const uint32_t*)key, len / 4, initVal);
 	}
 
+	// Byte order in which lookup3 and spooky read the key's words.  Values
+	// hashed as little or big are the same on every platform and are safe to
+	// persist; native is whichever of the two the host uses.  The overloads
+	// without a byte_order hash as little.
+	enum class byte_order { native, little, big };
+
 	// Lookup 3
 	EXPORT uint32_t jenkins_lookup3_32(const void* key, size_t length, uint32_t initialValue = 0) noexcept;
 	EXPORT uint64_t jenkins_lookup3_64(const void* key, size_t length, uint64_t initialValue = 0) noexcept;
+	EXPORT uint32_t jenkins_lookup3_32(const void* key, size_t length, uint32_t initialValue, byte_order order) noexcept;
+	EXPORT uint64_t jenkins_lookup3_64(const void* key, size_t length, uint64_t initialValue, byte_order order) noexcept;
 
 	constexpr uint32_t jenkins_hashsize(const uint32_t bits) noexcept { return 1 << bits; }
 	constexpr uint32_t jenkins_hashmask(const uint32_t bits) noexcept { return jenkins_hashsize(bits) - 1; }
@@ -68,11 +100,77 @@ BEGIN_HASHTOOLS_NS
 	EXPORT uint32_t spooky_32(const void* message, size_t length, uint32_t seed = 0) noexcept;
 	EXPORT uint64_t spooky_64(const void* message, size_t length, uint64_t seed = 0) noexcept;
 	EXPORT uint64_t spooky_128(const void* message, size_t length, uint64_t seed = 0, uint64_t* pSeedHigh = 0) noexcept;
+	EXPORT uint32_t spooky_32(const void* message, size_t length, uint32_t seed, byte_order order) noexcept;
+	EXPORT uint64_t spooky_64(const void* message, size_t length, uint64_t seed, byte_order order) noexcept;
+	EXPORT uint64_t spooky_128(const void* message, size_t length, uint64_t seed, uint64_t* pSeedHigh, byte_order order) noexcept;
+
+	// Incremental spooky for data that arrives in pieces.  spooky_final()
+	// gives the same value as spooky_128() over the concatenated pieces with
+	// seed1 as seed and seed2 as *pSeedHigh.
+	struct spooky_state
+	{
+		uint64_t opaque[38];
+	};
+
+	EXPORT void spooky_init(spooky_state& state, uint64_t seed1 = 0, uint64_t seed2 = 0) noexcept;
+	EXPORT void spooky_update(spooky_state& state, const void* message, size_t length) noexcept;
+	EXPORT uint64_t spooky_final(spooky_state& state, uint64_t* pHigh = 0) noexcept;
+
+	//////////////////////////////////////////////////////////////////////////////
+	// Keyed hashes
+	//////////////////////////////////////////////////////////////////////////////
+	// SipHash (Aumasson & Bernstein).  With a secret key the output cannot be
+	// predicted, so attackers cannot choose keys that collide in a hash table.
+	// SipHash-2-4 is the conservative choice; SipHash-1-3 is about twice as
+	// fast and enough for tables.  HalfSipHash uses 32-bit words and only
+	// key.k0, for 32-bit targets.  The *_u64 forms hash an integer as its 8
+	// little-endian bytes.
+	struct sip_key
+	{
+		uint64_t k0;
+		uint64_t k1;
+	};
+
+	EXPORT uint64_t siphash_2_4(const void* message, size_t length, const sip_key& key) noexcept;
+	EXPORT uint64_t siphash_1_3(const void* message, size_t length, const sip_key& key) noexcept;
+	EXPORT uint64_t siphash_2_4_u64(uint64_t value, const sip_key& key) noexcept;
+	EXPORT uint64_t siphash_1_3_u64(uint64_t value, const sip_key& key) noexcept;
+	EXPORT uint32_t halfsiphash_2_4(const void* message, size_t length, const sip_key& key) noexcept;
+	EXPORT uint32_t halfsiphash_1_3(const void* message, size_t length, const sip_key& key) noexcept;
+
+	// A fresh key from std::random_device, and one chosen the first time it
+	// is asked for and kept for the life of the process
+	EXPORT sip_key random_sip_key() noexcept;
+	EXPORT const sip_key& process_sip_key() noexcept;
+
+	//////////////////////////////////////////////////////////////////////////////
+	// CRCs
+	//////////////////////////////////////////////////////////////////////////////
+	// CRC-32C (Castagnoli, as in iSCSI and ext4) and CRC-64/XZ (ECMA-182,
+	// reflected).  Pass the previous result as crc to continue a message.
+	// *_combine() gives the CRC of A followed by B from the CRCs of A and B
+	// and the length of B, without the data.
+	EXPORT uint32_t crc32c(const void* data, size_t length, uint32_t crc = 0) noexcept;
+	EXPORT uint32_t crc32c_combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB) noexcept;
+	EXPORT uint64_t crc64(const void* data, size_t length, uint64_t crc = 0) noexcept;
+	EXPORT uint64_t crc64_combine(uint64_t crcA, uint64_t crcB, uint64_t lengthB) noexcept;
 
 	//////////////////////////////////////////////////////////////////////////////
 	// Cryptographic hashes
 	//////////////////////////////////////////////////////////////////////////////
 	EXPORT void md5_ref(const void* message, size_t length, unsigned char* digest) noexcept;
+
+	// Incremental MD5; digest is 16 bytes
+	struct md5_state
+	{
+		uint32_t state[4];
+		uint32_t count[2];
+		unsigned char buffer[64];
+	};
+
+	EXPORT void md5_init(md5_state& state) noexcept;
+	EXPORT void md5_update(md5_state& state, const void* message, size_t length) noexcept;
+	EXPORT void md5_final(md5_state& state, unsigned char* digest) noexcept;
 	EXPORT uint32_t sha1_ref(const void* message, size_t length) noexcept;
 
 END_HASHTOOLS_NS
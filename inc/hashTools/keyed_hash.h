@@ -0,0 +1,115 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+keyed_hash.h -- SipHash hash functors for hash-flooding resistant containers
+
+keyed_hash<Key> hashes with a secret sip_key, so whoever supplies the keys of
+a public-facing table cannot precompute a set that lands in one bucket.  It
+is a drop-in replacement for std::hash:
+
+  std::unordered_map<std::string, int, keyed_hash<std::string>> table;
+  space_saving<std::string, keyed_hash<std::string>> topUrls(1000);
+
+A default-constructed functor uses process_sip_key(); pass a key to share
+hash values between processes or to re-key a table.  Integers, enums and
+pointers go through the single-block *_u64 path; strings hash their
+characters.  Variant picks the rounds: SipHash-1-3 (the default, as in
+Python and Rust), SipHash-2-4, or the HalfSipHash versions for 32-bit size_t.
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_KEYED_HASH_H
+#define CODETOOLS_HASHTOOLS_KEYED_HASH_H
+#pragma once
+
+#include "hashTools.h"
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+BEGIN_HASHTOOLS_NS
+
+	enum class sip_variant { sip_1_3, sip_2_4, half_1_3, half_2_4 };
+
+	template <class Key, sip_variant Variant = sip_variant::sip_1_3>
+	class keyed_hash
+	{
+	public:
+		typedef Key argument_type;
+		typedef size_t result_type;
+
+		keyed_hash() noexcept : m_key(process_sip_key()) {}
+		explicit keyed_hash(const sip_key& key) noexcept : m_key(key) {}
+
+		const sip_key& key() const noexcept { return m_key; }
+
+		size_t operator()(const Key& key) const noexcept
+		{
+			return hash_key(key, std::integral_constant<bool, std::is_scalar<Key>::value>());
+		}
+
+	private:
+		sip_key m_key;
+
+		size_t hash_key(const Key& key, std::true_type) const noexcept
+		{
+			return hash_u64(scalar_bits(key));
+		}
+
+		template <class Char, class Traits, class Alloc>
+		size_t hash_string(const std::basic_string<Char, Traits, Alloc>& key) const noexcept
+		{
+			return hash_bytes(key.data(), key.size() * sizeof(Char));
+		}
+
+		size_t hash_key(const Key& key, std::false_type) const noexcept
+		{
+			return hash_string(key);
+		}
+
+		template <class T>
+		static uint64_t scalar_bits(T* p) noexcept { return uint64_t(uintptr_t(p)); }
+		template <class T>
+		static uint64_t scalar_bits(T value) noexcept { return uint64_t(value); }
+		// 0.0 and -0.0 compare equal, so they must hash equal
+		static uint64_t scalar_bits(double value) noexcept
+		{
+			uint64_t bits = 0;
+			if (value != 0)
+				memcpy(&bits, &value, sizeof(value));
+			return bits;
+		}
+		static uint64_t scalar_bits(float value) noexcept { return scalar_bits(double(value)); }
+
+		size_t hash_u64(uint64_t value) const noexcept
+		{
+			switch (Variant)
+			{
+			case sip_variant::sip_2_4: return size_t(siphash_2_4_u64(value, m_key));
+			case sip_variant::half_1_3: return halfsiphash_1_3(&value, sizeof(value), m_key);
+			case sip_variant::half_2_4: return halfsiphash_2_4(&value, sizeof(value), m_key);
+			default: return size_t(siphash_1_3_u64(value, m_key));
+			}
+		}
+
+		size_t hash_bytes(const void* data, size_t length) const noexcept
+		{
+			switch (Variant)
+			{
+			case sip_variant::sip_2_4: return size_t(siphash_2_4(data, length, m_key));
+			case sip_variant::half_1_3: return halfsiphash_1_3(data, length, m_key);
+			case sip_variant::half_2_4: return halfsiphash_2_4(data, length, m_key);
+			default: return size_t(siphash_1_3(data, length, m_key));
+			}
+		}
+	};
+
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_KEYED_HASH_H
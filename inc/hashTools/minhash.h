@@ -0,0 +1,348 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+minhash.h -- Similarity-preserving signatures for near-duplicate detection
+
+MinHash (Broder): a document is reduced to the set of hashes of its shingles
+(every 'width' byte window).  Signature slot i is the minimum over the set of
+a seeded hash h_i; the probability that two documents agree in a slot equals
+the Jaccard similarity of their shingle sets.  h_i(x) is jenkins_lookup3_32
+of the 4-byte shingle hash with seed i, which minhash_32() evaluates for 8
+slots per pass with SSE4.1, or 16 with AVX2, when the CPU has them.
+
+SimHash (Charikar): a 64-bit fingerprint whose Hamming distance tracks the
+cosine distance of weighted feature sets.
+
+lsh_index bands MinHash signatures (bands x rows slots) so that documents
+with similarity s become candidates with probability 1 - (1 - s^rows)^bands,
+replacing the all-pairs comparison with a sort per band.
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_MINHASH_H
+#define CODETOOLS_HASHTOOLS_MINHASH_H
+#pragma once
+
+#include "hashTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <utility>
+#include <vector>
+
+BEGIN_HASHTOOLS_NS
+
+	// Hashes every 'width' byte window of data into out, which must have room
+	// for len - width + 1 values.  A non-empty input shorter than the width is
+	// one shingle.  Returns the number of hashes written.
+	EXPORT size_t shingle_hashes_32(const void* data, size_t len, uint32_t width, uint32_t* out, uint32_t seed = 0) noexcept;
+
+	// Fills seeds[0, k) with the per-slot seeds of a MinHash family
+	EXPORT void minhash_seeds(uint64_t familySeed, uint32_t k, uint32_t* seeds) noexcept;
+
+	// signature[i] = min over the shingles of jenkins_lookup3_32(&shingle, 4, seeds[i]).
+	// An empty set gives a signature of all 0xFFFFFFFF.
+	EXPORT void minhash_32(const uint32_t* shingles, size_t n, const uint32_t* seeds, uint32_t k, uint32_t* signature) noexcept;
+
+	// Fraction of agreeing slots, an estimate of the Jaccard similarity
+	inline double minhash_similarity(const uint32_t* lhs, const uint32_t* rhs, uint32_t k) noexcept
+	{
+		uint32_t same = 0;
+		for (uint32_t i = 0; i < k; ++i)
+			same += lhs[i] == rhs[i];
+		return k ? double(same) / k : 0.0;
+	}
+
+	// Weighted SimHash of 64-bit feature hashes; weights may be null for all 1
+	EXPORT uint64_t simhash_64(const uint64_t* features, const uint32_t* weights, size_t n) noexcept;
+
+	inline uint32_t simhash_distance(uint64_t lhs, uint64_t rhs) noexcept
+	{
+		uint64_t x = lhs ^ rhs;
+		uint32_t bits = 0;
+		for (; x; x &= x - 1)
+			++bits;
+		return bits;
+	}
+
+	class lsh_index
+	{
+	public:
+		typedef uint32_t doc_id;
+		typedef std::pair<doc_id, doc_id> doc_pair;
+
+		lsh_index(uint32_t bands, uint32_t rows) :
+			m_bands(bands ? bands : 1),
+			m_rows(rows ? rows : 1),
+			m_built(false)
+		{}
+
+		uint32_t bands() const noexcept { return m_bands; }
+		uint32_t rows() const noexcept { return m_rows; }
+		uint32_t signature_size() const noexcept { return m_bands * m_rows; }
+		size_t size() const noexcept { return m_signatures.size() / signature_size(); }
+		bool built() const noexcept { return m_built; }
+
+		// Chance that a pair with Jaccard similarity s becomes a candidate
+		double candidate_probability(double s) const
+		{
+			return 1.0 - std::pow(1.0 - std::pow(s, double(m_rows)), double(m_bands));
+		}
+
+		void reserve(size_t documents) { m_signatures.reserve(documents * signature_size()); }
+
+		// Adds a signature of signature_size() slots; documents are numbered in
+		// the order they are added.  build() must be called again before the
+		// new documents are visible to queries.
+		doc_id add(const uint32_t* signature)
+		{
+			const doc_id id = doc_id(size());
+			m_signatures.insert(m_signatures.end(), signature, signature + signature_size());
+			m_built = false;
+			return id;
+		}
+
+		const uint32_t* signature(doc_id doc) const noexcept { return &m_signatures[size_t(doc) * signature_size()]; }
+
+		double similarity(doc_id lhs, doc_id rhs) const noexcept
+		{
+			return minhash_similarity(signature(lhs), signature(rhs), signature_size());
+		}
+
+		// Sorts every band's bucket keys.  Bands are independent, so they are
+		// spread over 'threads' workers (0 = one per hardware thread).
+		void build(unsigned threads = 0)
+		{
+			m_tables.assign(m_bands, std::vector<bucket_entry>());
+			for_each_band(threads, [this](uint32_t band) { build_band(band); });
+			m_built = true;
+		}
+
+		// Every pair of documents that share a bucket in at least one band,
+		// as (lower id, higher id), sorted and unique.  Buckets holding more
+		// than maxBucket documents are skipped (0 = no limit); on real corpora
+		// those are boilerplate and would dominate the output quadratically.
+		std::vector<doc_pair> candidate_pairs(size_t maxBucket = 0, unsigned threads = 0) const
+		{
+			std::vector<std::vector<uint64_t>> perBand(m_bands);
+			if (m_built)
+			{
+				for_each_band(threads, [&](uint32_t band)
+				{
+					std::vector<uint64_t>& out = perBand[band];
+					const std::vector<bucket_entry>& table = m_tables[band];
+					for (size_t first = 0, last; first < table.size(); first = last)
+					{
+						for (last = first + 1; last < table.size() && table[last].key == table[first].key; ++last)
+							;
+						if (maxBucket && last - first > maxBucket)
+							continue;
+						for (size_t i = first; i < last; ++i)
+							for (size_t j = i + 1; j < last; ++j)
+								out.push_back((uint64_t(table[i].doc) << 32) | table[j].doc);
+					}
+					std::sort(out.begin(), out.end());
+					out.erase(std::unique(out.begin(), out.end()), out.end());
+				});
+			}
+
+			size_t total = 0;
+			for (const std::vector<uint64_t>& band : perBand)
+				total += band.size();
+			std::vector<uint64_t> all;
+			all.reserve(total);
+			for (std::vector<uint64_t>& band : perBand)
+			{
+				all.insert(all.end(), band.begin(), band.end());
+				std::vector<uint64_t>().swap(band);
+			}
+			std::sort(all.begin(), all.end());
+			all.erase(std::unique(all.begin(), all.end()), all.end());
+
+			std::vector<doc_pair> result;
+			result.reserve(all.size());
+			for (uint64_t pair : all)
+				result.push_back(doc_pair(doc_id(pair >> 32), doc_id(pair)));
+			return result;
+		}
+
+		// Documents sharing a bucket with 'signature' in at least one band
+		std::vector<doc_id> query(const uint32_t* signature) const
+		{
+			std::vector<doc_id> result;
+			if (!m_built)
+				return result;
+			for (uint32_t band = 0; band < m_bands; ++band)
+			{
+				const std::vector<bucket_entry>& table = m_tables[band];
+				bucket_entry probe = { band_key(signature, band), 0, 0 };
+				std::vector<bucket_entry>::const_iterator iter =
+					std::lower_bound(table.begin(), table.end(), probe, by_key_doc);
+				for (; iter != table.end() && iter->key == probe.key; ++iter)
+					result.push_back(iter->doc);
+			}
+			std::sort(result.begin(), result.end());
+			result.erase(std::unique(result.begin(), result.end()), result.end());
+			return result;
+		}
+
+		// Writes the signatures and the built bucket tables, so a loaded index
+		// can answer queries without re-sorting.  Returns false on I/O error.
+		bool save(const char* filename) const
+		{
+			FILE* file = open(filename, "wb");
+			if (!file)
+				return false;
+			const uint64_t header[4] = { k_magic, m_bands, m_rows, size() };
+			bool ok = write(file, header, 4);
+			ok = ok && write(file, m_signatures.data(), m_signatures.size());
+			const uint64_t built = m_built ? 1 : 0;
+			ok = ok && write(file, &built, 1);
+			if (m_built)
+				for (uint32_t band = 0; ok && band < m_bands; ++band)
+					ok = write(file, m_tables[band].data(), m_tables[band].size());
+			return fclose(file) == 0 && ok;
+		}
+
+		// Replaces the contents of the index with a saved one.  On failure the
+		// index is left empty and false is returned.
+		bool load(const char* filename)
+		{
+			m_signatures.clear();
+			m_tables.clear();
+			m_built = false;
+
+			FILE* file = open(filename, "rb");
+			if (!file)
+				return false;
+			uint64_t header[4];
+			uint64_t built = 0;
+			bool ok = read(file, header, 4) && header[0] == k_magic &&
+			          header[1] && header[1] <= 0xFFFFFFFFu && header[2] && header[2] <= 0xFFFFFFFFu &&
+			          header[3] <= 0xFFFFFFFFu;
+			if (ok)
+			{
+				m_bands = uint32_t(header[1]);
+				m_rows = uint32_t(header[2]);
+				m_signatures.resize(size_t(header[3]) * signature_size());
+				ok = read(file, m_signatures.data(), m_signatures.size()) && read(file, &built, 1);
+			}
+			if (ok && built)
+			{
+				m_tables.assign(m_bands, std::vector<bucket_entry>(size_t(header[3])));
+				for (uint32_t band = 0; ok && band < m_bands; ++band)
+					ok = read(file, m_tables[band].data(), m_tables[band].size());
+				m_built = ok;
+			}
+			fclose(file);
+			if (!ok)
+			{
+				m_signatures.clear();
+				m_tables.clear();
+				m_built = false;
+			}
+			return ok;
+		}
+
+	private:
+		static const uint64_t k_magic = 0x31303048534C5443ull; // "CTLSH001"
+
+		struct bucket_entry
+		{
+			uint64_t key;
+			doc_id doc;
+			uint32_t reserved; // keeps the on-disk layout free of padding bytes
+		};
+
+		uint32_t m_bands;
+		uint32_t m_rows;
+		bool m_built;
+		std::vector<uint32_t> m_signatures;              // size() x signature_size()
+		std::vector<std::vector<bucket_entry>> m_tables; // per band, sorted by key then doc
+
+		static bool by_key_doc(const bucket_entry& lhs, const bucket_entry& rhs)
+		{
+			return lhs.key < rhs.key || (lhs.key == rhs.key && lhs.doc < rhs.doc);
+		}
+
+		uint64_t band_key(const uint32_t* signature, uint32_t band) const noexcept
+		{
+			return jenkins_lookup3_64(signature + size_t(band) * m_rows, m_rows * sizeof(uint32_t), band);
+		}
+
+		void build_band(uint32_t band)
+		{
+			std::vector<bucket_entry>& table = m_tables[band];
+			const size_t n = size();
+			table.resize(n);
+			for (size_t doc = 0; doc < n; ++doc)
+			{
+				table[doc].key = band_key(signature(doc_id(doc)), band);
+				table[doc].doc = doc_id(doc);
+				table[doc].reserved = 0;
+			}
+			std::sort(table.begin(), table.end(), by_key_doc);
+		}
+
+		template <class Fn>
+		void for_each_band(unsigned threads, Fn fn) const
+		{
+			if (!threads)
+				threads = std::thread::hardware_concurrency();
+			if (threads > m_bands)
+				threads = m_bands;
+			if (threads <= 1)
+			{
+				for (uint32_t band = 0; band < m_bands; ++band)
+					fn(band);
+				return;
+			}
+			std::vector<std::thread> workers;
+			workers.reserve(threads);
+			for (unsigned t = 0; t < threads; ++t)
+			{
+				workers.emplace_back([=]()
+				{
+					for (uint32_t band = t; band < m_bands; band += threads)
+						fn(band);
+				});
+			}
+			for (std::thread& worker : workers)
+				worker.join();
+		}
+
+		static FILE* open(const char* filename, const char* mode)
+		{
+			FILE* file = nullptr;
+#ifdef _MSC_VER
+			if (fopen_s(&file, filename, mode))
+				file = nullptr;
+#else
+			file = fopen(filename, mode);
+#endif
+			return file;
+		}
+
+		template <class T>
+		static bool write(FILE* file, const T* data, size_t count)
+		{
+			return !count || fwrite(data, sizeof(T), count, file) == count;
+		}
+
+		template <class T>
+		static bool read(FILE* file, T* data, size_t count)
+		{
+			return !count || fread(data, sizeof(T), count, file) == count;
+		}
+	};
+
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_MINHASH_H
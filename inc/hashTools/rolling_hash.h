@@ -0,0 +1,152 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+rolling_hash.h -- Rolling hashes over a sliding window of bytes
+
+rotating_hash_32() folds the whole key every call.  The hashes here keep their
+state between calls so the window can slide one byte at a time in O(1):
+
+  buzhash_32     cyclic polynomial: h = rotl(h, 1) ^ T[in] ^ rotl(T[out], w)
+  rabin_karp_64  polynomial mod 2^64: h = h * B + T[in] - B^w * T[out]
+  gear_64        h = (h << 1) + G[in]; the window is implicitly the last 64
+                 bytes, because older bytes have been shifted out of the word
+
+Tables are filled from a seed with splitmix64(), so a seed fully determines
+the hash.  push() feeds a byte while the window is filling; roll() slides a
+full window, given the byte that falls out of it.
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_ROLLING_HASH_H
+#define CODETOOLS_HASHTOOLS_ROLLING_HASH_H
+#pragma once
+
+#include "hashTools.h"
+
+BEGIN_HASHTOOLS_NS
+
+	class buzhash_32
+	{
+	public:
+		explicit buzhash_32(uint32_t window, uint64_t seed = 0) noexcept :
+			m_window(window), m_hash(0)
+		{
+			for (unsigned i = 0; i < 256; ++i)
+			{
+				m_table[i] = uint32_t(splitmix64(seed));
+				m_outTable[i] = rotl(m_table[i], window);
+			}
+		}
+
+		uint32_t window() const noexcept { return m_window; }
+		uint32_t value() const noexcept { return m_hash; }
+		void reset() noexcept { m_hash = 0; }
+
+		void push(uint8_t in) noexcept { m_hash = rotl(m_hash, 1) ^ m_table[in]; }
+		void roll(uint8_t out, uint8_t in) noexcept { m_hash = rotl(m_hash, 1) ^ m_outTable[out] ^ m_table[in]; }
+
+		// Hash of window() bytes, computed from scratch
+		uint32_t hash(const uint8_t* window) const noexcept
+		{
+			uint32_t h = 0;
+			for (uint32_t i = 0; i < m_window; ++i)
+				h = rotl(h, 1) ^ m_table[window[i]];
+			return h;
+		}
+
+	private:
+		uint32_t m_table[256];
+		uint32_t m_outTable[256]; // m_table rotated by the window size
+		uint32_t m_window;
+		uint32_t m_hash;
+
+		static uint32_t rotl(uint32_t x, uint32_t k) noexcept
+		{
+			k &= 31;
+			return k ? (x << k) | (x >> (32 - k)) : x;
+		}
+	};
+
+	class rabin_karp_64
+	{
+	public:
+		static const uint64_t k_default_base = 0x100000001b3ull; // the FNV-64 prime; any odd value works
+
+		explicit rabin_karp_64(uint32_t window, uint64_t seed = 0, uint64_t base = k_default_base) noexcept :
+			m_base(base | 1), m_window(window), m_hash(0)
+		{
+			uint64_t baseToWindow = 1;
+			for (uint32_t i = 0; i < window; ++i)
+				baseToWindow *= m_base;
+			for (unsigned i = 0; i < 256; ++i)
+			{
+				m_table[i] = splitmix64(seed);
+				m_outTable[i] = baseToWindow * m_table[i];
+			}
+		}
+
+		uint32_t window() const noexcept { return m_window; }
+		uint64_t value() const noexcept { return m_hash; }
+		void reset() noexcept { m_hash = 0; }
+
+		void push(uint8_t in) noexcept { m_hash = m_hash * m_base + m_table[in]; }
+		void roll(uint8_t out, uint8_t in) noexcept { m_hash = m_hash * m_base + m_table[in] - m_outTable[out]; }
+
+		uint64_t hash(const uint8_t* window) const noexcept
+		{
+			uint64_t h = 0;
+			for (uint32_t i = 0; i < m_window; ++i)
+				h = h * m_base + m_table[window[i]];
+			return h;
+		}
+
+	private:
+		uint64_t m_table[256];
+		uint64_t m_outTable[256]; // base^window * m_table
+		uint64_t m_base;
+		uint32_t m_window;
+		uint64_t m_hash;
+	};
+
+	class gear_64
+	{
+	public:
+		static const uint32_t k_window = 64;
+
+		explicit gear_64(uint64_t seed = 0) noexcept : m_hash(0)
+		{
+			for (unsigned i = 0; i < 256; ++i)
+				m_table[i] = splitmix64(seed);
+		}
+
+		uint32_t window() const noexcept { return k_window; }
+		uint64_t value() const noexcept { return m_hash; }
+		void reset() noexcept { m_hash = 0; }
+
+		void push(uint8_t in) noexcept { m_hash = (m_hash << 1) + m_table[in]; }
+		// The outgoing byte has already been shifted out
+		void roll(uint8_t /*out*/, uint8_t in) noexcept { push(in); }
+
+		uint64_t hash(const uint8_t* window) const noexcept
+		{
+			uint64_t h = 0;
+			for (uint32_t i = 0; i < k_window; ++i)
+				h = (h << 1) + m_table[window[i]];
+			return h;
+		}
+
+		const uint64_t* table() const noexcept { return m_table; }
+
+	private:
+		uint64_t m_table[256];
+		uint64_t m_hash;
+	};
+
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_ROLLING_HASH_H
@@ -0,0 +1,241 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+space_saving.h -- Space-saving heavy hitters tracker
+
+Tracks the (approximately) most frequent keys of a stream in a fixed number of
+counters (Metwally, Agrawal & El Abbadi).  When an untracked key arrives and
+all counters are in use, the key with the smallest count is evicted and the
+newcomer inherits its count as an error bound.  Any key whose true frequency
+exceeds total() / capacity() is guaranteed to be tracked, and for every
+tracked key  count - error <= true frequency <= count.
+
+The counters are kept in a binary min-heap indexed by a hash map, so an update
+is one hash lookup plus O(log capacity) sifting.  Summaries are mergeable
+(Agarwal et al.), so per-thread trackers can be folded together periodically.
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_SPACE_SAVING_H
+#define CODETOOLS_HASHTOOLS_SPACE_SAVING_H
+#pragma once
+
+#include "hashTools.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+BEGIN_HASHTOOLS_NS
+
+	template <class Key, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>>
+	class space_saving
+	{
+	public:
+		typedef Key key_type;
+
+		struct entry
+		{
+			Key key;
+			uint64_t count; // upper bound on the key's frequency
+			uint64_t error; // maximum over-estimation included in count
+		};
+
+		// hash is copied into the tracker's maps; pass a seeded functor such
+		// as keyed_hash (keyed_hash.h) when the keys come from outside
+		explicit space_saving(size_t capacity, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual()) :
+			m_capacity(capacity ? capacity : 1),
+			m_total(0),
+			m_index(m_capacity, hash, equal),
+			m_scratch(0, hash, equal)
+		{
+			m_heap.reserve(m_capacity);
+		}
+
+		size_t capacity() const noexcept { return m_capacity; }
+		size_t size() const noexcept { return m_heap.size(); }
+		bool full() const noexcept { return m_heap.size() == m_capacity; }
+		uint64_t total() const noexcept { return m_total; }
+
+		// Smallest tracked count once the tracker is full; an untracked key
+		// has a true frequency of at most this much.
+		uint64_t min_count() const noexcept { return full() ? m_heap[0].count : 0; }
+
+		void add(const Key& key, uint64_t count = 1)
+		{
+			m_total += count;
+			typename index_type::iterator iter = m_index.find(key);
+			if (iter != m_index.end())
+			{
+				m_heap[iter->second].count += count;
+				sift_down(iter->second);
+			}
+			else if (!full())
+			{
+				m_heap.push_back(entry{ key, count, 0 });
+				m_index.emplace(key, m_heap.size() - 1);
+				sift_up(m_heap.size() - 1);
+			}
+			else
+			{
+				entry& victim = m_heap[0];
+				m_index.erase(victim.key);
+				victim.error = victim.count;
+				victim.count += count;
+				victim.key = key;
+				m_index.emplace(key, 0);
+				sift_down(0);
+			}
+		}
+
+		// Batched update.  The batch is pre-aggregated so a hot key that
+		// appears many times costs a single heap update.
+		template <class InputIterator>
+		void add_batch(InputIterator first, InputIterator last)
+		{
+			m_scratch.clear();
+			for (; first != last; ++first)
+				++m_scratch[*first];
+			for (const std::pair<const Key, uint64_t>& kv : m_scratch)
+				add(kv.first, kv.second);
+		}
+
+		// Folds another summary into this one.  A key missing from one side
+		// is credited with that side's min_count(), both as count and as
+		// error, which keeps the space-saving guarantees for the union of
+		// the two streams.
+		void merge(const space_saving& other)
+		{
+			const uint64_t myMin = min_count();
+			const uint64_t otherMin = other.min_count();
+
+			std::unordered_map<Key, entry, Hash, KeyEqual> combined(m_heap.size() + other.m_heap.size(),
+				m_index.hash_function(), m_index.key_eq());
+			for (const entry& e : m_heap)
+				combined.emplace(e.key, entry{ e.key, e.count + otherMin, e.error + otherMin });
+			for (const entry& e : other.m_heap)
+			{
+				typename std::unordered_map<Key, entry, Hash, KeyEqual>::iterator iter = combined.find(e.key);
+				if (iter != combined.end())
+				{
+					iter->second.count = iter->second.count - otherMin + e.count;
+					iter->second.error = iter->second.error - otherMin + e.error;
+				}
+				else
+					combined.emplace(e.key, entry{ e.key, e.count + myMin, e.error + myMin });
+			}
+
+			std::vector<entry> merged;
+			merged.reserve(combined.size());
+			for (std::pair<const Key, entry>& kv : combined)
+				merged.push_back(std::move(kv.second));
+			if (merged.size() > m_capacity)
+			{
+				std::nth_element(merged.begin(), merged.begin() + m_capacity, merged.end(), by_count_desc);
+				merged.resize(m_capacity);
+			}
+
+			m_heap.swap(merged);
+			rebuild();
+			m_total += other.m_total;
+		}
+
+		// Up to k tracked entries, most frequent first
+		std::vector<entry> top(size_t k) const
+		{
+			std::vector<entry> result(m_heap);
+			if (k < result.size())
+			{
+				std::partial_sort(result.begin(), result.begin() + k, result.end(), by_count_desc);
+				result.resize(k);
+			}
+			else
+				std::sort(result.begin(), result.end(), by_count_desc);
+			return result;
+		}
+
+		// Tracked entries whose guaranteed frequency (count - error) is at
+		// least 'threshold', most frequent first
+		std::vector<entry> frequent(uint64_t threshold) const
+		{
+			std::vector<entry> result;
+			for (const entry& e : m_heap)
+				if (e.count - e.error >= threshold)
+					result.push_back(e);
+			std::sort(result.begin(), result.end(), by_count_desc);
+			return result;
+		}
+
+		void clear()
+		{
+			m_heap.clear();
+			m_index.clear();
+			m_total = 0;
+		}
+
+	private:
+		typedef std::unordered_map<Key, size_t, Hash, KeyEqual> index_type;
+
+		size_t m_capacity;
+		uint64_t m_total;
+		std::vector<entry> m_heap; // min-heap on count
+		index_type m_index;        // key -> position in m_heap
+		std::unordered_map<Key, uint64_t, Hash, KeyEqual> m_scratch;
+
+		static bool by_count_desc(const entry& lhs, const entry& rhs) { return lhs.count > rhs.count; }
+
+		void place(size_t pos) { m_index[m_heap[pos].key] = pos; }
+
+		void sift_up(size_t pos)
+		{
+			while (pos)
+			{
+				size_t parent = (pos - 1) / 2;
+				if (m_heap[parent].count <= m_heap[pos].count)
+					break;
+				std::swap(m_heap[parent], m_heap[pos]);
+				place(pos);
+				pos = parent;
+			}
+			place(pos);
+		}
+
+		void sift_down(size_t pos)
+		{
+			const size_t n = m_heap.size();
+			for (;;)
+			{
+				size_t child = 2 * pos + 1;
+				if (child >= n)
+					break;
+				if (child + 1 < n && m_heap[child + 1].count < m_heap[child].count)
+					++child;
+				if (m_heap[pos].count <= m_heap[child].count)
+					break;
+				std::swap(m_heap[pos], m_heap[child]);
+				place(pos);
+				pos = child;
+			}
+			place(pos);
+		}
+
+		void rebuild()
+		{
+			std::make_heap(m_heap.begin(), m_heap.end(), by_count_desc);
+			m_index.clear();
+			for (size_t i = 0; i < m_heap.size(); ++i)
+				m_index.emplace(m_heap[i].key, i);
+		}
+	};
+
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_SPACE_SAVING_H
@@ -0,0 +1,129 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+tabulation_hash.h -- Simple and twisted tabulation hashing of integer keys
+
+Zobrist hashing applied to fixed-width keys: the key is split into bytes and
+the hash is the XOR of one random table entry per byte position.
+
+  tabulation_hash<Key>          h(x) = T[0][x0] ^ T[1][x1] ^ ... ^ T[c-1][x(c-1)]
+                                3-independent, and behaves like a truly random
+                                hash for linear probing, cuckoo hashing and
+                                min-wise hashing (Patrascu & Thorup).
+  twisted_tabulation_hash<Key>  the entries for the first c-1 bytes also carry
+                                a "twister" byte that is XORed into the last
+                                key byte before its lookup, which gives
+                                Chernoff-style concentration bounds (Patrascu &
+                                Thorup, "Twisted Tabulation Hashing").
+
+Key is uint32_t or uint64_t and the hash has the same width.  The tables are
+byte-sliced: sizeof(Key) rows of 256 entries, 4-32KB in all, so every lookup
+is an L1 hit once warm and the per-byte loads are independent.  Both classes
+are hash functors usable with the standard containers and the sketches in
+this library.
+\*****************************************************************************/
+#ifndef CODETOOLS_HASHTOOLS_TABULATION_HASH_H
+#define CODETOOLS_HASHTOOLS_TABULATION_HASH_H
+#pragma once
+
+#include "hashTools.h"
+
+#include <type_traits>
+
+BEGIN_HASHTOOLS_NS
+
+	template <class Key>
+	class tabulation_hash
+	{
+		static_assert(std::is_same<Key, uint32_t>::value || std::is_same<Key, uint64_t>::value,
+		              "tabulation_hash keys are uint32_t or uint64_t");
+	public:
+		typedef Key argument_type;
+		typedef Key result_type;
+		static const unsigned k_chars = sizeof(Key);
+
+		explicit tabulation_hash(uint64_t seed = 0) noexcept
+		{
+			for (unsigned i = 0; i < k_chars; ++i)
+				for (unsigned c = 0; c < 256; ++c)
+					m_table[i][c] = Key(splitmix64(seed));
+		}
+
+		Key operator()(Key x) const noexcept
+		{
+			Key h = 0;
+			for (unsigned i = 0; i < k_chars; ++i, x >>= 8)
+				h ^= m_table[i][x & 0xFF];
+			return h;
+		}
+
+		void hash(const Key* keys, size_t n, Key* out) const noexcept
+		{
+			for (size_t i = 0; i < n; ++i)
+				out[i] = (*this)(keys[i]);
+		}
+
+	private:
+		Key m_table[k_chars][256];
+	};
+
+	template <class Key>
+	class twisted_tabulation_hash
+	{
+		static_assert(std::is_same<Key, uint32_t>::value || std::is_same<Key, uint64_t>::value,
+		              "twisted_tabulation_hash keys are uint32_t or uint64_t");
+	public:
+		typedef Key argument_type;
+		typedef Key result_type;
+		static const unsigned k_chars = sizeof(Key);
+
+		explicit twisted_tabulation_hash(uint64_t seed = 0) noexcept
+		{
+			for (unsigned i = 0; i < k_chars; ++i)
+				for (unsigned c = 0; c < 256; ++c)
+				{
+					m_table[i][c].hash = Key(splitmix64(seed));
+					// The last row's twister is never used
+					m_table[i][c].twist = i + 1 < k_chars ? Key(splitmix64(seed) & 0xFF) : 0;
+				}
+		}
+
+		Key operator()(Key x) const noexcept
+		{
+			Key h = 0, t = 0;
+			for (unsigned i = 0; i + 1 < k_chars; ++i, x >>= 8)
+			{
+				h ^= m_table[i][x & 0xFF].hash;
+				t ^= m_table[i][x & 0xFF].twist;
+			}
+			return h ^ m_table[k_chars - 1][(x ^ t) & 0xFF].hash;
+		}
+
+		void hash(const Key* keys, size_t n, Key* out) const noexcept
+		{
+			for (size_t i = 0; i < n; ++i)
+				out[i] = (*this)(keys[i]);
+		}
+
+	private:
+		// The twister is stored beside the hash word so both come from the
+		// same cache line
+		struct entry
+		{
+			Key hash;
+			Key twist;
+		};
+
+		entry m_table[k_chars][256];
+	};
+
+END_HASHTOOLS_NS
+
+#endif // CODETOOLS_HASHTOOLS_TABULATION_HASH_H
@@ -16,6 +16,15 @@ is allocated and released by dependent libraries.
 \*****************************************************************************/
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#if (defined(_MSVC_LANG) ? _MSVC_LANG : __cplusplus) >= 201703L
+#define CTMEMORY_HAS_PMR 1
+#include <memory_resource>
+#endif
+
 #ifdef EXPORT
 #undef EXPORT
 #endif // EXPORT
@@ -25,31 +34,45 @@ is allocated and released by dependent libraries.
 #ifdef LIBNEWNAMESPACE
 #undef LIBNEWNAMESPACE
 #endif // LIBNEWNAMESPACE
+#ifdef LIBNEWCALL
+#undef LIBNEWCALL
+#endif // LIBNEWCALL
 
 // CONFIGURE THIS CORRECTLY FOR YOUR PROJECT
 // Replace LIBNEW_EXPORTS with the appropriate macro from your build
 // Define LIBNEWWART with the [prepended] wart for the C function interface
 // Define LIBNEWNAMESPACE with the C++ namespace for your library
+#ifdef _WIN32
 #ifdef CTMEMORY_EXPORTS
 #define EXPORT __declspec(dllexport)
 #else
 #define EXPORT __declspec(dllimport)
 #endif
+#define LIBNEWCALL __cdecl
+#else
+// ELF: build with -fvisibility=hidden so only the interface is exported
+#define EXPORT __attribute__((visibility("default")))
+#define LIBNEWCALL
+#endif
 
 #define LIBNEWWART cdt
 #define LIBNEWNAMESPACE codetools
 
 #define DECL_NAME_HELPER1(x) x
 #define DECL_NAME_HELPER2(x, y) x ## y
-#define DECL_NAME(x) DECL_NAME_HELPER1(LIBNEWWART) ## x
-#define DECL_EXPORT_C(ret, name) extern "C" EXPORT ret __cdecl DECL_NAME(name)
-#define DECL_EXPORT_CPP(ret, name) EXPORT ret __cdecl name
+#define DECL_NAME_HELPER3(x, y) DECL_NAME_HELPER2(x, y)
+#define DECL_NAME(x) DECL_NAME_HELPER3(LIBNEWWART, x)
+#define DECL_EXPORT_C(ret, name) extern "C" EXPORT ret LIBNEWCALL DECL_NAME(name)
+#define DECL_EXPORT_CPP(ret, name) EXPORT ret LIBNEWCALL name
 
 #define LIB_ALLOC_FUNC DECL_NAME(LibAllocFunc)
 #define LIB_FREE_FUNC  DECL_NAME(LibFreeFunc)
+#define LIB_ALIGNED_ALLOC_FUNC DECL_NAME(LibAlignedAllocFunc)
 
-typedef void* (__cdecl *LIB_ALLOC_FUNC)(size_t size);
-typedef void(__cdecl *LIB_FREE_FUNC)(void*);
+typedef void* (LIBNEWCALL *LIB_ALLOC_FUNC)(size_t size);
+typedef void(LIBNEWCALL *LIB_FREE_FUNC)(void*);
+typedef void* (LIBNEWCALL *LIB_ALIGNED_ALLOC_FUNC)(size_t size, size_t alignment);
+typedef void(LIBNEWCALL *LIB_GUARD_ERROR_FUNC)(int error, void* block, size_t size);
 
 struct DECL_NAME(AllocInfo)
 {
@@ -62,33 +85,400 @@ struct DECL_NAME(AllocInfo)
 struct DECL_NAME(MemoryStats)
 {
 	size_t allocated;
-	size_t total_allocations;
-	size_t total_deallocations;
+	size_t total_allocations;       // calls
+	size_t total_deallocations;     // calls
 	size_t high_water_mark;
+	size_t bytes_allocated;
+	size_t bytes_deallocated;
+	// Mapped by HugePageAlloc right now, by what the system provided
+	size_t huge_page_bytes;             // explicit huge (large) pages
+	size_t transparent_huge_bytes;      // advised for transparent huge pages
+	size_t huge_fallback_bytes;         // ordinary pages; none were available
+};
+
+// Allocations by requested size.  Bin 0 holds sizes up to 16 bytes and bin i
+// those in (16 << (i - 1), 16 << i]; the last bin takes everything larger.
+// limit[i] is the largest size in bin i, SIZE_MAX for the last.
+#define LIBNEW_SIZE_BINS 24
+
+struct DECL_NAME(SizeHistogram)
+{
+	size_t limit[LIBNEW_SIZE_BINS];
+	size_t count[LIBNEW_SIZE_BINS];
+	size_t bytes[LIBNEW_SIZE_BINS];
+};
+
+// Caller-owned state for SampleAllocationRate.  Zero it to measure from
+// the time ctMemory was loaded; each call then measures from the last.
+struct DECL_NAME(RateCounter)
+{
+	int64_t ticks;
+	size_t allocations;
+	size_t deallocations;
+	size_t bytes;
+};
+
+struct DECL_NAME(AllocationRate)
+{
+	double seconds;
+	double allocations_per_second;
+	double deallocations_per_second;
+	double bytes_per_second;
+};
+
+// Allocation volume under one tag, since the process started.  Tag 0 is
+// "untagged".
+struct DECL_NAME(TagStats)
+{
+	const char* name;
+	size_t allocations;
+	size_t bytes;
+};
+
+// A point in the tracked allocation history, while BeginTrackAllocs is
+// active.  Taking one costs a single load.
+struct DECL_NAME(HeapSnapshot)
+{
+	uint64_t sequence;
+};
+
+struct DECL_NAME(HeapSizeGroup)
+{
+	size_t size;
+	size_t count;
+	size_t bytes;
+};
+
+// frames stay valid for the life of the process
+struct DECL_NAME(HeapStackGroup)
+{
+	void* const* frames;
+	unsigned depth;
+	size_t count;
+	size_t bytes;
+};
+
+// Allocations made between two snapshots and still alive.  Both groupings
+// are sorted by bytes, largest first; byStack only covers allocations made
+// while TrackAllocStacks was on.
+struct DECL_NAME(HeapDiff)
+{
+	size_t count;
+	size_t bytes;
+	size_t sizeGroups;
+	DECL_NAME(HeapSizeGroup)* bySize;
+	size_t stackGroups;
+	DECL_NAME(HeapStackGroup)* byStack;
+};
+
+// One call from an allocation trace.  Blocks are numbered in order of
+// allocation; a free carries its block's number, or LIBNEW_TRACE_UNKNOWN
+// when the block was allocated before the trace began.  size is 0 on a free
+// whose size was not given, alignment 0 on a plain allocation.
+#define LIBNEW_TRACE_ALLOC   0
+#define LIBNEW_TRACE_FREE    1
+#define LIBNEW_TRACE_UNKNOWN UINT64_MAX
+
+struct DECL_NAME(TraceEvent)
+{
+	int64_t ticks;          // since the first event
+	uint64_t block;
+	size_t size;
+	size_t alignment;
+	uint32_t thread;        // numbered from 0 in order of first use
+	uint32_t op;
+};
+
+// Events from every thread, merged in time order
+struct DECL_NAME(AllocTrace)
+{
+	int64_t tickFrequency;  // ticks per second
+	size_t count;
+	uint64_t blocks;
+	uint32_t threads;
+	DECL_NAME(TraceEvent)* events;
+};
+
+// Guard page allocator settings.  With alignment 1 an overflowing block
+// ends flush against its guard page; larger alignments leave up to
+// alignment - 1 bytes between, which are checked when the block is freed.
+// Underflow mode always starts the block on the page after its guard.
+#define LIBNEW_GUARD_OVERFLOW      0
+#define LIBNEW_GUARD_UNDERFLOW     1
+
+// Errors passed to onError; size is 0 for a bad free
+#define LIBNEW_GUARD_SLACK_DAMAGED 1   // a write just outside the block
+#define LIBNEW_GUARD_BAD_FREE      2   // not a live block: freed twice?
+
+struct DECL_NAME(GuardOptions)
+{
+	int mode;
+	size_t alignment;               // 0 means that of max_align_t
+	unsigned sampleRate;            // guard one allocation in this many; 0 or 1 guards all
+	size_t quarantineBytes;         // of freed slots kept inaccessible; 0 picks 64 MB
+	LIB_GUARD_ERROR_FUNC onError;   // null reports to stderr and aborts
+};
+
+struct DECL_NAME(GuardStats)
+{
+	size_t guarded;                 // blocks guarded so far
+	size_t live;                    // guarded blocks not yet freed
+	size_t quarantined;             // address space held by freed blocks
+	size_t reserved;                // address space taken from the guard range
+};
+
+// A monotonic region: allocations bump a pointer through a chain of blocks
+// and are only ever released together.  cursor and limit bound the free
+// space in the current block, so callers may bump inline; everything else
+// about an arena is private to ctMemory.
+struct DECL_NAME(Arena)
+{
+	char* cursor;
+	char* limit;
 };
 
 DECL_EXPORT_C(void,   BeginTrackAllocs)    ();
 DECL_EXPORT_C(void,   EndTrackAllocs)      ();
 DECL_EXPORT_C(size_t, GetAllocationInfo)   (DECL_NAME(AllocInfo)* pBuffer, size_t count);
 DECL_EXPORT_C(void,   GetMemoryStatistics) (DECL_NAME(MemoryStats)* pStats);
+// Tracked allocations also record their call stack while enabled
+DECL_EXPORT_C(void,   TrackAllocStacks)    (int enable);
+// A null before means since tracking began, a null after means now.  The
+// diff comes from one allocation and is freed by ReleaseHeapDiff; nullptr
+// when memory is short.
+DECL_EXPORT_C(DECL_NAME(HeapSnapshot), TakeHeapSnapshot) ();
+DECL_EXPORT_C(DECL_NAME(HeapDiff)*, DiffHeapSnapshots) (const DECL_NAME(HeapSnapshot)* before, const DECL_NAME(HeapSnapshot)* after);
+DECL_EXPORT_C(void,   ReleaseHeapDiff)     (DECL_NAME(HeapDiff)* diff);
 DECL_EXPORT_C(void,   SetAllocator)        (LIB_ALLOC_FUNC alloc, LIB_FREE_FUNC free);
 DECL_EXPORT_C(void*,  Alloc)               (size_t size);
 DECL_EXPORT_C(void,   Dealloc)             (void* vp);
+// Sized release needs no lookup to keep the statistics.  Alignments up to
+// that of max_align_t go to the plain allocator; larger ones to the aligned
+// allocator (_aligned_malloc, or posix_memalign off Windows, unless
+// replaced).  Size 0 means unknown.
+DECL_EXPORT_C(void,   SetAlignedAllocator) (LIB_ALIGNED_ALLOC_FUNC alloc, LIB_FREE_FUNC free);
+DECL_EXPORT_C(void*,  AllocAligned)        (size_t size, size_t alignment);
+DECL_EXPORT_C(void,   DeallocSized)        (void* vp, size_t size);
+DECL_EXPORT_C(void,   DeallocAligned)      (void* vp, size_t size, size_t alignment);
+// Records memory handed out without cdtAlloc (a caller's own pool, say) in
+// the statistics
+DECL_EXPORT_C(void,   CountAlloc)          (size_t size);
+DECL_EXPORT_C(void,   CountDealloc)        (size_t size);
+// As above, but the block also enters allocation tracking and heap sampling.
+// RecordDealloc must come before the memory is released.
+DECL_EXPORT_C(void,   RecordAlloc)         (void* vp, size_t size);
+DECL_EXPORT_C(void,   RecordDealloc)       (void* vp, size_t size);
+
+DECL_EXPORT_C(void,   GetSizeHistogram)    (DECL_NAME(SizeHistogram)* pHistogram);
+DECL_EXPORT_C(void,   SampleAllocationRate)(DECL_NAME(RateCounter)* pCounter, DECL_NAME(AllocationRate)* pRate);
+
+// Allocations are attributed to the calling thread's current tag.  MemoryTag
+// returns the id for a name, registering it on first use; names are compared
+// by content and copied.  Up to 63 names can be registered, after which 0
+// comes back.  SetMemoryTag returns the thread's previous tag so it can be
+// restored.  GetTagStatistics returns the number of tags when pBuffer is
+// null, otherwise the number written.
+DECL_EXPORT_C(unsigned, MemoryTag)         (const char* name);
+DECL_EXPORT_C(unsigned, SetMemoryTag)      (unsigned tag);
+DECL_EXPORT_C(size_t, GetTagStatistics)    (DECL_NAME(TagStats)* pBuffer, size_t count);
+
+// Heap sampling: about one allocation per sampleBytes (0 picks 512 KB) is
+// recorded with its call stack.  WriteHeapProfile writes the live samples as
+// a pprof heap profile and returns nonzero on success; EndHeapSampling
+// discards them.
+DECL_EXPORT_C(void,   BeginHeapSampling)   (size_t sampleBytes);
+DECL_EXPORT_C(void,   EndHeapSampling)     ();
+DECL_EXPORT_C(int,    WriteHeapProfile)    (const char* path);
+
+// Trace recording: every allocation and release through ctMemory is written
+// to path, with its size, thread and time, until EndAllocTrace.  Returns
+// nonzero once the file is open; starting a trace ends any other.
+// LoadAllocTrace reads a trace back as one allocation freed by
+// ReleaseAllocTrace; nullptr if the file is unreadable or memory is short.
+DECL_EXPORT_C(int,    BeginAllocTrace)     (const char* path);
+DECL_EXPORT_C(void,   EndAllocTrace)       ();
+DECL_EXPORT_C(DECL_NAME(AllocTrace)*, LoadAllocTrace) (const char* path);
+DECL_EXPORT_C(void,   ReleaseAllocTrace)   (DECL_NAME(AllocTrace)* trace);
+
+// Built-in size-class allocator with per-thread caches, for SetAllocator.
+// Requests over 4 KB are passed to malloc.
+DECL_EXPORT_C(void*,  ThreadCacheAlloc)    (size_t size);
+DECL_EXPORT_C(void,   ThreadCacheFree)     (void* vp);
+
+// Allocator for large blocks on huge pages, for SetAllocator or direct use.
+// Requests of half a huge page or more are mapped in whole huge pages:
+// explicit ones where the system has them reserved (hugetlbfs; on Windows,
+// large pages with SeLockMemoryPrivilege), else transparent huge pages, else
+// ordinary pages.  Smaller requests are passed to malloc.  HugePageSize
+// returns the huge page size in use.
+DECL_EXPORT_C(void*,  HugePageAlloc)       (size_t size);
+DECL_EXPORT_C(void,   HugePageFree)        (void* vp);
+DECL_EXPORT_C(size_t, HugePageSize)        ();
+
+// Debug allocator for SetAllocator: each guarded block sits against an
+// inaccessible page, so an overrun (or underrun) faults where it happens,
+// and freed blocks stay inaccessible in a quarantine to catch use after
+// free.  Every block takes at least two pages of address space and one of
+// memory; sampleRate keeps that affordable on a canary.  Blocks not sampled
+// come from malloc.  A null pOptions restores the defaults.
+DECL_EXPORT_C(void,   SetGuardOptions)     (const DECL_NAME(GuardOptions)* pOptions);
+DECL_EXPORT_C(void*,  GuardAlloc)          (size_t size);
+DECL_EXPORT_C(void,   GuardFree)           (void* vp);
+DECL_EXPORT_C(void,   GetGuardStatistics)  (DECL_NAME(GuardStats)* pStats);
+
+// Blocks come from cdtAlloc; blockSize 0 picks 64 KB.  ArenaCreateHuge
+// takes its blocks from HugePageAlloc instead, each rounded up to fill whole
+// huge pages (0 picks one).  Alignment 0 means that of max_align_t.  Reset
+// keeps the blocks for reuse, Destroy frees them.
+DECL_EXPORT_C(DECL_NAME(Arena)*, ArenaCreate) (size_t blockSize);
+DECL_EXPORT_C(DECL_NAME(Arena)*, ArenaCreateHuge) (size_t blockSize);
+DECL_EXPORT_C(void*,  ArenaAlloc)          (DECL_NAME(Arena)* arena, size_t size, size_t alignment);
+DECL_EXPORT_C(void,   ArenaReset)          (DECL_NAME(Arena)* arena);
+DECL_EXPORT_C(void,   ArenaDestroy)        (DECL_NAME(Arena)* arena);
 
 #ifdef __cplusplus
 namespace LIBNEWNAMESPACE
 {
 	typedef DECL_NAME(AllocInfo) AllocInfo;
 	typedef DECL_NAME(MemoryStats) MemoryStats;
+	typedef DECL_NAME(SizeHistogram) SizeHistogram;
+	typedef DECL_NAME(RateCounter) RateCounter;
+	typedef DECL_NAME(AllocationRate) AllocationRate;
+	typedef DECL_NAME(TagStats) TagStats;
+	typedef DECL_NAME(HeapSnapshot) HeapSnapshot;
+	typedef DECL_NAME(HeapSizeGroup) HeapSizeGroup;
+	typedef DECL_NAME(HeapStackGroup) HeapStackGroup;
+	typedef DECL_NAME(HeapDiff) HeapDiff;
+	typedef DECL_NAME(TraceEvent) TraceEvent;
+	typedef DECL_NAME(AllocTrace) AllocTrace;
+	typedef DECL_NAME(GuardOptions) GuardOptions;
+	typedef DECL_NAME(GuardStats) GuardStats;
 
 	DECL_EXPORT_CPP(void,   BeginTrackAllocs)    ();
 	DECL_EXPORT_CPP(void,   EndTrackAllocs)      ();
 	DECL_EXPORT_CPP(size_t, GetAllocationInfo)   (DECL_NAME(AllocInfo)* pBuffer, size_t count);
 	DECL_EXPORT_CPP(void,   GetMemoryStatistics) (DECL_NAME(MemoryStats)*);
+	DECL_EXPORT_CPP(void,   TrackAllocStacks)    (int enable);
+	DECL_EXPORT_CPP(DECL_NAME(HeapSnapshot), TakeHeapSnapshot) ();
+	DECL_EXPORT_CPP(DECL_NAME(HeapDiff)*, DiffHeapSnapshots) (const DECL_NAME(HeapSnapshot)* before, const DECL_NAME(HeapSnapshot)* after);
+	DECL_EXPORT_CPP(void,   ReleaseHeapDiff)     (DECL_NAME(HeapDiff)* diff);
 	DECL_EXPORT_CPP(void,   SetAllocator)        (LIB_ALLOC_FUNC alloc, LIB_FREE_FUNC free);
 	DECL_EXPORT_CPP(void,   SetAllocator)        (LIB_ALLOC_FUNC, LIB_FREE_FUNC);
 	DECL_EXPORT_CPP(void*,  Alloc)               (size_t size);
 	DECL_EXPORT_CPP(void,   Dealloc)             (void* vp);
+	DECL_EXPORT_CPP(void,   SetAlignedAllocator) (LIB_ALIGNED_ALLOC_FUNC alloc, LIB_FREE_FUNC free);
+	DECL_EXPORT_CPP(void*,  AllocAligned)        (size_t size, size_t alignment);
+	DECL_EXPORT_CPP(void,   DeallocSized)        (void* vp, size_t size);
+	DECL_EXPORT_CPP(void,   DeallocAligned)      (void* vp, size_t size, size_t alignment);
+	DECL_EXPORT_CPP(void,   CountAlloc)          (size_t size);
+	DECL_EXPORT_CPP(void,   CountDealloc)        (size_t size);
+	DECL_EXPORT_CPP(void,   RecordAlloc)         (void* vp, size_t size);
+	DECL_EXPORT_CPP(void,   RecordDealloc)       (void* vp, size_t size);
+	DECL_EXPORT_CPP(void,   GetSizeHistogram)    (DECL_NAME(SizeHistogram)* pHistogram);
+	DECL_EXPORT_CPP(void,   SampleAllocationRate)(DECL_NAME(RateCounter)* pCounter, DECL_NAME(AllocationRate)* pRate);
+	DECL_EXPORT_CPP(unsigned, MemoryTag)         (const char* name);
+	DECL_EXPORT_CPP(unsigned, SetMemoryTag)      (unsigned tag);
+	DECL_EXPORT_CPP(size_t, GetTagStatistics)    (DECL_NAME(TagStats)* pBuffer, size_t count);
+	DECL_EXPORT_CPP(void,   BeginHeapSampling)   (size_t sampleBytes);
+	DECL_EXPORT_CPP(void,   EndHeapSampling)     ();
+	DECL_EXPORT_CPP(int,    WriteHeapProfile)    (const char* path);
+	DECL_EXPORT_CPP(int,    BeginAllocTrace)     (const char* path);
+	DECL_EXPORT_CPP(void,   EndAllocTrace)       ();
+	DECL_EXPORT_CPP(DECL_NAME(AllocTrace)*, LoadAllocTrace) (const char* path);
+	DECL_EXPORT_CPP(void,   ReleaseAllocTrace)   (DECL_NAME(AllocTrace)* trace);
+	DECL_EXPORT_CPP(void*,  ThreadCacheAlloc)    (size_t size);
+	DECL_EXPORT_CPP(void,   ThreadCacheFree)     (void* vp);
+	DECL_EXPORT_CPP(void*,  HugePageAlloc)       (size_t size);
+	DECL_EXPORT_CPP(void,   HugePageFree)        (void* vp);
+	DECL_EXPORT_CPP(size_t, HugePageSize)        ();
+	DECL_EXPORT_CPP(void,   SetGuardOptions)     (const DECL_NAME(GuardOptions)* pOptions);
+	DECL_EXPORT_CPP(void*,  GuardAlloc)          (size_t size);
+	DECL_EXPORT_CPP(void,   GuardFree)           (void* vp);
+	DECL_EXPORT_CPP(void,   GetGuardStatistics)  (DECL_NAME(GuardStats)* pStats);
+	DECL_EXPORT_CPP(DECL_NAME(Arena)*, ArenaCreate) (size_t blockSize);
+	DECL_EXPORT_CPP(DECL_NAME(Arena)*, ArenaCreateHuge) (size_t blockSize);
+	DECL_EXPORT_CPP(void*,  ArenaAlloc)          (DECL_NAME(Arena)* arena, size_t size, size_t alignment);
+	DECL_EXPORT_CPP(void,   ArenaReset)          (DECL_NAME(Arena)* arena);
+	DECL_EXPORT_CPP(void,   ArenaDestroy)        (DECL_NAME(Arena)* arena);
+
+	// Attributes the calling thread's allocations to a tag until the end of
+	// the scope.  Scopes nest; the enclosing tag comes back on exit.
+	class ScopedMemoryTag
+	{
+	public:
+		explicit ScopedMemoryTag(const char* name) : m_previous(SetMemoryTag(MemoryTag(name))) {}
+		explicit ScopedMemoryTag(unsigned tag) : m_previous(SetMemoryTag(tag)) {}
+		~ScopedMemoryTag() { SetMemoryTag(m_previous); }
+		ScopedMemoryTag(const ScopedMemoryTag&) = delete;
+		ScopedMemoryTag& operator=(const ScopedMemoryTag&) = delete;
+
+	private:
+		unsigned m_previous;
+	};
+
+	// Owns an arena.  allocate() bumps inline and calls into ctMemory only
+	// when the current block is full; nothing is run on reset, so only
+	// trivially destructible objects belong here.  hugePages puts the blocks
+	// on huge pages, as ArenaCreateHuge.
+	class Arena
+	{
+	public:
+		explicit Arena(size_t blockSize = 0, bool hugePages = false)
+			: m_arena(hugePages ? ArenaCreateHuge(blockSize) : ArenaCreate(blockSize))
+		{
+			if (!m_arena)
+				throw std::bad_alloc();
+		}
+		~Arena() { ArenaDestroy(m_arena); }
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		// nullptr when memory is exhausted or alignment is not a power of
+		// two; alignment 0 means alignof(std::max_align_t), as ArenaAlloc
+		void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+		{
+			if (!alignment)
+				alignment = alignof(std::max_align_t);
+			if (alignment & (alignment - 1))
+				return nullptr;
+			const uintptr_t p = (uintptr_t(m_arena->cursor) + alignment - 1) & ~uintptr_t(alignment - 1);
+			const uintptr_t limit = uintptr_t(m_arena->limit);
+			if (p <= limit && size <= limit - p)
+			{
+				m_arena->cursor = (char*)(p + size);
+				return (void*)p;
+			}
+			return ArenaAlloc(m_arena, size, alignment);
+		}
+
+		void reset() { ArenaReset(m_arena); }
+		DECL_NAME(Arena)* get() const { return m_arena; }
+
+	private:
+		DECL_NAME(Arena)* m_arena;
+	};
+
+#ifdef CTMEMORY_HAS_PMR
+	// Lets pmr containers draw from an Arena.  Deallocation does nothing;
+	// the memory comes back when the arena is reset.
+	class ArenaResource : public std::pmr::memory_resource
+	{
+	public:
+		explicit ArenaResource(Arena& arena) : m_arena(arena) {}
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			void* p = m_arena.allocate(bytes, alignment);
+			if (!p)
+				throw std::bad_alloc();
+			return p;
+		}
+		void do_deallocate(void*, size_t, size_t) override {}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
 
+		Arena& m_arena;
+	};
+#endif // CTMEMORY_HAS_PMR
 }
 #endif // __cplusplus
@@ -0,0 +1,216 @@
+/*****************************************************************************\
+Copyright (c) 2016 Daniel Newby
+
+Part of the codetools library: https://github.com/DanielANewby/codetools
+
+The following code is licensed under The MIT License (MIT).  You should have
+received a copy of the license with the software as 'MIT-LICENSE'.  The test
+of the license can be found at https://opensource.org/licenses/MIT . See also
+'LICENSE' or 'LICENSE.txt' for more information.
+
+object_pool.h -- Fixed-size object pool with a lock-free free list
+
+Objects live in slabs that double in size as the pool grows and are only
+returned when the pool is destroyed.  Free objects form a stack threaded
+through a small header in front of each object.  The stack head packs the
+top object's index with a counter bumped on every pop, so a CAS cannot
+succeed against a head that was popped and pushed back in between (ABA).
+Indexes rather than pointers keep the pair in 64 bits on every platform.
+
+With CountStats the pool reports each object as an allocation in
+cdtMemoryStats and takes its slabs from malloc, so the statistics show the
+objects in use rather than the slabs.  Without it slabs come from cdtAlloc.
+\*****************************************************************************/
+#ifndef CODETOOLS_OBJECT_POOL_H
+#define CODETOOLS_OBJECT_POOL_H
+#pragma once
+
+#include "libnew.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace LIBNEWNAMESPACE
+{
+	template <class T, bool CountStats = false>
+	class object_pool
+	{
+		static_assert(alignof(T) <= alignof(std::max_align_t), "object_pool does not over-align");
+
+		struct slot
+		{
+			std::atomic<uint32_t> next;   // index + 1 of the next free slot, 0 at the end
+			uint32_t index;
+		};
+
+		static const size_t k_align = alignof(T) > alignof(slot) ? alignof(T) : alignof(slot);
+		static const size_t k_objectOffset = (sizeof(slot) + alignof(T) - 1) & ~(alignof(T) - 1);
+		static const size_t k_stride = (k_objectOffset + sizeof(T) + k_align - 1) & ~(k_align - 1);
+		static const unsigned k_baseShift = 5;  // the first slab holds 32 objects
+		static const uint32_t k_base = uint32_t(1) << k_baseShift;
+		static const unsigned k_maxSlabs = 31 - k_baseShift;
+		static const uint64_t k_tagUnit = uint64_t(1) << 32;
+
+	public:
+		object_pool() : m_head(0), m_slabCount(0)
+		{
+			for (unsigned i = 0; i < k_maxSlabs; ++i)
+				m_slabs[i] = nullptr;
+		}
+
+		// Objects still out are not destroyed, only their memory released
+		~object_pool()
+		{
+			for (unsigned i = 0; i < m_slabCount; ++i)
+				free_slab(m_slabs[i]);
+		}
+
+		object_pool(const object_pool&) = delete;
+		object_pool& operator=(const object_pool&) = delete;
+
+		// Uninitialized storage for one T; nullptr when memory is exhausted
+		void* allocate()
+		{
+			uint64_t head = m_head.load(std::memory_order_acquire);
+			for (;;)
+			{
+				const uint32_t top = uint32_t(head);
+				if (!top)
+				{
+					if (!grow())
+						return nullptr;
+					head = m_head.load(std::memory_order_acquire);
+					continue;
+				}
+				slot* s = slot_at(top - 1);
+				const uint64_t next = ((head >> 32) + 1) * k_tagUnit | s->next.load(std::memory_order_relaxed);
+				if (m_head.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire))
+				{
+					count_alloc(stats_tag());
+					return (char*)s + k_objectOffset;
+				}
+			}
+		}
+
+		void deallocate(void* p)
+		{
+			if (!p)
+				return;
+			slot* s = (slot*)((char*)p - k_objectOffset);
+			push(s, s);
+			count_dealloc(stats_tag());
+		}
+
+		template <class... Args>
+		T* create(Args&&... args)
+		{
+			void* p = allocate();
+			if (!p)
+				throw std::bad_alloc();
+			try
+			{
+				return new (p) T(std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				deallocate(p);
+				throw;
+			}
+		}
+
+		void destroy(T* p)
+		{
+			if (!p)
+				return;
+			p->~T();
+			deallocate(p);
+		}
+
+	private:
+		static unsigned floor_log2(uint32_t x)
+		{
+#ifdef _MSC_VER
+			unsigned long bit;
+			_BitScanReverse(&bit, x);
+			return unsigned(bit);
+#else
+			return 31 - unsigned(__builtin_clz(x));
+#endif
+		}
+
+		// Slab j holds k_base << j objects and starts at index k_base * (2^j - 1)
+		slot* slot_at(uint32_t index) const
+		{
+			const unsigned j = floor_log2((index >> k_baseShift) + 1);
+			const uint32_t offset = index + k_base - (k_base << j);
+			return (slot*)(m_slabs[j] + offset * k_stride);
+		}
+
+		// Pushes the chain first..last, already linked, onto the free stack
+		void push(slot* first, slot* last)
+		{
+			uint64_t head = m_head.load(std::memory_order_relaxed);
+			do
+				last->next.store(uint32_t(head), std::memory_order_relaxed);
+			while (!m_head.compare_exchange_weak(head, (head & ~(k_tagUnit - 1)) | (first->index + 1),
+				std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		bool grow()
+		{
+			std::lock_guard<std::mutex> guard(m_growth);
+			if (uint32_t(m_head.load(std::memory_order_acquire)))
+				return true;  // another thread grew the pool or freed an object
+			const unsigned j = m_slabCount;
+			if (j == k_maxSlabs)
+				return false;
+			const uint32_t count = k_base << j;
+			char* slab = alloc_slab(size_t(count) * k_stride);
+			if (!slab)
+				return false;
+
+			const uint32_t first = k_base * ((uint32_t(1) << j) - 1);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				slot* s = new (slab + size_t(i) * k_stride) slot;
+				s->index = first + i;
+				s->next.store(first + i + 2, std::memory_order_relaxed);
+			}
+			m_slabs[j] = slab;
+			m_slabCount = j + 1;
+			push((slot*)slab, (slot*)(slab + size_t(count - 1) * k_stride));
+			return true;
+		}
+
+		typedef std::integral_constant<bool, CountStats> stats_tag;
+
+		static void count_alloc(std::true_type) { CountAlloc(sizeof(T)); }
+		static void count_alloc(std::false_type) {}
+		static void count_dealloc(std::true_type) { CountDealloc(sizeof(T)); }
+		static void count_dealloc(std::false_type) {}
+
+		static char* alloc_slab(size_t bytes) { return alloc_slab(bytes, stats_tag()); }
+		static char* alloc_slab(size_t bytes, std::true_type) { return (char*)malloc(bytes); }
+		static char* alloc_slab(size_t bytes, std::false_type) { return (char*)Alloc(bytes); }
+
+		static void free_slab(char* slab) { free_slab(slab, stats_tag()); }
+		static void free_slab(char* slab, std::true_type) { free(slab); }
+		static void free_slab(char* slab, std::false_type) { Dealloc(slab); }
+
+		std::atomic<uint64_t> m_head;     // tag << 32 | (top index + 1)
+		char* m_slabs[k_maxSlabs];
+		unsigned m_slabCount;
+		std::mutex m_growth;
+	};
+}
+
+#endif // CODETOOLS_OBJECT_POOL_H
@@ -0,0 +1,18 @@
+#ifndef CODETOOLS_TESTS_SMOKE_H
+#define CODETOOLS_TESTS_SMOKE_H
+#pragma once
+
+#include <iostream>
+
+namespace smoke
+{
+	// Reports a failed condition and returns the failure count to add
+	inline int check(bool condition, const char* what)
+	{
+		if (!condition)
+			std::cout << "FAILED: " << what << std::endl;
+		return condition ? 0 : 1;
+	}
+}
+
+#endif // CODETOOLS_TESTS_SMOKE_H
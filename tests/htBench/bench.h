@@ -0,0 +1,34 @@
+#ifndef CODETOOLS_HTBENCH_BENCH_H
+#define CODETOOLS_HTBENCH_BENCH_H
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace htbench
+{
+	// Accumulates results so the optimizer cannot drop the timed work
+	extern volatile uint64_t g_sink;
+
+	// Runs fn() until at least minSeconds have passed and returns the mean
+	// time per call in nanoseconds
+	template <class Fn>
+	double time_ns(Fn fn, double minSeconds = 0.2)
+	{
+		typedef std::chrono::steady_clock clock;
+		fn(); // warm caches and tables
+		size_t calls = 0;
+		const clock::time_point start = clock::now();
+		double elapsed = 0;
+		do
+		{
+			fn();
+			++calls;
+			elapsed = std::chrono::duration<double>(clock::now() - start).count();
+		} while (elapsed < minSeconds);
+		return elapsed * 1e9 / calls;
+	}
+}
+
+#endif // CODETOOLS_HTBENCH_BENCH_H
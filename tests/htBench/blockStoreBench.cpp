@@ -0,0 +1,73 @@
+#include "bench.h"
+#include "hashTools/hashTools.h"
+#include "hashTools/block_store.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define remove_dir(path) _rmdir(path)
+#else
+#include <unistd.h>
+#define remove_dir(path) rmdir(path)
+#endif
+
+using namespace codetools::hashtools;
+
+// Dedup cache costs: a put of a block already in the store should be its
+// digest plus one index probe
+void blockStoreBench()
+{
+	const char* k_directory = "block_store_bench";
+	const size_t k_blocks = 16384, k_blockSize = 4096;
+	std::vector<uint8_t> data(k_blocks * k_blockSize);
+	uint64_t seed = 17;
+	for (uint8_t& b : data)
+		b = (uint8_t)splitmix64(seed);
+
+	printf("Block store, %zu blocks of %zu bytes\n", k_blocks, k_blockSize);
+	{
+		block_store store(k_directory);
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < k_blocks; ++i)
+			store.put(&data[i * k_blockSize], uint32_t(k_blockSize));
+		store.flush();
+		const double fill = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / k_blocks;
+
+		const double digest = htbench::time_ns([&]() {
+			uint8_t key[16];
+			for (size_t i = 0; i < k_blocks; ++i)
+			{
+				store.digest(&data[i * k_blockSize], k_blockSize, key);
+				htbench::g_sink += key[0];
+			}
+		}) / k_blocks;
+		const double present = htbench::time_ns([&]() {
+			for (size_t i = 0; i < k_blocks; ++i)
+				htbench::g_sink += (uint64_t)store.put(&data[i * k_blockSize], uint32_t(k_blockSize));
+		}) / k_blocks;
+
+		std::vector<uint8_t> keys(k_blocks * 16);
+		for (size_t i = 0; i < k_blocks; ++i)
+			store.digest(&data[i * k_blockSize], k_blockSize, &keys[i * 16]);
+		const double probe = htbench::time_ns([&]() {
+			for (size_t i = 0; i < k_blocks; ++i)
+				htbench::g_sink += store.contains(&keys[i * 16]);
+		}) / k_blocks;
+
+		printf("%-18s %10.1f ns/block\n", "put (new)", fill);
+		printf("%-18s %10.1f ns/block\n", "put (present)", present);
+		printf("%-18s %10.1f ns/block\n", "digest only", digest);
+		printf("%-18s %10.1f ns/block\n\n", "index probe", probe);
+	}
+
+	char path[64];
+	for (unsigned segment = 0; segment < 4; ++segment)
+	{
+		snprintf(path, sizeof(path), "%s/segment-%08u.blk", k_directory, segment);
+		remove(path);
+	}
+	remove_dir(k_directory);
+}
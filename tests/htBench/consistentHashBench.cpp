@@ -0,0 +1,110 @@
+#include "bench.h"
+#include "hashTools/consistent_hash.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	const size_t k_keys = 1 << 20;
+
+	struct load_stats
+	{
+		double skew;  // busiest shard / mean
+		double moved; // fraction of keys that moved when one shard was added
+	};
+
+	load_stats measure(const std::vector<uint64_t>& before, const std::vector<uint64_t>& after, size_t shards)
+	{
+		std::vector<size_t> load(shards);
+		size_t moved = 0;
+		for (size_t i = 0; i < before.size(); ++i)
+		{
+			++load[before[i]];
+			moved += before[i] != after[i];
+		}
+		size_t most = 0;
+		for (size_t c : load)
+			most = c > most ? c : most;
+		return load_stats{ double(most) * shards / before.size(), double(moved) / before.size() };
+	}
+
+	void report(const char* name, size_t shards, double ns, const load_stats& stats)
+	{
+		printf("%-22s %6zu %10.1f %8.3f %8.4f %8.4f\n", name, shards, ns, stats.skew, stats.moved, 1.0 / (shards + 1));
+	}
+}
+
+void consistentHashBench()
+{
+	std::vector<uint64_t> keys(k_keys);
+	for (size_t i = 0; i < k_keys; ++i)
+	{
+		const uint64_t id = i;
+		keys[i] = shard_key(&id, sizeof(id));
+	}
+	std::vector<uint64_t> before(k_keys), after(k_keys);
+	std::vector<int32_t> buckets(k_keys);
+	std::vector<uint64_t> nodes;
+
+	printf("Shard routing, %zu keys\n", k_keys);
+	printf("%-22s %6s %10s %8s %8s %8s\n", "scheme", "shards", "ns/key", "skew", "moved", "ideal");
+	for (size_t shards : { 16, 256, 4096 })
+	{
+		const int32_t n = int32_t(shards);
+		nodes.clear();
+		for (uint64_t node = 0; node < shards; ++node)
+			nodes.push_back(node);
+
+		double ns = htbench::time_ns([&]() {
+			uint64_t sum = 0;
+			for (uint64_t key : keys)
+				sum += jump_consistent_hash(key, n);
+			htbench::g_sink += sum;
+		}) / k_keys;
+		jump_consistent_hash_batch(keys.data(), k_keys, n, buckets.data());
+		before.assign(buckets.begin(), buckets.end());
+		jump_consistent_hash_batch(keys.data(), k_keys, n + 1, buckets.data());
+		after.assign(buckets.begin(), buckets.end());
+		const load_stats jumpStats = measure(before, after, shards + 1);
+		report("jump", shards, ns, jumpStats);
+
+		ns = htbench::time_ns([&]() {
+			jump_consistent_hash_batch(keys.data(), k_keys, n, buckets.data());
+			htbench::g_sink += buckets[0];
+		}) / k_keys;
+		report("jump (batch)", shards, ns, jumpStats);
+
+		for (uint32_t vnodes : { 40, 160 })
+		{
+			hash_ring ring(vnodes);
+			ring.add(nodes.data(), shards);
+			ns = htbench::time_ns([&]() {
+				ring.route_batch(keys.data(), k_keys, before.data());
+				htbench::g_sink += before[0];
+			}) / k_keys;
+			ring.add(shards);
+			ring.route_batch(keys.data(), k_keys, after.data());
+			char name[32];
+			snprintf(name, sizeof(name), "ring (%u vnodes)", vnodes);
+			report(name, shards, ns, measure(before, after, shards + 1));
+		}
+
+		if (shards <= 256)
+		{
+			rendezvous_hash hrw;
+			for (uint64_t node = 0; node < shards; ++node)
+				hrw.add(node);
+			ns = htbench::time_ns([&]() {
+				hrw.route_batch(keys.data(), k_keys, before.data());
+				htbench::g_sink += before[0];
+			}) / k_keys;
+			hrw.add(shards);
+			hrw.route_batch(keys.data(), k_keys, after.data());
+			report("rendezvous", shards, ns, measure(before, after, shards + 1));
+		}
+	}
+	printf("\n");
+}
@@ -0,0 +1,52 @@
+#include "bench.h"
+#include "hashTools/hashTools.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace codetools::hashtools;
+
+void crcBench()
+{
+	std::vector<uint8_t> data(1 << 20);
+	uint64_t seed = 5;
+	for (uint8_t& b : data)
+		b = (uint8_t)splitmix64(seed);
+
+	printf("CRCs, GB/s\n");
+	printf("%8s %10s %10s %10s\n", "bytes", "crc32c", "crc64", "spooky_64");
+	for (size_t len : { size_t(64), size_t(1024), size_t(16384), size_t(1) << 20 })
+	{
+		const size_t reps = (size_t(1) << 20) / len;
+		double ns[3];
+		ns[0] = htbench::time_ns([&]() {
+			uint32_t h = 0;
+			for (size_t r = 0; r < reps; ++r)
+				h ^= crc32c(&data[r * len], len);
+			htbench::g_sink += h;
+		}) / reps;
+		ns[1] = htbench::time_ns([&]() {
+			uint64_t h = 0;
+			for (size_t r = 0; r < reps; ++r)
+				h ^= crc64(&data[r * len], len);
+			htbench::g_sink += h;
+		}) / reps;
+		ns[2] = htbench::time_ns([&]() {
+			uint64_t h = 0;
+			for (size_t r = 0; r < reps; ++r)
+				h ^= spooky_64(&data[r * len], len);
+			htbench::g_sink += h;
+		}) / reps;
+		printf("%8zu %10.2f %10.2f %10.2f\n", len, len / ns[0], len / ns[1], len / ns[2]);
+	}
+
+	// Merging per-segment CRCs costs O(log length) multiplies, independent
+	// of the data
+	const double combine = htbench::time_ns([&]() {
+		uint32_t h = 0;
+		for (uint64_t len = 1; len < (1ull << 40); len <<= 1)
+			h = crc32c_combine(h, uint32_t(len), len);
+		htbench::g_sink += h;
+	}) / 40;
+	printf("crc32c_combine: %.0f ns/call\n\n", combine);
+}
@@ -0,0 +1,45 @@
+#include "bench.h"
+
+#include <cstring>
+
+volatile uint64_t htbench::g_sink;
+
+void consistentHashBench();
+void tableHashBench();
+void legacyHashBench();
+void crcBench();
+void siphashBench();
+void blockStoreBench();
+
+namespace
+{
+	struct benchmark
+	{
+		const char* name;
+		void (*run)();
+	};
+
+	const benchmark k_benchmarks[] =
+	{
+		{ "consistent", consistentHashBench },
+		{ "table", tableHashBench },
+		{ "legacy", legacyHashBench },
+		{ "crc", crcBench },
+		{ "siphash", siphashBench },
+		{ "blockstore", blockStoreBench },
+	};
+}
+
+// Runs every benchmark, or only those named on the command line
+int main(int argc, char** argv)
+{
+	for (const benchmark& b : k_benchmarks)
+	{
+		bool selected = argc < 2;
+		for (int i = 1; i < argc; ++i)
+			selected = selected || strcmp(argv[i], b.name) == 0;
+		if (selected)
+			b.run();
+	}
+	return 0;
+}
@@ -0,0 +1,52 @@
+#include "bench.h"
+#include "hashTools/hashTools.h"
+#include "../htSmoke/legacyHashes.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	// Keys start at every offset mod 8, so unaligned loads are included and
+	// the compiler cannot hoist the hash out of the repeat loop
+	template <class Fn>
+	double rate(size_t len, Fn fn)
+	{
+		static std::vector<uint8_t> data;
+		if (data.empty())
+		{
+			data.resize((64 << 10) + 8);
+			uint64_t seed = 1;
+			for (uint8_t& b : data)
+				b = (uint8_t)splitmix64(seed);
+		}
+		const size_t reps = len < 4096 ? 4096 / len : 1;
+		const double ns = htbench::time_ns([&]() {
+			uint32_t h = 0;
+			for (size_t r = 0; r < reps; ++r)
+				h ^= fn(&data[r & 7], len);
+			htbench::g_sink += h;
+		}, 0.1);
+		return double(len * reps) / ns; // bytes per ns == GB/s
+	}
+}
+
+void legacyHashBench()
+{
+	printf("Legacy byte hashes, GB/s: byte-wise original -> word-at-a-time\n");
+	printf("%8s %18s %18s %18s\n", "bytes", "jenkins_oaat_32", "jenkins_lookup2_32", "hseih_32");
+	for (size_t len = 16; len <= (64 << 10); len *= 4)
+	{
+		const uint32_t n = uint32_t(len);
+		const double oaatOld = rate(len, [=](const uint8_t* p, size_t) { return legacy::jenkins_oaat_32(p, n); });
+		const double oaatNew = rate(len, [=](const uint8_t* p, size_t) { return jenkins_oaat_32(p, n); });
+		const double l2Old = rate(len, [=](const uint8_t* p, size_t) { return legacy::jenkins_lookup2_32(p, n); });
+		const double l2New = rate(len, [=](const uint8_t* p, size_t) { return jenkins_lookup2_32(p, n); });
+		const double hsOld = rate(len, [=](const uint8_t* p, size_t l) { return legacy::hseih_32(p, l, 0); });
+		const double hsNew = rate(len, [=](const uint8_t* p, size_t l) { return hseih_32(p, l, 0); });
+		printf("%8zu %8.2f -> %5.2f %8.2f -> %5.2f %8.2f -> %5.2f\n", len, oaatOld, oaatNew, l2Old, l2New, hsOld, hsNew);
+	}
+	printf("\n");
+}
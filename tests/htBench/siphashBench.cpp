@@ -0,0 +1,65 @@
+#include "bench.h"
+#include "hashTools/hashTools.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace codetools::hashtools;
+
+// The price of flooding resistance: keyed hashes against spooky_64 at
+// hash-table key sizes
+void siphashBench()
+{
+	const size_t k_keys = 4096, k_stride = 64;
+	std::vector<uint8_t> keys(k_keys * k_stride);
+	uint64_t seed = 9;
+	for (uint8_t& b : keys)
+		b = (uint8_t)splitmix64(seed);
+	const sip_key key = random_sip_key();
+
+	printf("Keyed hashes, ns/key\n");
+	printf("%6s %10s %10s %10s %10s %10s\n", "bytes", "spooky_64", "sip-1-3", "sip-2-4", "half-1-3", "half-2-4");
+	for (size_t len : { size_t(8), size_t(16), size_t(24), size_t(32), size_t(48), size_t(64) })
+	{
+		double ns[5];
+		ns[0] = htbench::time_ns([&]() {
+			uint64_t h = 0;
+			for (size_t k = 0; k < k_keys; ++k)
+				h ^= spooky_64(&keys[k * k_stride], len, key.k0);
+			htbench::g_sink += h;
+		}) / k_keys;
+		ns[1] = htbench::time_ns([&]() {
+			uint64_t h = 0;
+			for (size_t k = 0; k < k_keys; ++k)
+				h ^= siphash_1_3(&keys[k * k_stride], len, key);
+			htbench::g_sink += h;
+		}) / k_keys;
+		ns[2] = htbench::time_ns([&]() {
+			uint64_t h = 0;
+			for (size_t k = 0; k < k_keys; ++k)
+				h ^= siphash_2_4(&keys[k * k_stride], len, key);
+			htbench::g_sink += h;
+		}) / k_keys;
+		ns[3] = htbench::time_ns([&]() {
+			uint32_t h = 0;
+			for (size_t k = 0; k < k_keys; ++k)
+				h ^= halfsiphash_1_3(&keys[k * k_stride], len, key);
+			htbench::g_sink += h;
+		}) / k_keys;
+		ns[4] = htbench::time_ns([&]() {
+			uint32_t h = 0;
+			for (size_t k = 0; k < k_keys; ++k)
+				h ^= halfsiphash_2_4(&keys[k * k_stride], len, key);
+			htbench::g_sink += h;
+		}) / k_keys;
+		printf("%6zu %10.1f %10.1f %10.1f %10.1f %10.1f\n", len, ns[0], ns[1], ns[2], ns[3], ns[4]);
+	}
+
+	const double u64 = htbench::time_ns([&]() {
+		uint64_t h = 0;
+		for (uint64_t k = 0; k < k_keys; ++k)
+			h ^= siphash_1_3_u64(k, key);
+		htbench::g_sink += h;
+	}) / k_keys;
+	printf("siphash_1_3_u64: %.1f ns/key\n\n", u64);
+}
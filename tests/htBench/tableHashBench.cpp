@@ -0,0 +1,90 @@
+#include "bench.h"
+#include "hashTools/hashTools.h"
+#include "hashTools/tabulation_hash.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace codetools::hashtools;
+
+void tableHashBench()
+{
+	const uint32_t maxlen = 256;
+	std::vector<uint32_t> universal(maxlen * 8), zobrist(maxlen * 256);
+	universal_table_32(universal.data(), maxlen, 1);
+	zobrist_table_32(zobrist.data(), maxlen, 2);
+
+	// Random keys make the reference loops' bit tests unpredictable
+	const size_t k_keys = 4096;
+	std::vector<char> keys(k_keys * maxlen);
+	uint64_t seed = 3;
+	for (char& c : keys)
+		c = (char)splitmix64(seed);
+
+	printf("Table hashes, ns/key\n");
+	printf("%6s %12s %12s %12s %12s\n", "bytes", "universal", "(fast)", "zobrist", "(fast)");
+	for (uint32_t len : { 8u, 16u, 32u, 64u, 256u })
+	{
+		double ns[4];
+		ns[0] = htbench::time_ns([&]() {
+			uint32_t h = 0;
+			for (size_t k = 0; k < k_keys; ++k)
+				h ^= universal_hash_32(&keys[k * maxlen], len, maxlen, universal.data());
+			htbench::g_sink += h;
+		}) / k_keys;
+		ns[1] = htbench::time_ns([&]() {
+			uint32_t h = 0;
+			for (size_t k = 0; k < k_keys; ++k)
+				h ^= universal_hash_32_fast(&keys[k * maxlen], len, maxlen, universal.data());
+			htbench::g_sink += h;
+		}) / k_keys;
+		ns[2] = htbench::time_ns([&]() {
+			uint32_t h = 0;
+			for (size_t k = 0; k < k_keys; ++k)
+				h ^= zobrist_hash_32(&keys[k * maxlen], len, maxlen, zobrist.data());
+			htbench::g_sink += h;
+		}) / k_keys;
+		ns[3] = htbench::time_ns([&]() {
+			uint32_t h = 0;
+			for (size_t k = 0; k < k_keys; ++k)
+				h ^= zobrist_hash_32_fast(&keys[k * maxlen], len, maxlen, zobrist.data());
+			htbench::g_sink += h;
+		}) / k_keys;
+		printf("%6u %12.1f %12.1f %12.1f %12.1f\n", len, ns[0], ns[1], ns[2], ns[3]);
+	}
+	printf("\n");
+
+	// Integer keys: tabulation against the byte-string hashes
+	std::vector<uint64_t> ids(k_keys);
+	for (uint64_t& id : ids)
+		id = splitmix64(seed);
+	const tabulation_hash<uint64_t> simple(1);
+	const twisted_tabulation_hash<uint64_t> twisted(1);
+	const double simpleNs = htbench::time_ns([&]() {
+		uint64_t h = 0;
+		for (uint64_t id : ids)
+			h ^= simple(id);
+		htbench::g_sink += h;
+	}) / k_keys;
+	const double twistedNs = htbench::time_ns([&]() {
+		uint64_t h = 0;
+		for (uint64_t id : ids)
+			h ^= twisted(id);
+		htbench::g_sink += h;
+	}) / k_keys;
+	const double spookyNs = htbench::time_ns([&]() {
+		uint64_t h = 0;
+		for (uint64_t id : ids)
+			h ^= spooky_64(&id, sizeof(id));
+		htbench::g_sink += h;
+	}) / k_keys;
+	const double lookup3Ns = htbench::time_ns([&]() {
+		uint64_t h = 0;
+		for (uint64_t id : ids)
+			h ^= jenkins_lookup3_64(&id, sizeof(id));
+		htbench::g_sink += h;
+	}) / k_keys;
+	printf("64-bit keys, ns/key\n");
+	printf("%12s %12s %12s %12s\n", "tabulation", "twisted", "spooky_64", "lookup3_64");
+	printf("%12.2f %12.2f %12.2f %12.2f\n\n", simpleNs, twistedNs, spookyNs, lookup3Ns);
+}
@@ -0,0 +1,104 @@
+#include "../common/smoke.h"
+#include "hashTools/hashTools.h"
+#include "hashTools/block_store.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define remove_dir(path) _rmdir(path)
+#else
+#include <unistd.h>
+#define remove_dir(path) rmdir(path)
+#endif
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	using smoke::check;
+
+	std::vector<uint8_t> block(uint64_t seed, size_t length)
+	{
+		std::vector<uint8_t> data(length);
+		for (uint8_t& b : data)
+			b = (uint8_t)splitmix64(seed);
+		return data;
+	}
+
+	void remove_store(const char* directory)
+	{
+		char path[64];
+		for (unsigned segment = 0; segment < 100; ++segment)
+		{
+			snprintf(path, sizeof(path), "%s/segment-%08u.blk", directory, segment);
+			remove(path);
+		}
+		remove_dir(directory);
+	}
+}
+
+int blockStoreSmokeTest()
+{
+	int failures = 0;
+	const char* k_directory = "block_store_smoke";
+	remove_store(k_directory);
+
+	// Small segments so the blocks span several of them
+	const block_store_options options(cdc_digest::spooky_128, 20000);
+	std::vector<std::vector<uint8_t>> blocks;
+	for (uint64_t i = 0; i < 40; ++i)
+		blocks.push_back(block(i, 100 + 97 * i));
+	uint8_t keys[40][16];
+	{
+		block_store store(k_directory, options);
+		failures += check(store.error() == 0 && store.blocks() == 0, "new store opens empty");
+
+		bool stored = true;
+		for (size_t i = 0; i < blocks.size(); ++i)
+			stored = stored && store.put(blocks[i].data(), uint32_t(blocks[i].size()), keys[i]) == block_put::stored;
+		failures += check(stored && store.blocks() == 40 && store.segments() > 1, "blocks stored across segments");
+
+		bool present = true;
+		for (size_t i = 0; i < blocks.size(); ++i)
+			present = present && store.put(blocks[i].data(), uint32_t(blocks[i].size())) == block_put::present;
+		failures += check(present && store.blocks() == 40 && store.duplicate_bytes() == store.stored_bytes(), "duplicates are not stored again");
+
+		uint8_t expected[16];
+		store.digest(blocks[3].data(), blocks[3].size(), expected);
+		failures += check(memcmp(expected, keys[3], 16) == 0 && store.length(keys[3]) == int64_t(blocks[3].size()), "key is the block digest");
+
+		// Reads from the segment still being written see unflushed data
+		std::vector<uint8_t> buffer(10000);
+		const int64_t got = store.get(keys[39], buffer.data(), buffer.size());
+		failures += check(got == int64_t(blocks[39].size()) && memcmp(buffer.data(), blocks[39].data(), blocks[39].size()) == 0, "get of the latest block");
+		failures += check(store.get(keys[39], buffer.data(), 10) == -1, "get into a short buffer fails");
+	}
+
+	{
+		// Reopening rebuilds the index from the segments
+		block_store store(k_directory, options);
+		failures += check(store.error() == 0 && store.blocks() == 40, "reopened store indexes every block");
+		bool matches = true;
+		std::vector<uint8_t> buffer(10000);
+		for (size_t i = 0; i < blocks.size(); ++i)
+			matches = matches && store.get(keys[i], buffer.data(), buffer.size()) == int64_t(blocks[i].size()) &&
+			          memcmp(buffer.data(), blocks[i].data(), blocks[i].size()) == 0;
+		failures += check(matches, "reopened store returns every block");
+
+		const std::vector<uint8_t> extra = block(1000, 500);
+		failures += check(store.put(extra.data(), uint32_t(extra.size())) == block_put::stored && store.blocks() == 41, "reopened store appends");
+		uint8_t missing[16] = { 1 };
+		failures += check(!store.contains(missing) && store.length(missing) == -1, "absent key");
+	}
+
+	{
+		block_store store(k_directory, block_store_options(cdc_digest::md5));
+		failures += check(store.error() != 0, "a store written with another digest is refused");
+	}
+
+	remove_store(k_directory);
+	return failures;
+}
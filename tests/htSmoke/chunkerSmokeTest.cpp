@@ -0,0 +1,114 @@
+#include "../common/smoke.h"
+#include "hashTools/rolling_hash.h"
+#include "hashTools/chunker.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	using smoke::check;
+
+	std::vector<uint8_t> random_bytes(size_t n, uint64_t seed)
+	{
+		std::vector<uint8_t> bytes(n);
+		for (size_t i = 0; i < n; ++i)
+			bytes[i] = (uint8_t)splitmix64(seed);
+		return bytes;
+	}
+
+	template <class Rolling>
+	bool rolls_like_recompute(Rolling& rolling, const std::vector<uint8_t>& data)
+	{
+		const uint32_t w = rolling.window();
+		rolling.reset();
+		for (uint32_t i = 0; i < w; ++i)
+			rolling.push(data[i]);
+		bool same = rolling.value() == rolling.hash(&data[0]);
+		for (size_t i = w; same && i < data.size(); ++i)
+		{
+			rolling.roll(data[i - w], data[i]);
+			same = rolling.value() == rolling.hash(&data[i - w + 1]);
+		}
+		return same;
+	}
+
+	void collect(const cdc_chunk& chunk, const uint8_t*, void* context)
+	{
+		((std::vector<cdc_chunk>*)context)->push_back(chunk);
+	}
+
+	bool same_chunks(const std::vector<cdc_chunk>& a, const std::vector<cdc_chunk>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); ++i)
+			if (a[i].offset != b[i].offset || a[i].length != b[i].length || memcmp(a[i].digest, b[i].digest, 16))
+				return false;
+		return true;
+	}
+}
+
+int chunkerSmokeTest()
+{
+	int failures = 0;
+	const std::vector<uint8_t> data = random_bytes(1 << 20, 99);
+
+	buzhash_32 buz(48, 1);
+	rabin_karp_64 rk(48, 2);
+	gear_64 gear(3);
+	failures += check(rolls_like_recompute(buz, data), "buzhash_32 roll matches recompute");
+	failures += check(rolls_like_recompute(rk, data), "rabin_karp_64 roll matches recompute");
+	failures += check(rolls_like_recompute(gear, data), "gear_64 roll matches recompute");
+
+	const cdc_params params(2048, 8192, 65536);
+	const cdc_chunker chunker(params);
+	std::vector<cdc_chunk> whole;
+	chunker.chunk(data.data(), data.size(), &collect, &whole);
+
+	uint64_t covered = 0;
+	bool sized = true;
+	for (size_t i = 0; i < whole.size(); ++i)
+	{
+		sized = sized && whole[i].offset == covered && whole[i].length <= params.max_size;
+		sized = sized && (whole[i].length >= params.min_size || i + 1 == whole.size());
+		covered += whole[i].length;
+	}
+	failures += check(sized && covered == data.size(), "chunks tile the buffer within size limits");
+	failures += check(whole.size() > data.size() / 32768 && whole.size() < data.size() / 4096, "average chunk size");
+
+	// Feeding the same data in odd sized pieces gives the same chunks
+	std::vector<cdc_chunk> streamed;
+	{
+		cdc_stream stream(chunker, &collect, &streamed);
+		size_t pos = 0, piece = 1;
+		while (pos < data.size())
+		{
+			size_t n = piece < data.size() - pos ? piece : data.size() - pos;
+			stream.update(&data[pos], n);
+			pos += n;
+			piece = piece * 7 % 50021 + 1;
+		}
+		stream.finish();
+	}
+	failures += check(same_chunks(whole, streamed), "streamed chunks match one-shot chunks");
+
+	// An insertion near the front only disturbs the chunks around it
+	std::vector<uint8_t> edited(data);
+	edited.insert(edited.begin() + 1000, 17, 0x5a);
+	std::vector<cdc_chunk> after;
+	chunker.chunk(edited.data(), edited.size(), &collect, &after);
+	size_t shared = 0;
+	for (const cdc_chunk& a : after)
+		for (const cdc_chunk& w : whole)
+			if (!memcmp(a.digest, w.digest, 16))
+			{
+				++shared;
+				break;
+			}
+	failures += check(shared + 3 >= whole.size(), "insertion preserves most chunks");
+
+	return failures;
+}
@@ -0,0 +1,119 @@
+#include "../common/smoke.h"
+#include "hashTools/consistent_hash.h"
+
+#include <vector>
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	using smoke::check;
+
+	std::vector<uint64_t> key_hashes(size_t n)
+	{
+		std::vector<uint64_t> keys(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			const uint64_t id = i;
+			keys[i] = shard_key(&id, sizeof(id), i & 1 ? shard_hash::fnv1a_64 : shard_hash::spooky_64);
+		}
+		return keys;
+	}
+
+	// Largest shard load relative to a perfectly even split
+	template <class Count>
+	double skew(const std::vector<Count>& load, size_t keys)
+	{
+		Count most = 0;
+		for (Count c : load)
+			most = c > most ? c : most;
+		return double(most) * load.size() / keys;
+	}
+
+	// Routes every key before and after a membership change; returns false if
+	// a key moved anywhere except to or from 'changed'
+	template <class Router>
+	bool minimal_movement(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& before, Router& router, uint64_t changed)
+	{
+		std::vector<uint64_t> after(keys.size());
+		router.route_batch(keys.data(), keys.size(), after.data());
+		for (size_t i = 0; i < keys.size(); ++i)
+			if (before[i] != after[i] && before[i] != changed && after[i] != changed)
+				return false;
+		return true;
+	}
+}
+
+int consistentHashSmokeTest()
+{
+	int failures = 0;
+	const size_t n = 100000;
+	const std::vector<uint64_t> keys = key_hashes(n);
+
+	// Jump hash: batch agrees with single, keys only move to the new bucket
+	{
+		std::vector<int32_t> batch(n), grown(n);
+		jump_consistent_hash_batch(keys.data(), n, 10, batch.data());
+		jump_consistent_hash_batch(keys.data(), n, 11, grown.data());
+		bool same = true, minimal = true;
+		std::vector<size_t> load(10);
+		for (size_t i = 0; i < n; ++i)
+		{
+			same = same && batch[i] == jump_consistent_hash(keys[i], 10) && batch[i] >= 0 && batch[i] < 10;
+			minimal = minimal && (grown[i] == batch[i] || grown[i] == 10);
+			++load[batch[i]];
+		}
+		failures += check(same, "jump_consistent_hash_batch matches single key routing");
+		failures += check(minimal, "jump_consistent_hash moves keys only to the new bucket");
+		failures += check(skew(load, n) < 1.05, "jump_consistent_hash balance");
+		failures += check(jump_consistent_hash(12345, 1) == 0, "jump_consistent_hash single bucket");
+	}
+
+	// Ring: joins and leaves only move the affected node's keys
+	{
+		hash_ring ring;
+		for (uint64_t node = 100; node < 116; ++node)
+			ring.add(node);
+		std::vector<uint64_t> before(n);
+		ring.route_batch(keys.data(), n, before.data());
+		std::vector<size_t> load(16);
+		for (uint64_t node : before)
+			++load[node - 100];
+		failures += check(skew(load, n) < 1.3, "hash_ring balance");
+
+		ring.add(200);
+		failures += check(minimal_movement(keys, before, ring, 200), "hash_ring join moves keys only to new node");
+		ring.remove(200);
+		ring.remove(105);
+		failures += check(minimal_movement(keys, before, ring, 105), "hash_ring leave moves only the node's keys");
+	}
+
+	// Rendezvous: same properties, and weights shift the share of keys
+	{
+		rendezvous_hash hrw;
+		for (uint64_t node = 0; node < 16; ++node)
+			hrw.add(node);
+		std::vector<uint64_t> before(n);
+		hrw.route_batch(keys.data(), n, before.data());
+		std::vector<size_t> load(16);
+		for (uint64_t node : before)
+			++load[node];
+		failures += check(skew(load, n) < 1.05, "rendezvous_hash balance");
+
+		hrw.add(99);
+		failures += check(minimal_movement(keys, before, hrw, 99), "rendezvous_hash join moves keys only to new node");
+		hrw.remove(99);
+		hrw.remove(3);
+		failures += check(minimal_movement(keys, before, hrw, 3), "rendezvous_hash leave moves only the node's keys");
+
+		rendezvous_hash weighted;
+		weighted.add(1, 1.0);
+		weighted.add(2, 3.0);
+		size_t heavy = 0;
+		for (uint64_t key : keys)
+			heavy += weighted.route(key) == 2;
+		failures += check(heavy > n * 0.72 && heavy < n * 0.78, "rendezvous_hash weights");
+	}
+
+	return failures;
+}
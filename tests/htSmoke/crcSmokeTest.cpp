@@ -0,0 +1,97 @@
+#include "../common/smoke.h"
+#include "hashTools/hashTools.h"
+
+#include <vector>
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	using smoke::check;
+
+	// Bit-at-a-time references
+	uint32_t crc32c_bitwise(const uint8_t* p, size_t length)
+	{
+		uint32_t crc = 0xFFFFFFFF;
+		for (size_t i = 0; i < length; ++i)
+		{
+			crc ^= p[i];
+			for (int b = 0; b < 8; ++b)
+				crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+		}
+		return ~crc;
+	}
+
+	uint64_t crc64_bitwise(const uint8_t* p, size_t length)
+	{
+		uint64_t crc = ~0ull;
+		for (size_t i = 0; i < length; ++i)
+		{
+			crc ^= p[i];
+			for (int b = 0; b < 8; ++b)
+				crc = (crc & 1) ? (crc >> 1) ^ 0xC96C5795D7870F42ull : crc >> 1;
+		}
+		return ~crc;
+	}
+}
+
+int crcSmokeTest()
+{
+	int failures = 0;
+
+	// Catalogue check values
+	failures += check(crc32c("123456789", 9) == 0xE3069283, "crc32c check value");
+	failures += check(crc64("123456789", 9) == 0x995DC9BBDF1939FAull, "crc64 check value");
+	failures += check(crc32c("", 0) == 0 && crc64("", 0) == 0, "crc of empty message");
+
+	std::vector<uint8_t> data(40000);
+	uint64_t seed = 7;
+	for (uint8_t& b : data)
+		b = (uint8_t)splitmix64(seed);
+
+	// Every length through the tails and the first hardware block sizes,
+	// then lengths around the three-way kernel's strides
+	bool c32 = true, c64 = true;
+	for (size_t offset = 0; offset < 8; ++offset)
+		for (size_t len = 0; len <= 1100; len += (len < 300 ? 1 : 37))
+		{
+			c32 = c32 && crc32c(&data[offset], len) == crc32c_bitwise(&data[offset], len);
+			c64 = c64 && crc64(&data[offset], len) == crc64_bitwise(&data[offset], len);
+		}
+	const size_t lengths[] = { 3 * 256 - 1, 3 * 256, 3 * 4096 - 8, 3 * 4096, 3 * 4096 + 3 * 256 + 5, 39990 };
+	for (size_t len : lengths)
+	{
+		c32 = c32 && crc32c(&data[3], len) == crc32c_bitwise(&data[3], len);
+		c64 = c64 && crc64(&data[3], len) == crc64_bitwise(&data[3], len);
+	}
+	failures += check(c32, "crc32c matches bitwise reference");
+	failures += check(c64, "crc64 matches bitwise reference");
+
+	// Continuing and combining give the CRC of the whole
+	bool cont = true, combine = true;
+	const size_t splits[] = { 0, 1, 15, 64, 1000, 12345, 39999, 40000 };
+	const uint32_t whole32 = crc32c(data.data(), data.size());
+	const uint64_t whole64 = crc64(data.data(), data.size());
+	for (size_t split : splits)
+	{
+		const size_t lenB = data.size() - split;
+		const uint32_t a32 = crc32c(data.data(), split), b32 = crc32c(&data[split], lenB);
+		const uint64_t a64 = crc64(data.data(), split), b64 = crc64(&data[split], lenB);
+		cont = cont && crc32c(&data[split], lenB, a32) == whole32 && crc64(&data[split], lenB, a64) == whole64;
+		combine = combine && crc32c_combine(a32, b32, lenB) == whole32 && crc64_combine(a64, b64, lenB) == whole64;
+	}
+	failures += check(cont, "crc continued across a split");
+	failures += check(combine, "crc combined across a split");
+
+	// Per-thread style: many segments folded left to right
+	uint32_t merged32 = 0;
+	uint64_t merged64 = 0;
+	for (size_t at = 0; at < data.size(); at += 4000)
+	{
+		merged32 = crc32c_combine(merged32, crc32c(&data[at], 4000), 4000);
+		merged64 = crc64_combine(merged64, crc64(&data[at], 4000), 4000);
+	}
+	failures += check(merged32 == whole32 && merged64 == whole64, "crc combined from segments");
+
+	return failures;
+}
@@ -0,0 +1,165 @@
+#include "../common/smoke.h"
+#include "hashTools/hashTools.h"
+#include "hashTools/fingerprint.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define make_dir(path) _mkdir(path)
+#define remove_dir(path) _rmdir(path)
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define make_dir(path) mkdir(path, 0755)
+#define remove_dir(path) rmdir(path)
+#endif
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	using smoke::check;
+
+	bool write_file(const std::string& path, const std::vector<uint8_t>& data)
+	{
+		FILE* f = nullptr;
+#ifdef _MSC_VER
+		if (fopen_s(&f, path.c_str(), "wb"))
+			f = nullptr;
+#else
+		f = fopen(path.c_str(), "wb");
+#endif
+		if (!f)
+			return false;
+		const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+		fclose(f);
+		return ok;
+	}
+
+	struct collected
+	{
+		std::map<std::string, fingerprint_entry> entries;
+	};
+
+	void collect(void* context, const fingerprint_entry& entry)
+	{
+		fingerprint_entry copy = entry;
+		copy.path = 0;
+		((collected*)context)->entries[entry.path] = copy;
+	}
+
+	void refuse(void* context, const fingerprint_entry&)
+	{
+		++*(int*)context;
+		throw std::runtime_error("sink full");
+	}
+}
+
+int fingerprintSmokeTest()
+{
+	int failures = 0;
+
+	std::vector<uint8_t> data(300000);
+	uint64_t seed = 11;
+	for (uint8_t& b : data)
+		b = (uint8_t)splitmix64(seed);
+
+	// Incremental hashes equal the one-shot ones however the data is cut
+	spooky_state spooky;
+	md5_state md5;
+	spooky_init(spooky, 5, 6);
+	md5_init(md5);
+	for (size_t at = 0, step = 1; at < data.size(); at += step, step = step * 3 + 1)
+	{
+		const size_t n = std::min(step, data.size() - at);
+		spooky_update(spooky, &data[at], n);
+		md5_update(md5, &data[at], n);
+	}
+	uint64_t high = 6, streamHigh = 0;
+	const uint64_t low = spooky_128(data.data(), data.size(), 5, &high);
+	failures += check(spooky_final(spooky, &streamHigh) == low && streamHigh == high, "incremental spooky matches spooky_128");
+	unsigned char digest[16], streamDigest[16];
+	md5_ref(data.data(), data.size(), digest);
+	md5_final(md5, streamDigest);
+	failures += check(memcmp(digest, streamDigest, 16) == 0, "incremental md5 matches md5_ref");
+
+	// A small tree; block sizes that do and do not divide the file sizes
+	make_dir("fingerprint_smoke");
+	make_dir("fingerprint_smoke/sub");
+	const std::vector<uint8_t> empty;
+	const std::vector<uint8_t> small(data.begin(), data.begin() + 1000);
+	bool written = write_file("fingerprint_smoke/big.bin", data) &&
+	               write_file("fingerprint_smoke/empty.bin", empty) &&
+	               write_file("fingerprint_smoke/sub/small.bin", small);
+	failures += check(written, "fingerprint test files written");
+
+	unsigned char fileDigest[16];
+	uint64_t size = 0;
+	failures += check(fingerprint_file("fingerprint_smoke/big.bin", fingerprint_hash::md5, fileDigest, &size, 4096) == 0 &&
+	                  size == data.size() && memcmp(fileDigest, digest, 16) == 0, "fingerprint_file md5");
+	failures += check(fingerprint_file("fingerprint_smoke/missing.bin", fingerprint_hash::md5, fileDigest) != 0, "fingerprint_file reports a missing file");
+
+	fingerprint_options options;
+	options.threads = 3;
+	options.blockSize = 65536;
+	options.queueDepth = 1;
+	const fingerprint_hash hashes[] = { fingerprint_hash::spooky_128, fingerprint_hash::md5, fingerprint_hash::crc32c };
+	for (fingerprint_hash hash : hashes)
+	{
+		options.hash = hash;
+		collected result;
+		const uint64_t files = fingerprint_tree("fingerprint_smoke", options, collect, &result);
+		bool ok = files == 3 && result.entries.size() == 3 &&
+		          result.entries.count("big.bin") && result.entries.count("sub/small.bin") && result.entries.count("empty.bin");
+		if (ok)
+		{
+			const fingerprint_entry& big = result.entries["big.bin"];
+			const fingerprint_entry& sm = result.entries["sub/small.bin"];
+			ok = big.error == 0 && big.size == data.size() && sm.size == small.size() && result.entries["empty.bin"].size == 0;
+			if (hash == fingerprint_hash::spooky_128)
+			{
+				uint64_t h = 0;
+				const uint64_t l = spooky_128(small.data(), small.size(), 0, &h);
+				for (int i = 0; i < 8; ++i)
+					ok = ok && sm.digest[i] == uint8_t(l >> (8 * i)) && sm.digest[8 + i] == uint8_t(h >> (8 * i));
+			}
+			else if (hash == fingerprint_hash::md5)
+				ok = ok && memcmp(big.digest, digest, 16) == 0;
+			else
+			{
+				const uint32_t crc = crc32c(data.data(), data.size());
+				ok = ok && big.digestSize == 4 && big.digest[0] == uint8_t(crc >> 24) && big.digest[3] == uint8_t(crc);
+			}
+		}
+		failures += check(ok, "fingerprint_tree results");
+	}
+
+	// A throwing sink stops the walk; its exception reaches the caller once
+	// the workers have been joined
+	int calls = 0;
+	bool thrown = false;
+	try
+	{
+		fingerprint_tree("fingerprint_smoke", options, refuse, &calls);
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	failures += check(thrown && calls == 1, "fingerprint_tree rethrows the sink's exception");
+
+	remove("fingerprint_smoke/big.bin");
+	remove("fingerprint_smoke/empty.bin");
+	remove("fingerprint_smoke/sub/small.bin");
+	remove_dir("fingerprint_smoke/sub");
+	remove_dir("fingerprint_smoke");
+
+	return failures;
+}
@@ -0,0 +1,28 @@
+int sketchSmokeTest();
+int chunkerSmokeTest();
+int minhashSmokeTest();
+int consistentHashSmokeTest();
+int tableHashSmokeTest();
+int legacyHashSmokeTest();
+int stableHashSmokeTest();
+int crcSmokeTest();
+int siphashSmokeTest();
+int fingerprintSmokeTest();
+int blockStoreSmokeTest();
+
+int main()
+{
+	int failures = 0;
+	failures += sketchSmokeTest();
+	failures += chunkerSmokeTest();
+	failures += minhashSmokeTest();
+	failures += consistentHashSmokeTest();
+	failures += tableHashSmokeTest();
+	failures += legacyHashSmokeTest();
+	failures += stableHashSmokeTest();
+	failures += crcSmokeTest();
+	failures += siphashSmokeTest();
+	failures += fingerprintSmokeTest();
+	failures += blockStoreSmokeTest();
+	return failures;
+}
@@ -0,0 +1,41 @@
+#include "../common/smoke.h"
+#include "hashTools/hashTools.h"
+#include "legacyHashes.h"
+
+#include <vector>
+
+using namespace codetools::hashtools;
+
+using smoke::check;
+
+// The word-at-a-time paths must match the byte-wise originals for every
+// length and alignment, including bytes >= 0x80
+int legacyHashSmokeTest()
+{
+	int failures = 0;
+
+	std::vector<uint8_t> data(1100);
+	uint64_t seed = 42;
+	for (uint8_t& b : data)
+		b = (uint8_t)splitmix64(seed);
+
+	bool oaat = true, lookup2 = true, hseih = true;
+	for (uint32_t offset = 0; offset < 8; ++offset)
+	{
+		const uint8_t* key = &data[offset];
+		for (uint32_t len = 0; len <= 80; ++len)
+		{
+			oaat = oaat && jenkins_oaat_32(key, len) == legacy::jenkins_oaat_32(key, len);
+			lookup2 = lookup2 && jenkins_lookup2_32(key, len, offset) == legacy::jenkins_lookup2_32(key, len, offset);
+			hseih = hseih && hseih_32(key, len, len) == legacy::hseih_32(key, len, len);
+		}
+		oaat = oaat && jenkins_oaat_32(key, 1024, 0xFFFF) == legacy::jenkins_oaat_32(key, 1024, 0xFFFF);
+		lookup2 = lookup2 && jenkins_lookup2_32(key, 1024) == legacy::jenkins_lookup2_32(key, 1024);
+		hseih = hseih && hseih_32(key, 1024, 0) == legacy::hseih_32(key, 1024, 0);
+	}
+	failures += check(oaat, "jenkins_oaat_32 matches byte-wise version");
+	failures += check(lookup2, "jenkins_lookup2_32 matches byte-wise version");
+	failures += check(hseih, "hseih_32 matches byte-wise version");
+
+	return failures;
+}
@@ -0,0 +1,120 @@
+// Byte-at-a-time copies of jenkins_oaat_32, the byte-key jenkins_lookup2_32
+// and hseih_32 as they were before the word-at-a-time fast paths.  The
+// library versions must keep producing exactly these values.
+#ifndef CODETOOLS_HTSMOKE_LEGACY_HASHES_H
+#define CODETOOLS_HTSMOKE_LEGACY_HASHES_H
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace legacy
+{
+	inline uint32_t jenkins_oaat_32(const uint8_t* key, uint32_t len, uint32_t mask = 0xFFFFFFFF)
+	{
+		uint32_t hash, i;
+		for (hash = 0, i = 0; i < len; ++i)
+		{
+			hash += key[i];
+			hash += (hash << 10);
+			hash ^= (hash >> 6);
+		}
+		hash += (hash << 3);
+		hash ^= (hash >> 11);
+		hash += (hash << 15);
+		return (hash & mask);
+	}
+
+#define LEGACY_LOOKUP2_MIX(a,b,c) \
+	{ \
+		a -= b; a -= c; a ^= (c>>13); \
+		b -= c; b -= a; b ^= (a<<8); \
+		c -= a; c -= b; c ^= (b>>13); \
+		a -= b; a -= c; a ^= (c>>12);  \
+		b -= c; b -= a; b ^= (a<<16); \
+		c -= a; c -= b; c ^= (b>>5); \
+		a -= b; a -= c; a ^= (c>>3);  \
+		b -= c; b -= a; b ^= (a<<10); \
+		c -= a; c -= b; c ^= (b>>15); \
+	}
+
+	inline uint32_t jenkins_lookup2_32(const uint8_t* k, uint32_t length, uint32_t initval = 0)
+	{
+		uint32_t a, b, c, len;
+		len = length;
+		a = b = 0x9e3779b9;
+		c = initval;
+		while (len >= 12)
+		{
+			a += (k[0] + ((uint32_t)k[1] << 8) + ((uint32_t)k[2] << 16) + ((uint32_t)k[3] << 24));
+			b += (k[4] + ((uint32_t)k[5] << 8) + ((uint32_t)k[6] << 16) + ((uint32_t)k[7] << 24));
+			c += (k[8] + ((uint32_t)k[9] << 8) + ((uint32_t)k[10] << 16) + ((uint32_t)k[11] << 24));
+			LEGACY_LOOKUP2_MIX(a, b, c);
+			k += 12; len -= 12;
+		}
+		c += length;
+		switch (len)
+		{
+		case 11: c += ((uint32_t)k[10] << 24);
+		case 10: c += ((uint32_t)k[9] << 16);
+		case 9: c += ((uint32_t)k[8] << 8);
+		case 8: b += ((uint32_t)k[7] << 24);
+		case 7: b += ((uint32_t)k[6] << 16);
+		case 6: b += ((uint32_t)k[5] << 8);
+		case 5: b += k[4];
+		case 4: a += ((uint32_t)k[3] << 24);
+		case 3: a += ((uint32_t)k[2] << 16);
+		case 2: a += ((uint32_t)k[1] << 8);
+		case 1: a += k[0];
+		}
+		LEGACY_LOOKUP2_MIX(a, b, c);
+		return c;
+	}
+#undef LEGACY_LOOKUP2_MIX
+
+	inline uint32_t hseih_32(const void* message, size_t size, uint32_t initialVal)
+	{
+#define LEGACY_GET16(d) ((((uint32_t)(((const uint8_t *)(d))[1])) << 8) + (uint32_t)(((const uint8_t *)(d))[0]))
+		uint32_t hash = initialVal;
+		uint32_t tmp;
+		uint32_t rem;
+		const char* data = (const char*)message;
+		if (data == NULL)
+			return 0;
+		rem = size & 3;
+		size >>= 2;
+		for (; size; --size)
+		{
+			hash += LEGACY_GET16(data);
+			tmp = (LEGACY_GET16(data + 2) << 11) ^ hash;
+			hash = (hash << 16) ^ tmp;
+			data += 2 * sizeof(uint16_t);
+			hash += hash >> 11;
+		}
+		switch (rem)
+		{
+		case 3: hash += LEGACY_GET16(data);
+			hash ^= hash << 16;
+			hash ^= ((signed char)data[sizeof(uint16_t)]) << 18;
+			hash += hash >> 11;
+			break;
+		case 2: hash += LEGACY_GET16(data);
+			hash ^= hash << 11;
+			hash += hash >> 17;
+			break;
+		case 1: hash += (signed char)*data;
+			hash ^= hash << 10;
+			hash += hash >> 1;
+		}
+		hash ^= hash << 3;
+		hash += hash >> 5;
+		hash ^= hash << 4;
+		hash += hash >> 17;
+		hash ^= hash << 25;
+		hash += hash >> 6;
+		return hash;
+#undef LEGACY_GET16
+	}
+}
+
+#endif // CODETOOLS_HTSMOKE_LEGACY_HASHES_H
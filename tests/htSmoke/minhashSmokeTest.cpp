@@ -0,0 +1,136 @@
+#include "../common/smoke.h"
+#include "hashTools/minhash.h"
+
+#include <cstdio>
+#include <set>
+#include <vector>
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	using smoke::check;
+
+	std::vector<uint8_t> random_text(size_t n, uint64_t seed)
+	{
+		std::vector<uint8_t> bytes(n);
+		for (size_t i = 0; i < n; ++i)
+			bytes[i] = (uint8_t)('a' + splitmix64(seed) % 26);
+		return bytes;
+	}
+
+	std::vector<uint32_t> shingles(const std::vector<uint8_t>& text)
+	{
+		std::vector<uint32_t> out(text.size());
+		out.resize(shingle_hashes_32(text.data(), text.size(), 5, out.data()));
+		return out;
+	}
+
+	double jaccard(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+	{
+		std::set<uint32_t> sa(a.begin(), a.end()), sb(b.begin(), b.end());
+		size_t common = 0;
+		for (uint32_t x : sa)
+			common += sb.count(x);
+		return double(common) / double(sa.size() + sb.size() - common);
+	}
+}
+
+int minhashSmokeTest()
+{
+	int failures = 0;
+
+	// The SIMD kernels must match the scalar definition for every k
+	{
+		uint32_t seeds[133], sig[133];
+		minhash_seeds(7, 133, seeds);
+		const std::vector<uint32_t> set = shingles(random_text(300, 1));
+		bool same = true;
+		for (uint32_t k : { 1u, 4u, 8u, 15u, 16u, 17u, 64u, 133u })
+		{
+			minhash_32(set.data(), set.size(), seeds, k, sig);
+			for (uint32_t i = 0; i < k; ++i)
+			{
+				uint32_t m = 0xFFFFFFFF;
+				for (uint32_t x : set)
+					m = std::min(m, jenkins_lookup3_32(&x, 4, seeds[i]));
+				same = same && sig[i] == m;
+			}
+		}
+		failures += check(same, "minhash_32 matches jenkins_lookup3_32 definition");
+		minhash_32(nullptr, 0, seeds, 20, sig);
+		failures += check(sig[0] == 0xFFFFFFFF && sig[19] == 0xFFFFFFFF, "minhash_32 of empty set");
+	}
+
+	// Estimated similarity tracks Jaccard similarity
+	{
+		const uint32_t k = 256;
+		std::vector<uint32_t> seeds(k), sa(k), sb(k);
+		minhash_seeds(11, k, seeds.data());
+		std::vector<uint8_t> a = random_text(4000, 2), b = a;
+		for (size_t i = 1000; i < 1800; ++i)
+			b[i] = 'A';
+		const std::vector<uint32_t> ha = shingles(a), hb = shingles(b);
+		minhash_32(ha.data(), ha.size(), seeds.data(), k, sa.data());
+		minhash_32(hb.data(), hb.size(), seeds.data(), k, sb.data());
+		const double estimate = minhash_similarity(sa.data(), sb.data(), k);
+		const double truth = jaccard(ha, hb);
+		failures += check(estimate > truth - 0.1 && estimate < truth + 0.1, "minhash estimate near Jaccard");
+	}
+
+	// LSH finds planted near duplicates among unrelated documents
+	{
+		const uint32_t bands = 16, rows = 4, k = bands * rows;
+		std::vector<uint32_t> seeds(k), sig(k);
+		minhash_seeds(3, k, seeds.data());
+		lsh_index index(bands, rows);
+		for (uint32_t doc = 0; doc < 200; ++doc)
+		{
+			// documents 2i and 2i+1 differ in a few bytes for i < 20
+			std::vector<uint8_t> text = random_text(1500, doc < 40 ? doc / 2 + 1000 : doc);
+			if (doc < 40 && (doc & 1))
+				for (size_t i = 0; i < 1500; i += 300)
+					text[i] = '#';
+			const std::vector<uint32_t> set = shingles(text);
+			minhash_32(set.data(), set.size(), seeds.data(), k, sig.data());
+			index.add(sig.data());
+		}
+		index.build(4);
+		const std::vector<lsh_index::doc_pair> pairs = index.candidate_pairs();
+		size_t planted = 0;
+		for (const lsh_index::doc_pair& p : pairs)
+			planted += p.first < 40 && p.second == p.first + 1 && !(p.first & 1);
+		failures += check(planted == 20, "lsh_index finds planted pairs");
+		failures += check(pairs.size() < 40, "lsh_index has few false candidates");
+
+		const std::vector<lsh_index::doc_id> hits = index.query(index.signature(6));
+		failures += check(hits.size() >= 2 && hits[0] == 6 && hits[1] == 7, "lsh_index query");
+
+		const char* path = "minhashSmokeTest.lsh";
+		lsh_index loaded(1, 1);
+		const bool roundTrip = index.save(path) && loaded.load(path);
+		failures += check(roundTrip && loaded.size() == 200 && loaded.bands() == bands &&
+		                  loaded.candidate_pairs() == pairs, "lsh_index save/load");
+		remove(path);
+	}
+
+	// SimHash of near-identical feature sets is close in Hamming distance
+	{
+		std::vector<uint64_t> fa, fb;
+		uint64_t seed = 5;
+		for (int i = 0; i < 500; ++i)
+			fa.push_back(splitmix64(seed));
+		fb = fa;
+		for (int i = 0; i < 10; ++i)
+			fb[i * 50] = splitmix64(seed);
+		std::vector<uint64_t> fc;
+		for (int i = 0; i < 500; ++i)
+			fc.push_back(splitmix64(seed));
+		const uint64_t a = simhash_64(fa.data(), nullptr, fa.size());
+		const uint64_t b = simhash_64(fb.data(), nullptr, fb.size());
+		const uint64_t c = simhash_64(fc.data(), nullptr, fc.size());
+		failures += check(simhash_distance(a, b) < 12 && simhash_distance(a, c) > 16, "simhash distance");
+	}
+
+	return failures;
+}
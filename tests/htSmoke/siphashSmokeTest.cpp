@@ -0,0 +1,99 @@
+#include "../common/smoke.h"
+#include "hashTools/hashTools.h"
+#include "hashTools/keyed_hash.h"
+#include "hashTools/space_saving.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	using smoke::check;
+
+	uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+	// Straight transcription of the reference siphash.c, byte-wise tail
+	uint64_t siphash_reference(const uint8_t* p, size_t length, const sip_key& key, int c, int d)
+	{
+		uint64_t v0 = key.k0 ^ 0x736f6d6570736575ull, v1 = key.k1 ^ 0x646f72616e646f6dull;
+		uint64_t v2 = key.k0 ^ 0x6c7967656e657261ull, v3 = key.k1 ^ 0x7465646279746573ull;
+		auto round = [&]() {
+			v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+			v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+			v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+			v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+		};
+		size_t i = 0;
+		for (; i + 8 <= length; i += 8)
+		{
+			uint64_t m = 0;
+			for (int b = 7; b >= 0; --b)
+				m = (m << 8) | p[i + b];
+			v3 ^= m;
+			for (int r = 0; r < c; ++r)
+				round();
+			v0 ^= m;
+		}
+		uint64_t last = uint64_t(length) << 56;
+		for (size_t b = 0; i + b < length; ++b)
+			last |= uint64_t(p[i + b]) << (8 * b);
+		v3 ^= last;
+		for (int r = 0; r < c; ++r)
+			round();
+		v0 ^= last;
+		v2 ^= 0xFF;
+		for (int r = 0; r < d; ++r)
+			round();
+		return v0 ^ v1 ^ v2 ^ v3;
+	}
+}
+
+int siphashSmokeTest()
+{
+	int failures = 0;
+
+	// Test vectors from the SipHash paper and reference code: key 00..0f,
+	// message 00..len-1
+	const sip_key key = { 0x0706050403020100ull, 0x0f0e0d0c0b0a0908ull };
+	uint8_t message[64];
+	for (int i = 0; i < 64; ++i)
+		message[i] = uint8_t(i);
+	failures += check(siphash_2_4(message, 0, key) == 0x726fdb47dd0e0e31ull, "siphash_2_4 empty message vector");
+	failures += check(siphash_2_4(message, 15, key) == 0xa129ca6149be45e5ull, "siphash_2_4 15-byte vector");
+	failures += check(halfsiphash_2_4(message, 0, key) == 0x5b9f35a9, "halfsiphash_2_4 empty message vector");
+
+	bool matches = true;
+	for (size_t len = 0; len <= 64; ++len)
+		matches = matches && siphash_2_4(message, len, key) == siphash_reference(message, len, key, 2, 4) &&
+		          siphash_1_3(message, len, key) == siphash_reference(message, len, key, 1, 3);
+	failures += check(matches, "siphash matches the reference for lengths 0-64");
+
+	const uint64_t value = 0x8877665544332211ull;
+	const uint8_t valueBytes[8] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 };
+	failures += check(siphash_2_4_u64(value, key) == siphash_2_4(valueBytes, 8, key) &&
+	                  siphash_1_3_u64(value, key) == siphash_1_3(valueBytes, 8, key), "integer path matches bytes");
+
+	// Different keys, different hashes; the process key is stable
+	const sip_key other = { key.k0 + 1, key.k1 };
+	failures += check(siphash_1_3(message, 16, key) != siphash_1_3(message, 16, other), "key changes the hash");
+	failures += check(&process_sip_key() == &process_sip_key() && keyed_hash<int>().key().k0 == process_sip_key().k0, "process key");
+
+	// As a container hasher
+	keyed_hash<std::string> strings(key);
+	failures += check(strings("abc") == size_t(siphash_1_3("abc", 3, key)), "keyed_hash of a string");
+	failures += check(keyed_hash<double>()(0.0) == keyed_hash<double>()(-0.0), "keyed_hash of signed zero");
+	std::unordered_set<std::string, keyed_hash<std::string, sip_variant::sip_2_4>> set(16, keyed_hash<std::string, sip_variant::sip_2_4>(key));
+	for (int i = 0; i < 1000; ++i)
+		set.insert(std::to_string(i));
+	failures += check(set.size() == 1000 && set.count("999") == 1, "unordered_set with keyed_hash");
+
+	space_saving<uint64_t, keyed_hash<uint64_t>> tracker(4, keyed_hash<uint64_t>(key));
+	for (uint64_t i = 0; i < 1000; ++i)
+		tracker.add(i % 3 == 0 ? 7 : i);
+	failures += check(tracker.top(1)[0].key == 7, "space_saving with keyed_hash");
+
+	return failures;
+}
@@ -0,0 +1,84 @@
+#include "../common/smoke.h"
+#include "hashTools/count_min_sketch.h"
+#include "hashTools/space_saving.h"
+
+#include <vector>
+
+using codetools::hashtools::count_min_sketch;
+using codetools::hashtools::space_saving;
+
+namespace
+{
+	using smoke::check;
+
+	// Zipf stream: key k appears k_top / (k + 1) times
+	const uint32_t k_keys = 1000;
+	const uint32_t k_top = 100000;
+	uint32_t frequency(uint32_t k) { return k_top / (k + 1); }
+
+	std::vector<uint32_t> make_stream()
+	{
+		std::vector<uint32_t> stream;
+		for (uint32_t k = 0; k < k_keys; ++k)
+			stream.insert(stream.end(), frequency(k), k);
+		uint32_t x = 12345;
+		for (size_t i = stream.size() - 1; i > 0; --i)
+		{
+			x = x * 1664525 + 1013904223;
+			std::swap(stream[i], stream[x % (i + 1)]);
+		}
+		return stream;
+	}
+}
+
+int sketchSmokeTest()
+{
+	int failures = 0;
+	const std::vector<uint32_t> stream = make_stream();
+
+	count_min_sketch<> single(10, 4, 7);
+	for (uint32_t k : stream)
+		single.add(&k, sizeof(k));
+
+	// Never under-estimates, and the hottest keys are close to exact
+	bool bounded = true;
+	for (uint32_t k = 0; k < k_keys; ++k)
+		bounded = bounded && single.estimate(&k, sizeof(k)) >= frequency(k);
+	failures += check(bounded, "count_min_sketch never under-estimates");
+	uint32_t hot = 0;
+	failures += check(single.estimate(&hot, sizeof(hot)) < k_top + k_top / 10, "count_min_sketch hot key estimate");
+	failures += check(single.total() == stream.size(), "count_min_sketch total");
+
+	// Per-thread style: two halves batched into separate sketches, then merged
+	count_min_sketch<> a(10, 4, 7), b(10, 4, 7), other(10, 4, 8);
+	std::vector<uint64_t> hashes;
+	for (uint32_t k : stream)
+		hashes.push_back(a.hash(&k, sizeof(k)));
+	const size_t half = hashes.size() / 2;
+	a.add_hashes(hashes.data(), half);
+	b.add_hashes(hashes.data() + half, hashes.size() - half);
+	failures += check(a.merge(b), "count_min_sketch merge");
+	failures += check(!a.merge(other), "count_min_sketch rejects mismatched seed");
+	bounded = true;
+	for (uint32_t k = 0; k < k_keys; ++k)
+		bounded = bounded && a.estimate(&k, sizeof(k)) >= frequency(k);
+	failures += check(bounded, "merged count_min_sketch never under-estimates");
+
+	space_saving<uint32_t> tracker(50);
+	for (uint32_t k : stream)
+		tracker.add(k);
+	std::vector<space_saving<uint32_t>::entry> top = tracker.top(5);
+	bool topFound = top.size() == 5;
+	for (size_t i = 0; topFound && i < top.size(); ++i)
+		topFound = top[i].key == i && top[i].count >= frequency(top[i].key) && top[i].count - top[i].error <= frequency(top[i].key);
+	failures += check(topFound, "space_saving top-5");
+
+	space_saving<uint32_t> left(50), right(50);
+	left.add_batch(stream.begin(), stream.begin() + half);
+	right.add_batch(stream.begin() + half, stream.end());
+	left.merge(right);
+	top = left.top(3);
+	failures += check(top.size() == 3 && top[0].key == 0 && left.total() == stream.size(), "space_saving merge");
+
+	return failures;
+}
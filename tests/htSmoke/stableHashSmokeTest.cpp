@@ -0,0 +1,95 @@
+#include "../common/smoke.h"
+#include "hashTools/hashTools.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	using smoke::check;
+
+	// Reverses the bytes of each w-byte word, so reading the result in one
+	// byte order sees the words of the original in the other
+	std::vector<uint8_t> swap_words(const uint8_t* data, size_t len, size_t w)
+	{
+		std::vector<uint8_t> out(data, data + len);
+		for (size_t i = 0; i + w <= len; i += w)
+			for (size_t j = 0; j < w; ++j)
+				out[i + j] = data[i + w - 1 - j];
+		return out;
+	}
+
+	bool host_is_little() noexcept
+	{
+		const uint32_t one = 1;
+		uint8_t first;
+		memcpy(&first, &one, 1);
+		return first == 1;
+	}
+}
+
+// Known answers pin the persisted values: the little values are Bob Jenkins'
+// published ones (lookup3.c driver5, SpookyV2 TestResults); the big values
+// were recorded when the mode was added and must never change.
+int stableHashSmokeTest()
+{
+	int failures = 0;
+
+	const char* quote = "Four score and seven years ago";
+	failures += check(jenkins_lookup3_32("", 0, 0) == 0xdeadbeef, "lookup3 of empty key");
+	failures += check(jenkins_lookup3_32(quote, 30, 0) == 0x17770551, "lookup3 known answer, init 0");
+	failures += check(jenkins_lookup3_32(quote, 30, 1) == 0xcd628161, "lookup3 known answer, init 1");
+	failures += check(jenkins_lookup3_64("", 0, 0xdeadbeefull << 32) == 0xdeadbeefbd5b7ddeull, "lookup3_64 of empty key");
+	failures += check(jenkins_lookup3_64(quote, 30, 0) == 0xce7226e617770551ull, "lookup3_64 known answer");
+	failures += check(jenkins_lookup3_64(quote, 30, 1ull << 32) == 0xbd371de4e3607caeull, "lookup3_64 known answer, high seed");
+	failures += check(jenkins_lookup3_32(quote, 30, 0, byte_order::little) == 0x17770551, "lookup3 little matches default");
+	failures += check(jenkins_lookup3_32(quote, 30, 0, byte_order::big) == 0x65e759cb, "lookup3 big known answer, init 0");
+	failures += check(jenkins_lookup3_32(quote, 30, 1, byte_order::big) == 0x68acf242, "lookup3 big known answer, init 1");
+	failures += check(jenkins_lookup3_64(quote, 30, 0, byte_order::big) == 0xa420682e65e759cbull, "lookup3_64 big known answer");
+
+	uint8_t buf[512];
+	for (int i = 0; i < 512; ++i)
+		buf[i] = uint8_t(i + 128);
+	const uint32_t spooky32[12] = {
+		0x6bf50919, 0x70de1d26, 0xa2b37298, 0x35bc5fbf, 0x8223b279, 0x5bcb315e,
+		0x53fe88a1, 0xf9f1a233, 0xee193982, 0x54f86f29, 0xc8772d36, 0x9ed60886,
+	};
+	bool spooky = true;
+	for (size_t len = 0; len < 12; ++len)
+		spooky = spooky && spooky_32(buf, len, 0) == spooky32[len] && spooky_32(buf, len, 0, byte_order::little) == spooky32[len];
+	failures += check(spooky, "spooky_32 known answers");
+	failures += check(spooky_64(buf, 100, 0) == 0xd9368b96de4a961full, "spooky_64 known answer, short path");
+	failures += check(spooky_64(buf, 500, 0) == 0x14b28c74d1169f87ull, "spooky_64 known answer, long path");
+	failures += check(spooky_32(buf, 7, 0, byte_order::big) == 0xc61dd137, "spooky_32 big known answer");
+	failures += check(spooky_64(buf, 100, 0, byte_order::big) == 0x034ef36cc8786fcaull, "spooky_64 big known answer, short path");
+	failures += check(spooky_64(buf, 500, 0, byte_order::big) == 0xff265836f377cc2cull, "spooky_64 big known answer, long path");
+
+	// Byte-reversing every word turns one order into the other wherever the
+	// hash only reads whole words: lookup3 at multiples of 4, spooky's short
+	// path at multiples of 8.  The offsets cover unaligned keys.
+	bool lookup3Swap = true, spookySwap = true;
+	for (size_t offset = 0; offset < 8; ++offset)
+	{
+		for (size_t len = 0; len <= 96; len += 4)
+		{
+			const std::vector<uint8_t> swapped = swap_words(buf + offset, len, 4);
+			lookup3Swap = lookup3Swap && jenkins_lookup3_64(swapped.data(), len, 5, byte_order::big) == jenkins_lookup3_64(buf + offset, len, 5, byte_order::little);
+		}
+		for (size_t len = 0; len < 192; len += 8)
+		{
+			const std::vector<uint8_t> swapped = swap_words(buf + offset, len, 8);
+			uint64_t bigHigh = 3, littleHigh = 3;
+			spookySwap = spookySwap && spooky_128(swapped.data(), len, 9, &bigHigh, byte_order::big) == spooky_128(buf + offset, len, 9, &littleHigh, byte_order::little) && bigHigh == littleHigh;
+		}
+	}
+	failures += check(lookup3Swap, "lookup3 big reads word-swapped keys as little does");
+	failures += check(spookySwap, "spooky big reads word-swapped keys as little does");
+
+	const byte_order host = host_is_little() ? byte_order::little : byte_order::big;
+	failures += check(jenkins_lookup3_64(buf + 1, 77, 11, byte_order::native) == jenkins_lookup3_64(buf + 1, 77, 11, host), "lookup3 native is the host order");
+	failures += check(spooky_64(buf + 3, 300, 11, byte_order::native) == spooky_64(buf + 3, 300, 11, host), "spooky native is the host order");
+
+	return failures;
+}
@@ -0,0 +1,95 @@
+#include "../common/smoke.h"
+#include "hashTools/hashTools.h"
+#include "hashTools/tabulation_hash.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	using smoke::check;
+
+	// Sequential keys spread evenly over 256 buckets taken from both the low
+	// and the high byte of the hash
+	template <class Hash>
+	bool spreads(const Hash& hash)
+	{
+		typedef typename Hash::result_type result_type;
+		const unsigned k_keys = 256 * 64;
+		unsigned low[256] = {}, high[256] = {};
+		for (unsigned k = 0; k < k_keys; ++k)
+		{
+			const result_type h = hash(result_type(k) * 0x10001);
+			++low[h & 0xFF];
+			++high[h >> (sizeof(result_type) * 8 - 8)];
+		}
+		double chiLow = 0, chiHigh = 0;
+		for (unsigned b = 0; b < 256; ++b)
+		{
+			chiLow += (low[b] - 64.0) * (low[b] - 64.0) / 64.0;
+			chiHigh += (high[b] - 64.0) * (high[b] - 64.0) / 64.0;
+		}
+		// 255 degrees of freedom; 350 is beyond the 99.99th percentile
+		return chiLow < 350 && chiHigh < 350;
+	}
+}
+
+int tableHashSmokeTest()
+{
+	int failures = 0;
+
+	// The branch-free kernels agree with the reference loops, including
+	// bytes >= 0x80 and keys longer than maxlen
+	{
+		const uint32_t maxlen = 64;
+		std::vector<uint32_t> universal(maxlen * 8), zobrist(maxlen * 256);
+		universal_table_32(universal.data(), maxlen, 1);
+		zobrist_table_32(zobrist.data(), maxlen, 2);
+
+		uint64_t seed = 3;
+		std::vector<char> key(80);
+		for (char& c : key)
+			c = (char)splitmix64(seed);
+
+		bool universalSame = true, zobristSame = true;
+		for (uint32_t len = 0; len <= 80; ++len)
+		{
+			universalSame = universalSame && universal_hash_32(key.data(), len, maxlen, universal.data()) ==
+			                                 universal_hash_32_fast(key.data(), len, maxlen, universal.data());
+			zobristSame = zobristSame && zobrist_hash_32(key.data(), len, maxlen, zobrist.data()) ==
+			                             zobrist_hash_32_fast(key.data(), len, maxlen, zobrist.data());
+		}
+		failures += check(universalSame, "universal_hash_32_fast matches universal_hash_32");
+		failures += check(zobristSame, "zobrist_hash_32_fast matches zobrist_hash_32");
+	}
+
+	// Generated tables depend on the seed only
+	{
+		uint32_t a[8 * 4], b[8 * 4], c[8 * 4];
+		universal_table_32(a, 4, 9);
+		universal_table_32(b, 4, 9);
+		universal_table_32(c, 4, 10);
+		failures += check(std::equal(a, a + 32, b) && !std::equal(a, a + 32, c), "universal_table_32 seeding");
+	}
+
+	// Tabulation hashes match their definitions and spread sequential keys
+	{
+		const tabulation_hash<uint64_t> simple(4);
+		const tabulation_hash<uint64_t> simpleCopy(4);
+		const twisted_tabulation_hash<uint32_t> twisted(5);
+		uint64_t keys[3] = { 0, 0x0123456789ABCDEFull, ~0ull };
+		uint64_t hashes[3];
+		simple.hash(keys, 3, hashes);
+		failures += check(hashes[1] == simpleCopy(keys[1]) && hashes[0] != hashes[2], "tabulation_hash batch and seeding");
+		failures += check((simple(0x0100) ^ simple(0)) == (simple(0x0101) ^ simple(1)), "tabulation_hash is XOR of byte lookups");
+		failures += check((twisted(0x01000000) ^ twisted(0)) != (twisted(0x01000001) ^ twisted(1)), "twisted_tabulation_hash twists the last byte");
+		failures += check(spreads(tabulation_hash<uint32_t>(6)), "tabulation_hash<uint32_t> spread");
+		failures += check(spreads(simple), "tabulation_hash<uint64_t> spread");
+		failures += check(spreads(twisted), "twisted_tabulation_hash<uint32_t> spread");
+		failures += check(spreads(twisted_tabulation_hash<uint64_t>(7)), "twisted_tabulation_hash<uint64_t> spread");
+	}
+
+	return failures;
+}
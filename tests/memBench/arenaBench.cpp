@@ -0,0 +1,46 @@
+#include "bench.h"
+#include "libnew.h"
+
+#include <cstdio>
+
+// A request handler's temporaries: a few hundred small objects, all
+// dropped at the end of the request
+void arenaBench()
+{
+	const size_t k_objects = 300, k_requests = 5000;
+
+	printf("request of %u temporaries, M allocations/s over all threads\n", unsigned(k_objects));
+	printf("%8s %12s %12s\n", "threads", "cdtAlloc", "arena");
+	for (unsigned threads : { 1u, 2u, 4u, 8u })
+	{
+		const double heap = membench::run_threads(threads, [=](unsigned t) {
+			void* objects[k_objects];
+			uint64_t sum = 0;
+			for (size_t r = 0; r < k_requests; ++r)
+			{
+				for (size_t i = 0; i < k_objects; ++i)
+					objects[i] = codetools::Alloc(16 + ((i * 7 + t) % 16) * 16);
+				for (size_t i = 0; i < k_objects; ++i)
+				{
+					sum += (uintptr_t)objects[i];
+					codetools::Dealloc(objects[i]);
+				}
+			}
+			membench::g_sink += sum;
+		});
+		const double arena = membench::run_threads(threads, [=](unsigned t) {
+			codetools::Arena region;
+			uint64_t sum = 0;
+			for (size_t r = 0; r < k_requests; ++r)
+			{
+				for (size_t i = 0; i < k_objects; ++i)
+					sum += (uintptr_t)region.allocate(16 + ((i * 7 + t) % 16) * 16);
+				region.reset();
+			}
+			membench::g_sink += sum;
+		});
+		const double count = double(threads) * k_requests * k_objects / 1e6;
+		printf("%8u %12.1f %12.1f\n", threads, count / heap, count / arena);
+	}
+	printf("\n");
+}
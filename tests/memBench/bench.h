@@ -0,0 +1,39 @@
+#ifndef CODETOOLS_MEMBENCH_BENCH_H
+#define CODETOOLS_MEMBENCH_BENCH_H
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace membench
+{
+	// Accumulates results so the optimizer cannot drop the timed work
+	extern volatile uint64_t g_sink;
+
+	// Runs fn(thread) on each of threads threads, released together, and
+	// returns the wall time in seconds
+	template <class Fn>
+	double run_threads(unsigned threads, Fn fn)
+	{
+		typedef std::chrono::steady_clock clock;
+		std::vector<std::thread> pool;
+		std::atomic<bool> go(false);
+		for (unsigned t = 0; t < threads; ++t)
+			pool.emplace_back([&, t]() {
+				while (!go.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				fn(t);
+			});
+		const clock::time_point start = clock::now();
+		go.store(true, std::memory_order_release);
+		for (std::thread& thread : pool)
+			thread.join();
+		return std::chrono::duration<double>(clock::now() - start).count();
+	}
+}
+
+#endif // CODETOOLS_MEMBENCH_BENCH_H
@@ -0,0 +1,51 @@
+#include "bench.h"
+#include "libnew.h"
+
+#include <cstdio>
+
+namespace
+{
+	double pairs_per_second(unsigned threads)
+	{
+		const size_t k_batch = 64, k_rounds = 40000;
+		const double seconds = membench::run_threads(threads, [=](unsigned t) {
+			void* blocks[k_batch];
+			uint64_t sum = 0;
+			for (size_t r = 0; r < k_rounds; ++r)
+			{
+				for (size_t i = 0; i < k_batch; ++i)
+					blocks[i] = codetools::Alloc(16 + ((i * 7 + t) % 16) * 16);
+				for (size_t i = 0; i < k_batch; ++i)
+				{
+					sum += (uintptr_t)blocks[i];
+					codetools::Dealloc(blocks[i]);
+				}
+			}
+			membench::g_sink += sum;
+		});
+		return threads * k_rounds * k_batch / seconds / 1e6;
+	}
+}
+
+// Cost of heap sampling at the default period on the cdtAlloc path
+void heapSamplerBench()
+{
+	printf("cdtAlloc/cdtDealloc pairs, M/s over all threads\n");
+	printf("%8s %12s %12s %10s\n", "threads", "plain", "sampling", "overhead");
+	for (unsigned threads : { 1u, 4u })
+	{
+		// Best of three to steady the comparison
+		double plain = 0, sampled = 0;
+		for (int run = 0; run < 3; ++run)
+		{
+			const double a = pairs_per_second(threads);
+			codetools::BeginHeapSampling(0);
+			const double b = pairs_per_second(threads);
+			codetools::EndHeapSampling();
+			plain = a > plain ? a : plain;
+			sampled = b > sampled ? b : sampled;
+		}
+		printf("%8u %12.1f %12.1f %9.1f%%\n", threads, plain, sampled, (plain / sampled - 1) * 100);
+	}
+	printf("\n");
+}
@@ -0,0 +1,45 @@
+#include "bench.h"
+
+#include <cstring>
+
+volatile uint64_t membench::g_sink;
+
+void threadAllocBench();
+void sizeClassBench();
+void arenaBench();
+void objectPoolBench();
+void heapSamplerBench();
+void tlbBench();
+
+namespace
+{
+	struct benchmark
+	{
+		const char* name;
+		void (*run)();
+	};
+
+	const benchmark k_benchmarks[] =
+	{
+		{ "threads", threadAllocBench },
+		{ "sizeclass", sizeClassBench },
+		{ "arena", arenaBench },
+		{ "pool", objectPoolBench },
+		{ "sampling", heapSamplerBench },
+		{ "tlb", tlbBench },
+	};
+}
+
+// Runs every benchmark, or only those named on the command line
+int main(int argc, char** argv)
+{
+	for (const benchmark& b : k_benchmarks)
+	{
+		bool selected = argc < 2;
+		for (int i = 1; i < argc; ++i)
+			selected = selected || strcmp(argv[i], b.name) == 0;
+		if (selected)
+			b.run();
+	}
+	return 0;
+}
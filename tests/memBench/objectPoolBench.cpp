@@ -0,0 +1,61 @@
+#include "bench.h"
+#include "libnew.h"
+#include "object_pool.h"
+
+#include <cstdio>
+
+namespace
+{
+	struct message
+	{
+		uint64_t id;
+		uint64_t fields[5];
+	};
+}
+
+// One struct size allocated and freed at a high rate: new/delete (through
+// cdtAlloc) against a shared object_pool
+void objectPoolBench()
+{
+	const size_t k_batch = 64, k_rounds = 20000;
+
+	printf("%u-byte objects, M create/destroy pairs/s over all threads\n", unsigned(sizeof(message)));
+	printf("%8s %12s %12s\n", "threads", "new/delete", "object_pool");
+	for (unsigned threads : { 1u, 2u, 4u, 8u })
+	{
+		const double heap = membench::run_threads(threads, [=](unsigned t) {
+			message* batch[k_batch];
+			uint64_t sum = 0;
+			for (size_t r = 0; r < k_rounds; ++r)
+			{
+				for (size_t i = 0; i < k_batch; ++i)
+					batch[i] = new message{ i + t, {} };
+				for (size_t i = 0; i < k_batch; ++i)
+				{
+					sum += batch[i]->id;
+					delete batch[i];
+				}
+			}
+			membench::g_sink += sum;
+		});
+		codetools::object_pool<message> pool;
+		const double pooled = membench::run_threads(threads, [&pool](unsigned t) {
+			message* batch[k_batch];
+			uint64_t sum = 0;
+			for (size_t r = 0; r < k_rounds; ++r)
+			{
+				for (size_t i = 0; i < k_batch; ++i)
+					batch[i] = pool.create(message{ i + t, {} });
+				for (size_t i = 0; i < k_batch; ++i)
+				{
+					sum += batch[i]->id;
+					pool.destroy(batch[i]);
+				}
+			}
+			membench::g_sink += sum;
+		});
+		const double pairs = double(threads) * k_rounds * k_batch / 1e6;
+		printf("%8u %12.1f %12.1f\n", threads, pairs / heap, pairs / pooled);
+	}
+	printf("\n");
+}
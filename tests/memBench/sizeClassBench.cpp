@@ -0,0 +1,49 @@
+#include "bench.h"
+#include "libnew.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+	// Batches of 16-256 byte objects allocated and freed per thread
+	template <typename Alloc, typename Free>
+	double pairs_per_second(unsigned threads, Alloc alloc, Free release)
+	{
+		const size_t k_batch = 64, k_rounds = 20000;
+		const double seconds = membench::run_threads(threads, [=](unsigned t) {
+			void* blocks[k_batch];
+			uint64_t sum = 0;
+			for (size_t r = 0; r < k_rounds; ++r)
+			{
+				for (size_t i = 0; i < k_batch; ++i)
+					blocks[i] = alloc(16 + ((i * 7 + t) % 16) * 16);
+				for (size_t i = 0; i < k_batch; ++i)
+				{
+					sum += (uintptr_t)blocks[i];
+					release(blocks[i]);
+				}
+			}
+			membench::g_sink += sum;
+		});
+		return threads * k_rounds * k_batch / seconds / 1e6;
+	}
+}
+
+// The built-in thread-caching allocator against the CRT heap, called
+// directly and installed behind cdtAlloc
+void sizeClassBench()
+{
+	printf("16-256 byte alloc/free pairs, M/s over all threads\n");
+	printf("%8s %12s %12s %12s\n", "threads", "malloc", "threadcache", "cdtAlloc");
+	for (unsigned threads : { 1u, 2u, 4u, 8u })
+	{
+		const double crt = pairs_per_second(threads, malloc, free);
+		const double cached = pairs_per_second(threads, codetools::ThreadCacheAlloc, codetools::ThreadCacheFree);
+		codetools::SetAllocator(codetools::ThreadCacheAlloc, codetools::ThreadCacheFree);
+		const double redirected = pairs_per_second(threads, codetools::Alloc, codetools::Dealloc);
+		codetools::SetAllocator(nullptr, nullptr);
+		printf("%8u %12.1f %12.1f %12.1f\n", threads, crt, cached, redirected);
+	}
+	printf("\n");
+}
@@ -0,0 +1,44 @@
+#include "bench.h"
+#include "libnew.h"
+
+#include <cstdio>
+
+// cdtAlloc/cdtDealloc from several threads at once: small objects allocated
+// in batches and freed, as a request handler would
+void threadAllocBench()
+{
+	const size_t k_batch = 64, k_rounds = 20000;
+
+	printf("cdtAlloc/cdtDealloc pairs, M/s over all threads\n");
+	printf("%8s %12s %12s\n", "threads", "untracked", "tracked");
+	for (unsigned threads : { 1u, 2u, 4u, 8u })
+	{
+		double rate[2];
+		for (int tracked = 0; tracked < 2; ++tracked)
+		{
+			const size_t rounds = tracked ? k_rounds / 10 : k_rounds;
+			if (tracked)
+				codetools::BeginTrackAllocs();
+			const double seconds = membench::run_threads(threads, [=](unsigned t) {
+				void* blocks[k_batch];
+				uint64_t sum = 0;
+				for (size_t r = 0; r < rounds; ++r)
+				{
+					for (size_t i = 0; i < k_batch; ++i)
+						blocks[i] = codetools::Alloc(16 + ((i * 7 + t) % 16) * 16);
+					for (size_t i = 0; i < k_batch; ++i)
+					{
+						sum += (uintptr_t)blocks[i];
+						codetools::Dealloc(blocks[i]);
+					}
+				}
+				membench::g_sink += sum;
+			});
+			if (tracked)
+				codetools::EndTrackAllocs();
+			rate[tracked] = threads * rounds * k_batch / seconds / 1e6;
+		}
+		printf("%8u %12.1f %12.1f\n", threads, rate[0], rate[1]);
+	}
+	printf("\n");
+}
@@ -0,0 +1,102 @@
+#include "bench.h"
+#include "libnew.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+	// One cache line per node, so every hop misses the cache either way and
+	// the difference left is the page walk
+	struct Node
+	{
+		Node* next;
+		char pad[64 - sizeof(Node*)];
+	};
+
+	// Links the nodes into a single cycle in random order
+	Node* link(Node* nodes, size_t count)
+	{
+		std::vector<size_t> order(count);
+		for (size_t i = 0; i < count; ++i)
+			order[i] = i;
+		uint64_t rng = 0x9E3779B97F4A7C15ull;
+		for (size_t i = count - 1; i > 0; --i)
+		{
+			rng ^= rng << 13;
+			rng ^= rng >> 7;
+			rng ^= rng << 17;
+			const size_t j = size_t(rng % (i + 1));
+			const size_t t = order[i];
+			order[i] = order[j];
+			order[j] = t;
+		}
+		for (size_t i = 0; i < count; ++i)
+			nodes[order[i]].next = &nodes[order[(i + 1) % count]];
+		return &nodes[order[0]];
+	}
+
+	double ns_per_hop(Node* start, size_t hops)
+	{
+		typedef std::chrono::steady_clock clock;
+		const clock::time_point begin = clock::now();
+		Node* p = start;
+		for (size_t i = 0; i < hops; ++i)
+			p = p->next;
+		const double seconds = std::chrono::duration<double>(clock::now() - begin).count();
+		membench::g_sink += (uintptr_t)p;
+		return seconds * 1e9 / hops;
+	}
+
+	const char* backing(const codetools::MemoryStats& before, const codetools::MemoryStats& after)
+	{
+		if (after.huge_page_bytes > before.huge_page_bytes)
+			return "explicit";
+		if (after.transparent_huge_bytes > before.transparent_huge_bytes)
+			return "transparent";
+		return "none";
+	}
+}
+
+// A random walk over an index-sized working set, on ordinary pages from
+// malloc and on huge pages from HugePageAlloc
+void tlbBench()
+{
+	const size_t k_hops = 8 * 1000 * 1000;
+
+	printf("random pointer chase, ns per hop\n");
+	printf("%10s %12s %12s %12s\n", "MB", "small pages", "huge pages", "huge kind");
+	for (size_t mb : { 4u, 32u, 256u, 1024u })
+	{
+		const size_t bytes = mb << 20, count = bytes / sizeof(Node);
+
+		// Page aligned and kept off transparent huge pages, for a fair baseline
+		char* raw = (char*)malloc(bytes + 4096);
+		if (!raw)
+			break;
+		Node* small = (Node*)((uintptr_t(raw) + 4095) & ~uintptr_t(4095));
+#if defined(__linux__) && defined(MADV_NOHUGEPAGE)
+		madvise(small, bytes, MADV_NOHUGEPAGE);
+#endif
+		const double smallNs = ns_per_hop(link(small, count), k_hops);
+		free(raw);
+
+		codetools::MemoryStats before, after;
+		codetools::GetMemoryStatistics(&before);
+		Node* huge = (Node*)codetools::HugePageAlloc(bytes);
+		codetools::GetMemoryStatistics(&after);
+		if (!huge)
+			break;
+		const double hugeNs = ns_per_hop(link(huge, count), k_hops);
+		codetools::HugePageFree(huge);
+
+		printf("%10u %12.1f %12.1f %12s\n", unsigned(mb), smallNs, hugeNs, backing(before, after));
+	}
+	printf("\n");
+}
@@ -0,0 +1,122 @@
+#include "../common/smoke.h"
+#include "libnew.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	using smoke::check;
+
+	// Mixed sizes and alignments across several blocks, contents intact
+	int fill()
+	{
+		int failures = 0;
+		codetools::Arena arena(1024);
+		std::vector<std::pair<unsigned char*, size_t>> blocks;
+		bool aligned = true;
+		for (size_t i = 0; i < 2000; ++i)
+		{
+			const size_t size = 1 + (i * 37) % 200;
+			const size_t alignment = size_t(1) << (i % 7);
+			unsigned char* p = (unsigned char*)arena.allocate(size, alignment);
+			failures += check(p != nullptr, "arena allocation succeeds");
+			if (!p)
+				break;
+			aligned = aligned && (uintptr_t(p) & (alignment - 1)) == 0;
+			memset(p, int(i & 0xFF), size);
+			blocks.push_back(std::make_pair(p, i));
+		}
+		bool intact = true;
+		for (const auto& b : blocks)
+		{
+			const size_t size = 1 + (b.second * 37) % 200;
+			for (size_t j = 0; j < size; ++j)
+				intact = intact && b.first[j] == (b.second & 0xFF);
+		}
+		failures += check(aligned, "arena allocations honour alignment");
+		failures += check(intact, "arena allocations do not overlap");
+		return failures;
+	}
+
+	// Reset hands out the same memory again; oversized and over-aligned
+	// requests work
+	int reset()
+	{
+		int failures = 0;
+		codetools::Arena arena(4096);
+		void* first = arena.allocate(64);
+		for (int i = 0; i < 1000; ++i)
+			arena.allocate(100);
+		void* big = arena.allocate(100000);
+		failures += check(big != nullptr, "arena oversized allocation");
+		if (big)
+			memset(big, 0, 100000);
+		void* page = arena.allocate(16, 4096);
+		failures += check(page && (uintptr_t(page) & 4095) == 0, "arena page-aligned allocation");
+		arena.reset();
+		failures += check(arena.allocate(64) == first, "arena reset reuses the first block");
+		failures += check(codetools::ArenaAlloc(arena.get(), 8, 3) == nullptr, "arena rejects non power of two alignment");
+		return failures;
+	}
+
+	// The inline fast path validates alignment as ArenaAlloc does
+	int inline_alignment()
+	{
+		int failures = 0;
+		codetools::Arena arena(4096);
+		arena.allocate(1);
+		void* p = arena.allocate(24, 0);
+		failures += check(p && (uintptr_t(p) % alignof(std::max_align_t)) == 0, "Arena::allocate alignment 0 is the default");
+		failures += check(arena.allocate(8, 3) == nullptr, "Arena::allocate rejects non power of two alignment");
+		void* q = arena.allocate(24);
+		failures += check(q && (char*)q >= (char*)p + 24 && (uintptr_t(q) % alignof(std::max_align_t)) == 0,
+			"Arena::allocate continues after rejected alignments");
+		return failures;
+	}
+
+	// The C interface, including null handles
+	int c_api()
+	{
+		int failures = 0;
+		cdtArena* arena = cdtArenaCreate(0);
+		failures += check(arena != nullptr, "cdtArenaCreate");
+		void* p = cdtArenaAlloc(arena, 24, 0);
+		failures += check(p && (uintptr_t(p) % alignof(std::max_align_t)) == 0, "cdtArenaAlloc default alignment");
+		cdtArenaReset(arena);
+		cdtArenaDestroy(arena);
+		failures += check(cdtArenaAlloc(nullptr, 8, 0) == nullptr, "cdtArenaAlloc on null arena");
+		cdtArenaReset(nullptr);
+		cdtArenaDestroy(nullptr);
+		return failures;
+	}
+
+#ifdef CTMEMORY_HAS_PMR
+	int pmr()
+	{
+		codetools::Arena arena;
+		codetools::ArenaResource resource(arena);
+		std::pmr::vector<int> values(&resource);
+		for (int i = 0; i < 10000; ++i)
+			values.push_back(i);
+		bool intact = true;
+		for (int i = 0; i < 10000; ++i)
+			intact = intact && values[i] == i;
+		return check(intact, "pmr vector on an arena");
+	}
+#endif
+}
+
+int arenaSmokeTest()
+{
+	int failures = 0;
+	failures += fill();
+	failures += reset();
+	failures += inline_alignment();
+	failures += c_api();
+#ifdef CTMEMORY_HAS_PMR
+	failures += pmr();
+#endif
+	return failures;
+}
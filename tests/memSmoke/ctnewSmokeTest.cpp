@@ -0,0 +1,85 @@
+#include "../common/smoke.h"
+#include "libnew.h"
+
+#include <cstdint>
+#include <new>
+
+namespace
+{
+	using smoke::check;
+
+	size_t deallocated_bytes()
+	{
+		codetools::MemoryStats stats;
+		codetools::GetMemoryStatistics(&stats);
+		return stats.bytes_deallocated;
+	}
+
+	int failure_forms()
+	{
+		int failures = 0;
+		const size_t huge = ~size_t(0) / 2;
+		void* p = operator new(huge, std::nothrow);
+		failures += check(p == nullptr, "nothrow new returns nullptr when memory is exhausted");
+		bool threw = false;
+		try
+		{
+			p = operator new(huge);
+		}
+		catch (const std::bad_alloc&)
+		{
+			threw = true;
+		}
+		failures += check(threw, "new throws bad_alloc when memory is exhausted");
+		p = operator new[](0, std::nothrow);
+		failures += check(p != nullptr, "nothrow new of zero bytes");
+		operator delete[](p, std::nothrow);
+		return failures;
+	}
+
+	// Sized release keeps the statistics without tracking
+	int sized()
+	{
+		const size_t before = deallocated_bytes();
+		void* p = operator new(100);
+		operator delete(p, size_t(100));
+		return check(deallocated_bytes() - before == 100, "sized delete counts the deallocation");
+	}
+
+	int aligned()
+	{
+		int failures = 0;
+		void* p = codetools::AllocAligned(100, 256);
+		failures += check(p && (uintptr_t(p) & 255) == 0, "AllocAligned honours alignment");
+		const size_t before = deallocated_bytes();
+		codetools::DeallocAligned(p, 100, 256);
+		failures += check(deallocated_bytes() - before == 100, "DeallocAligned counts the deallocation");
+
+		codetools::BeginTrackAllocs();
+		p = codetools::AllocAligned(40, 128);
+		const size_t tracked = codetools::GetAllocationInfo(nullptr, 0);
+		codetools::DeallocAligned(p, 0, 128);
+		failures += check(tracked == 1 && codetools::GetAllocationInfo(nullptr, 0) == 0,
+			"aligned allocations are tracked and released");
+		codetools::EndTrackAllocs();
+
+#ifdef __cpp_aligned_new
+		struct alignas(64) line { char bytes[64]; };
+		line* lines = new line[3];
+		line* single = new line;
+		failures += check((uintptr_t(lines) & 63) == 0 && (uintptr_t(single) & 63) == 0, "aligned new");
+		delete single;
+		delete[] lines;
+#endif
+		return failures;
+	}
+}
+
+int ctnewSmokeTest()
+{
+	int failures = 0;
+	failures += failure_forms();
+	failures += sized();
+	failures += aligned();
+	return failures;
+}
@@ -0,0 +1,150 @@
+#include "../common/smoke.h"
+#include "libnew.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	using smoke::check;
+
+	int s_lastError;
+	void* s_lastBlock;
+
+	void LIBNEWCALL on_error(int error, void* block, size_t)
+	{
+		s_lastError = error;
+		s_lastBlock = block;
+	}
+
+	void set_options(int mode, size_t alignment, unsigned sampleRate)
+	{
+		const codetools::GuardOptions options = { mode, alignment, sampleRate, 0, on_error };
+		codetools::SetGuardOptions(&options);
+	}
+
+	// Blocks sit against their guard page as configured and are usable
+	int placement()
+	{
+		int failures = 0;
+		set_options(LIBNEW_GUARD_OVERFLOW, 1, 1);
+		unsigned char* p = (unsigned char*)codetools::GuardAlloc(1000);
+		failures += check(p && (uintptr_t(p + 1000) & 4095) == 0, "overflow blocks end at a page boundary");
+		if (p)
+			memset(p, 0x11, 1000);
+		codetools::GuardFree(p);
+
+		set_options(LIBNEW_GUARD_UNDERFLOW, 0, 1);
+		p = (unsigned char*)codetools::GuardAlloc(5000);
+		failures += check(p && (uintptr_t(p) & 4095) == 0, "underflow blocks start at a page boundary");
+		if (p)
+			memset(p, 0x22, 5000);
+		codetools::GuardFree(p);
+
+		set_options(LIBNEW_GUARD_OVERFLOW, 0, 1);
+		p = (unsigned char*)codetools::GuardAlloc(13);
+		failures += check(p && (uintptr_t(p) & (alignof(std::max_align_t) - 1)) == 0, "guarded blocks are aligned");
+		codetools::GuardFree(p);
+		codetools::GuardFree(nullptr);
+		failures += check(s_lastError == 0, "clean blocks free without errors");
+		return failures;
+	}
+
+	// Writes into the alignment slack and double frees are reported
+	int errors()
+	{
+		int failures = 0;
+		set_options(LIBNEW_GUARD_OVERFLOW, 0, 1);
+		unsigned char* p = (unsigned char*)codetools::GuardAlloc(13);
+		if (!p)
+			return check(false, "guarded allocation succeeds");
+		p[13] = 0;
+		codetools::GuardFree(p);
+		failures += check(s_lastError == LIBNEW_GUARD_SLACK_DAMAGED && s_lastBlock == p, "a write past the block is reported");
+		s_lastError = 0;
+		codetools::GuardFree(p);
+		failures += check(s_lastError == LIBNEW_GUARD_BAD_FREE, "a double free is reported");
+		s_lastError = 0;
+		return failures;
+	}
+
+	// About one allocation in sampleRate is guarded, the rest pass to malloc
+	int sampling()
+	{
+		set_options(LIBNEW_GUARD_OVERFLOW, 0, 8);
+		codetools::GuardStats before, after;
+		codetools::GetGuardStatistics(&before);
+		for (int i = 0; i < 4000; ++i)
+			codetools::GuardFree(codetools::GuardAlloc(64));
+		codetools::GetGuardStatistics(&after);
+		const size_t guarded = after.guarded - before.guarded;
+		return check(guarded > 250 && guarded < 750 && after.live == before.live, "sampled guarding");
+	}
+
+	// Through SetAllocator, as a debugging session would use it
+	int allocator()
+	{
+		set_options(LIBNEW_GUARD_OVERFLOW, 0, 1);
+		codetools::SetAllocator(codetools::GuardAlloc, codetools::GuardFree);
+		codetools::GuardStats before, after;
+		codetools::GetGuardStatistics(&before);
+		void* p = codetools::Alloc(100);
+		codetools::GetGuardStatistics(&after);
+		codetools::Dealloc(p);
+		codetools::SetAllocator(nullptr, nullptr);
+		return check(after.live == before.live + 1, "SetAllocator routes allocations to the guard allocator");
+	}
+
+#ifndef _WIN32
+	// True if fn kills a child process with SIGSEGV
+	template <class Fn>
+	bool faults(Fn fn)
+	{
+		const pid_t child = fork();
+		if (child == 0)
+		{
+			fn();
+			_exit(0);
+		}
+		int status = 0;
+		return child > 0 && waitpid(child, &status, 0) == child && WIFSIGNALED(status) &&
+			(WTERMSIG(status) == SIGSEGV || WTERMSIG(status) == SIGBUS);
+	}
+
+	int protection()
+	{
+		int failures = 0;
+		set_options(LIBNEW_GUARD_OVERFLOW, 1, 1);
+		volatile char* p = (volatile char*)codetools::GuardAlloc(100);
+		failures += check(faults([=]() { p[100] = 1; }), "writing past a block faults");
+		codetools::GuardFree((void*)p);
+		failures += check(faults([=]() { p[0] = 1; }), "writing a freed block faults");
+
+		set_options(LIBNEW_GUARD_UNDERFLOW, 0, 1);
+		p = (volatile char*)codetools::GuardAlloc(100);
+		failures += check(faults([=]() { p[-1] = 1; }), "writing before a block faults");
+		codetools::GuardFree((void*)p);
+		return failures;
+	}
+#endif
+}
+
+int guardSmokeTest()
+{
+	int failures = 0;
+	failures += placement();
+	failures += errors();
+	failures += sampling();
+	failures += allocator();
+#ifndef _WIN32
+	failures += protection();
+#endif
+	codetools::SetGuardOptions(nullptr);
+	return failures;
+}
@@ -0,0 +1,76 @@
+#include "../common/smoke.h"
+#include "libnew.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	using smoke::check;
+
+	const size_t k_blocks = 2000, k_blockSize = 1000, k_period = 4096;
+
+	void allocate_blocks(std::vector<void*>& blocks)
+	{
+		for (void*& p : blocks)
+			p = codetools::Alloc(k_blockSize);
+	}
+
+	bool read_header(const char* path, size_t counts[4], size_t& period, bool& mapped)
+	{
+		FILE* in = nullptr;
+#ifdef _MSC_VER
+		if (fopen_s(&in, path, "r"))
+			in = nullptr;
+#else
+		in = fopen(path, "r");
+#endif
+		if (!in)
+			return false;
+		char line[4096];
+		bool parsed = fgets(line, sizeof(line), in) &&
+#ifdef _MSC_VER
+			sscanf_s(line, "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu",
+#else
+			sscanf(line, "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu",
+#endif
+				&counts[0], &counts[1], &counts[2], &counts[3], &period) == 5;
+		mapped = false;
+		while (fgets(line, sizeof(line), in))
+			mapped = mapped || strncmp(line, "MAPPED_LIBRARIES:", 17) == 0;
+		fclose(in);
+		return parsed;
+	}
+}
+
+int heapSamplerSmokeTest()
+{
+	int failures = 0;
+	const char* k_path = "heap_sampler_smoke.prof";
+	std::vector<void*> blocks(k_blocks);
+
+	codetools::BeginHeapSampling(k_period);
+	allocate_blocks(blocks);
+	for (size_t i = 0; i < k_blocks; i += 2)
+		codetools::Dealloc(blocks[i]);
+	failures += check(codetools::WriteHeapProfile(k_path) != 0, "WriteHeapProfile");
+	codetools::EndHeapSampling();
+	for (size_t i = 1; i < k_blocks; i += 2)
+		codetools::Dealloc(blocks[i]);
+
+	// Each block is sampled with probability 1 - exp(-1000/4096), about 0.22,
+	// so some 430 of the 2000; the bounds are many deviations wide
+	size_t counts[4] = { 0 }, period = 0;
+	bool mapped = false;
+	failures += check(read_header(k_path, counts, period, mapped), "heap profile header");
+	failures += check(period == k_period, "heap profile records the sampling period");
+	failures += check(counts[2] > 300 && counts[2] < 600, "heap sampling rate");
+	failures += check(counts[3] >= counts[2] * k_blockSize, "heap profile allocated bytes");
+	failures += check(counts[0] > counts[2] / 4 && counts[0] < counts[2] * 3 / 4, "freed samples leave the in-use count");
+	failures += check(mapped, "heap profile lists mapped modules");
+	remove(k_path);
+
+	failures += check(codetools::WriteHeapProfile(nullptr) == 0, "WriteHeapProfile rejects a null path");
+	return failures;
+}
@@ -0,0 +1,86 @@
+#include "../common/smoke.h"
+#include "libnew.h"
+
+#include <vector>
+
+namespace
+{
+	using smoke::check;
+
+	void* leak_small() { return codetools::Alloc(64); }
+	void* leak_large() { return codetools::Alloc(256); }
+
+	size_t stack_bytes(const codetools::HeapDiff* diff)
+	{
+		size_t bytes = 0;
+		for (size_t i = 0; i < diff->stackGroups; ++i)
+			bytes += diff->byStack[i].bytes;
+		return bytes;
+	}
+}
+
+int heapSnapshotSmokeTest()
+{
+	int failures = 0;
+	std::vector<void*> kept;
+	kept.reserve(64);
+
+	codetools::BeginTrackAllocs();
+	const codetools::HeapSnapshot start = codetools::TakeHeapSnapshot();
+	for (int i = 0; i < 10; ++i)
+		kept.push_back(leak_small());
+	for (int i = 0; i < 5; ++i)
+		codetools::Dealloc(codetools::Alloc(128));
+	const codetools::HeapSnapshot middle = codetools::TakeHeapSnapshot();
+
+	codetools::TrackAllocStacks(1);
+	for (int i = 0; i < 3; ++i)
+		kept.push_back(leak_large());
+	for (int i = 0; i < 2; ++i)
+		kept.push_back(leak_small());
+	codetools::TrackAllocStacks(0);
+	const codetools::HeapSnapshot end = codetools::TakeHeapSnapshot();
+
+	codetools::HeapDiff* first = codetools::DiffHeapSnapshots(&start, &middle);
+	failures += check(first != nullptr, "DiffHeapSnapshots");
+	if (first)
+	{
+		failures += check(first->count == 10 && first->bytes == 640, "diff holds only surviving allocations");
+		failures += check(first->sizeGroups == 1 && first->bySize[0].size == 64 && first->bySize[0].count == 10,
+			"diff groups by size");
+		failures += check(first->stackGroups == 0, "no stack groups without stack capture");
+		codetools::ReleaseHeapDiff(first);
+	}
+
+	codetools::HeapDiff* second = codetools::DiffHeapSnapshots(&middle, &end);
+	if (second)
+	{
+		failures += check(second->count == 5 && second->bytes == 3 * 256 + 2 * 64, "second interval");
+		failures += check(second->sizeGroups == 2 && second->bySize[0].size == 256 && second->bySize[0].bytes == 768,
+			"size groups sorted by bytes");
+		// At least one stack per call site; unrolled loops may add more
+		failures += check(second->stackGroups >= 2 && second->stackGroups <= 5 && stack_bytes(second) == second->bytes &&
+			second->byStack[0].depth > 0, "diff groups by call stack");
+		codetools::ReleaseHeapDiff(second);
+	}
+	else
+		failures += check(false, "DiffHeapSnapshots");
+
+	codetools::HeapDiff* all = codetools::DiffHeapSnapshots(nullptr, nullptr);
+	if (all)
+	{
+		failures += check(all->count >= 15, "null snapshots span all of tracking");
+		codetools::ReleaseHeapDiff(all);
+	}
+
+	for (void* p : kept)
+		codetools::Dealloc(p);
+	codetools::HeapDiff* freed = codetools::DiffHeapSnapshots(&start, &end);
+	if (freed)
+	{
+		failures += check(freed->count == 0 && freed->sizeGroups == 0, "freed allocations leave the diff");
+		codetools::ReleaseHeapDiff(freed);
+	}
+	codetools::EndTrackAllocs();
+	return failures;
+}
@@ -0,0 +1,84 @@
+#include "../common/smoke.h"
+#include "libnew.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	using smoke::check;
+
+	size_t huge_total(const codetools::MemoryStats& s)
+	{
+		return s.huge_page_bytes + s.transparent_huge_bytes + s.huge_fallback_bytes;
+	}
+
+	// Large requests are mapped in whole huge pages, whatever the system
+	// provides; small ones pass through to malloc
+	int mappings()
+	{
+		int failures = 0;
+		const size_t huge = codetools::HugePageSize();
+		failures += check(huge && !(huge & (huge - 1)), "huge page size is a power of two");
+
+		codetools::MemoryStats before, during, after;
+		codetools::GetMemoryStatistics(&before);
+		unsigned char* big = (unsigned char*)codetools::HugePageAlloc(huge + 1);
+		unsigned char* small = (unsigned char*)codetools::HugePageAlloc(100);
+		codetools::GetMemoryStatistics(&during);
+		failures += check(big != nullptr && small != nullptr, "huge page allocations succeed");
+		if (!big || !small)
+			return failures;
+		failures += check((uintptr_t(big) & (huge - 1)) == 0, "huge page blocks are aligned to a huge page");
+		failures += check(huge_total(during) - huge_total(before) == 2 * huge, "huge page blocks fill whole huge pages");
+		memset(big, 0x5A, huge + 1);
+		memset(small, 0xA5, 100);
+		failures += check(big[0] == 0x5A && big[huge] == 0x5A && small[99] == 0xA5, "huge page blocks are writable");
+		codetools::HugePageFree(big);
+		codetools::HugePageFree(small);
+		codetools::HugePageFree(nullptr);
+		codetools::GetMemoryStatistics(&after);
+		failures += check(huge_total(after) == huge_total(before), "freeing returns the huge pages");
+		return failures;
+	}
+
+	int arena()
+	{
+		int failures = 0;
+		codetools::MemoryStats before, during, after;
+		codetools::GetMemoryStatistics(&before);
+		{
+			codetools::Arena region(0, true);
+			bool intact = true;
+			unsigned* values[5000];
+			for (unsigned i = 0; i < 5000; ++i)
+			{
+				values[i] = (unsigned*)region.allocate(1000);
+				if (values[i])
+					*values[i] = i;
+			}
+			for (unsigned i = 0; i < 5000; ++i)
+				intact = intact && values[i] && *values[i] == i;
+			failures += check(intact, "huge page arena allocations do not overlap");
+			codetools::GetMemoryStatistics(&during);
+			failures += check(huge_total(during) - huge_total(before) >= 3 * codetools::HugePageSize(),
+				"huge page arena blocks are on huge pages");
+			failures += check(during.bytes_allocated - before.bytes_allocated >= 5000 * 1000,
+				"huge page arena blocks are counted");
+			region.reset();
+		}
+		codetools::GetMemoryStatistics(&after);
+		failures += check(huge_total(after) == huge_total(before), "destroying a huge page arena frees its blocks");
+		failures += check(after.bytes_deallocated - before.bytes_deallocated >= 5000 * 1000,
+			"huge page arena blocks leave the statistics");
+		return failures;
+	}
+}
+
+int hugePageSmokeTest()
+{
+	int failures = 0;
+	failures += mappings();
+	failures += arena();
+	return failures;
+}
@@ -0,0 +1,26 @@
+int threadCacheSmokeTest();
+int arenaSmokeTest();
+int objectPoolSmokeTest();
+int ctnewSmokeTest();
+int heapSamplerSmokeTest();
+int statsSmokeTest();
+int heapSnapshotSmokeTest();
+int hugePageSmokeTest();
+int traceSmokeTest();
+int guardSmokeTest();
+
+int main()
+{
+	int failures = 0;
+	failures += threadCacheSmokeTest();
+	failures += arenaSmokeTest();
+	failures += objectPoolSmokeTest();
+	failures += ctnewSmokeTest();
+	failures += heapSamplerSmokeTest();
+	failures += statsSmokeTest();
+	failures += heapSnapshotSmokeTest();
+	failures += hugePageSmokeTest();
+	failures += traceSmokeTest();
+	failures += guardSmokeTest();
+	return failures;
+}
@@ -0,0 +1,120 @@
+#include "../common/smoke.h"
+#include "object_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using smoke::check;
+
+	struct tracked
+	{
+		static std::atomic<int> live;
+		explicit tracked(uint64_t v) : value(v) { ++live; }
+		~tracked() { --live; }
+		uint64_t value;
+		double pad[3];
+	};
+	std::atomic<int> tracked::live(0);
+
+	// Construction, destruction and reuse across several slabs
+	int basic()
+	{
+		int failures = 0;
+		codetools::object_pool<tracked> pool;
+		std::vector<tracked*> objects;
+		for (uint64_t i = 0; i < 5000; ++i)
+			objects.push_back(pool.create(i));
+		failures += check(tracked::live == 5000, "object_pool constructs objects");
+		bool intact = true, aligned = true;
+		for (size_t i = 0; i < objects.size(); ++i)
+		{
+			intact = intact && objects[i]->value == i;
+			aligned = aligned && (uintptr_t(objects[i]) % alignof(tracked)) == 0;
+		}
+		failures += check(intact, "object_pool objects do not overlap");
+		failures += check(aligned, "object_pool objects are aligned");
+
+		tracked* last = objects.back();
+		for (tracked* p : objects)
+			pool.destroy(p);
+		failures += check(tracked::live == 0, "object_pool destroys objects");
+		tracked* again = pool.create(1);
+		failures += check(again == last, "object_pool reuses the most recently freed object");
+		pool.destroy(again);
+		pool.destroy(nullptr);
+		return failures;
+	}
+
+	// Threads taking and returning objects, each checking nobody else holds
+	// what it was given
+	int concurrent()
+	{
+		codetools::object_pool<uint64_t> pool;
+		std::atomic<int> clashes(0);
+		std::vector<std::thread> threads;
+		for (uint64_t t = 1; t <= 4; ++t)
+			threads.emplace_back([&pool, &clashes, t] {
+				uint64_t* held[32];
+				for (int round = 0; round < 2000; ++round)
+				{
+					for (uint64_t*& p : held)
+					{
+						p = pool.create(t);
+						if (p && *p != t)
+							++clashes;
+					}
+					std::this_thread::yield();
+					for (uint64_t* p : held)
+					{
+						if (p && *p != t)
+							++clashes;
+						pool.destroy(p);
+					}
+				}
+			});
+		for (std::thread& th : threads)
+			th.join();
+		return check(clashes == 0, "object_pool hands each object to one thread at a time");
+	}
+
+	// With CountStats, objects in use appear in the memory statistics
+	int statistics()
+	{
+		int failures = 0;
+		codetools::MemoryStats before, during, after;
+		std::vector<tracked*> objects;
+		objects.reserve(100);
+		codetools::GetMemoryStatistics(&before);
+		{
+			codetools::object_pool<tracked, true> pool;
+			for (uint64_t i = 0; i < 100; ++i)
+				objects.push_back(pool.create(i));
+			codetools::GetMemoryStatistics(&during);
+			for (tracked* p : objects)
+				pool.destroy(p);
+			codetools::GetMemoryStatistics(&after);
+		}
+		failures += check(during.total_allocations - before.total_allocations == 100,
+			"object_pool counts allocations in MemoryStats");
+		failures += check(during.bytes_allocated - before.bytes_allocated == 100 * sizeof(tracked),
+			"object_pool counts allocated bytes in MemoryStats");
+		failures += check(after.total_deallocations - before.total_deallocations == 100,
+			"object_pool counts deallocations in MemoryStats");
+		failures += check(after.bytes_deallocated - before.bytes_deallocated == 100 * sizeof(tracked),
+			"object_pool counts deallocated bytes in MemoryStats");
+		return failures;
+	}
+}
+
+int objectPoolSmokeTest()
+{
+	int failures = 0;
+	failures += basic();
+	failures += concurrent();
+	failures += statistics();
+	return failures;
+}
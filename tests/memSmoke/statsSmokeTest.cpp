@@ -0,0 +1,127 @@
+#include "../common/smoke.h"
+#include "libnew.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using smoke::check;
+
+	codetools::TagStats tag_stats(const char* name)
+	{
+		codetools::TagStats result = { name, 0, 0 };
+		std::vector<codetools::TagStats> tags(codetools::GetTagStatistics(nullptr, 0));
+		tags.resize(codetools::GetTagStatistics(tags.data(), tags.size()));
+		for (const codetools::TagStats& t : tags)
+			if (!strcmp(t.name, name))
+				result = t;
+		return result;
+	}
+
+	int counts()
+	{
+		int failures = 0;
+		codetools::MemoryStats before, after;
+		codetools::GetMemoryStatistics(&before);
+		for (int i = 0; i < 10; ++i)
+			codetools::Dealloc(codetools::Alloc(100));
+		codetools::GetMemoryStatistics(&after);
+		failures += check(after.total_allocations - before.total_allocations == 10, "total_allocations counts calls");
+		failures += check(after.bytes_allocated - before.bytes_allocated == 1000, "bytes_allocated sums sizes");
+		failures += check(after.total_deallocations - before.total_deallocations == 10,
+			"total_deallocations counts calls without tracking");
+		return failures;
+	}
+
+	int histogram()
+	{
+		int failures = 0;
+		codetools::SizeHistogram before, after;
+		codetools::GetSizeHistogram(&before);
+		const size_t sizes[] = { 1, 16, 17, 32, 33, 4096, 4097 };
+		for (size_t size : sizes)
+			codetools::Dealloc(codetools::Alloc(size));
+		codetools::GetSizeHistogram(&after);
+
+		failures += check(after.limit[0] == 16 && after.limit[1] == 32 && after.limit[8] == 4096,
+			"histogram bin limits");
+		failures += check(after.limit[LIBNEW_SIZE_BINS - 1] == SIZE_MAX, "last histogram bin is open");
+		const size_t expected[] = { 2, 2, 1, 0, 0, 0, 0, 0, 1, 1 };
+		bool matches = true;
+		for (unsigned i = 0; i < 10; ++i)
+			matches = matches && after.count[i] - before.count[i] == expected[i];
+		failures += check(matches, "histogram counts by size");
+		failures += check(after.bytes[0] - before.bytes[0] == 17 && after.bytes[9] - before.bytes[9] == 4097,
+			"histogram bytes by size");
+		return failures;
+	}
+
+	int tags()
+	{
+		int failures = 0;
+		const unsigned parser = codetools::MemoryTag("stats.parser");
+		char name[] = "stats.parser";
+		failures += check(parser != 0 && codetools::MemoryTag(name) == parser, "tags are found by name");
+
+		const codetools::TagStats parserBefore = tag_stats("stats.parser");
+		const codetools::TagStats lexerBefore = tag_stats("stats.lexer");
+		{
+			codetools::ScopedMemoryTag tag("stats.parser");
+			codetools::Dealloc(codetools::Alloc(300));
+			{
+				codetools::ScopedMemoryTag inner("stats.lexer");
+				codetools::Dealloc(codetools::Alloc(50));
+			}
+			codetools::Dealloc(codetools::Alloc(200));
+		}
+		codetools::Dealloc(codetools::Alloc(700));
+		const codetools::TagStats parserAfter = tag_stats("stats.parser");
+		const codetools::TagStats lexerAfter = tag_stats("stats.lexer");
+
+		unsigned threadTag = parser;
+		{
+			codetools::ScopedMemoryTag tag(parser);
+			std::thread([&threadTag] { threadTag = codetools::SetMemoryTag(0); }).join();
+		}
+		failures += check(threadTag == 0, "tags belong to the thread that set them");
+
+		failures += check(parserAfter.allocations - parserBefore.allocations == 2 &&
+			parserAfter.bytes - parserBefore.bytes == 500, "ScopedMemoryTag attributes allocations");
+		failures += check(lexerAfter.allocations - lexerBefore.allocations == 1 &&
+			lexerAfter.bytes - lexerBefore.bytes == 50, "ScopedMemoryTag nests");
+		failures += check(codetools::SetMemoryTag(12345) == 0 && codetools::SetMemoryTag(0) == 0,
+			"unknown tags fall back to untagged");
+		return failures;
+	}
+
+	int rate()
+	{
+		int failures = 0;
+		codetools::RateCounter counter = {};
+		codetools::AllocationRate since;
+		codetools::SampleAllocationRate(&counter, &since);
+		failures += check(since.seconds > 0 && since.allocations_per_second > 0, "rate since load");
+
+		for (int i = 0; i < 1000; ++i)
+			codetools::Dealloc(codetools::Alloc(64));
+		codetools::AllocationRate step;
+		codetools::SampleAllocationRate(&counter, &step);
+		failures += check(step.seconds > 0, "rate interval");
+		failures += check(step.allocations_per_second * step.seconds > 999.0 &&
+			step.allocations_per_second * step.seconds < 1001.0, "allocation rate covers the interval");
+		failures += check(step.bytes_per_second >= step.allocations_per_second * 63.0, "byte rate");
+		return failures;
+	}
+}
+
+int statsSmokeTest()
+{
+	int failures = 0;
+	failures += counts();
+	failures += histogram();
+	failures += tags();
+	failures += rate();
+	return failures;
+}
@@ -0,0 +1,176 @@
+#include "../common/smoke.h"
+#include "libnew.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using smoke::check;
+
+	// Every size up to the small limit and a little past it: aligned, writable
+	// and not overlapping
+	int sizes()
+	{
+		int failures = 0;
+		std::vector<unsigned char*> blocks;
+		for (size_t size = 1; size <= 4200; size += 7)
+		{
+			unsigned char* p = (unsigned char*)codetools::ThreadCacheAlloc(size);
+			failures += check(p != nullptr, "thread cache allocation succeeds");
+			if (!p)
+				continue;
+			failures += check((uintptr_t(p) & 15) == 0, "thread cache allocations are 16 byte aligned");
+			memset(p, int(size & 0xFF), size);
+			blocks.push_back(p);
+		}
+		size_t size = 1;
+		bool intact = true;
+		for (unsigned char* p : blocks)
+		{
+			for (size_t i = 0; i < size; ++i)
+				intact = intact && p[i] == (size & 0xFF);
+			codetools::ThreadCacheFree(p);
+			size += 7;
+		}
+		failures += check(intact, "thread cache allocations do not overlap");
+		codetools::ThreadCacheFree(nullptr);
+		return failures;
+	}
+
+	// Enough objects of one class to span many spans and overflow the cache,
+	// freed and reallocated
+	int churn()
+	{
+		int failures = 0;
+		std::vector<void*> blocks(20000);
+		for (int round = 0; round < 3; ++round)
+		{
+			for (size_t i = 0; i < blocks.size(); ++i)
+			{
+				blocks[i] = codetools::ThreadCacheAlloc(48);
+				if (blocks[i])
+					*(size_t*)blocks[i] = i;
+			}
+			bool intact = true;
+			for (size_t i = 0; i < blocks.size(); ++i)
+			{
+				intact = intact && blocks[i] && *(size_t*)blocks[i] == i;
+				codetools::ThreadCacheFree(blocks[i]);
+			}
+			failures += check(intact, "thread cache churn keeps contents");
+		}
+		return failures;
+	}
+
+	// Objects allocated on one thread and freed on another, and caches left
+	// behind by exiting threads
+	int cross_thread()
+	{
+		const size_t k_count = 5000;
+		std::vector<void*> blocks(k_count * 4);
+		std::vector<std::thread> threads;
+		for (size_t t = 0; t < 4; ++t)
+			threads.emplace_back([&blocks, t] {
+				for (size_t i = 0; i < k_count; ++i)
+				{
+					void* p = codetools::ThreadCacheAlloc(16 + (i % 64) * 16);
+					if (p)
+						memset(p, int(t), 16);
+					blocks[t * k_count + i] = p;
+				}
+			});
+		for (std::thread& th : threads)
+			th.join();
+		threads.clear();
+
+		bool intact = true;
+		for (size_t i = 0; i < blocks.size(); ++i)
+			intact = intact && blocks[i] && *(unsigned char*)blocks[i] == i / k_count;
+		for (size_t t = 0; t < 4; ++t)
+			threads.emplace_back([&blocks, t] {
+				// Free another thread's objects
+				const size_t from = ((t + 1) % 4) * k_count;
+				for (size_t i = 0; i < k_count; ++i)
+					codetools::ThreadCacheFree(blocks[from + i]);
+			});
+		for (std::thread& th : threads)
+			th.join();
+		return check(intact, "thread cache objects survive their allocating thread");
+	}
+
+	// A thread_local constructed before the thread's cache is destroyed after
+	// it, and may still allocate and free from its destructor
+	const size_t k_lateBlocks = 512;  // more than a cache holds, so the walk reaches the central list
+	bool s_lateDistinct;
+
+	struct LateUser
+	{
+		bool armed = false;
+
+		~LateUser()
+		{
+			if (!armed)
+				return;
+			void* blocks[k_lateBlocks];
+			for (size_t i = 0; i < k_lateBlocks; ++i)
+			{
+				blocks[i] = codetools::ThreadCacheAlloc(32);
+				if (blocks[i])
+					memset(blocks[i], int(i), 32);
+			}
+			std::sort(blocks, blocks + k_lateBlocks);
+			s_lateDistinct = blocks[0] && std::adjacent_find(blocks, blocks + k_lateBlocks) == blocks + k_lateBlocks;
+			for (size_t i = 0; i < k_lateBlocks; ++i)
+				codetools::ThreadCacheFree(blocks[i]);
+		}
+	};
+	thread_local LateUser t_lateUser;
+
+	int after_exit()
+	{
+		s_lateDistinct = false;
+		std::thread([] {
+			t_lateUser.armed = true;
+			// Leave objects of the class in this thread's cache
+			void* blocks[k_lateBlocks];
+			for (size_t i = 0; i < k_lateBlocks; ++i)
+				blocks[i] = codetools::ThreadCacheAlloc(32);
+			for (size_t i = 0; i < k_lateBlocks; ++i)
+				codetools::ThreadCacheFree(blocks[i]);
+		}).join();
+		return check(s_lateDistinct, "thread cache allocations from a TLS destructor are distinct");
+	}
+
+	// The allocator installed behind Alloc/Dealloc
+	int installed()
+	{
+		int failures = 0;
+		codetools::SetAllocator(codetools::ThreadCacheAlloc, codetools::ThreadCacheFree);
+		void* small = codetools::Alloc(100);
+		void* large = codetools::Alloc(100000);
+		failures += check(small && large, "Alloc through the thread cache");
+		if (small)
+			memset(small, 1, 100);
+		if (large)
+			memset(large, 1, 100000);
+		codetools::Dealloc(small);
+		codetools::Dealloc(large);
+		codetools::SetAllocator(nullptr, nullptr);
+		return failures;
+	}
+}
+
+int threadCacheSmokeTest()
+{
+	int failures = 0;
+	failures += sizes();
+	failures += churn();
+	failures += cross_thread();
+	failures += after_exit();
+	failures += installed();
+	return failures;
+}
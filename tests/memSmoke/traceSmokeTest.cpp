@@ -0,0 +1,76 @@
+#include "../common/smoke.h"
+#include "libnew.h"
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using smoke::check;
+
+	const char* const k_path = "traceSmokeTest.trace";
+
+	// Allocations from two threads, one block freed on the other thread,
+	// come back paired and in order
+	int round_trip()
+	{
+		int failures = 0;
+		void* early = codetools::Alloc(8);
+		failures += check(codetools::BeginAllocTrace(k_path) != 0, "trace file opens");
+		void* shared = nullptr;
+		std::thread worker([&]() {
+			for (size_t i = 1; i <= 1000; ++i)
+				codetools::Dealloc(codetools::Alloc(i));
+			shared = codetools::AllocAligned(100, 256);
+		});
+		worker.join();
+		for (size_t i = 0; i < 1000; ++i)
+			codetools::DeallocSized(codetools::Alloc(24), 24);
+		codetools::DeallocAligned(shared, 100, 256);
+		codetools::Dealloc(early);
+		codetools::EndAllocTrace();
+		codetools::Dealloc(codetools::Alloc(8));
+
+		codetools::AllocTrace* trace = codetools::LoadAllocTrace(k_path);
+		failures += check(trace != nullptr, "trace loads");
+		if (!trace)
+			return failures;
+		// std::thread may allocate its state through operator new as well
+		failures += check(trace->count >= 4003, "trace holds every call made while recording");
+		failures += check(trace->blocks >= 2001 && trace->threads == 2, "trace counts blocks and threads");
+
+		bool ordered = true, paired = true;
+		std::vector<size_t> sizes(size_t(trace->blocks), 0);
+		size_t unknown = 0, aligned = 0;
+		for (size_t i = 0; i < trace->count; ++i)
+		{
+			const codetools::TraceEvent& e = trace->events[i];
+			ordered = ordered && (!i || e.ticks >= trace->events[i - 1].ticks);
+			if (e.op == LIBNEW_TRACE_ALLOC)
+			{
+				sizes[size_t(e.block)] = e.size;
+				aligned += e.alignment == 256;
+			}
+			else if (e.block == LIBNEW_TRACE_UNKNOWN)
+				++unknown;
+			else
+				paired = paired && (e.size == 0 || e.size == sizes[size_t(e.block)]);
+		}
+		failures += check(ordered, "trace events are in time order");
+		failures += check(paired, "frees name the block they release");
+		failures += check(unknown == 1, "blocks from before the trace are unknown");
+		failures += check(aligned == 1, "trace keeps the alignment");
+		codetools::ReleaseAllocTrace(trace);
+		remove(k_path);
+		return failures;
+	}
+}
+
+int traceSmokeTest()
+{
+	int failures = 0;
+	failures += round_trip();
+	failures += check(codetools::LoadAllocTrace("no such trace") == nullptr, "a missing trace does not load");
+	return failures;
+}
@@ -0,0 +1,100 @@
+// fingerprint -- writes a manifest of content hashes for a directory tree
+//
+//   fingerprint [-a spooky|md5|crc32c] [-j threads] [-b blockKB] [-o manifest] root
+//
+// The manifest goes to stdout unless -o is given; a summary with the
+// throughput goes to stderr.
+#include "hashTools/fingerprint.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace codetools::hashtools;
+
+namespace
+{
+	struct summary
+	{
+		FILE* out;
+		uint64_t bytes;
+		uint64_t errors;
+	};
+
+	void record(void* context, const fingerprint_entry& entry)
+	{
+		summary* s = (summary*)context;
+		write_fingerprint_entry(s->out, entry);
+		s->bytes += entry.size;
+		s->errors += entry.error != 0;
+	}
+
+	int usage()
+	{
+		fprintf(stderr, "usage: fingerprint [-a spooky|md5|crc32c] [-j threads] [-b blockKB] [-o manifest] root\n");
+		return 2;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	fingerprint_options options;
+	const char* output = 0;
+	const char* root = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "-a") == 0 && hasValue)
+		{
+			const char* name = argv[++i];
+			if (strcmp(name, "spooky") == 0)
+				options.hash = fingerprint_hash::spooky_128;
+			else if (strcmp(name, "md5") == 0)
+				options.hash = fingerprint_hash::md5;
+			else if (strcmp(name, "crc32c") == 0)
+				options.hash = fingerprint_hash::crc32c;
+			else
+				return usage();
+		}
+		else if (strcmp(argv[i], "-j") == 0 && hasValue)
+			options.threads = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-b") == 0 && hasValue)
+			options.blockSize = (uint32_t)atoi(argv[++i]) * 1024;
+		else if (strcmp(argv[i], "-o") == 0 && hasValue)
+			output = argv[++i];
+		else if (argv[i][0] == '-' || root)
+			return usage();
+		else
+			root = argv[i];
+	}
+	if (!root || options.blockSize == 0)
+		return usage();
+
+	summary s = { stdout, 0, 0 };
+	if (output)
+	{
+#ifdef _MSC_VER
+		if (fopen_s(&s.out, output, "w"))
+			s.out = nullptr;
+#else
+		s.out = fopen(output, "w");
+#endif
+	}
+	if (!s.out)
+	{
+		fprintf(stderr, "fingerprint: cannot open %s\n", output);
+		return 1;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	const uint64_t files = fingerprint_tree(root, options, record, &s);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (s.out != stdout)
+		fclose(s.out);
+	fprintf(stderr, "%llu files, %llu bytes, %llu errors, %.3f s, %.1f MB/s\n",
+		(unsigned long long)files, (unsigned long long)s.bytes, (unsigned long long)s.errors,
+		seconds, seconds > 0 ? s.bytes / seconds / 1e6 : 0.0);
+	return s.errors ? 1 : 0;
+}
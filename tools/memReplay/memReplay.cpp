@@ -0,0 +1,222 @@
+// memReplay -- reruns a ctMemory allocation trace against an allocator
+//
+//   memReplay [-a malloc|ctmemory|threadcache|hugepage|arena] trace
+//
+// Traces come from cdtBeginAllocTrace, or from any program run under the
+// preload library with CTMEMORY_TRACE set.  Every thread's calls are
+// replayed on one thread in recorded order, each block touched once per
+// page.  The report gives the replay time, the peak of the requested bytes
+// alive at once, the peak resident set the replay added and the share of
+// that not explained by live data.  Run one allocator per process, since
+// the resident peak cannot be rewound everywhere.
+#include "libnew.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	struct allocator
+	{
+		const char* name;
+		void* (*alloc)(size_t size);
+		void (*free)(void* p);
+	};
+
+	codetools::Arena* s_arena;
+
+	void* arena_alloc(size_t size) { return s_arena->allocate(size); }
+	void arena_free(void*) {}
+
+	const allocator k_allocators[] =
+	{
+		{ "malloc", malloc, free },
+		{ "ctmemory", codetools::Alloc, codetools::Dealloc },
+		{ "threadcache", codetools::ThreadCacheAlloc, codetools::ThreadCacheFree },
+		{ "hugepage", codetools::HugePageAlloc, codetools::HugePageFree },
+		{ "arena", arena_alloc, arena_free },
+	};
+
+	const size_t k_page = 4096;
+
+#ifdef _WIN32
+	size_t resident()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+	}
+
+	size_t peak_resident()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+	}
+
+	void reset_peak() {}
+#elif defined(__linux__)
+	// VmRSS or VmHWM from /proc/self/status, in bytes
+	size_t status_field(const char* field)
+	{
+		FILE* f = fopen("/proc/self/status", "r");
+		if (!f)
+			return 0;
+		char line[256];
+		size_t kb = 0;
+		const size_t length = strlen(field);
+		while (fgets(line, sizeof(line), f))
+			if (!strncmp(line, field, length))
+				kb = size_t(strtoull(line + length, nullptr, 10));
+		fclose(f);
+		return kb * 1024;
+	}
+
+	size_t resident() { return status_field("VmRSS:"); }
+	size_t peak_resident() { return status_field("VmHWM:"); }
+
+	// Writing 5 to clear_refs restarts the peak from the current size
+	void reset_peak()
+	{
+		if (FILE* f = fopen("/proc/self/clear_refs", "w"))
+		{
+			fputs("5", f);
+			fclose(f);
+		}
+	}
+#else
+	size_t resident() { return 0; }
+	size_t peak_resident()
+	{
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+		return size_t(usage.ru_maxrss);
+#else
+		return size_t(usage.ru_maxrss) * 1024;
+#endif
+	}
+	void reset_peak() {}
+#endif
+
+	int usage()
+	{
+		fprintf(stderr, "usage: memReplay [-a malloc|ctmemory|threadcache|hugepage|arena] trace\n");
+		return 2;
+	}
+
+	double mb(double bytes) { return bytes / (1024.0 * 1024.0); }
+}
+
+int main(int argc, char** argv)
+{
+	const allocator* chosen = &k_allocators[0];
+	const char* path = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+		{
+			const char* name = argv[++i];
+			chosen = 0;
+			for (const allocator& a : k_allocators)
+				if (strcmp(a.name, name) == 0)
+					chosen = &a;
+			if (!chosen)
+				return usage();
+		}
+		else if (argv[i][0] == '-' || path)
+			return usage();
+		else
+			path = argv[i];
+	}
+	if (!path)
+		return usage();
+
+	codetools::AllocTrace* trace = codetools::LoadAllocTrace(path);
+	if (!trace)
+	{
+		fprintf(stderr, "memReplay: cannot read %s\n", path);
+		return 1;
+	}
+	const double recorded = trace->count && trace->tickFrequency ?
+		double(trace->events[trace->count - 1].ticks) / double(trace->tickFrequency) : 0.0;
+	printf("trace         %s: %zu events, %llu blocks, %u threads over %.3f s\n", path, trace->count,
+		(unsigned long long)trace->blocks, unsigned(trace->threads), recorded);
+
+	// Aligned requests are over-allocated and aligned here, so every
+	// allocator sees them; base is what goes back to it
+	std::vector<void*> base(size_t(trace->blocks), nullptr);
+	std::vector<size_t> sizes(size_t(trace->blocks), 0);
+	codetools::Arena arena(1024 * 1024);
+	s_arena = &arena;
+
+	const size_t before = resident();
+	reset_peak();
+	size_t live = 0, peakLive = 0, failed = 0;
+	typedef std::chrono::steady_clock clock;
+	const clock::time_point start = clock::now();
+	for (size_t i = 0; i < trace->count; ++i)
+	{
+		const codetools::TraceEvent& e = trace->events[i];
+		if (e.block == LIBNEW_TRACE_UNKNOWN)
+			continue;
+		const size_t block = size_t(e.block);
+		if (e.op == LIBNEW_TRACE_ALLOC)
+		{
+			const size_t alignment = e.alignment;
+			char* p = (char*)chosen->alloc(e.size + (alignment ? alignment - 1 : 0));
+			if (!p)
+			{
+				++failed;
+				continue;
+			}
+			base[block] = p;
+			sizes[block] = e.size;
+			if (alignment)
+				p = (char*)((uintptr_t(p) + alignment - 1) & ~uintptr_t(alignment - 1));
+			for (size_t offset = 0; offset < e.size; offset += k_page)
+				p[offset] = 1;
+			if ((live += e.size) > peakLive)
+				peakLive = live;
+		}
+		else if (base[block])
+		{
+			chosen->free(base[block]);
+			base[block] = nullptr;
+			live -= sizes[block];
+		}
+	}
+	const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+	const size_t peak = peak_resident();
+	const size_t after = resident();
+
+	printf("allocator     %s\n", chosen->name);
+	printf("replay        %.4f s, %.2f M events/s\n", seconds, seconds > 0 ? trace->count / seconds / 1e6 : 0.0);
+	printf("peak live     %.2f MB requested\n", mb(double(peakLive)));
+	if (peak > before)
+	{
+		const double added = double(peak - before);
+		const double fragmentation = added > double(peakLive) ? 1.0 - double(peakLive) / added : 0.0;
+		printf("peak resident +%.2f MB\n", mb(added));
+		printf("fragmentation %.1f%%\n", fragmentation * 100);
+	}
+	if (after > before)
+		printf("end resident  +%.2f MB with %.2f MB live\n", mb(double(after - before)), mb(double(live)));
+	if (failed)
+		printf("failed        %zu allocations\n", failed);
+
+	for (size_t b = 0; b < base.size(); ++b)
+		if (base[b])
+			chosen->free(base[b]);
+	codetools::ReleaseAllocTrace(trace);
+	return 0;
+}